@@ -0,0 +1,139 @@
+/**
+  ******************************************************************************
+  * @file    bench_decode.c
+  * @brief   Throughput of the capture decoder on one core, per path.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "digital_io_decode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+/* Defines -------------------------------------*/
+#define BENCH_SAMPLES		(1U << 20)	// 4 MiB of samples: out of L2, like a long capture
+#define BENCH_WORDS			(DIGITAL_IO_DECODE_WORDS(BENCH_SAMPLES))
+#define BENCH_REPORTS		(4096U)
+#define BENCH_TIME			(0.5)		// seconds per measurement
+
+
+/* Private variables -------------------------------------*/
+static uint32_t samples[BENCH_SAMPLES];
+static uint64_t planes[DIGITAL_IO_DECODE_BIT_NUM * BENCH_WORDS];
+static uint64_t edges[DIGITAL_IO_DECODE_BIT_NUM * BENCH_WORDS];
+static uint8_t reports[BENCH_REPORTS][DIGITAL_IO_DECODE_REPORT_SIZE];
+
+
+/* Private functions -------------------------------------*/
+/**
+  * @brief  Monotonic time.
+  * @retval Seconds
+  */
+static double Bench_Now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+/**
+  * @brief  Samples per second of the transpose, the edges and both.
+  * @retval None
+  */
+static void Bench_Path(DIGITAL_IO_Decode_Path path)
+{
+	uint64_t counts[DIGITAL_IO_DECODE_BIT_NUM], total = 0;
+	double start = 0, transpose = 0, edge = 0;
+	uint32_t runs = 0;
+
+	start = Bench_Now();
+	for (runs = 0; Bench_Now() - start < BENCH_TIME; runs++)
+	{
+		DIGITAL_IO_Decode_Transpose(path, samples, BENCH_SAMPLES, planes, BENCH_WORDS);
+	}
+	transpose = (double)runs * BENCH_SAMPLES / (Bench_Now() - start);
+
+	start = Bench_Now();
+	for (runs = 0; Bench_Now() - start < BENCH_TIME; runs++)
+	{
+		total = DIGITAL_IO_Decode_Edges(path, planes, BENCH_WORDS, BENCH_SAMPLES, 0, edges, counts);
+	}
+	edge = (double)runs * BENCH_SAMPLES / (Bench_Now() - start);
+
+	printf("%-6s transpose %8.1f Msamples/s/core, edges %8.1f Msamples/s/core, both %8.1f Msamples/s/core (%llu edges)\n",
+		   DIGITAL_IO_Decode_Path_Name(path), transpose * 1e-6, edge * 1e-6, 1e-6 / (1.0 / transpose + 1.0 / edge),
+		   (unsigned long long)total);
+}
+
+
+/* Main -------------------------------------*/
+int main(void)
+{
+	// Period 1000, ports 0 and 1 in one group: 4 records per report
+	const uint8_t config[10] = {0xE8, 0x03, 0x00, 0x00, 1, 1, 0, 0, 0, 0};
+	DIGITAL_IO_DECODE_Capture capture;
+	DIGITAL_IO_DECODE_Records records;
+	DIGITAL_IO_Decode_Path path = DIGITAL_IO_DECODE_SCALAR;
+	uint32_t state = 0xC0FFEEU, value = 0, idx = 0, runs = 0;
+	uint64_t decoded = 0;
+	double start = 0;
+
+	// Bus-like samples: a few pins toggle between the samples
+	for (idx = 0; idx < BENCH_SAMPLES; idx++)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		if ((state & 0x07U) == 0)
+		{
+			value ^= 1U << ((state >> 8) % DIGITAL_IO_DECODE_BIT_NUM);
+		}
+		samples[idx] = value;
+	}
+
+	for (path = DIGITAL_IO_DECODE_SCALAR; path <= DIGITAL_IO_Decode_Select(DIGITAL_IO_DECODE_AUTO); path++)
+	{
+		Bench_Path(path);
+	}
+
+	// Report unpacking (scalar)
+	DIGITAL_IO_Decode_Setup(&capture, config, 0x03U);
+	for (idx = 0; idx < BENCH_REPORTS; idx++)
+	{
+		reports[idx][0] = DIGITAL_IO_DECODE_EXTENDED | DIGITAL_IO_DECODE_CAPTURE;
+		reports[idx][1] = 4U << 4;
+		memcpy(&reports[idx][6], &samples[idx], sizeof(uint32_t));
+	}
+	start = Bench_Now();
+	for (runs = 0; Bench_Now() - start < BENCH_TIME; runs++)
+	{
+		for (idx = 0; idx < BENCH_REPORTS; idx++)
+		{
+			decoded += (uint64_t)DIGITAL_IO_Decode_Report(&capture, reports[idx], DIGITAL_IO_DECODE_REPORT_SIZE, &records);
+		}
+	}
+	printf("report unpacking %8.1f Msamples/s/core\n", (double)decoded / (Bench_Now() - start) * 1e-6);
+	return 0;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
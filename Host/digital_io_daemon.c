@@ -0,0 +1,203 @@
+/**
+  ******************************************************************************
+  * @file    digital_io_daemon.c
+  * @brief   Owns the HID device of one module and fans its reports out.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  * @verbatim
+  *
+  * Usage: digital_io_daemon /dev/hidrawN [shared memory name]
+  *
+  * One daemon per module. Without a name the shared memory is called
+  * "/digital_io_<serial>" after the USB serial string (unique device ID of the
+  * module), so the consumers find a module again after re-enumeration.
+  * While a reliable consumer is a full ring behind, the daemon stops reading
+  * the device and the kernel buffers the reports.
+  *
+  * @endverbatim
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "digital_io_fanout.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/hidraw.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/* Defines -------------------------------------*/
+#define DIGITAL_IO_DAEMON_POLL_MS		(1)
+#define DIGITAL_IO_DAEMON_REAP_NS		(100000000ULL)	// check for dead consumers every 100 ms
+
+
+/* Variables -------------------------------------*/
+static volatile sig_atomic_t digital_io_daemon_stop = 0;
+
+
+/* Private function prototypes -------------------------------------*/
+static void DIGITAL_IO_Daemon_Signal(int signal_num);
+static uint64_t DIGITAL_IO_Daemon_Time(void);
+static void DIGITAL_IO_Daemon_Name(int fd, const char* device, char* name, size_t size);
+
+
+/* Private functions -------------------------------------*/
+/**
+  * @brief  DIGITAL_IO_Daemon_Signal
+  *         Stop the daemon (SIGINT, SIGTERM).
+  * @retval None
+  */
+static void DIGITAL_IO_Daemon_Signal(int signal_num)
+{
+	(void)signal_num;
+	digital_io_daemon_stop = 1;
+}
+
+/**
+  * @brief  DIGITAL_IO_Daemon_Time
+  *         Host time of a report.
+  * @retval CLOCK_MONOTONIC ns
+  */
+static uint64_t DIGITAL_IO_Daemon_Time(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+  * @brief  DIGITAL_IO_Daemon_Name
+  *         Shared memory name after the USB serial string, else after the device node.
+  * @retval None
+  */
+static void DIGITAL_IO_Daemon_Name(int fd, const char* device, char* name, size_t size)
+{
+	char serial[64] = {0};
+	const char* base = strrchr(device, '/');
+
+#ifdef HIDIOCGRAWUNIQ
+	if (ioctl(fd, HIDIOCGRAWUNIQ(sizeof(serial) - 1), serial) > 0 && serial[0] != 0)
+	{
+		snprintf(name, size, "/digital_io_%s", serial);
+		return;
+	}
+#else
+	(void)fd;
+#endif
+	snprintf(name, size, "/digital_io_%s", (base != NULL) ? base + 1 : device);
+}
+
+
+/* Main -------------------------------------*/
+int main(int argc, char** argv)
+{
+	DIGITAL_IO_FANOUT_TypeDef fanout;
+	struct pollfd device = {-1, POLLIN, 0};
+	uint8_t report[DIGITAL_IO_FANOUT_REPORT_SIZE];
+	uint8_t command[1 + DIGITAL_IO_FANOUT_COMMAND_SIZE];	// report number 0 (no report IDs) + output report
+	uint64_t report_time = 0, reap_time = 0;
+	char name[96];
+	ssize_t length = 0, pending = 0;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s /dev/hidrawN [shared memory name]\n", argv[0]);
+		return 2;
+	}
+	device.fd = open(argv[1], O_RDWR);
+	if (device.fd < 0)
+	{
+		perror(argv[1]);
+		return 1;
+	}
+	if (argc > 2)
+	{
+		snprintf(name, sizeof(name), "%s", argv[2]);
+	}
+	else
+	{
+		DIGITAL_IO_Daemon_Name(device.fd, argv[1], name, sizeof(name));
+	}
+	if (DIGITAL_IO_Fanout_Create(&fanout, name) != 0)
+	{
+		perror(name);
+		close(device.fd);
+		return 1;
+	}
+	signal(SIGINT, DIGITAL_IO_Daemon_Signal);
+	signal(SIGTERM, DIGITAL_IO_Daemon_Signal);
+	printf("%s -> %s\n", argv[1], name);
+
+	while (!digital_io_daemon_stop)
+	{
+		// Backpressure: a report refused by the ring is kept and the device is not read
+		if (pending > 0 && DIGITAL_IO_Fanout_Publish(&fanout, report, (uint16_t)pending, report_time) == 0)
+		{
+			pending = 0;
+		}
+		device.events = (pending == 0) ? POLLIN : 0;
+		if (poll(&device, 1, DIGITAL_IO_DAEMON_POLL_MS) < 0 && errno != EINTR)
+		{
+			perror("poll");
+			break;
+		}
+		if (device.revents & (POLLERR | POLLHUP | POLLNVAL))
+		{
+			fprintf(stderr, "%s: device removed\n", argv[1]);
+			break;
+		}
+		if (device.revents & POLLIN)
+		{
+			length = read(device.fd, report, sizeof(report));
+			if (length > 0)
+			{
+				report_time = DIGITAL_IO_Daemon_Time();
+				pending = length;
+			}
+		}
+
+		// Commands in ticket order
+		command[0] = 0;
+		while (DIGITAL_IO_Fanout_Pop_Command(&fanout, &command[1]) == 0)
+		{
+			if (write(device.fd, command, sizeof(command)) < 0)
+			{
+				perror("write");
+			}
+		}
+
+		if (DIGITAL_IO_Daemon_Time() - reap_time > DIGITAL_IO_DAEMON_REAP_NS)
+		{
+			reap_time = DIGITAL_IO_Daemon_Time();
+			DIGITAL_IO_Fanout_Reap(&fanout);
+		}
+	}
+
+	DIGITAL_IO_Fanout_Close(&fanout);
+	close(device.fd);
+	return 0;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,568 @@
+/**
+  ******************************************************************************
+  * @file    digital_io_decode.c
+  * @brief   Host decoder of the capture reports.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  * @verbatim
+  *
+  * The capture reports carry packed samples: logical bit port * 4 + pin of
+  * the ports of one rate group. Analysis wants them per pin, so the decoder
+  * transposes blocks of 64 samples x 24 bits into 24 words of 64 samples
+  * (bitplanes). Edges are then word-parallel: a sample differs from the
+  * previous one where plane ^ (plane << 1 | carry) is set, and the edge count
+  * of a pin is the popcount of its edge words.
+  *
+  * Paths (the results are identical, test_decode checks it):
+  * - scalar: portable C, reference of the SIMD paths
+  * - SSE (SSSE3): PSHUFB gathers byte k of 4 samples into one dword, a 4x4
+  *   dword transpose gives 16 samples of one sample byte per register and
+  *   PMOVMSKB takes one bit of 16 samples at a time (PADDB shifts the next
+  *   bit up); popcount with a PSHUFB nibble table and PSADBW
+  * - AVX2: the same on 32 samples per register, VPERMD restores the sample
+  *   order after the in-lane unpacks
+  * The SIMD paths are compiled with target attributes and selected at run
+  * time (__builtin_cpu_supports): the program runs on any x86-64 CPU and on
+  * other architectures with the scalar path.
+  *
+  * @endverbatim
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "digital_io_decode.h"
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define DIGITAL_IO_DECODE_X86
+#include <immintrin.h>
+#endif
+
+
+/* Defines -------------------------------------*/
+#define DIGITAL_IO_DECODE_BYTE_BITS		(0x08U)
+
+
+/* Private function prototypes -------------------------------------*/
+static void DIGITAL_IO_Decode_Transpose_Scalar(const uint32_t* samples, size_t num, uint64_t* planes, size_t stride, size_t word);
+static uint64_t DIGITAL_IO_Decode_Edges_Scalar(const uint64_t* plane, uint64_t* edges, size_t first, size_t words, uint64_t carry);
+#ifdef DIGITAL_IO_DECODE_X86
+static void DIGITAL_IO_Decode_Transpose_SSE(const uint32_t* samples, size_t blocks, uint64_t* planes, size_t stride);
+static void DIGITAL_IO_Decode_Transpose_AVX2(const uint32_t* samples, size_t blocks, uint64_t* planes, size_t stride);
+static uint64_t DIGITAL_IO_Decode_Edges_SSE(const uint64_t* plane, uint64_t* edges, size_t words);
+static uint64_t DIGITAL_IO_Decode_Edges_AVX2(const uint64_t* plane, uint64_t* edges, size_t words);
+#endif
+
+
+/* Private functions -------------------------------------*/
+/**
+  * @brief  DIGITAL_IO_Decode_Transpose_Scalar
+  *         Transpose up to 64 samples into word 'word' of every plane.
+  * @retval None
+  */
+static void DIGITAL_IO_Decode_Transpose_Scalar(const uint32_t* samples, size_t num, uint64_t* planes, size_t stride, size_t word)
+{
+	uint64_t plane[DIGITAL_IO_DECODE_BIT_NUM];
+	uint32_t sample = 0;
+	size_t sample_idx = 0;
+	uint8_t bit = 0;
+
+	memset(plane, 0, sizeof(plane));
+	for (sample_idx = 0; sample_idx < num; sample_idx++)
+	{
+		sample = samples[sample_idx];
+		for (bit = 0; bit < DIGITAL_IO_DECODE_BIT_NUM; bit++)
+		{
+			plane[bit] |= (uint64_t)((sample >> bit) & 0x01U) << sample_idx;
+		}
+	}
+	for (bit = 0; bit < DIGITAL_IO_DECODE_BIT_NUM; bit++)
+	{
+		planes[bit * stride + word] = plane[bit];
+	}
+}
+
+/**
+  * @brief  DIGITAL_IO_Decode_Edges_Scalar
+  *         Edge words first..words-1 of one plane.
+  * @param  carry: level of the sample before word 'first' (bit 0)
+  * @retval Edges
+  */
+static uint64_t DIGITAL_IO_Decode_Edges_Scalar(const uint64_t* plane, uint64_t* edges, size_t first, size_t words, uint64_t carry)
+{
+	uint64_t count = 0, current = 0;
+	size_t word_idx = 0;
+
+	for (word_idx = first; word_idx < words; word_idx++)
+	{
+		current = plane[word_idx];
+		edges[word_idx] = current ^ ((current << 1) | carry);
+		carry = current >> 63;
+		count += (uint64_t)__builtin_popcountll(edges[word_idx]);
+	}
+	return count;
+}
+
+#ifdef DIGITAL_IO_DECODE_X86
+/**
+  * @brief  DIGITAL_IO_Decode_Transpose_SSE
+  *         Transpose blocks of 64 samples, 16 samples per step.
+  * @retval None
+  */
+__attribute__((target("ssse3")))
+static void DIGITAL_IO_Decode_Transpose_SSE(const uint32_t* samples, size_t blocks, uint64_t* planes, size_t stride)
+{
+	// Byte k of the 4 samples of a register into dword k
+	const __m128i gather = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+	uint64_t plane[DIGITAL_IO_DECODE_BIT_NUM];
+	__m128i v0, v1, v2, v3, t0, t1, t2, t3, lane[3];
+	const uint32_t* src = 0;
+	size_t block_idx = 0;
+	uint8_t step = 0, byte = 0, bit = 0;
+
+	for (block_idx = 0; block_idx < blocks; block_idx++)
+	{
+		memset(plane, 0, sizeof(plane));
+		for (step = 0; step < 4; step++)
+		{
+			src = &samples[block_idx * DIGITAL_IO_DECODE_PLANE_BITS + step * 16];
+			v0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&src[0]), gather);
+			v1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&src[4]), gather);
+			v2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&src[8]), gather);
+			v3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&src[12]), gather);
+			// 4x4 dword transpose: lane k = byte k of the 16 samples in sample order
+			t0 = _mm_unpacklo_epi32(v0, v1);
+			t1 = _mm_unpackhi_epi32(v0, v1);
+			t2 = _mm_unpacklo_epi32(v2, v3);
+			t3 = _mm_unpackhi_epi32(v2, v3);
+			lane[0] = _mm_unpacklo_epi64(t0, t2);
+			lane[1] = _mm_unpackhi_epi64(t0, t2);
+			lane[2] = _mm_unpacklo_epi64(t1, t3);
+			for (byte = 0; byte < 3; byte++)
+			{
+				// Most significant bit first, the next one is shifted up by the byte add
+				for (bit = DIGITAL_IO_DECODE_BYTE_BITS; bit-- > 0;)
+				{
+					plane[byte * DIGITAL_IO_DECODE_BYTE_BITS + bit] |= (uint64_t)(uint16_t)_mm_movemask_epi8(lane[byte]) << (step * 16);
+					lane[byte] = _mm_add_epi8(lane[byte], lane[byte]);
+				}
+			}
+		}
+		for (bit = 0; bit < DIGITAL_IO_DECODE_BIT_NUM; bit++)
+		{
+			planes[bit * stride + block_idx] = plane[bit];
+		}
+	}
+}
+
+/**
+  * @brief  DIGITAL_IO_Decode_Transpose_AVX2
+  *         Transpose blocks of 64 samples, 32 samples per step.
+  * @retval None
+  */
+__attribute__((target("avx2")))
+static void DIGITAL_IO_Decode_Transpose_AVX2(const uint32_t* samples, size_t blocks, uint64_t* planes, size_t stride)
+{
+	const __m256i gather = _mm256_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+											0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+	// The unpacks stay in the 128-bit lanes: dwords 0-3 hold samples 0-3, 8-11, 16-19, 24-27, dwords 4-7 the others
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	uint64_t plane[DIGITAL_IO_DECODE_BIT_NUM];
+	__m256i v0, v1, v2, v3, t0, t1, t2, t3, lane[3];
+	const uint32_t* src = 0;
+	size_t block_idx = 0;
+	uint8_t step = 0, byte = 0, bit = 0;
+
+	for (block_idx = 0; block_idx < blocks; block_idx++)
+	{
+		memset(plane, 0, sizeof(plane));
+		for (step = 0; step < 2; step++)
+		{
+			src = &samples[block_idx * DIGITAL_IO_DECODE_PLANE_BITS + step * 32];
+			v0 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)&src[0]), gather);
+			v1 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)&src[8]), gather);
+			v2 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)&src[16]), gather);
+			v3 = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)&src[24]), gather);
+			t0 = _mm256_unpacklo_epi32(v0, v1);
+			t1 = _mm256_unpackhi_epi32(v0, v1);
+			t2 = _mm256_unpacklo_epi32(v2, v3);
+			t3 = _mm256_unpackhi_epi32(v2, v3);
+			lane[0] = _mm256_permutevar8x32_epi32(_mm256_unpacklo_epi64(t0, t2), order);
+			lane[1] = _mm256_permutevar8x32_epi32(_mm256_unpackhi_epi64(t0, t2), order);
+			lane[2] = _mm256_permutevar8x32_epi32(_mm256_unpacklo_epi64(t1, t3), order);
+			for (byte = 0; byte < 3; byte++)
+			{
+				for (bit = DIGITAL_IO_DECODE_BYTE_BITS; bit-- > 0;)
+				{
+					plane[byte * DIGITAL_IO_DECODE_BYTE_BITS + bit] |= (uint64_t)(uint32_t)_mm256_movemask_epi8(lane[byte]) << (step * 32);
+					lane[byte] = _mm256_add_epi8(lane[byte], lane[byte]);
+				}
+			}
+		}
+		for (bit = 0; bit < DIGITAL_IO_DECODE_BIT_NUM; bit++)
+		{
+			planes[bit * stride + block_idx] = plane[bit];
+		}
+	}
+}
+
+/**
+  * @brief  DIGITAL_IO_Decode_Edges_SSE
+  *         Edge words 1..words-1 of one plane, 2 words per step.
+  * @retval Edges of the words written
+  */
+__attribute__((target("ssse3")))
+static uint64_t DIGITAL_IO_Decode_Edges_SSE(const uint64_t* plane, uint64_t* edges, size_t words)
+{
+	const __m128i table = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m128i low = _mm_set1_epi8(0x0F);
+	__m128i current, previous, edge, count, total = _mm_setzero_si128();
+	size_t word_idx = 1;
+
+	for (; word_idx + 2 <= words; word_idx += 2)
+	{
+		current = _mm_loadu_si128((const __m128i*)&plane[word_idx]);
+		previous = _mm_loadu_si128((const __m128i*)&plane[word_idx - 1]);
+		edge = _mm_xor_si128(current, _mm_or_si128(_mm_slli_epi64(current, 1), _mm_srli_epi64(previous, 63)));
+		_mm_storeu_si128((__m128i*)&edges[word_idx], edge);
+		count = _mm_add_epi8(_mm_shuffle_epi8(table, _mm_and_si128(edge, low)),
+							 _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(edge, 4), low)));
+		total = _mm_add_epi64(total, _mm_sad_epu8(count, _mm_setzero_si128()));
+	}
+	return (uint64_t)_mm_cvtsi128_si64(total) + (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(total, total))
+		 + DIGITAL_IO_Decode_Edges_Scalar(plane, edges, word_idx, words, plane[word_idx - 1] >> 63);
+}
+
+/**
+  * @brief  DIGITAL_IO_Decode_Edges_AVX2
+  *         Edge words 1..words-1 of one plane, 4 words per step.
+  * @retval Edges of the words written
+  */
+__attribute__((target("avx2")))
+static uint64_t DIGITAL_IO_Decode_Edges_AVX2(const uint64_t* plane, uint64_t* edges, size_t words)
+{
+	const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+										   0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i low = _mm256_set1_epi8(0x0F);
+	__m256i current, previous, edge, count, total = _mm256_setzero_si256();
+	__m128i sum;
+	size_t word_idx = 1;
+
+	for (; word_idx + 4 <= words; word_idx += 4)
+	{
+		current = _mm256_loadu_si256((const __m256i*)&plane[word_idx]);
+		previous = _mm256_loadu_si256((const __m256i*)&plane[word_idx - 1]);
+		edge = _mm256_xor_si256(current, _mm256_or_si256(_mm256_slli_epi64(current, 1), _mm256_srli_epi64(previous, 63)));
+		_mm256_storeu_si256((__m256i*)&edges[word_idx], edge);
+		count = _mm256_add_epi8(_mm256_shuffle_epi8(table, _mm256_and_si256(edge, low)),
+								_mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(edge, 4), low)));
+		total = _mm256_add_epi64(total, _mm256_sad_epu8(count, _mm256_setzero_si256()));
+	}
+	sum = _mm_add_epi64(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+	return (uint64_t)_mm_cvtsi128_si64(sum) + (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(sum, sum))
+		 + DIGITAL_IO_Decode_Edges_Scalar(plane, edges, word_idx, words, plane[word_idx - 1] >> 63);
+}
+#endif
+
+
+/* Exported functions -------------------------------------*/
+/**
+  * @brief  DIGITAL_IO_Decode_Select
+  *         Path used for a request on this CPU.
+  * @retval Path
+  */
+DIGITAL_IO_Decode_Path DIGITAL_IO_Decode_Select(DIGITAL_IO_Decode_Path path)
+{
+	DIGITAL_IO_Decode_Path best = DIGITAL_IO_DECODE_SCALAR;
+
+#ifdef DIGITAL_IO_DECODE_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("ssse3"))
+	{
+		best = DIGITAL_IO_DECODE_SSE;
+	}
+	if (__builtin_cpu_supports("avx2"))
+	{
+		best = DIGITAL_IO_DECODE_AVX2;
+	}
+#endif
+	return (path > best) ? best : path;
+}
+
+/**
+  * @brief  DIGITAL_IO_Decode_Path_Name
+  *         Name of a path.
+  * @retval Name
+  */
+const char* DIGITAL_IO_Decode_Path_Name(DIGITAL_IO_Decode_Path path)
+{
+	switch (path)
+	{
+		case DIGITAL_IO_DECODE_SCALAR:
+			return "scalar";
+		case DIGITAL_IO_DECODE_SSE:
+			return "sse";
+		case DIGITAL_IO_DECODE_AVX2:
+			return "avx2";
+		default:
+			return "auto";
+	}
+}
+
+/**
+  * @brief  DIGITAL_IO_Decode_Setup
+  *         Rate groups of a capture (USBD_HID_Digital_IO_Capture_Setup_Groups of the firmware).
+  *         The module rounds the period to its timer: the records period is
+  *         exact for the periods it can produce, the timestamps always are.
+  * @retval None
+  */
+void DIGITAL_IO_Decode_Setup(DIGITAL_IO_DECODE_Capture* capture, const uint8_t* config, uint8_t control)
+{
+	DIGITAL_IO_DECODE_Group* group = 0;
+	uint8_t port_idx = 0, group_idx = 0, decimation = 0;
+
+	memset(capture, 0, sizeof(*capture));
+	capture->period = (uint32_t)config[0] | ((uint32_t)config[1] << 8) | ((uint32_t)config[2] << 16) | ((uint32_t)config[3] << 24);
+	capture->planar = (control >> 2) & 0x01U;
+	// State mode: one record per DUT clock, the timestamps count DUT clocks
+	if ((control >> 4) & 0x01U)
+	{
+		capture->period = 1;
+	}
+
+	for (port_idx = 0; port_idx < DIGITAL_IO_DECODE_PORT_NUM; port_idx++)
+	{
+		decimation = config[port_idx + 4];
+		if (decimation == 0)
+		{
+			continue;
+		}
+		for (group_idx = 0; group_idx < capture->group_num; group_idx++)
+		{
+			if (capture->group[group_idx].decimation == decimation)
+			{
+				break;
+			}
+		}
+		group = &capture->group[group_idx];
+		if (group_idx == capture->group_num)
+		{
+			capture->group_num++;
+			group->decimation = decimation;
+		}
+		group->ports[group->port_num++] = port_idx;
+		group->mask |= 0x0FU << (port_idx * DIGITAL_IO_DECODE_PIN_NUM);
+	}
+}
+
+/**
+  * @brief  DIGITAL_IO_Decode_Report
+  *         Unpack the records of a REPORT_CAPTURE.
+  * @retval Number of records, -1 = no capture report or unknown group
+  */
+int DIGITAL_IO_Decode_Report(const DIGITAL_IO_DECODE_Capture* capture, const uint8_t* report, uint16_t length, DIGITAL_IO_DECODE_Records* records)
+{
+	const DIGITAL_IO_DECODE_Group* group = 0;
+	uint32_t bits = 0, sample = 0;
+	uint8_t rec_idx = 0, port_idx = 0, pin_idx = 0, num = 0, shift = 0;
+
+	if (length < DIGITAL_IO_DECODE_REPORT_SIZE || report[0] != (DIGITAL_IO_DECODE_EXTENDED | DIGITAL_IO_DECODE_CAPTURE))
+	{
+		return -1;
+	}
+	records->group = report[1] & 0x0FU;
+	num = report[1] >> 4;
+	if (records->group >= capture->group_num)
+	{
+		return -1;
+	}
+	group = &capture->group[records->group];
+	if (num * group->port_num * DIGITAL_IO_DECODE_PIN_NUM > DIGITAL_IO_DECODE_RECORD_BITS)
+	{
+		return -1;
+	}
+
+	records->num = num;
+	records->lost = report[10];
+	records->timestamp = (uint32_t)report[2] | ((uint32_t)report[3] << 8) | ((uint32_t)report[4] << 16) | ((uint32_t)report[5] << 24);
+	records->period = group->decimation * capture->period;
+	bits = (uint32_t)report[6] | ((uint32_t)report[7] << 8) | ((uint32_t)report[8] << 16) | ((uint32_t)report[9] << 24);
+
+	for (rec_idx = 0; rec_idx < num; rec_idx++)
+	{
+		sample = 0;
+		for (port_idx = 0; port_idx < group->port_num; port_idx++)
+		{
+			for (pin_idx = 0; pin_idx < DIGITAL_IO_DECODE_PIN_NUM; pin_idx++)
+			{
+				if (capture->planar)
+				{
+					shift = (uint8_t)((port_idx * DIGITAL_IO_DECODE_PIN_NUM + pin_idx) * num + rec_idx);
+				}
+				else
+				{
+					shift = (uint8_t)((rec_idx * group->port_num + port_idx) * DIGITAL_IO_DECODE_PIN_NUM + pin_idx);
+				}
+				sample |= ((bits >> shift) & 0x01U) << (group->ports[port_idx] * DIGITAL_IO_DECODE_PIN_NUM + pin_idx);
+			}
+		}
+		records->samples[rec_idx] = sample;
+	}
+	return num;
+}
+
+/**
+  * @brief  DIGITAL_IO_Decode_Run
+  *         Unpack a REPORT_CAPTURE_RUN.
+  * @retval 0 = OK, -1 = no run report
+  */
+int DIGITAL_IO_Decode_Run(const uint8_t* report, uint16_t length, DIGITAL_IO_DECODE_Run* run)
+{
+	if (length < DIGITAL_IO_DECODE_REPORT_SIZE || report[0] != (DIGITAL_IO_DECODE_EXTENDED | DIGITAL_IO_DECODE_CAPTURE_RUN))
+	{
+		return -1;
+	}
+	run->group = report[1] >> 4;
+	run->lost = report[1] & 0x0FU;
+	run->timestamp = (uint32_t)report[2] | ((uint32_t)report[3] << 8) | ((uint32_t)report[4] << 16) | ((uint32_t)report[5] << 24);
+	run->value = (uint32_t)report[6] | ((uint32_t)report[7] << 8) | ((uint32_t)report[8] << 16);
+	run->length = (uint16_t)(report[9] | (report[10] << 8));
+	return 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Decode_Transpose
+  *         Bit-matrix transpose of packed samples into bitplanes.
+  * @retval None
+  */
+void DIGITAL_IO_Decode_Transpose(DIGITAL_IO_Decode_Path path, const uint32_t* samples, size_t num, uint64_t* planes, size_t stride)
+{
+	size_t blocks = num / DIGITAL_IO_DECODE_PLANE_BITS, done = 0;
+
+	switch (DIGITAL_IO_Decode_Select(path))
+	{
+#ifdef DIGITAL_IO_DECODE_X86
+		case DIGITAL_IO_DECODE_AVX2:
+			DIGITAL_IO_Decode_Transpose_AVX2(samples, blocks, planes, stride);
+			done = blocks;
+			break;
+		case DIGITAL_IO_DECODE_SSE:
+			DIGITAL_IO_Decode_Transpose_SSE(samples, blocks, planes, stride);
+			done = blocks;
+			break;
+#endif
+		default:
+			break;
+	}
+	// Scalar blocks and the partial last block (the bits after the last sample are 0)
+	for (; done < DIGITAL_IO_DECODE_WORDS(num); done++)
+	{
+		DIGITAL_IO_Decode_Transpose_Scalar(&samples[done * DIGITAL_IO_DECODE_PLANE_BITS],
+										   (num - done * DIGITAL_IO_DECODE_PLANE_BITS < DIGITAL_IO_DECODE_PLANE_BITS) ? num - done * DIGITAL_IO_DECODE_PLANE_BITS : DIGITAL_IO_DECODE_PLANE_BITS,
+										   planes, stride, done);
+	}
+}
+
+/**
+  * @brief  DIGITAL_IO_Decode_Edges
+  *         Edge bitmaps and edge counts of the bitplanes.
+  * @retval Edges of all logical bits
+  */
+uint64_t DIGITAL_IO_Decode_Edges(DIGITAL_IO_Decode_Path path, const uint64_t* planes, size_t stride, size_t num, uint32_t initial, uint64_t* edges, uint64_t* counts)
+{
+	DIGITAL_IO_Decode_Path selected = DIGITAL_IO_Decode_Select(path);
+	size_t words = DIGITAL_IO_DECODE_WORDS(num);
+	uint64_t total = 0, tail = 0, count = 0;
+	const uint64_t* plane = 0;
+	uint64_t* edge = 0;
+	uint8_t bit = 0;
+
+	if (words == 0)
+	{
+		memset(counts, 0, DIGITAL_IO_DECODE_BIT_NUM * sizeof(uint64_t));
+		return 0;
+	}
+	// Samples after the last one: the 0 padding would look like an edge
+	if (num % DIGITAL_IO_DECODE_PLANE_BITS)
+	{
+		tail = ~0ULL << (num % DIGITAL_IO_DECODE_PLANE_BITS);
+	}
+
+	for (bit = 0; bit < DIGITAL_IO_DECODE_BIT_NUM; bit++)
+	{
+		plane = &planes[bit * stride];
+		edge = &edges[bit * stride];
+		// Word 0 against the level before the capture
+		count = DIGITAL_IO_Decode_Edges_Scalar(plane, edge, 0, 1, (initial >> bit) & 0x01U);
+		switch (selected)
+		{
+#ifdef DIGITAL_IO_DECODE_X86
+			case DIGITAL_IO_DECODE_AVX2:
+				count += DIGITAL_IO_Decode_Edges_AVX2(plane, edge, words);
+				break;
+			case DIGITAL_IO_DECODE_SSE:
+				count += DIGITAL_IO_Decode_Edges_SSE(plane, edge, words);
+				break;
+#endif
+			default:
+				count += DIGITAL_IO_Decode_Edges_Scalar(plane, edge, 1, words, plane[0] >> 63);
+				break;
+		}
+		count -= (uint64_t)__builtin_popcountll(edge[words - 1] & tail);
+		edge[words - 1] &= ~tail;
+		counts[bit] = count;
+		total += count;
+	}
+	return total;
+}
+
+/**
+  * @brief  DIGITAL_IO_Decode_Edge_List
+  *         Per-pin edge lists.
+  * @retval Entries written
+  */
+size_t DIGITAL_IO_Decode_Edge_List(const uint64_t* planes, const uint64_t* edges, size_t stride, size_t num, uint64_t first, DIGITAL_IO_DECODE_Edge* list, size_t max)
+{
+	size_t words = DIGITAL_IO_DECODE_WORDS(num), word_idx = 0, entries = 0;
+	uint64_t edge = 0;
+	uint8_t bit = 0, position = 0;
+
+	for (bit = 0; bit < DIGITAL_IO_DECODE_BIT_NUM; bit++)
+	{
+		for (word_idx = 0; word_idx < words; word_idx++)
+		{
+			edge = edges[bit * stride + word_idx];
+			while (edge)
+			{
+				if (entries == max)
+				{
+					return entries;
+				}
+				position = (uint8_t)__builtin_ctzll(edge);
+				list[entries].sample = first + word_idx * DIGITAL_IO_DECODE_PLANE_BITS + position;
+				list[entries].bit = bit;
+				list[entries].level = (uint8_t)((planes[bit * stride + word_idx] >> position) & 0x01U);
+				entries++;
+				edge &= edge - 1;
+			}
+		}
+	}
+	return entries;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,201 @@
+/**
+  ******************************************************************************
+  * @file    digital_io_decode.h
+  * @brief   Host decoder of the capture reports: packed samples, per-pin
+  *          bitplanes and edge lists (scalar, SSE and AVX2 paths).
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* Defines -------------------------------------*/
+#ifndef __DIGITAL_IO_DECODE_H
+#define __DIGITAL_IO_DECODE_H
+
+// Report layout of the module (usbd_digital_io.h, usbd_digital_io_capture.h)
+#define DIGITAL_IO_DECODE_REPORT_SIZE	(0x0BU)		// DIGITAL_IO_REPORT_SIZE
+#define DIGITAL_IO_DECODE_EXTENDED		(0x80U)		// DIGITAL_IO_REPORT_EXTENDED
+#define DIGITAL_IO_DECODE_CAPTURE		(0x01U)		// REPORT_CAPTURE
+#define DIGITAL_IO_DECODE_CAPTURE_RUN	(0x07U)		// REPORT_CAPTURE_RUN
+#define DIGITAL_IO_DECODE_RECORD_BITS	(0x20U)		// DIGITAL_IO_CAPTURE_RECORD_BITS
+#define DIGITAL_IO_DECODE_PORT_NUM		(0x06U)		// DIGITAL_MAX_PORT_NUM
+#define DIGITAL_IO_DECODE_PIN_NUM		(0x04U)		// DIGITAL_MAX_PIN_NUM
+#define DIGITAL_IO_DECODE_BIT_NUM		(0x18U)		// logical bits: port * 4 + pin
+#define DIGITAL_IO_DECODE_ALL_BITS		(0x00FFFFFFU)
+#define DIGITAL_IO_DECODE_MAX_RECORDS	(DIGITAL_IO_DECODE_RECORD_BITS / DIGITAL_IO_DECODE_PIN_NUM)
+
+// Bitplanes: one bit per sample (sample 64 * w + j in bit j of word w), plane of logical bit b at planes[b * stride]
+#define DIGITAL_IO_DECODE_PLANE_BITS	(0x40U)
+#define DIGITAL_IO_DECODE_WORDS(num)	(((num) + DIGITAL_IO_DECODE_PLANE_BITS - 1U) / DIGITAL_IO_DECODE_PLANE_BITS)
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ typedef enum {
+	 DIGITAL_IO_DECODE_SCALAR = 0x00,	// portable C
+	 DIGITAL_IO_DECODE_SSE = 0x01,		// SSSE3 (x86)
+	 DIGITAL_IO_DECODE_AVX2 = 0x02,		// AVX2 (x86)
+	 DIGITAL_IO_DECODE_AUTO = 0xFF		// best path of the CPU
+ } DIGITAL_IO_Decode_Path;
+
+ // Rate group of a capture: the ports with the same decimation, in port order (as the firmware builds them)
+ typedef struct _DIGITAL_IO_DECODE_Group
+ {
+	 uint8_t							decimation;
+	 uint8_t							port_num;
+	 uint8_t							ports[DIGITAL_IO_DECODE_PORT_NUM];
+	 uint32_t							mask;			// logical bits of the group
+ } DIGITAL_IO_DECODE_Group;
+
+ // Capture settings sent to the module (COMMAND_CAPTURE_CONFIG, COMMAND_CAPTURE_CONTROL)
+ typedef struct _DIGITAL_IO_DECODE_Capture
+ {
+	 uint32_t							period;			// base sample period (CPU cycles)
+	 uint8_t							planar;			// P bit: pin-major records
+	 uint8_t							group_num;
+	 DIGITAL_IO_DECODE_Group			group[DIGITAL_IO_DECODE_PORT_NUM];
+ } DIGITAL_IO_DECODE_Capture;
+
+ // Records of one REPORT_CAPTURE
+ typedef struct _DIGITAL_IO_DECODE_Records
+ {
+	 uint8_t							group;
+	 uint8_t							num;
+	 uint8_t							lost;			// records overwritten before the report, saturated
+	 uint32_t							timestamp;		// first record (CPU cycles)
+	 uint32_t							period;			// CPU cycles between two records
+	 uint32_t							samples[DIGITAL_IO_DECODE_MAX_RECORDS];	// logical bits of the group ports
+ } DIGITAL_IO_DECODE_Records;
+
+ // One REPORT_CAPTURE_RUN
+ typedef struct _DIGITAL_IO_DECODE_Run
+ {
+	 uint8_t							group;
+	 uint8_t							lost;			// records lost before the run, saturated at 15
+	 uint32_t							timestamp;		// first record of the run (CPU cycles)
+	 uint32_t							value;			// logical bits of the group ports
+	 uint16_t							length;			// records of the run
+ } DIGITAL_IO_DECODE_Run;
+
+ // Level change of one logical bit
+ typedef struct _DIGITAL_IO_DECODE_Edge
+ {
+	 uint64_t							sample;			// first sample with the new level
+	 uint8_t							bit;
+	 uint8_t							level;
+ } DIGITAL_IO_DECODE_Edge;
+
+ /**
+   * @brief  DIGITAL_IO_Decode_Select
+   *         Path used for a request on this CPU.
+   * @param  path: requested path, DIGITAL_IO_DECODE_AUTO = best one
+   * @retval The requested path, or the best supported one below it
+   */
+ DIGITAL_IO_Decode_Path DIGITAL_IO_Decode_Select(DIGITAL_IO_Decode_Path path);
+
+ /**
+   * @brief  DIGITAL_IO_Decode_Path_Name
+   *         Name of a path for logs and benchmarks.
+   * @param  path: decode path
+   * @retval Name
+   */
+ const char* DIGITAL_IO_Decode_Path_Name(DIGITAL_IO_Decode_Path path);
+
+ /**
+   * @brief  DIGITAL_IO_Decode_Setup
+   *         Rate groups of a capture from the command payloads sent to the module.
+   * @param  capture: capture settings
+   * @param  config: COMMAND_CAPTURE_CONFIG payload (period, decimation of the ports)
+   * @param  control: COMMAND_CAPTURE_CONTROL byte
+   * @retval None
+   */
+ void DIGITAL_IO_Decode_Setup(DIGITAL_IO_DECODE_Capture* capture, const uint8_t* config, uint8_t control);
+
+ /**
+   * @brief  DIGITAL_IO_Decode_Report
+   *         Unpack the records of a REPORT_CAPTURE (port nibbles or planar layout).
+   * @param  capture: capture settings
+   * @param  report: input report
+   * @param  length: bytes of the report
+   * @param  records: decoded records
+   * @retval Number of records, -1 = no capture report or unknown group
+   */
+ int DIGITAL_IO_Decode_Report(const DIGITAL_IO_DECODE_Capture* capture, const uint8_t* report, uint16_t length, DIGITAL_IO_DECODE_Records* records);
+
+ /**
+   * @brief  DIGITAL_IO_Decode_Run
+   *         Unpack a REPORT_CAPTURE_RUN.
+   * @param  report: input report
+   * @param  length: bytes of the report
+   * @param  run: decoded run
+   * @retval 0 = OK, -1 = no run report
+   */
+ int DIGITAL_IO_Decode_Run(const uint8_t* report, uint16_t length, DIGITAL_IO_DECODE_Run* run);
+
+ /**
+   * @brief  DIGITAL_IO_Decode_Transpose
+   *         Bit-matrix transpose of packed samples into one bitplane per logical bit.
+   * @param  path: decode path
+   * @param  samples: packed samples (logical bits 0-23, higher bits are ignored)
+   * @param  num: number of samples
+   * @param  planes: DIGITAL_IO_DECODE_BIT_NUM planes, DIGITAL_IO_DECODE_WORDS(num) words written per plane
+   * @param  stride: words between two planes (>= DIGITAL_IO_DECODE_WORDS(num))
+   * @retval None
+   */
+ void DIGITAL_IO_Decode_Transpose(DIGITAL_IO_Decode_Path path, const uint32_t* samples, size_t num, uint64_t* planes, size_t stride);
+
+ /**
+   * @brief  DIGITAL_IO_Decode_Edges
+   *         Edge bitmaps (XOR of every sample with the previous one) and edge counts of the bitplanes.
+   * @param  path: decode path
+   * @param  planes: bitplanes of DIGITAL_IO_Decode_Transpose
+   * @param  stride: words between two planes
+   * @param  num: number of samples
+   * @param  initial: levels before the first sample (packed)
+   * @param  edges: edge bitmaps, same layout as the planes (may not alias them)
+   * @param  counts: edges of every logical bit (DIGITAL_IO_DECODE_BIT_NUM entries)
+   * @retval Edges of all logical bits
+   */
+ uint64_t DIGITAL_IO_Decode_Edges(DIGITAL_IO_Decode_Path path, const uint64_t* planes, size_t stride, size_t num, uint32_t initial, uint64_t* edges, uint64_t* counts);
+
+ /**
+   * @brief  DIGITAL_IO_Decode_Edge_List
+   *         Per-pin edge lists: the edges of logical bit 0 in time order, then those of bit 1, ...
+   * @param  planes: bitplanes
+   * @param  edges: edge bitmaps of DIGITAL_IO_Decode_Edges
+   * @param  stride: words between two planes
+   * @param  num: number of samples
+   * @param  first: sample index of the first sample
+   * @param  list: edge list
+   * @param  max: entries of the list
+   * @retval Entries written
+   */
+ size_t DIGITAL_IO_Decode_Edge_List(const uint64_t* planes, const uint64_t* edges, size_t stride, size_t num, uint64_t first, DIGITAL_IO_DECODE_Edge* list, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __DIGITAL_IO_DECODE_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
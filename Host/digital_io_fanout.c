@@ -0,0 +1,387 @@
+/**
+  ******************************************************************************
+  * @file    digital_io_fanout.c
+  * @brief   Shared memory fan-out of the reports of one module.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  * @verbatim
+  *
+  * Only one process can own the HID device of a module. The daemon owns it and
+  * publishes every input report into a ring in POSIX shared memory:
+  * - single producer (daemon), any number of consumers up to
+  *   DIGITAL_IO_FANOUT_CONSUMERS, no lock and no copy: a consumer reads the
+  *   report in its ring slot
+  * - every consumer has its own tail, reliable consumers hold the daemon back
+  *   (backpressure: the daemon stops reading the device and the kernel queues
+  *   the reports), lossy consumers (dashboards) are overrun and count what
+  *   they lost
+  * - output reports of all processes go through a bounded multi-producer ring:
+  *   the ticket of a push is its place in one global order and the daemon
+  *   writes the commands to the module in ticket order
+  * The slots of the report ring are read like a seqlock: a lossy consumer
+  * checks after reading that the daemon did not start to overwrite the slot.
+  *
+  * @endverbatim
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "digital_io_fanout.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+/* Private function prototypes -------------------------------------*/
+static int DIGITAL_IO_Fanout_Map(DIGITAL_IO_FANOUT_TypeDef* fanout, const char* name, int flags);
+
+
+/* Private functions -------------------------------------*/
+/**
+  * @brief  DIGITAL_IO_Fanout_Map
+  *         Open and map the shared memory.
+  * @retval 0 = OK, -1 = error (errno)
+  */
+static int DIGITAL_IO_Fanout_Map(DIGITAL_IO_FANOUT_TypeDef* fanout, const char* name, int flags)
+{
+	int fd = -1;
+	void* map = MAP_FAILED;
+
+	memset(fanout, 0, sizeof(*fanout));
+	snprintf(fanout->name, sizeof(fanout->name), "%s", name);
+	fd = shm_open(name, flags, 0660);
+	if (fd < 0)
+	{
+		return -1;
+	}
+	if ((flags & O_CREAT) && ftruncate(fd, sizeof(DIGITAL_IO_FANOUT_Shared)) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	map = mmap(NULL, sizeof(DIGITAL_IO_FANOUT_Shared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		return -1;
+	}
+	fanout->shared = (DIGITAL_IO_FANOUT_Shared*)map;
+	return 0;
+}
+
+
+/* Exported functions -------------------------------------*/
+/**
+  * @brief  DIGITAL_IO_Fanout_Create
+  *         Create (or reset) the shared memory of a module (daemon).
+  * @retval 0 = OK, -1 = error (errno)
+  */
+int DIGITAL_IO_Fanout_Create(DIGITAL_IO_FANOUT_TypeDef* fanout, const char* name)
+{
+	DIGITAL_IO_FANOUT_Shared* shared = 0;
+	uint32_t idx = 0;
+
+	if (DIGITAL_IO_Fanout_Map(fanout, name, O_CREAT | O_RDWR) != 0)
+	{
+		return -1;
+	}
+	fanout->owner = 1;
+	shared = fanout->shared;
+	memset(shared, 0, sizeof(*shared));
+	shared->version = DIGITAL_IO_FANOUT_VERSION;
+	atomic_store(&shared->daemon_pid, (int32_t)getpid());
+	for (idx = 0; idx < DIGITAL_IO_FANOUT_COMMANDS; idx++)
+	{
+		atomic_store_explicit(&shared->command[idx].sequence, idx, memory_order_relaxed);
+	}
+	// Consumers accept the mapping once the magic is set
+	atomic_thread_fence(memory_order_release);
+	shared->magic = DIGITAL_IO_FANOUT_MAGIC;
+	return 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Fanout_Open
+  *         Map the shared memory of a module created by its daemon (consumer).
+  * @retval 0 = OK, -1 = error (errno)
+  */
+int DIGITAL_IO_Fanout_Open(DIGITAL_IO_FANOUT_TypeDef* fanout, const char* name)
+{
+	if (DIGITAL_IO_Fanout_Map(fanout, name, O_RDWR) != 0)
+	{
+		return -1;
+	}
+	atomic_thread_fence(memory_order_acquire);
+	if (fanout->shared->magic != DIGITAL_IO_FANOUT_MAGIC || fanout->shared->version != DIGITAL_IO_FANOUT_VERSION)
+	{
+		munmap(fanout->shared, sizeof(DIGITAL_IO_FANOUT_Shared));
+		fanout->shared = 0;
+		errno = EPROTO;
+		return -1;
+	}
+	return 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Fanout_Close
+  *         Unmap the shared memory, the daemon also removes it.
+  * @retval None
+  */
+void DIGITAL_IO_Fanout_Close(DIGITAL_IO_FANOUT_TypeDef* fanout)
+{
+	if (fanout->shared == 0)
+	{
+		return;
+	}
+	if (fanout->owner)
+	{
+		atomic_store(&fanout->shared->daemon_pid, 0);
+		shm_unlink(fanout->name);
+	}
+	munmap(fanout->shared, sizeof(DIGITAL_IO_FANOUT_Shared));
+	fanout->shared = 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Fanout_Publish
+  *         Append an input report of the module (daemon only).
+  * @retval 0 = published, -1 = a reliable consumer still holds the slot (retry later)
+  */
+int DIGITAL_IO_Fanout_Publish(DIGITAL_IO_FANOUT_TypeDef* fanout, const uint8_t* report, uint16_t length, uint64_t host_time)
+{
+	DIGITAL_IO_FANOUT_Shared* shared = fanout->shared;
+	DIGITAL_IO_FANOUT_Slot* slot = 0;
+	uint64_t head = atomic_load_explicit(&shared->head, memory_order_relaxed);
+	uint32_t idx = 0, flags = 0;
+
+	// The slot still holds report head - SLOTS: every reliable consumer must be past it
+	if (head >= DIGITAL_IO_FANOUT_SLOTS)
+	{
+		for (idx = 0; idx < DIGITAL_IO_FANOUT_CONSUMERS; idx++)
+		{
+			flags = atomic_load(&shared->consumer[idx].flags);
+			if ((flags & (DIGITAL_IO_FANOUT_ATTACHED | DIGITAL_IO_FANOUT_RELIABLE)) == (DIGITAL_IO_FANOUT_ATTACHED | DIGITAL_IO_FANOUT_RELIABLE)
+				&& head - atomic_load_explicit(&shared->consumer[idx].tail, memory_order_acquire) >= DIGITAL_IO_FANOUT_SLOTS)
+			{
+				atomic_fetch_add_explicit(&shared->stalls, 1, memory_order_relaxed);
+				return -1;
+			}
+		}
+	}
+
+	// Seqlock write: the slot stores are not visible before the previous head
+	atomic_thread_fence(memory_order_release);
+	slot = &shared->slot[head & (DIGITAL_IO_FANOUT_SLOTS - 1)];
+	if (length > DIGITAL_IO_FANOUT_REPORT_SIZE)
+	{
+		length = DIGITAL_IO_FANOUT_REPORT_SIZE;
+	}
+	slot->host_time = host_time;
+	slot->length = length;
+	memcpy(slot->report, report, length);
+	atomic_store_explicit(&shared->head, head + 1, memory_order_release);
+	return 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Fanout_Reap
+  *         Detach the consumers of processes which exited without detaching (daemon).
+  * @retval Detached consumers
+  */
+uint32_t DIGITAL_IO_Fanout_Reap(DIGITAL_IO_FANOUT_TypeDef* fanout)
+{
+	DIGITAL_IO_FANOUT_Consumer* consumer = 0;
+	uint32_t idx = 0, reaped = 0;
+	int32_t pid = 0;
+
+	for (idx = 0; idx < DIGITAL_IO_FANOUT_CONSUMERS; idx++)
+	{
+		consumer = &fanout->shared->consumer[idx];
+		pid = atomic_load(&consumer->pid);
+		if ((atomic_load(&consumer->flags) & DIGITAL_IO_FANOUT_ATTACHED) && pid > 0
+			&& kill(pid, 0) != 0 && errno == ESRCH)
+		{
+			DIGITAL_IO_Fanout_Detach(fanout, (int)idx);
+			reaped++;
+		}
+	}
+	return reaped;
+}
+
+/**
+  * @brief  DIGITAL_IO_Fanout_Attach
+  *         Take a consumer entry, the consumer starts with the next published report.
+  * @retval Consumer index, -1 = all entries taken
+  */
+int DIGITAL_IO_Fanout_Attach(DIGITAL_IO_FANOUT_TypeDef* fanout, uint32_t mode)
+{
+	DIGITAL_IO_FANOUT_Shared* shared = fanout->shared;
+	DIGITAL_IO_FANOUT_Consumer* consumer = 0;
+	uint32_t idx = 0, free_flags = 0;
+
+	for (idx = 0; idx < DIGITAL_IO_FANOUT_CONSUMERS; idx++)
+	{
+		consumer = &shared->consumer[idx];
+		free_flags = 0;
+		// Claim the entry as lossy: the daemon ignores it until the tail is valid
+		if (atomic_compare_exchange_strong(&consumer->flags, &free_flags, DIGITAL_IO_FANOUT_ATTACHED))
+		{
+			atomic_store(&consumer->pid, (int32_t)getpid());
+			atomic_store(&consumer->lost, 0);
+			atomic_store(&consumer->tail, atomic_load(&shared->head));
+			if (mode & DIGITAL_IO_FANOUT_RELIABLE)
+			{
+				atomic_store(&consumer->flags, DIGITAL_IO_FANOUT_ATTACHED | DIGITAL_IO_FANOUT_RELIABLE);
+				// Reports published before the daemon saw the flag may have overwritten the first tail
+				atomic_store(&consumer->tail, atomic_load(&shared->head));
+			}
+			return (int)idx;
+		}
+	}
+	return -1;
+}
+
+/**
+  * @brief  DIGITAL_IO_Fanout_Detach
+  *         Free a consumer entry.
+  * @retval None
+  */
+void DIGITAL_IO_Fanout_Detach(DIGITAL_IO_FANOUT_TypeDef* fanout, int consumer)
+{
+	if (consumer < 0 || consumer >= (int)DIGITAL_IO_FANOUT_CONSUMERS)
+	{
+		return;
+	}
+	atomic_store(&fanout->shared->consumer[consumer].pid, 0);
+	atomic_store(&fanout->shared->consumer[consumer].flags, 0);
+}
+
+/**
+  * @brief  DIGITAL_IO_Fanout_Peek
+  *         Next report of a consumer, read in place.
+  * @retval Report slot, NULL = no new report
+  */
+const DIGITAL_IO_FANOUT_Slot* DIGITAL_IO_Fanout_Peek(DIGITAL_IO_FANOUT_TypeDef* fanout, int consumer)
+{
+	DIGITAL_IO_FANOUT_Shared* shared = fanout->shared;
+	DIGITAL_IO_FANOUT_Consumer* entry = &shared->consumer[consumer];
+	uint64_t tail = atomic_load_explicit(&entry->tail, memory_order_relaxed);
+	uint64_t head = atomic_load_explicit(&shared->head, memory_order_acquire);
+
+	// A lossy consumer skips what the daemon already overwrote
+	if (head - tail > DIGITAL_IO_FANOUT_SLOTS)
+	{
+		atomic_fetch_add_explicit(&entry->lost, head - DIGITAL_IO_FANOUT_SLOTS - tail, memory_order_relaxed);
+		tail = head - DIGITAL_IO_FANOUT_SLOTS;
+		atomic_store_explicit(&entry->tail, tail, memory_order_release);
+	}
+	if (tail == head)
+	{
+		return NULL;
+	}
+	return &shared->slot[tail & (DIGITAL_IO_FANOUT_SLOTS - 1)];
+}
+
+/**
+  * @brief  DIGITAL_IO_Fanout_Release
+  *         Done with the report returned by DIGITAL_IO_Fanout_Peek.
+  * @retval 0 = the report was intact, -1 = overwritten while it was read (lossy consumer, counted as lost)
+  */
+int DIGITAL_IO_Fanout_Release(DIGITAL_IO_FANOUT_TypeDef* fanout, int consumer)
+{
+	DIGITAL_IO_FANOUT_Shared* shared = fanout->shared;
+	DIGITAL_IO_FANOUT_Consumer* entry = &shared->consumer[consumer];
+	uint64_t tail = atomic_load_explicit(&entry->tail, memory_order_relaxed);
+	int intact = 0;
+
+	// Seqlock check: report tail + SLOTS goes into the same slot once the head reached it (never for a reliable consumer)
+	atomic_thread_fence(memory_order_acquire);
+	if (!(atomic_load_explicit(&entry->flags, memory_order_relaxed) & DIGITAL_IO_FANOUT_RELIABLE)
+		&& atomic_load_explicit(&shared->head, memory_order_relaxed) >= tail + DIGITAL_IO_FANOUT_SLOTS)
+	{
+		atomic_fetch_add_explicit(&entry->lost, 1, memory_order_relaxed);
+		intact = -1;
+	}
+	atomic_store_explicit(&entry->tail, tail + 1, memory_order_release);
+	return intact;
+}
+
+/**
+  * @brief  DIGITAL_IO_Fanout_Push_Command
+  *         Queue an output report for the module (any process).
+  * @retval Ticket of the command (global order), -1 = command ring full
+  */
+int64_t DIGITAL_IO_Fanout_Push_Command(DIGITAL_IO_FANOUT_TypeDef* fanout, const uint8_t* report)
+{
+	DIGITAL_IO_FANOUT_Shared* shared = fanout->shared;
+	DIGITAL_IO_FANOUT_Command* command = 0;
+	uint64_t ticket = atomic_load_explicit(&shared->command_head, memory_order_relaxed), sequence = 0;
+
+	for (;;)
+	{
+		command = &shared->command[ticket & (DIGITAL_IO_FANOUT_COMMANDS - 1)];
+		sequence = atomic_load_explicit(&command->sequence, memory_order_acquire);
+		if (sequence == ticket)
+		{
+			if (atomic_compare_exchange_weak_explicit(&shared->command_head, &ticket, ticket + 1, memory_order_relaxed, memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if ((int64_t)(sequence - ticket) < 0)
+		{
+			// The daemon did not pop the command of the previous lap yet
+			return -1;
+		}
+		else
+		{
+			ticket = atomic_load_explicit(&shared->command_head, memory_order_relaxed);
+		}
+	}
+	memcpy(command->report, report, DIGITAL_IO_FANOUT_COMMAND_SIZE);
+	atomic_store_explicit(&command->sequence, ticket + 1, memory_order_release);
+	return (int64_t)ticket;
+}
+
+/**
+  * @brief  DIGITAL_IO_Fanout_Pop_Command
+  *         Next output report in ticket order (daemon only).
+  *         A ticket taken but not filled yet holds back the later ones.
+  * @retval 0 = report copied, -1 = no command
+  */
+int DIGITAL_IO_Fanout_Pop_Command(DIGITAL_IO_FANOUT_TypeDef* fanout, uint8_t* report)
+{
+	DIGITAL_IO_FANOUT_Shared* shared = fanout->shared;
+	uint64_t ticket = atomic_load_explicit(&shared->command_tail, memory_order_relaxed);
+	DIGITAL_IO_FANOUT_Command* command = &shared->command[ticket & (DIGITAL_IO_FANOUT_COMMANDS - 1)];
+
+	if (atomic_load_explicit(&command->sequence, memory_order_acquire) != ticket + 1)
+	{
+		return -1;
+	}
+	memcpy(report, command->report, DIGITAL_IO_FANOUT_COMMAND_SIZE);
+	atomic_store_explicit(&shared->command_tail, ticket + 1, memory_order_relaxed);
+	atomic_store_explicit(&command->sequence, ticket + DIGITAL_IO_FANOUT_COMMANDS, memory_order_release);
+	return 0;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
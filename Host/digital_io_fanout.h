@@ -0,0 +1,214 @@
+/**
+  ******************************************************************************
+  * @file    digital_io_fanout.h
+  * @brief   Header file for the digital_io_fanout.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+
+/* Defines -------------------------------------*/
+#ifndef __DIGITAL_IO_FANOUT_H
+#define __DIGITAL_IO_FANOUT_H
+
+#define DIGITAL_IO_FANOUT_MAGIC			(0x44494F46U)	// "DIOF"
+#define DIGITAL_IO_FANOUT_VERSION		(0x01U)
+#define DIGITAL_IO_FANOUT_SLOTS			(0x1000U)		// input reports in the ring (power of 2)
+#define DIGITAL_IO_FANOUT_CONSUMERS		(0x10U)
+#define DIGITAL_IO_FANOUT_REPORT_SIZE	(0x30U)			// largest input report (the module sends 11 bytes)
+#define DIGITAL_IO_FANOUT_COMMANDS		(0x100U)		// output reports in the command ring (power of 2)
+#define DIGITAL_IO_FANOUT_COMMAND_SIZE	(0x0CU)			// DIGITAL_IO_OUTPUT_REPORT_SIZE
+#define DIGITAL_IO_FANOUT_LINE			(0x40U)			// cache line: no false sharing between the processes
+
+// Consumer flags
+#define DIGITAL_IO_FANOUT_RELIABLE		(0x01U)		// the daemon waits for the consumer (backpressure)
+#define DIGITAL_IO_FANOUT_LOSSY			(0x00U)		// the consumer is overrun and counts the lost reports
+#define DIGITAL_IO_FANOUT_ATTACHED		(0x80U)
+
+#if (DIGITAL_IO_FANOUT_SLOTS & (DIGITAL_IO_FANOUT_SLOTS - 1)) || (DIGITAL_IO_FANOUT_COMMANDS & (DIGITAL_IO_FANOUT_COMMANDS - 1))
+#error "The ring sizes must be powers of 2"
+#endif
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ /* One input report of the module: written once by the daemon, read in place by
+  * every consumer (no copy).
+  */
+ typedef struct _DIGITAL_IO_FANOUT_Slot
+ {
+	 uint64_t							host_time;		// CLOCK_MONOTONIC ns of the read
+	 uint16_t							length;
+	 uint8_t							report[DIGITAL_IO_FANOUT_REPORT_SIZE];
+ } __attribute__((aligned(DIGITAL_IO_FANOUT_LINE))) DIGITAL_IO_FANOUT_Slot;
+
+ typedef struct _DIGITAL_IO_FANOUT_Consumer
+ {
+	 _Atomic uint32_t					flags;			// 0 = free, DIGITAL_IO_FANOUT_ATTACHED | mode
+	 _Atomic int32_t					pid;
+	 _Atomic uint64_t					tail;			// next report index of the consumer
+	 _Atomic uint64_t					lost;			// reports overrun (lossy consumers)
+ } __attribute__((aligned(DIGITAL_IO_FANOUT_LINE))) DIGITAL_IO_FANOUT_Consumer;
+
+ /* Output report of a consumer: the ticket taken when pushing orders the commands
+  * of all processes, the daemon writes them to the module in ticket order.
+  */
+ typedef struct _DIGITAL_IO_FANOUT_Command
+ {
+	 _Atomic uint64_t					sequence;		// ticket = free for the ticket, ticket + 1 = ready to pop
+	 uint8_t							report[DIGITAL_IO_FANOUT_COMMAND_SIZE];
+ } __attribute__((aligned(DIGITAL_IO_FANOUT_LINE))) DIGITAL_IO_FANOUT_Command;
+
+ // Shared memory layout
+ typedef struct _DIGITAL_IO_FANOUT_Shared
+ {
+	 uint32_t							magic;
+	 uint32_t							version;
+	 _Atomic int32_t					daemon_pid;
+	 // Producer (daemon)
+	 _Atomic uint64_t					head __attribute__((aligned(DIGITAL_IO_FANOUT_LINE)));	// reports published
+	 _Atomic uint64_t					stalls;			// publish attempts refused by a reliable consumer
+	 // Command ring (multi-producer, single consumer)
+	 _Atomic uint64_t					command_head __attribute__((aligned(DIGITAL_IO_FANOUT_LINE)));	// next ticket
+	 _Atomic uint64_t					command_tail __attribute__((aligned(DIGITAL_IO_FANOUT_LINE)));	// next ticket of the daemon
+	 DIGITAL_IO_FANOUT_Consumer			consumer[DIGITAL_IO_FANOUT_CONSUMERS];
+	 DIGITAL_IO_FANOUT_Command			command[DIGITAL_IO_FANOUT_COMMANDS];
+	 DIGITAL_IO_FANOUT_Slot				slot[DIGITAL_IO_FANOUT_SLOTS];
+ } DIGITAL_IO_FANOUT_Shared;
+
+ // Mapping of the shared memory in one process
+ typedef struct _DIGITAL_IO_FANOUT_TypeDef
+ {
+	 DIGITAL_IO_FANOUT_Shared*			shared;
+	 char								name[64];
+	 uint8_t							owner;			// created by this process (daemon)
+ } DIGITAL_IO_FANOUT_TypeDef;
+
+ /**
+   * @brief  DIGITAL_IO_Fanout_Create
+   *         Create (or reset) the shared memory of a module (daemon).
+   * @param  fanout: mapping
+   * @param  name: POSIX shared memory name ("/digital_io_<serial>")
+   * @retval 0 = OK, -1 = error (errno)
+   */
+ int DIGITAL_IO_Fanout_Create(DIGITAL_IO_FANOUT_TypeDef* fanout, const char* name);
+
+ /**
+   * @brief  DIGITAL_IO_Fanout_Open
+   *         Map the shared memory of a module created by its daemon (consumer).
+   * @param  fanout: mapping
+   * @param  name: POSIX shared memory name
+   * @retval 0 = OK, -1 = error (errno)
+   */
+ int DIGITAL_IO_Fanout_Open(DIGITAL_IO_FANOUT_TypeDef* fanout, const char* name);
+
+ /**
+   * @brief  DIGITAL_IO_Fanout_Close
+   *         Unmap the shared memory, the daemon also removes it.
+   * @param  fanout: mapping
+   * @retval None
+   */
+ void DIGITAL_IO_Fanout_Close(DIGITAL_IO_FANOUT_TypeDef* fanout);
+
+ /**
+   * @brief  DIGITAL_IO_Fanout_Publish
+   *         Append an input report of the module (daemon only).
+   * @param  fanout: mapping
+   * @param  report: input report
+   * @param  length: bytes of the report (clipped to DIGITAL_IO_FANOUT_REPORT_SIZE)
+   * @param  host_time: read time of the report
+   * @retval 0 = published, -1 = a reliable consumer still holds the slot (retry later)
+   */
+ int DIGITAL_IO_Fanout_Publish(DIGITAL_IO_FANOUT_TypeDef* fanout, const uint8_t* report, uint16_t length, uint64_t host_time);
+
+ /**
+   * @brief  DIGITAL_IO_Fanout_Reap
+   *         Detach the consumers of processes which exited without detaching (daemon).
+   * @param  fanout: mapping
+   * @retval Detached consumers
+   */
+ uint32_t DIGITAL_IO_Fanout_Reap(DIGITAL_IO_FANOUT_TypeDef* fanout);
+
+ /**
+   * @brief  DIGITAL_IO_Fanout_Attach
+   *         Take a consumer entry, the consumer starts with the next published report.
+   * @param  fanout: mapping
+   * @param  mode: DIGITAL_IO_FANOUT_RELIABLE or DIGITAL_IO_FANOUT_LOSSY
+   * @retval Consumer index, -1 = all entries taken
+   */
+ int DIGITAL_IO_Fanout_Attach(DIGITAL_IO_FANOUT_TypeDef* fanout, uint32_t mode);
+
+ /**
+   * @brief  DIGITAL_IO_Fanout_Detach
+   *         Free a consumer entry.
+   * @param  fanout: mapping
+   * @param  consumer: consumer index
+   * @retval None
+   */
+ void DIGITAL_IO_Fanout_Detach(DIGITAL_IO_FANOUT_TypeDef* fanout, int consumer);
+
+ /**
+   * @brief  DIGITAL_IO_Fanout_Peek
+   *         Next report of a consumer, read in place.
+   *         A lossy consumer checks the report with DIGITAL_IO_Fanout_Release.
+   * @param  fanout: mapping
+   * @param  consumer: consumer index
+   * @retval Report slot, NULL = no new report
+   */
+ const DIGITAL_IO_FANOUT_Slot* DIGITAL_IO_Fanout_Peek(DIGITAL_IO_FANOUT_TypeDef* fanout, int consumer);
+
+ /**
+   * @brief  DIGITAL_IO_Fanout_Release
+   *         Done with the report returned by DIGITAL_IO_Fanout_Peek.
+   * @param  fanout: mapping
+   * @param  consumer: consumer index
+   * @retval 0 = the report was intact, -1 = overwritten while it was read (lossy consumer, counted as lost)
+   */
+ int DIGITAL_IO_Fanout_Release(DIGITAL_IO_FANOUT_TypeDef* fanout, int consumer);
+
+ /**
+   * @brief  DIGITAL_IO_Fanout_Push_Command
+   *         Queue an output report for the module (any process).
+   * @param  fanout: mapping
+   * @param  report: output report (DIGITAL_IO_FANOUT_COMMAND_SIZE bytes)
+   * @retval Ticket of the command (global order), -1 = command ring full
+   */
+ int64_t DIGITAL_IO_Fanout_Push_Command(DIGITAL_IO_FANOUT_TypeDef* fanout, const uint8_t* report);
+
+ /**
+   * @brief  DIGITAL_IO_Fanout_Pop_Command
+   *         Next output report in ticket order (daemon only).
+   * @param  fanout: mapping
+   * @param  report: output report (DIGITAL_IO_FANOUT_COMMAND_SIZE bytes)
+   * @retval 0 = report copied, -1 = no command
+   */
+ int DIGITAL_IO_Fanout_Pop_Command(DIGITAL_IO_FANOUT_TypeDef* fanout, uint8_t* report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __DIGITAL_IO_FANOUT_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
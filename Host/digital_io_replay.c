@@ -0,0 +1,328 @@
+/**
+  ******************************************************************************
+  * @file    digital_io_replay.c
+  * @brief   Host capture-to-stimulus pipeline.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  * @verbatim
+  *
+  * A golden DUT is recorded with run length reports (REPORT_CAPTURE_RUN) and
+  * one rate group is replayed by the stimulus engine of the module:
+  * - the runs of the group become steps: consecutive runs with the same level
+  *   (split at the maximum run length, or around lost records) are one step,
+  *   a step is held for its ticks of unit = decimation * period
+  * - the ticks come from the timestamps of the runs on an absolute schedule
+  *   (rounded to the tick, the rounding errors do not add up)
+  * - a step word holds up to 255 ticks, longer steps take a second word; a
+  *   step held longer than DIGITAL_IO_REPLAY_MAX_HOLD cycles is repeated
+  * - the program is uploaded with COMMAND_UPLOAD (UPLOAD_STIMULUS) and feature
+  *   reports of at most 4096 bytes; the module refuses a report which goes past
+  *   the end of the program buffer, so the last chunk carries exactly the
+  *   remaining bytes
+  * - COMMAND_STIMULUS_RUN carries the checksum, the module answers with
+  *   REPORT_STIMULUS: the steps played and the lateness of the steps against
+  *   the schedule; a step later than one tick could land in the next record of
+  *   a capture at the same rate
+  *
+  * @endverbatim
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "digital_io_replay.h"
+#include <errno.h>
+#include <linux/hidraw.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+
+/* Private function prototypes -------------------------------------*/
+static int DIGITAL_IO_Replay_Step(DIGITAL_IO_REPLAY_Program* program, uint32_t value, uint64_t ticks);
+static int DIGITAL_IO_Replay_Command(uint8_t command, const uint8_t* payload, uint8_t length, uint8_t* sequence,
+									 DIGITAL_IO_Replay_Write write, void* context);
+
+
+/* Private functions -------------------------------------*/
+/**
+  * @brief  DIGITAL_IO_Replay_Step
+  *         Append the words of a step (held for ticks).
+  * @retval 0 = OK, -1 = program full
+  */
+static int DIGITAL_IO_Replay_Step(DIGITAL_IO_REPLAY_Program* program, uint32_t value, uint64_t ticks)
+{
+	// The module waits for a deadline with a signed 32-bit compare: longer steps are repeated
+	uint64_t limit = DIGITAL_IO_REPLAY_MAX_HOLD / program->unit;
+	uint32_t part = 0;
+
+	while (ticks > 0)
+	{
+		part = (uint32_t)((ticks > limit) ? limit : ticks);
+		if (part <= DIGITAL_IO_REPLAY_MAX_TICKS)
+		{
+			if (program->num + 1U > DIGITAL_IO_REPLAY_MAX_WORDS)
+			{
+				errno = ENOSPC;
+				return -1;
+			}
+			program->words[program->num++] = value | (part << DIGITAL_IO_REPLAY_TICKS_SHIFT);
+			program->checksum += value | (part << DIGITAL_IO_REPLAY_TICKS_SHIFT);
+		}
+		else
+		{
+			if (program->num + 2U > DIGITAL_IO_REPLAY_MAX_WORDS)
+			{
+				errno = ENOSPC;
+				return -1;
+			}
+			program->words[program->num++] = value;
+			program->words[program->num++] = part;
+			program->checksum += value + part;
+		}
+		program->steps++;
+		program->ticks += part;
+		ticks -= part;
+	}
+	return 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Replay_Command
+  *         Send an output report: command, payload, sequence number in the last byte.
+  * @retval 0 = sent, -1 = error (errno)
+  */
+static int DIGITAL_IO_Replay_Command(uint8_t command, const uint8_t* payload, uint8_t length, uint8_t* sequence,
+									 DIGITAL_IO_Replay_Write write, void* context)
+{
+	uint8_t report[DIGITAL_IO_REPLAY_OUTPUT_SIZE] = {0};
+
+	report[0] = command;
+	memcpy(&report[1], payload, length);
+	report[DIGITAL_IO_REPLAY_SEQUENCE_BYTE] = (*sequence)++;
+	return write(context, report, sizeof(report), 0);
+}
+
+
+/* Exported functions -------------------------------------*/
+/**
+  * @brief  DIGITAL_IO_Replay_Init
+  *         Empty program for a rate group of a capture.
+  * @retval 0 = OK, -1 = unknown group or state mode capture (errno)
+  */
+int DIGITAL_IO_Replay_Init(DIGITAL_IO_REPLAY_Program* program, const DIGITAL_IO_DECODE_Capture* capture, uint8_t group)
+{
+	uint64_t unit = 0;
+
+	memset(program, 0, sizeof(*program));
+	// State mode: the timestamps count DUT clocks
+	if (group >= capture->group_num || capture->period <= 1)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	unit = (uint64_t)capture->group[group].decimation * capture->period;
+	if (unit == 0 || unit > DIGITAL_IO_REPLAY_MAX_HOLD)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	program->group = group;
+	program->mask = capture->group[group].mask;
+	program->unit = (uint32_t)unit;
+	return 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Replay_Add
+  *         Add a REPORT_CAPTURE_RUN.
+  * @retval 1 = added, 0 = other report or group, -1 = program full (errno)
+  */
+int DIGITAL_IO_Replay_Add(DIGITAL_IO_REPLAY_Program* program, const uint8_t* report, uint16_t length)
+{
+	DIGITAL_IO_DECODE_Run run;
+	uint64_t tick = 0;
+
+	if (DIGITAL_IO_Decode_Run(report, length, &run) != 0 || run.group != program->group)
+	{
+		return 0;
+	}
+	run.value &= program->mask;
+	if (program->open || program->steps)
+	{
+		program->elapsed += (uint32_t)(run.timestamp - program->timestamp);
+	}
+	program->timestamp = run.timestamp;
+	program->lost += run.lost;
+	tick = (program->elapsed + program->unit / 2) / program->unit;
+
+	if (program->open && run.value != program->value)
+	{
+		if (DIGITAL_IO_Replay_Step(program, program->value, tick - program->start) != 0)
+		{
+			return -1;
+		}
+		program->open = 0;
+	}
+	if (!program->open)
+	{
+		program->open = 1;
+		program->value = run.value;
+		program->start = tick;
+	}
+	program->end = tick + run.length;
+	return 1;
+}
+
+/**
+  * @brief  DIGITAL_IO_Replay_Finish
+  *         Write the last step.
+  * @retval 0 = OK, -1 = program full (errno)
+  */
+int DIGITAL_IO_Replay_Finish(DIGITAL_IO_REPLAY_Program* program)
+{
+	if (!program->open)
+	{
+		return 0;
+	}
+	if (DIGITAL_IO_Replay_Step(program, program->value, program->end - program->start) != 0)
+	{
+		return -1;
+	}
+	program->open = 0;
+	return 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Replay_Send
+  *         Configure the playback, upload the program and start it.
+  * @retval 0 = sent, -1 = error (errno)
+  */
+int DIGITAL_IO_Replay_Send(const DIGITAL_IO_REPLAY_Program* program, uint32_t mask, uint8_t flags, uint8_t* sequence,
+						   DIGITAL_IO_Replay_Write write, void* context)
+{
+	uint8_t payload[DIGITAL_IO_REPLAY_SEQUENCE_BYTE - 1] = {0};
+	const uint8_t* data = (const uint8_t*)program->words;
+	uint32_t size = program->num * sizeof(uint32_t), offset = 0, chunk = 0;
+
+	if (program->open || program->num == 0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	mask = (mask != 0) ? mask : program->mask;
+
+	// COMMAND_STIMULUS_CONFIG: driven bits, time unit, flags
+	payload[0] = (uint8_t)(mask);
+	payload[1] = (uint8_t)(mask >> 8);
+	payload[2] = (uint8_t)(mask >> 16);
+	memcpy(&payload[3], &program->unit, sizeof(program->unit));
+	payload[7] = flags & (DIGITAL_IO_REPLAY_VERIFY | DIGITAL_IO_REPLAY_ISOLATE);
+	if (DIGITAL_IO_Replay_Command(DIGITAL_IO_REPLAY_CONFIG, payload, 8, sequence, write, context) != 0)
+	{
+		return -1;
+	}
+
+	// COMMAND_UPLOAD from offset 0, then the chunks (the module words are little endian like the host)
+	memset(payload, 0, sizeof(payload));
+	payload[0] = DIGITAL_IO_REPLAY_TARGET;
+	if (DIGITAL_IO_Replay_Command(DIGITAL_IO_REPLAY_UPLOAD, payload, 5, sequence, write, context) != 0)
+	{
+		return -1;
+	}
+	for (offset = 0; offset < size; offset += chunk)
+	{
+		chunk = (size - offset < DIGITAL_IO_REPLAY_CHUNK_SIZE) ? size - offset : DIGITAL_IO_REPLAY_CHUNK_SIZE;
+		if (write(context, &data[offset], (uint16_t)chunk, 1) != 0)
+		{
+			return -1;
+		}
+	}
+
+	// COMMAND_STIMULUS_RUN: words and checksum
+	payload[0] = (uint8_t)(program->num);
+	payload[1] = (uint8_t)(program->num >> 8);
+	memcpy(&payload[2], &program->checksum, sizeof(program->checksum));
+	return DIGITAL_IO_Replay_Command(DIGITAL_IO_REPLAY_RUN, payload, 6, sequence, write, context);
+}
+
+/**
+  * @brief  DIGITAL_IO_Replay_Hidraw
+  *         Transport on a hidraw device.
+  * @retval 0 = sent, -1 = error (errno)
+  */
+int DIGITAL_IO_Replay_Hidraw(void* context, const uint8_t* report, uint16_t length, uint8_t feature)
+{
+	uint8_t buffer[1 + DIGITAL_IO_REPLAY_CHUNK_SIZE];	// report number 0 (no report IDs) + report
+	int fd = *(int*)context;
+
+	if (length > DIGITAL_IO_REPLAY_CHUNK_SIZE)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	buffer[0] = 0;
+	memcpy(&buffer[1], report, length);
+	if (feature)
+	{
+		// A stalled transfer (busy or past the end of the program buffer) fails the ioctl
+		return (ioctl(fd, HIDIOCSFEATURE(1 + length), buffer) < 0) ? -1 : 0;
+	}
+	return (write(fd, buffer, 1 + length) < 0) ? -1 : 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Replay_Check
+  *         Compare a REPORT_STIMULUS with the program and the capture timing.
+  * @retval 0 = faithful playback, DIGITAL_IO_REPLAY_FAIL_x flags, -1 = no stimulus report
+  */
+int DIGITAL_IO_Replay_Check(const DIGITAL_IO_REPLAY_Program* program, const uint8_t* report, uint16_t length, uint32_t tolerance,
+							DIGITAL_IO_REPLAY_Result* result)
+{
+	int fail = 0;
+
+	if (length < DIGITAL_IO_DECODE_REPORT_SIZE || report[0] != (DIGITAL_IO_DECODE_EXTENDED | DIGITAL_IO_REPLAY_REPORT))
+	{
+		return -1;
+	}
+	result->flags = report[1];
+	result->steps = (uint16_t)(report[2] | (report[3] << 8));
+	result->late_max = (uint32_t)report[4] | ((uint32_t)report[5] << 8) | ((uint32_t)report[6] << 16);
+	result->late_mean = (uint16_t)(report[7] | (report[8] << 8));
+	result->mismatches = (uint16_t)(report[9] | (report[10] << 8));
+
+	tolerance = (tolerance != 0) ? tolerance : program->unit;
+	if (result->flags & (DIGITAL_IO_REPLAY_CHECKSUM_ERROR | DIGITAL_IO_REPLAY_TRUNCATED))
+	{
+		fail |= DIGITAL_IO_REPLAY_FAIL_PROGRAM;
+	}
+	if (result->steps != program->steps)
+	{
+		fail |= DIGITAL_IO_REPLAY_FAIL_STEPS;
+	}
+	if (result->late_max > tolerance)
+	{
+		fail |= DIGITAL_IO_REPLAY_FAIL_LATE;
+	}
+	if (result->mismatches != 0)
+	{
+		fail |= DIGITAL_IO_REPLAY_FAIL_PINS;
+	}
+	return fail;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
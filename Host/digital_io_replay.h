@@ -0,0 +1,174 @@
+/**
+  ******************************************************************************
+  * @file    digital_io_replay.h
+  * @brief   Host capture-to-stimulus pipeline: step program of a recorded rate
+  *          group, chunked upload and check of the playback timing.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "digital_io_decode.h"
+
+
+/* Defines -------------------------------------*/
+#ifndef __DIGITAL_IO_REPLAY_H
+#define __DIGITAL_IO_REPLAY_H
+
+// Commands and program layout of the module (usbd_digital_io.h, usbd_digital_io_stimulus.h)
+#define DIGITAL_IO_REPLAY_OUTPUT_SIZE	(0x0CU)		// DIGITAL_IO_OUTPUT_REPORT_SIZE
+#define DIGITAL_IO_REPLAY_SEQUENCE_BYTE	(0x0BU)		// DIGITAL_IO_SEQUENCE_BYTE
+#define DIGITAL_IO_REPLAY_UPLOAD		(0x14U)		// COMMAND_UPLOAD
+#define DIGITAL_IO_REPLAY_CONFIG		(0x22U)		// COMMAND_STIMULUS_CONFIG
+#define DIGITAL_IO_REPLAY_RUN			(0x23U)		// COMMAND_STIMULUS_RUN
+#define DIGITAL_IO_REPLAY_REPORT		(0x0EU)		// REPORT_STIMULUS
+#define DIGITAL_IO_REPLAY_TARGET		(0x06U)		// UPLOAD_STIMULUS
+#define DIGITAL_IO_REPLAY_CHUNK_SIZE	(0x1000U)	// DIGITAL_IO_UPLOAD_REPORT_SIZE
+#define DIGITAL_IO_REPLAY_MAX_WORDS		(0x1000U)	// DIGITAL_IO_STIMULUS_MAX_WORDS
+#define DIGITAL_IO_REPLAY_TICKS_SHIFT	(0x18U)		// step word: ticks in bits 24-31 (0 = next word holds the ticks)
+#define DIGITAL_IO_REPLAY_MAX_TICKS		(0xFFU)
+#define DIGITAL_IO_REPLAY_MAX_HOLD		(0x7FFFFFFFU)	// CPU cycles of a step (signed deadline compare)
+
+// Playback flags (COMMAND_STIMULUS_CONFIG) and results (REPORT_STIMULUS)
+#define DIGITAL_IO_REPLAY_VERIFY		(0x01U)		// DIGITAL_IO_STIMULUS_VERIFY
+#define DIGITAL_IO_REPLAY_ISOLATE		(0x02U)		// DIGITAL_IO_STIMULUS_ISOLATE
+#define DIGITAL_IO_REPLAY_CHECKSUM_ERROR	(0x10U)	// DIGITAL_IO_STIMULUS_CHECKSUM_ERROR
+#define DIGITAL_IO_REPLAY_TRUNCATED		(0x20U)		// DIGITAL_IO_STIMULUS_TRUNCATED
+
+// Failures of DIGITAL_IO_Replay_Check
+#define DIGITAL_IO_REPLAY_FAIL_STEPS	(0x01U)		// not every step was played
+#define DIGITAL_IO_REPLAY_FAIL_LATE		(0x02U)		// a step came later than the tolerance
+#define DIGITAL_IO_REPLAY_FAIL_PINS		(0x04U)		// the verify pass read a wrong level back
+#define DIGITAL_IO_REPLAY_FAIL_PROGRAM	(0x08U)		// checksum error or truncated program
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ /* Step program of one rate group: a step per level change, held for its duration
+  * in ticks of unit = decimation * period of the capture.
+  */
+ typedef struct _DIGITAL_IO_REPLAY_Program
+ {
+	 uint32_t							words[DIGITAL_IO_REPLAY_MAX_WORDS];
+	 uint16_t							num;			// program words
+	 uint16_t							steps;
+	 uint32_t							checksum;		// 32-bit sum of the words
+	 uint32_t							unit;			// CPU cycles per tick
+	 uint32_t							mask;			// logical bits of the group
+	 uint64_t							ticks;			// duration of the program
+	 uint8_t							group;
+	 uint8_t							open;			// a step is being recorded
+	 uint32_t							value;			// level of the open step
+	 uint64_t							start;			// tick of the open step
+	 uint64_t							end;			// tick after its last record
+	 uint32_t							timestamp;		// last run
+	 uint64_t							elapsed;		// CPU cycles from the first run to the last one
+	 uint32_t							lost;			// records lost by the module (levels held over the gap)
+ } DIGITAL_IO_REPLAY_Program;
+
+ // REPORT_STIMULUS
+ typedef struct _DIGITAL_IO_REPLAY_Result
+ {
+	 uint8_t							flags;			// config flags | result flags
+	 uint16_t							steps;
+	 uint32_t							late_max;		// CPU cycles
+	 uint16_t							late_mean;		// CPU cycles
+	 uint16_t							mismatches;
+ } DIGITAL_IO_REPLAY_Result;
+
+ /* Transport of the reports: output reports (12 bytes) or feature reports
+  * (upload chunks).
+  * @retval 0 = sent, -1 = error (errno)
+  */
+ typedef int (*DIGITAL_IO_Replay_Write)(void* context, const uint8_t* report, uint16_t length, uint8_t feature);
+
+ /**
+   * @brief  DIGITAL_IO_Replay_Init
+   *         Empty program for a rate group of a capture.
+   * @param  program: program
+   * @param  capture: capture settings (DIGITAL_IO_Decode_Setup)
+   * @param  group: rate group to replay
+   * @retval 0 = OK, -1 = unknown group or state mode capture (no CPU time base) (errno)
+   */
+ int DIGITAL_IO_Replay_Init(DIGITAL_IO_REPLAY_Program* program, const DIGITAL_IO_DECODE_Capture* capture, uint8_t group);
+
+ /**
+   * @brief  DIGITAL_IO_Replay_Add
+   *         Add a REPORT_CAPTURE_RUN: the runs of the group are merged into steps
+   *         timed by their timestamps (a gap of lost records extends the previous step).
+   * @param  program: program
+   * @param  report: input report
+   * @param  length: bytes of the report
+   * @retval 1 = added, 0 = other report or group, -1 = program full (errno)
+   */
+ int DIGITAL_IO_Replay_Add(DIGITAL_IO_REPLAY_Program* program, const uint8_t* report, uint16_t length);
+
+ /**
+   * @brief  DIGITAL_IO_Replay_Finish
+   *         Write the last step.
+   * @param  program: program
+   * @retval 0 = OK, -1 = program full (errno)
+   */
+ int DIGITAL_IO_Replay_Finish(DIGITAL_IO_REPLAY_Program* program);
+
+ /**
+   * @brief  DIGITAL_IO_Replay_Send
+   *         Configure the playback, upload the program and start it:
+   *         COMMAND_STIMULUS_CONFIG, COMMAND_UPLOAD (UPLOAD_STIMULUS), the feature
+   *         reports of at most DIGITAL_IO_REPLAY_CHUNK_SIZE bytes (the last one with
+   *         exactly the remaining bytes) and COMMAND_STIMULUS_RUN.
+   * @param  program: finished program
+   * @param  mask: driven logical bits (0 = the bits of the group)
+   * @param  flags: DIGITAL_IO_REPLAY_VERIFY | DIGITAL_IO_REPLAY_ISOLATE
+   * @param  sequence: sequence number of the first output report, incremented
+   * @param  write: transport
+   * @param  context: context of the transport
+   * @retval 0 = sent, -1 = error (errno)
+   */
+ int DIGITAL_IO_Replay_Send(const DIGITAL_IO_REPLAY_Program* program, uint32_t mask, uint8_t flags, uint8_t* sequence,
+							DIGITAL_IO_Replay_Write write, void* context);
+
+ /**
+   * @brief  DIGITAL_IO_Replay_Hidraw
+   *         Transport on a hidraw device (context = pointer to the file descriptor).
+   * @retval 0 = sent, -1 = error (errno)
+   */
+ int DIGITAL_IO_Replay_Hidraw(void* context, const uint8_t* report, uint16_t length, uint8_t feature);
+
+ /**
+   * @brief  DIGITAL_IO_Replay_Check
+   *         Compare a REPORT_STIMULUS with the program and the capture timing.
+   * @param  program: played program
+   * @param  report: input report
+   * @param  length: bytes of the report
+   * @param  tolerance: largest lateness of a step (CPU cycles, 0 = one tick: the
+   *                    recorded change and the played one fall in the same record)
+   * @param  result: decoded report
+   * @retval 0 = faithful playback, DIGITAL_IO_REPLAY_FAIL_x flags, -1 = no stimulus report
+   */
+ int DIGITAL_IO_Replay_Check(const DIGITAL_IO_REPLAY_Program* program, const uint8_t* report, uint16_t length, uint32_t tolerance,
+							 DIGITAL_IO_REPLAY_Result* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __DIGITAL_IO_REPLAY_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,796 @@
+/**
+  ******************************************************************************
+  * @file    digital_io_store.c
+  * @brief   Host capture store with bitmap queries.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  * @verbatim
+  *
+  * The store is columnar: a row starts at every change of the 24 logical
+  * bits, the start times of the rows are one column and every logical bit is
+  * a bitplane over the rows. 64 rows are transposed at once
+  * (DIGITAL_IO_Decode_Transpose) and the plane words are appended to run-length
+  * compressed bitmaps: a pin which holds its level over thousands of rows
+  * costs one marker word.
+  *
+  * The rate groups report independently (round robin, different periods):
+  * the changes of a group wait in its queue until every group reported past
+  * them, then they are merged in time order into the rows.
+  *
+  * A query is an OR of AND terms of pin levels. It runs on the compressed
+  * words: a 0 fill of any term of an AND skips its whole length in all the
+  * other bitmaps, all-1 fills give a 1 fill, only literal words are combined
+  * word by word. The OR is an AND of the inverted terms, inverted. The 1 bits
+  * of the result are the rows of the intervals.
+  *
+  * Times are the 32-bit timestamps of the module extended to 64 bits (the low
+  * 32 bits are the timestamps of the reports); the groups must not be more
+  * than 2^31 CPU cycles apart.
+  *
+  * @endverbatim
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "digital_io_store.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* Defines -------------------------------------*/
+#define DIGITAL_IO_STORE_FILL_SHIFT		(1U)
+#define DIGITAL_IO_STORE_FILL_MAX		(0xFFFFFFFFULL)
+#define DIGITAL_IO_STORE_LITERAL_SHIFT	(33U)
+#define DIGITAL_IO_STORE_LITERAL_MAX	(0x7FFFFFFFULL)
+#define DIGITAL_IO_STORE_FILL(marker)		(((marker) >> DIGITAL_IO_STORE_FILL_SHIFT) & DIGITAL_IO_STORE_FILL_MAX)
+#define DIGITAL_IO_STORE_LITERALS(marker)	((marker) >> DIGITAL_IO_STORE_LITERAL_SHIFT)
+
+#define DIGITAL_IO_STORE_FIRST_TIME		(0x100000000ULL)	// extended time of the first report: earlier reports of other groups stay positive
+#define DIGITAL_IO_STORE_MIN_CAPACITY	(0x400U)
+
+
+/* Private typedef -------------------------------------*/
+// Read position in a compressed bitmap, optionally inverted
+typedef struct
+{
+	const uint64_t*			words;
+	size_t					size;
+	size_t					position;		// next word of the array
+	uint64_t				fill;			// fill words left in the current marker
+	uint64_t				fill_word;
+	uint64_t				literal;		// literal words left in the current marker
+	uint64_t				tail;			// open rows after the compressed words
+	uint64_t				invert;			// 0 or all bits
+} DIGITAL_IO_STORE_Cursor;
+
+
+/* Private function prototypes -------------------------------------*/
+static int DIGITAL_IO_Store_Bitmap_Push(DIGITAL_IO_STORE_Bitmap* bitmap, uint64_t word);
+static int DIGITAL_IO_Store_Bitmap_Fill(DIGITAL_IO_STORE_Bitmap* bitmap, uint64_t bit, uint64_t count);
+static int DIGITAL_IO_Store_Bitmap_Literal(DIGITAL_IO_STORE_Bitmap* bitmap, uint64_t word);
+static void DIGITAL_IO_Store_Cursor_Init(DIGITAL_IO_STORE_Cursor* cursor, const DIGITAL_IO_STORE_Bitmap* bitmap, const uint64_t* tail, uint64_t invert);
+static uint64_t DIGITAL_IO_Store_Cursor_Peek(DIGITAL_IO_STORE_Cursor* cursor, uint64_t* word);
+static void DIGITAL_IO_Store_Cursor_Skip(DIGITAL_IO_STORE_Cursor* cursor, uint64_t count);
+static int DIGITAL_IO_Store_And(DIGITAL_IO_STORE_Cursor* cursor, size_t cursor_num, uint64_t length, uint64_t invert, DIGITAL_IO_STORE_Bitmap* result);
+static int DIGITAL_IO_Store_Append(DIGITAL_IO_STORE_TypeDef* store, uint64_t time, uint32_t value);
+static int DIGITAL_IO_Store_Commit(DIGITAL_IO_STORE_TypeDef* store, uint64_t watermark);
+static int DIGITAL_IO_Store_Queue(DIGITAL_IO_STORE_TypeDef* store, uint8_t group_idx, uint64_t time, uint32_t value, uint64_t length);
+static uint64_t DIGITAL_IO_Store_Extend(DIGITAL_IO_STORE_TypeDef* store, uint32_t timestamp);
+
+
+/* Private functions -------------------------------------*/
+/**
+  * @brief  DIGITAL_IO_Store_Bitmap_Push
+  *         Append a raw word (marker or literal).
+  * @retval 0 = OK, -1 = no memory
+  */
+static int DIGITAL_IO_Store_Bitmap_Push(DIGITAL_IO_STORE_Bitmap* bitmap, uint64_t word)
+{
+	uint64_t* words = 0;
+	size_t capacity = 0;
+
+	if (bitmap->size == bitmap->capacity)
+	{
+		capacity = bitmap->capacity ? bitmap->capacity * 2 : 16;
+		words = realloc(bitmap->words, capacity * sizeof(uint64_t));
+		if (words == NULL)
+		{
+			return -1;
+		}
+		bitmap->words = words;
+		bitmap->capacity = capacity;
+	}
+	bitmap->words[bitmap->size++] = word;
+	return 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Store_Bitmap_Fill
+  *         Append words with all bits = bit.
+  * @retval 0 = OK, -1 = no memory
+  */
+static int DIGITAL_IO_Store_Bitmap_Fill(DIGITAL_IO_STORE_Bitmap* bitmap, uint64_t bit, uint64_t count)
+{
+	uint64_t marker = 0, fill = 0, add = 0;
+
+	while (count > 0)
+	{
+		marker = bitmap->size ? bitmap->words[bitmap->marker] : 0;
+		fill = DIGITAL_IO_STORE_FILL(marker);
+		// The fill of a marker comes before its literals: extend it only while there are none
+		if (bitmap->size == 0 || DIGITAL_IO_STORE_LITERALS(marker) != 0 || (fill != 0 && (marker & 0x01U) != bit)
+			|| fill == DIGITAL_IO_STORE_FILL_MAX)
+		{
+			if (DIGITAL_IO_Store_Bitmap_Push(bitmap, 0) != 0)
+			{
+				return -1;
+			}
+			bitmap->marker = bitmap->size - 1;
+			continue;
+		}
+		add = (count < DIGITAL_IO_STORE_FILL_MAX - fill) ? count : DIGITAL_IO_STORE_FILL_MAX - fill;
+		bitmap->words[bitmap->marker] = ((fill + add) << DIGITAL_IO_STORE_FILL_SHIFT) | bit;
+		bitmap->length += add;
+		count -= add;
+	}
+	return 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Store_Bitmap_Literal
+  *         Append one word (all-0 and all-1 words become fills).
+  * @retval 0 = OK, -1 = no memory
+  */
+static int DIGITAL_IO_Store_Bitmap_Literal(DIGITAL_IO_STORE_Bitmap* bitmap, uint64_t word)
+{
+	if (word == 0 || word == ~0ULL)
+	{
+		return DIGITAL_IO_Store_Bitmap_Fill(bitmap, word & 0x01U, 1);
+	}
+	if (bitmap->size == 0 || DIGITAL_IO_STORE_LITERALS(bitmap->words[bitmap->marker]) == DIGITAL_IO_STORE_LITERAL_MAX)
+	{
+		if (DIGITAL_IO_Store_Bitmap_Push(bitmap, 0) != 0)
+		{
+			return -1;
+		}
+		bitmap->marker = bitmap->size - 1;
+	}
+	if (DIGITAL_IO_Store_Bitmap_Push(bitmap, word) != 0)
+	{
+		return -1;
+	}
+	bitmap->words[bitmap->marker] += 1ULL << DIGITAL_IO_STORE_LITERAL_SHIFT;
+	bitmap->length++;
+	return 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Store_Cursor_Init
+  *         Read a bitmap from the start.
+  * @param  tail: word after the compressed ones, NULL = none
+  * @retval None
+  */
+static void DIGITAL_IO_Store_Cursor_Init(DIGITAL_IO_STORE_Cursor* cursor, const DIGITAL_IO_STORE_Bitmap* bitmap, const uint64_t* tail, uint64_t invert)
+{
+	memset(cursor, 0, sizeof(*cursor));
+	cursor->words = bitmap->words;
+	cursor->size = bitmap->size;
+	cursor->tail = tail ? *tail : 0;
+	cursor->invert = invert;
+}
+
+/**
+  * @brief  DIGITAL_IO_Store_Cursor_Peek
+  *         Current word of a cursor.
+  * @retval Words of the current fill, 0 = literal word
+  */
+static uint64_t DIGITAL_IO_Store_Cursor_Peek(DIGITAL_IO_STORE_Cursor* cursor, uint64_t* word)
+{
+	uint64_t marker = 0;
+
+	while (cursor->fill == 0 && cursor->literal == 0 && cursor->position < cursor->size)
+	{
+		marker = cursor->words[cursor->position++];
+		cursor->fill_word = (marker & 0x01U) ? ~0ULL : 0;
+		cursor->fill = DIGITAL_IO_STORE_FILL(marker);
+		cursor->literal = DIGITAL_IO_STORE_LITERALS(marker);
+	}
+	if (cursor->fill)
+	{
+		*word = cursor->fill_word ^ cursor->invert;
+		return cursor->fill;
+	}
+	*word = (cursor->literal ? cursor->words[cursor->position] : cursor->tail) ^ cursor->invert;
+	return 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Store_Cursor_Skip
+  *         Move a cursor by count words.
+  * @retval None
+  */
+static void DIGITAL_IO_Store_Cursor_Skip(DIGITAL_IO_STORE_Cursor* cursor, uint64_t count)
+{
+	uint64_t word = 0, step = 0;
+
+	while (count > 0)
+	{
+		if (DIGITAL_IO_Store_Cursor_Peek(cursor, &word))
+		{
+			step = (count < cursor->fill) ? count : cursor->fill;
+			cursor->fill -= step;
+		}
+		else if (cursor->literal)
+		{
+			step = (count < cursor->literal) ? count : cursor->literal;
+			cursor->position += step;
+			cursor->literal -= step;
+		}
+		else
+		{
+			// The tail word
+			step = 1;
+		}
+		count -= step;
+	}
+}
+
+/**
+  * @brief  DIGITAL_IO_Store_And
+  *         AND of the bitmaps under the cursors (inverted if invert is all bits).
+  * @param  length: words of the bitmaps
+  * @retval 0 = OK, -1 = no memory
+  */
+static int DIGITAL_IO_Store_And(DIGITAL_IO_STORE_Cursor* cursor, size_t cursor_num, uint64_t length, uint64_t invert, DIGITAL_IO_STORE_Bitmap* result)
+{
+	uint64_t done = 0, zero = 0, one = 0, fill = 0, word = 0, value = 0, step = 0;
+	size_t cursor_idx = 0;
+	uint8_t literal = 0;
+
+	memset(result, 0, sizeof(*result));
+	while (done < length)
+	{
+		zero = 0;
+		one = length - done;
+		value = ~0ULL;
+		literal = 0;
+		for (cursor_idx = 0; cursor_idx < cursor_num; cursor_idx++)
+		{
+			fill = DIGITAL_IO_Store_Cursor_Peek(&cursor[cursor_idx], &word);
+			if (fill == 0)
+			{
+				literal = 1;
+			}
+			else if (word == 0)
+			{
+				zero = (fill > zero) ? fill : zero;
+			}
+			else
+			{
+				one = (fill < one) ? fill : one;
+			}
+			value &= word;
+		}
+
+		// A 0 fill of one term clears the same words of the AND
+		if (zero)
+		{
+			step = (zero < length - done) ? zero : length - done;
+			if (DIGITAL_IO_Store_Bitmap_Fill(result, invert & 0x01U, step) != 0)
+			{
+				return -1;
+			}
+		}
+		else if (!literal)
+		{
+			step = one;
+			if (DIGITAL_IO_Store_Bitmap_Fill(result, (~invert) & 0x01U, step) != 0)
+			{
+				return -1;
+			}
+		}
+		else
+		{
+			step = 1;
+			if (DIGITAL_IO_Store_Bitmap_Literal(result, value ^ invert) != 0)
+			{
+				return -1;
+			}
+		}
+		for (cursor_idx = 0; cursor_idx < cursor_num; cursor_idx++)
+		{
+			DIGITAL_IO_Store_Cursor_Skip(&cursor[cursor_idx], step);
+		}
+		done += step;
+	}
+	return 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Store_Append
+  *         New row, the open rows are compressed every 64 rows.
+  * @retval 0 = OK, -1 = no memory
+  */
+static int DIGITAL_IO_Store_Append(DIGITAL_IO_STORE_TypeDef* store, uint64_t time, uint32_t value)
+{
+	uint64_t words[DIGITAL_IO_DECODE_BIT_NUM], open = store->rows - store->plane[0].length * DIGITAL_IO_DECODE_PLANE_BITS;
+	uint64_t* times = 0;
+	uint64_t capacity = 0;
+	uint8_t bit = 0;
+
+	if (open == DIGITAL_IO_DECODE_PLANE_BITS)
+	{
+		DIGITAL_IO_Decode_Transpose(DIGITAL_IO_DECODE_AUTO, store->open, DIGITAL_IO_DECODE_PLANE_BITS, words, 1);
+		for (bit = 0; bit < DIGITAL_IO_DECODE_BIT_NUM; bit++)
+		{
+			if (DIGITAL_IO_Store_Bitmap_Literal(&store->plane[bit], words[bit]) != 0)
+			{
+				return -1;
+			}
+		}
+		open = 0;
+	}
+	if (store->rows == store->capacity)
+	{
+		capacity = store->capacity ? store->capacity * 2 : DIGITAL_IO_STORE_MIN_CAPACITY;
+		times = realloc(store->time, capacity * sizeof(uint64_t));
+		if (times == NULL)
+		{
+			return -1;
+		}
+		store->time = times;
+		store->capacity = capacity;
+	}
+	store->time[store->rows++] = time;
+	store->open[open] = value;
+	return 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Store_Commit
+  *         Merge the queued changes before the watermark into the rows.
+  * @retval 0 = OK, -1 = no memory
+  */
+static int DIGITAL_IO_Store_Commit(DIGITAL_IO_STORE_TypeDef* store, uint64_t watermark)
+{
+	DIGITAL_IO_STORE_Queue* queue = 0;
+	DIGITAL_IO_STORE_Change change;
+	uint32_t value = 0;
+	uint8_t group_idx = 0, next = 0;
+
+	for (;;)
+	{
+		next = DIGITAL_IO_DECODE_PORT_NUM;
+		for (group_idx = 0; group_idx < store->capture.group_num; group_idx++)
+		{
+			queue = &store->queue[group_idx];
+			if (queue->head != queue->tail && queue->change[queue->head].time < watermark
+				&& (next == DIGITAL_IO_DECODE_PORT_NUM || queue->change[queue->head].time < store->queue[next].change[store->queue[next].head].time))
+			{
+				next = group_idx;
+			}
+		}
+		if (next == DIGITAL_IO_DECODE_PORT_NUM)
+		{
+			break;
+		}
+		queue = &store->queue[next];
+		change = queue->change[queue->head++];
+		value = (store->value & ~store->capture.group[next].mask) | change.value;
+
+		// Groups changing at the same time: one row
+		if (store->rows > 0 && store->time[store->rows - 1] == change.time)
+		{
+			store->open[store->rows - 1 - store->plane[0].length * DIGITAL_IO_DECODE_PLANE_BITS] = value;
+		}
+		else if ((store->rows == 0 || value != store->value) && DIGITAL_IO_Store_Append(store, change.time, value) != 0)
+		{
+			return -1;
+		}
+		store->value = value;
+	}
+	if (watermark > store->end)
+	{
+		store->end = watermark;
+	}
+	return 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Store_Queue
+  *         Queue the records of a group, commit what every group reported.
+  * @retval 0 = OK, -1 = no memory
+  */
+static int DIGITAL_IO_Store_Queue(DIGITAL_IO_STORE_TypeDef* store, uint8_t group_idx, uint64_t time, uint32_t value, uint64_t length)
+{
+	const DIGITAL_IO_DECODE_Group* group = &store->capture.group[group_idx];
+	DIGITAL_IO_STORE_Queue* queue = &store->queue[group_idx];
+	DIGITAL_IO_STORE_Change* change = 0;
+	uint64_t watermark = ~0ULL;
+	size_t capacity = 0;
+
+	value &= group->mask;
+	if (!queue->valid || value != queue->value)
+	{
+		if (queue->tail == queue->capacity)
+		{
+			if (queue->head > 0)
+			{
+				memmove(queue->change, &queue->change[queue->head], (queue->tail - queue->head) * sizeof(DIGITAL_IO_STORE_Change));
+				queue->tail -= queue->head;
+				queue->head = 0;
+			}
+			else
+			{
+				capacity = queue->capacity ? queue->capacity * 2 : DIGITAL_IO_STORE_MIN_CAPACITY;
+				change = realloc(queue->change, capacity * sizeof(DIGITAL_IO_STORE_Change));
+				if (change == NULL)
+				{
+					return -1;
+				}
+				queue->change = change;
+				queue->capacity = capacity;
+			}
+		}
+		queue->change[queue->tail].time = time;
+		queue->change[queue->tail].value = value;
+		queue->tail++;
+	}
+	queue->value = value;
+	queue->valid = 1;
+	queue->end = time + length * group->decimation * store->capture.period;
+
+	for (group_idx = 0; group_idx < store->capture.group_num; group_idx++)
+	{
+		queue = &store->queue[group_idx];
+		if (!queue->valid)
+		{
+			return 0;
+		}
+		watermark = (queue->end < watermark) ? queue->end : watermark;
+	}
+	return DIGITAL_IO_Store_Commit(store, watermark);
+}
+
+/**
+  * @brief  DIGITAL_IO_Store_Extend
+  *         64-bit time of a report timestamp.
+  * @retval Time
+  */
+static uint64_t DIGITAL_IO_Store_Extend(DIGITAL_IO_STORE_TypeDef* store, uint32_t timestamp)
+{
+	uint64_t time = 0;
+
+	if (!store->started)
+	{
+		store->started = 1;
+		store->now = DIGITAL_IO_STORE_FIRST_TIME | timestamp;
+	}
+	time = store->now + (uint64_t)(int64_t)(int32_t)(timestamp - (uint32_t)store->now);
+	if (time > store->now)
+	{
+		store->now = time;
+	}
+	return time;
+}
+
+
+/* Exported functions -------------------------------------*/
+/**
+  * @brief  DIGITAL_IO_Store_Init
+  *         Empty store of a capture.
+  * @retval None
+  */
+void DIGITAL_IO_Store_Init(DIGITAL_IO_STORE_TypeDef* store, const DIGITAL_IO_DECODE_Capture* capture)
+{
+	memset(store, 0, sizeof(*store));
+	store->capture = *capture;
+}
+
+/**
+  * @brief  DIGITAL_IO_Store_Free
+  *         Release the memory of a store.
+  * @retval None
+  */
+void DIGITAL_IO_Store_Free(DIGITAL_IO_STORE_TypeDef* store)
+{
+	uint8_t idx = 0;
+
+	for (idx = 0; idx < DIGITAL_IO_DECODE_BIT_NUM; idx++)
+	{
+		free(store->plane[idx].words);
+	}
+	for (idx = 0; idx < DIGITAL_IO_DECODE_PORT_NUM; idx++)
+	{
+		free(store->queue[idx].change);
+	}
+	free(store->time);
+	memset(store, 0, sizeof(*store));
+}
+
+/**
+  * @brief  DIGITAL_IO_Store_Report
+  *         Add a capture report.
+  * @retval 1 = added, 0 = other report, -1 = error (errno)
+  */
+int DIGITAL_IO_Store_Report(DIGITAL_IO_STORE_TypeDef* store, const uint8_t* report, uint16_t length)
+{
+	DIGITAL_IO_DECODE_Run run;
+	DIGITAL_IO_DECODE_Records records;
+	uint64_t time = 0;
+	uint8_t rec_idx = 0;
+	int num = 0;
+
+	if (DIGITAL_IO_Decode_Run(report, length, &run) == 0)
+	{
+		if (run.group >= store->capture.group_num)
+		{
+			errno = EINVAL;
+			return -1;
+		}
+		store->lost += run.lost;
+		if (DIGITAL_IO_Store_Queue(store, run.group, DIGITAL_IO_Store_Extend(store, run.timestamp), run.value, run.length) != 0)
+		{
+			errno = ENOMEM;
+			return -1;
+		}
+		return 1;
+	}
+	if (length >= DIGITAL_IO_DECODE_REPORT_SIZE && report[0] == (DIGITAL_IO_DECODE_EXTENDED | DIGITAL_IO_DECODE_CAPTURE))
+	{
+		num = DIGITAL_IO_Decode_Report(&store->capture, report, length, &records);
+		if (num < 0)
+		{
+			errno = EINVAL;
+			return -1;
+		}
+		store->lost += records.lost;
+		time = DIGITAL_IO_Store_Extend(store, records.timestamp);
+		for (rec_idx = 0; rec_idx < num; rec_idx++)
+		{
+			if (DIGITAL_IO_Store_Queue(store, records.group, time + (uint64_t)rec_idx * records.period, records.samples[rec_idx], 1) != 0)
+			{
+				errno = ENOMEM;
+				return -1;
+			}
+		}
+		return 1;
+	}
+	return 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Store_Fanout
+  *         Add the capture reports waiting in the fan-out ring.
+  * @retval Reports added, -1 = error (errno)
+  */
+int64_t DIGITAL_IO_Store_Fanout(DIGITAL_IO_STORE_TypeDef* store, DIGITAL_IO_FANOUT_TypeDef* fanout, int consumer)
+{
+	const DIGITAL_IO_FANOUT_Slot* slot = 0;
+	uint8_t report[DIGITAL_IO_FANOUT_REPORT_SIZE];
+	uint16_t length = 0;
+	int64_t added = 0;
+	int result = 0;
+
+	while ((slot = DIGITAL_IO_Fanout_Peek(fanout, consumer)) != NULL)
+	{
+		length = (slot->length < sizeof(report)) ? slot->length : sizeof(report);
+		memcpy(report, slot->report, length);
+		// A lossy consumer may have read an overwritten slot: the ring counts it as lost
+		if (DIGITAL_IO_Fanout_Release(fanout, consumer) != 0)
+		{
+			continue;
+		}
+		result = DIGITAL_IO_Store_Report(store, report, length);
+		if (result < 0)
+		{
+			return -1;
+		}
+		added += result;
+	}
+	return added;
+}
+
+/**
+  * @brief  DIGITAL_IO_Store_Flush
+  *         Commit the pending changes.
+  * @retval 0 = OK, -1 = error (errno)
+  */
+int DIGITAL_IO_Store_Flush(DIGITAL_IO_STORE_TypeDef* store)
+{
+	uint64_t end = 0;
+	uint8_t group_idx = 0;
+
+	for (group_idx = 0; group_idx < store->capture.group_num; group_idx++)
+	{
+		if (store->queue[group_idx].valid && store->queue[group_idx].end > end)
+		{
+			end = store->queue[group_idx].end;
+		}
+	}
+	if (DIGITAL_IO_Store_Commit(store, end) != 0)
+	{
+		errno = ENOMEM;
+		return -1;
+	}
+	return 0;
+}
+
+/**
+  * @brief  DIGITAL_IO_Store_Query
+  *         Intervals where any of the conditions holds.
+  * @retval Number of intervals, -1 = error (errno)
+  */
+int64_t DIGITAL_IO_Store_Query(const DIGITAL_IO_STORE_TypeDef* store, const DIGITAL_IO_STORE_Condition* condition, size_t condition_num,
+							   DIGITAL_IO_STORE_Interval* interval, size_t max)
+{
+	DIGITAL_IO_STORE_Cursor cursor[DIGITAL_IO_DECODE_BIT_NUM * 2];
+	DIGITAL_IO_STORE_Bitmap* term = 0;
+	DIGITAL_IO_STORE_Bitmap result;
+	DIGITAL_IO_STORE_Cursor* reader = 0;
+	uint64_t tail[DIGITAL_IO_DECODE_BIT_NUM], open = 0, length = 0, row = 0, start = 0, word = 0, fill = 0, rest = 0;
+	size_t term_idx = 0, cursor_num = 0;
+	int64_t found = 0;
+	uint8_t bit = 0, position = 0, inside = 0;
+	int error = 0;
+
+	memset(&result, 0, sizeof(result));
+	if (condition_num == 0 || store->rows == 0)
+	{
+		return 0;
+	}
+	open = store->rows - store->plane[0].length * DIGITAL_IO_DECODE_PLANE_BITS;
+	DIGITAL_IO_Decode_Transpose(DIGITAL_IO_DECODE_AUTO, store->open, open, tail, 1);
+	length = store->plane[0].length + 1;
+
+	// AND terms, inverted when they are ORed
+	term = calloc(condition_num, sizeof(DIGITAL_IO_STORE_Bitmap));
+	reader = calloc(condition_num, sizeof(DIGITAL_IO_STORE_Cursor));
+	if (term == NULL || reader == NULL)
+	{
+		free(term);
+		free(reader);
+		errno = ENOMEM;
+		return -1;
+	}
+	for (term_idx = 0; term_idx < condition_num && !error; term_idx++)
+	{
+		cursor_num = 0;
+		for (bit = 0; bit < DIGITAL_IO_DECODE_BIT_NUM; bit++)
+		{
+			if ((condition[term_idx].high >> bit) & 0x01U)
+			{
+				DIGITAL_IO_Store_Cursor_Init(&cursor[cursor_num++], &store->plane[bit], &tail[bit], 0);
+			}
+			if ((condition[term_idx].low >> bit) & 0x01U)
+			{
+				DIGITAL_IO_Store_Cursor_Init(&cursor[cursor_num++], &store->plane[bit], &tail[bit], ~0ULL);
+			}
+		}
+		error = DIGITAL_IO_Store_And(cursor, cursor_num, length, (condition_num > 1) ? ~0ULL : 0, &term[term_idx]);
+		DIGITAL_IO_Store_Cursor_Init(&reader[term_idx], &term[term_idx], NULL, 0);
+	}
+	if (!error && condition_num > 1)
+	{
+		error = DIGITAL_IO_Store_And(reader, condition_num, length, ~0ULL, &result);
+	}
+	else if (!error)
+	{
+		result = term[0];
+		term[0].words = NULL;
+	}
+	for (term_idx = 0; term_idx < condition_num; term_idx++)
+	{
+		free(term[term_idx].words);
+	}
+	free(term);
+	free(reader);
+	if (error)
+	{
+		free(result.words);
+		errno = ENOMEM;
+		return -1;
+	}
+
+	// Runs of 1 bits = intervals of rows
+	DIGITAL_IO_Store_Cursor_Init(&cursor[0], &result, NULL, 0);
+	for (row = 0; row < store->rows; )
+	{
+		fill = DIGITAL_IO_Store_Cursor_Peek(&cursor[0], &word);
+		if (fill)
+		{
+			if (word != 0 && !inside)
+			{
+				inside = 1;
+				start = row;
+			}
+			else if (word == 0 && inside)
+			{
+				inside = 0;
+				if ((uint64_t)found < max)
+				{
+					interval[found].start = store->time[start];
+					interval[found].end = store->time[row];
+				}
+				found++;
+			}
+			row += fill * DIGITAL_IO_DECODE_PLANE_BITS;
+			DIGITAL_IO_Store_Cursor_Skip(&cursor[0], fill);
+			continue;
+		}
+		position = 0;
+		while (position < DIGITAL_IO_DECODE_PLANE_BITS)
+		{
+			rest = (inside ? ~word : word) >> position;
+			// Rows after the last one are not part of the capture
+			if (rest == 0 || row + position + (uint64_t)__builtin_ctzll(rest) >= store->rows)
+			{
+				break;
+			}
+			position += (uint8_t)__builtin_ctzll(rest);
+			if (!inside)
+			{
+				inside = 1;
+				start = row + position;
+			}
+			else
+			{
+				inside = 0;
+				if ((uint64_t)found < max)
+				{
+					interval[found].start = store->time[start];
+					interval[found].end = store->time[row + position];
+				}
+				found++;
+			}
+		}
+		row += DIGITAL_IO_DECODE_PLANE_BITS;
+		DIGITAL_IO_Store_Cursor_Skip(&cursor[0], 1);
+	}
+	if (inside)
+	{
+		if ((uint64_t)found < max)
+		{
+			interval[found].start = store->time[start];
+			interval[found].end = store->end;
+		}
+		found++;
+	}
+	free(result.words);
+	return found;
+}
+
+/**
+  * @brief  DIGITAL_IO_Store_Size
+  *         Bytes of the compressed bitplanes.
+  * @retval Bytes
+  */
+size_t DIGITAL_IO_Store_Size(const DIGITAL_IO_STORE_TypeDef* store)
+{
+	size_t size = 0;
+	uint8_t bit = 0;
+
+	for (bit = 0; bit < DIGITAL_IO_DECODE_BIT_NUM; bit++)
+	{
+		size += store->plane[bit].size * sizeof(uint64_t);
+	}
+	return size;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
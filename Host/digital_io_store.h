@@ -0,0 +1,177 @@
+/**
+  ******************************************************************************
+  * @file    digital_io_store.h
+  * @brief   Host capture store: one compressed bitplane per pin and boolean
+  *          pin queries over the bitmaps.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "digital_io_decode.h"
+#include "digital_io_fanout.h"
+
+
+/* Defines -------------------------------------*/
+#ifndef __DIGITAL_IO_STORE_H
+#define __DIGITAL_IO_STORE_H
+
+#define DIGITAL_IO_STORE_BIT(port, pin)	(1U << ((port) * DIGITAL_IO_DECODE_PIN_NUM + (pin)))
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ /* Run-length compressed bitmap: marker words, each followed by its literal words.
+  * Marker: bit 0 = fill bit, bits 1-32 = fill words (all bits = fill bit), bits 33-63 = literal words
+  */
+ typedef struct _DIGITAL_IO_STORE_Bitmap
+ {
+	 uint64_t*							words;
+	 size_t								size;
+	 size_t								capacity;
+	 size_t								marker;			// index of the last marker
+	 uint64_t							length;			// bitmap words (64 rows each)
+ } DIGITAL_IO_STORE_Bitmap;
+
+ // Changes of a rate group not committed yet
+ typedef struct _DIGITAL_IO_STORE_Change
+ {
+	 uint64_t							time;
+	 uint32_t							value;
+ } DIGITAL_IO_STORE_Change;
+
+ typedef struct _DIGITAL_IO_STORE_Queue
+ {
+	 DIGITAL_IO_STORE_Change*			change;
+	 size_t								head;
+	 size_t								tail;
+	 size_t								capacity;
+	 uint64_t							end;			// the levels of the group are known up to this time
+	 uint32_t							value;			// last queued value
+	 uint8_t							valid;			// the group sent a report
+ } DIGITAL_IO_STORE_Queue;
+
+ /* Capture store: a row per change of the 24 logical bits, the start times of the
+  * rows in one column, the levels of every logical bit in a bitplane over the rows.
+  */
+ typedef struct _DIGITAL_IO_STORE_TypeDef
+ {
+	 DIGITAL_IO_DECODE_Capture			capture;
+	 DIGITAL_IO_STORE_Queue				queue[DIGITAL_IO_DECODE_PORT_NUM];
+	 DIGITAL_IO_STORE_Bitmap			plane[DIGITAL_IO_DECODE_BIT_NUM];
+	 uint32_t							open[DIGITAL_IO_DECODE_PLANE_BITS];	// values of the rows not compressed yet
+	 uint64_t*							time;			// start of every row (CPU cycles since the first report)
+	 uint64_t							rows;
+	 uint64_t							capacity;
+	 uint64_t							now;			// latest timestamp, 64-bit
+	 uint64_t							origin;			// first timestamp
+	 uint64_t							end;			// the rows are complete up to this time
+	 uint64_t							lost;			// records lost by the module (levels held over the gap)
+	 uint32_t							value;			// levels at the end
+	 uint8_t							started;
+ } DIGITAL_IO_STORE_TypeDef;
+
+ // Conjunction of pin levels: every bit of high is 1 and every bit of low is 0
+ typedef struct _DIGITAL_IO_STORE_Condition
+ {
+	 uint32_t							high;
+	 uint32_t							low;
+ } DIGITAL_IO_STORE_Condition;
+
+ // Time interval [start, end) in CPU cycles since the first report
+ typedef struct _DIGITAL_IO_STORE_Interval
+ {
+	 uint64_t							start;
+	 uint64_t							end;
+ } DIGITAL_IO_STORE_Interval;
+
+ /**
+   * @brief  DIGITAL_IO_Store_Init
+   *         Empty store of a capture.
+   * @param  store: store
+   * @param  capture: rate groups of the capture (DIGITAL_IO_Decode_Setup)
+   * @retval None
+   */
+ void DIGITAL_IO_Store_Init(DIGITAL_IO_STORE_TypeDef* store, const DIGITAL_IO_DECODE_Capture* capture);
+
+ /**
+   * @brief  DIGITAL_IO_Store_Free
+   *         Release the memory of a store.
+   * @param  store: store
+   * @retval None
+   */
+ void DIGITAL_IO_Store_Free(DIGITAL_IO_STORE_TypeDef* store);
+
+ /**
+   * @brief  DIGITAL_IO_Store_Report
+   *         Add a REPORT_CAPTURE_RUN or REPORT_CAPTURE of the module.
+   *         The changes are committed once every rate group reported past them.
+   * @param  store: store
+   * @param  report: input report
+   * @param  length: bytes of the report
+   * @retval 1 = added, 0 = other report, -1 = error (errno)
+   */
+ int DIGITAL_IO_Store_Report(DIGITAL_IO_STORE_TypeDef* store, const uint8_t* report, uint16_t length);
+
+ /**
+   * @brief  DIGITAL_IO_Store_Fanout
+   *         Add the capture reports waiting in the fan-out ring of a consumer.
+   * @param  store: store
+   * @param  fanout: mapping
+   * @param  consumer: consumer index
+   * @retval Reports added, -1 = error (errno)
+   */
+ int64_t DIGITAL_IO_Store_Fanout(DIGITAL_IO_STORE_TypeDef* store, DIGITAL_IO_FANOUT_TypeDef* fanout, int consumer);
+
+ /**
+   * @brief  DIGITAL_IO_Store_Flush
+   *         Commit the pending changes (end of the capture).
+   * @param  store: store
+   * @retval 0 = OK, -1 = error (errno)
+   */
+ int DIGITAL_IO_Store_Flush(DIGITAL_IO_STORE_TypeDef* store);
+
+ /**
+   * @brief  DIGITAL_IO_Store_Query
+   *         Intervals where any of the conditions holds (OR of AND terms).
+   * @param  store: store
+   * @param  condition: conditions
+   * @param  condition_num: number of conditions
+   * @param  interval: intervals in time order
+   * @param  max: entries of interval
+   * @retval Number of intervals (only max are written), -1 = error (errno)
+   */
+ int64_t DIGITAL_IO_Store_Query(const DIGITAL_IO_STORE_TypeDef* store, const DIGITAL_IO_STORE_Condition* condition, size_t condition_num,
+								DIGITAL_IO_STORE_Interval* interval, size_t max);
+
+ /**
+   * @brief  DIGITAL_IO_Store_Size
+   *         Bytes of the compressed bitplanes.
+   * @param  store: store
+   * @retval Bytes
+   */
+ size_t DIGITAL_IO_Store_Size(const DIGITAL_IO_STORE_TypeDef* store);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __DIGITAL_IO_STORE_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
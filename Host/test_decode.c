@@ -0,0 +1,277 @@
+/**
+  ******************************************************************************
+  * @file    test_decode.c
+  * @brief   Test of the capture decoder: report layouts, and the SIMD paths
+  *          against the scalar one.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "digital_io_decode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* Defines -------------------------------------*/
+#define TEST_SAMPLES		(64U * 37U + 29U)	// full blocks and a partial one
+#define TEST_STRIDE			(DIGITAL_IO_DECODE_WORDS(TEST_SAMPLES) + 3U)
+#define TEST_MAX_EDGES		(TEST_SAMPLES * DIGITAL_IO_DECODE_BIT_NUM)
+
+#define CHECK(condition)	do { if (!(condition)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); exit(1); } } while (0)
+
+
+/* Private variables -------------------------------------*/
+static uint32_t samples[TEST_SAMPLES];
+static uint64_t reference[DIGITAL_IO_DECODE_BIT_NUM * TEST_STRIDE];
+static uint64_t planes[DIGITAL_IO_DECODE_BIT_NUM * TEST_STRIDE];
+static uint64_t edges[DIGITAL_IO_DECODE_BIT_NUM * TEST_STRIDE];
+static uint64_t scalar_edges[DIGITAL_IO_DECODE_BIT_NUM * TEST_STRIDE];
+static DIGITAL_IO_DECODE_Edge list[TEST_MAX_EDGES];
+
+
+/* Private functions -------------------------------------*/
+/**
+  * @brief  xorshift32 generator.
+  * @retval Random word
+  */
+static uint32_t Test_Random(uint32_t* state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+/**
+  * @brief  Pack records into a REPORT_CAPTURE like USBD_HID_Digital_IO_Capture_Stream_Report.
+  * @retval None
+  */
+static void Test_Pack(const DIGITAL_IO_DECODE_Capture* capture, uint8_t group_idx, const uint32_t* records, uint8_t num, uint32_t timestamp, uint8_t* report)
+{
+	const DIGITAL_IO_DECODE_Group* group = &capture->group[group_idx];
+	uint32_t bits = 0, nibble = 0;
+	uint8_t rec_idx = 0, port_idx = 0, pin_idx = 0, shift = 0;
+
+	for (rec_idx = 0; rec_idx < num; rec_idx++)
+	{
+		for (port_idx = 0; port_idx < group->port_num; port_idx++)
+		{
+			nibble = (records[rec_idx] >> (group->ports[port_idx] * DIGITAL_IO_DECODE_PIN_NUM)) & 0x0FU;
+			if (capture->planar)
+			{
+				for (pin_idx = 0; pin_idx < DIGITAL_IO_DECODE_PIN_NUM; pin_idx++)
+				{
+					bits |= ((nibble >> pin_idx) & 0x01U) << ((port_idx * DIGITAL_IO_DECODE_PIN_NUM + pin_idx) * num + rec_idx);
+				}
+			}
+			else
+			{
+				bits |= nibble << shift;
+			}
+			shift += DIGITAL_IO_DECODE_PIN_NUM;
+		}
+	}
+	report[0] = DIGITAL_IO_DECODE_EXTENDED | DIGITAL_IO_DECODE_CAPTURE;
+	report[1] = (uint8_t)(group_idx | (num << 4));
+	memcpy(&report[2], &timestamp, sizeof(timestamp));
+	memcpy(&report[6], &bits, sizeof(bits));
+	report[10] = 3;
+}
+
+/**
+  * @brief  Rate groups and both record layouts of REPORT_CAPTURE, REPORT_CAPTURE_RUN.
+  * @retval None
+  */
+static void Test_Reports(void)
+{
+	// Period 1000, decimation 1, 2, 1, off, 2, 1: group 0 = ports 0, 2, 5, group 1 = ports 1, 4
+	const uint8_t config[10] = {0xE8, 0x03, 0x00, 0x00, 1, 2, 1, 0, 2, 1};
+	const uint8_t run_report[DIGITAL_IO_DECODE_REPORT_SIZE] = {0x87, 0x12, 0x10, 0x27, 0x00, 0x00, 0x21, 0x43, 0x65, 0x34, 0x12};
+	DIGITAL_IO_DECODE_Capture capture;
+	DIGITAL_IO_DECODE_Records records;
+	DIGITAL_IO_DECODE_Run run;
+	uint32_t values[DIGITAL_IO_DECODE_MAX_RECORDS], state = 0x1234567U;
+	uint8_t report[DIGITAL_IO_DECODE_REPORT_SIZE], planar = 0, group_idx = 0, num = 0, rec_idx = 0;
+
+	for (planar = 0; planar < 2; planar++)
+	{
+		DIGITAL_IO_Decode_Setup(&capture, config, (uint8_t)(0x03U | (planar << 2)));
+		CHECK(capture.period == 1000 && capture.planar == planar && capture.group_num == 2);
+		CHECK(capture.group[0].decimation == 1 && capture.group[0].port_num == 3);
+		CHECK(capture.group[0].ports[0] == 0 && capture.group[0].ports[1] == 2 && capture.group[0].ports[2] == 5);
+		CHECK(capture.group[0].mask == 0xF00F0FU && capture.group[1].mask == 0x0F00F0U);
+
+		for (group_idx = 0; group_idx < capture.group_num; group_idx++)
+		{
+			// Full reports and the short one of a stop
+			for (num = 1; num <= DIGITAL_IO_DECODE_RECORD_BITS / (capture.group[group_idx].port_num * DIGITAL_IO_DECODE_PIN_NUM); num++)
+			{
+				for (rec_idx = 0; rec_idx < num; rec_idx++)
+				{
+					values[rec_idx] = Test_Random(&state) & capture.group[group_idx].mask;
+				}
+				Test_Pack(&capture, group_idx, values, num, 5000U + num, report);
+				CHECK(DIGITAL_IO_Decode_Report(&capture, report, sizeof(report), &records) == num);
+				CHECK(records.group == group_idx && records.lost == 3 && records.timestamp == 5000U + num);
+				CHECK(records.period == 1000U * capture.group[group_idx].decimation);
+				CHECK(memcmp(records.samples, values, num * sizeof(uint32_t)) == 0);
+			}
+		}
+		// Unknown group, other report
+		report[1] = 0x12;
+		CHECK(DIGITAL_IO_Decode_Report(&capture, report, sizeof(report), &records) == -1);
+		CHECK(DIGITAL_IO_Decode_Report(&capture, run_report, sizeof(run_report), &records) == -1);
+	}
+
+	// State mode: the timestamps count DUT clocks
+	DIGITAL_IO_Decode_Setup(&capture, config, 0x11U);
+	CHECK(capture.period == 1);
+
+	CHECK(DIGITAL_IO_Decode_Run(run_report, sizeof(run_report), &run) == 0);
+	CHECK(run.group == 1 && run.lost == 2 && run.timestamp == 10000U && run.value == 0x654321U && run.length == 0x1234U);
+	CHECK(DIGITAL_IO_Decode_Run(report, sizeof(report), &run) == -1);
+	printf("reports: OK\n");
+}
+
+/**
+  * @brief  Transpose, edges and edge lists of one path against the bitwise reference.
+  * @retval None
+  */
+static void Test_Path(DIGITAL_IO_Decode_Path path, uint32_t initial, const char* data)
+{
+	uint64_t counts[DIGITAL_IO_DECODE_BIT_NUM], expected[DIGITAL_IO_DECODE_BIT_NUM], total = 0, sum = 0;
+	uint32_t previous = 0;
+	size_t sample_idx = 0, entries = 0, entry = 0;
+	uint8_t bit = 0;
+
+	memset(planes, 0xA5, sizeof(planes));
+	DIGITAL_IO_Decode_Transpose(path, samples, TEST_SAMPLES, planes, TEST_STRIDE);
+	for (bit = 0; bit < DIGITAL_IO_DECODE_BIT_NUM; bit++)
+	{
+		CHECK(memcmp(&planes[bit * TEST_STRIDE], &reference[bit * TEST_STRIDE], DIGITAL_IO_DECODE_WORDS(TEST_SAMPLES) * sizeof(uint64_t)) == 0);
+		// The gap between the planes is not written
+		CHECK(planes[bit * TEST_STRIDE + TEST_STRIDE - 1] == 0xA5A5A5A5A5A5A5A5ULL);
+	}
+
+	memset(edges, 0, sizeof(edges));
+	total = DIGITAL_IO_Decode_Edges(path, planes, TEST_STRIDE, TEST_SAMPLES, initial, edges, counts);
+	memset(expected, 0, sizeof(expected));
+	previous = initial;
+	for (sample_idx = 0; sample_idx < TEST_SAMPLES; sample_idx++)
+	{
+		for (bit = 0; bit < DIGITAL_IO_DECODE_BIT_NUM; bit++)
+		{
+			expected[bit] += ((samples[sample_idx] ^ previous) >> bit) & 0x01U;
+		}
+		previous = samples[sample_idx];
+	}
+	for (bit = 0; bit < DIGITAL_IO_DECODE_BIT_NUM; bit++)
+	{
+		CHECK(counts[bit] == expected[bit]);
+		sum += expected[bit];
+	}
+	CHECK(total == sum);
+	if (path == DIGITAL_IO_DECODE_SCALAR)
+	{
+		memcpy(scalar_edges, edges, sizeof(edges));
+	}
+	CHECK(memcmp(edges, scalar_edges, sizeof(edges)) == 0);
+
+	// Per-pin lists in time order with the new level
+	entries = DIGITAL_IO_Decode_Edge_List(planes, edges, TEST_STRIDE, TEST_SAMPLES, 100, list, TEST_MAX_EDGES);
+	CHECK(entries == sum);
+	for (bit = 0; bit < DIGITAL_IO_DECODE_BIT_NUM; bit++)
+	{
+		previous = initial;
+		for (sample_idx = 0; sample_idx < TEST_SAMPLES; sample_idx++)
+		{
+			if (((samples[sample_idx] ^ previous) >> bit) & 0x01U)
+			{
+				CHECK(list[entry].bit == bit && list[entry].sample == 100 + sample_idx);
+				CHECK(list[entry].level == ((samples[sample_idx] >> bit) & 0x01U));
+				entry++;
+			}
+			previous = samples[sample_idx];
+		}
+	}
+	CHECK(DIGITAL_IO_Decode_Edge_List(planes, edges, TEST_STRIDE, TEST_SAMPLES, 0, list, 5) == 5);
+
+	printf("%s %s: %llu edges OK\n", DIGITAL_IO_Decode_Path_Name(path), data, (unsigned long long)total);
+}
+
+/**
+  * @brief  All paths of this CPU on one data set.
+  * @retval None
+  */
+static void Test_Data(uint32_t initial, const char* data)
+{
+	DIGITAL_IO_Decode_Path path = DIGITAL_IO_DECODE_SCALAR;
+	size_t sample_idx = 0;
+	uint8_t bit = 0;
+
+	memset(reference, 0, sizeof(reference));
+	for (sample_idx = 0; sample_idx < TEST_SAMPLES; sample_idx++)
+	{
+		for (bit = 0; bit < DIGITAL_IO_DECODE_BIT_NUM; bit++)
+		{
+			if ((samples[sample_idx] >> bit) & 0x01U)
+			{
+				reference[bit * TEST_STRIDE + sample_idx / 64] |= 1ULL << (sample_idx % 64);
+			}
+		}
+	}
+	for (path = DIGITAL_IO_DECODE_SCALAR; path <= DIGITAL_IO_Decode_Select(DIGITAL_IO_DECODE_AUTO); path++)
+	{
+		Test_Path(path, initial, data);
+	}
+}
+
+
+/* Main -------------------------------------*/
+int main(void)
+{
+	uint32_t state = 0xC0FFEEU, value = 0;
+	size_t sample_idx = 0;
+
+	Test_Reports();
+
+	// Random samples (bits above 23 must be ignored): edges everywhere
+	for (sample_idx = 0; sample_idx < TEST_SAMPLES; sample_idx++)
+	{
+		samples[sample_idx] = Test_Random(&state);
+	}
+	Test_Data(0x00FFFFFFU, "random");
+
+	// Bus-like samples: a few pins toggle, levels held across the words
+	for (sample_idx = 0; sample_idx < TEST_SAMPLES; sample_idx++)
+	{
+		if ((Test_Random(&state) & 0x0FU) == 0)
+		{
+			value ^= 1U << (Test_Random(&state) % DIGITAL_IO_DECODE_BIT_NUM);
+		}
+		samples[sample_idx] = value;
+	}
+	Test_Data(0x000001U, "sparse");
+
+	printf("decode: OK\n");
+	return 0;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
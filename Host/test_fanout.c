@@ -0,0 +1,227 @@
+/**
+  ******************************************************************************
+  * @file    test_fanout.c
+  * @brief   Checks the report fan-out with several consumer processes.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "digital_io_fanout.h"
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+/* Defines -------------------------------------*/
+#define TEST_REPORTS		(200000U)	// about 50 laps of the ring
+#define TEST_RELIABLE		(2U)
+#define TEST_PUSHERS		(4U)
+#define TEST_COMMANDS		(5000U)		// per pusher, 20 laps of the command ring
+
+#define CHECK(condition)	do { if (!(condition)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); exit(1); } } while (0)
+
+
+/* Private functions -------------------------------------*/
+/**
+  * @brief  Consumer process: reads every report and checks the order.
+  * @retval Exit code
+  */
+static int Test_Consumer(const char* name, uint32_t mode)
+{
+	DIGITAL_IO_FANOUT_TypeDef fanout;
+	const DIGITAL_IO_FANOUT_Slot* slot = 0;
+	uint64_t index = 0, start = 0;
+	uint32_t value = 0, intact = 0, reads = 0;
+	int consumer = -1;
+
+	CHECK(DIGITAL_IO_Fanout_Open(&fanout, name) == 0);
+	consumer = DIGITAL_IO_Fanout_Attach(&fanout, mode);
+	CHECK(consumer >= 0);
+	// The consumer starts with the reports published after its attach
+	start = atomic_load(&fanout.shared->consumer[consumer].tail);
+	while (index < TEST_REPORTS)
+	{
+		slot = DIGITAL_IO_Fanout_Peek(&fanout, consumer);
+		index = atomic_load(&fanout.shared->consumer[consumer].tail);
+		if (slot == NULL)
+		{
+			sched_yield();
+			continue;
+		}
+		memcpy(&value, slot->report, sizeof(value));
+		// The lossy consumer is slow on purpose: the daemon overwrites the slot while it is read
+		if (!(mode & DIGITAL_IO_FANOUT_RELIABLE) && (++reads % 64U) == 0)
+		{
+			usleep(200);
+		}
+		if (DIGITAL_IO_Fanout_Release(&fanout, consumer) == 0)
+		{
+			CHECK(value == index);
+			CHECK(slot->length == 11U);
+			intact++;
+		}
+		index++;
+	}
+	if (mode & DIGITAL_IO_FANOUT_RELIABLE)
+	{
+		CHECK(intact == TEST_REPORTS - start);
+		CHECK(atomic_load(&fanout.shared->consumer[consumer].lost) == 0);
+	}
+	else
+	{
+		CHECK(intact + atomic_load(&fanout.shared->consumer[consumer].lost) == TEST_REPORTS - start);
+		printf("lossy consumer: %u intact, %llu lost\n", intact, (unsigned long long)atomic_load(&fanout.shared->consumer[consumer].lost));
+		fflush(stdout);
+	}
+	DIGITAL_IO_Fanout_Detach(&fanout, consumer);
+	DIGITAL_IO_Fanout_Close(&fanout);
+	return 0;
+}
+
+/**
+  * @brief  Command producer process: numbered commands of one pusher.
+  * @retval Exit code
+  */
+static int Test_Pusher(const char* name, uint8_t pusher)
+{
+	DIGITAL_IO_FANOUT_TypeDef fanout;
+	uint8_t command[DIGITAL_IO_FANOUT_COMMAND_SIZE] = {0};
+	uint32_t idx = 0;
+
+	CHECK(DIGITAL_IO_Fanout_Open(&fanout, name) == 0);
+	command[0] = pusher;
+	for (idx = 0; idx < TEST_COMMANDS; idx++)
+	{
+		memcpy(&command[1], &idx, sizeof(idx));
+		while (DIGITAL_IO_Fanout_Push_Command(&fanout, command) < 0)
+		{
+			sched_yield();
+		}
+	}
+	DIGITAL_IO_Fanout_Close(&fanout);
+	return 0;
+}
+
+/**
+  * @brief  Wait for the children and check their exit codes.
+  * @retval None
+  */
+static void Test_Wait(uint32_t children)
+{
+	int status = 0;
+
+	while (children--)
+	{
+		CHECK(wait(&status) > 0);
+		CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	}
+}
+
+
+/* Main -------------------------------------*/
+int main(void)
+{
+	DIGITAL_IO_FANOUT_TypeDef fanout;
+	uint8_t report[11] = {0}, command[DIGITAL_IO_FANOUT_COMMAND_SIZE];
+	uint32_t next[TEST_PUSHERS] = {0}, value = 0, popped = 0, attached = 0, idx = 0;
+	char name[64];
+	pid_t pid = 0;
+
+	snprintf(name, sizeof(name), "/digital_io_test_%d", (int)getpid());
+	CHECK(DIGITAL_IO_Fanout_Create(&fanout, name) == 0);
+
+	// Report ring: reliable consumers see every report in order, the lossy one counts its losses
+	for (idx = 0; idx <= TEST_RELIABLE; idx++)
+	{
+		if (fork() == 0)
+		{
+			_exit(Test_Consumer(name, (idx < TEST_RELIABLE) ? DIGITAL_IO_FANOUT_RELIABLE : DIGITAL_IO_FANOUT_LOSSY));
+		}
+	}
+	while (attached <= TEST_RELIABLE)
+	{
+		attached = 0;
+		for (idx = 0; idx < DIGITAL_IO_FANOUT_CONSUMERS; idx++)
+		{
+			attached += (atomic_load(&fanout.shared->consumer[idx].flags) != 0);
+		}
+		sched_yield();
+	}
+	for (value = 0; value < TEST_REPORTS; value++)
+	{
+		memcpy(report, &value, sizeof(value));
+		while (DIGITAL_IO_Fanout_Publish(&fanout, report, sizeof(report), value) != 0)
+		{
+			sched_yield();
+		}
+	}
+	Test_Wait(TEST_RELIABLE + 1);
+	printf("reports: %u published, %llu stalls\n", TEST_REPORTS, (unsigned long long)atomic_load(&fanout.shared->stalls));
+
+	// Command ring: every command once, in the order of each pusher
+	for (idx = 0; idx < TEST_PUSHERS; idx++)
+	{
+		if (fork() == 0)
+		{
+			_exit(Test_Pusher(name, (uint8_t)idx));
+		}
+	}
+	while (popped < TEST_PUSHERS * TEST_COMMANDS)
+	{
+		if (DIGITAL_IO_Fanout_Pop_Command(&fanout, command) != 0)
+		{
+			sched_yield();
+			continue;
+		}
+		CHECK(command[0] < TEST_PUSHERS);
+		memcpy(&value, &command[1], sizeof(value));
+		CHECK(value == next[command[0]]);
+		next[command[0]]++;
+		popped++;
+	}
+	CHECK(DIGITAL_IO_Fanout_Pop_Command(&fanout, command) != 0);
+	Test_Wait(TEST_PUSHERS);
+	printf("commands: %u popped in order\n", popped);
+
+	// A reliable consumer which died without detaching no longer holds the daemon back
+	pid = fork();
+	if (pid == 0)
+	{
+		DIGITAL_IO_FANOUT_TypeDef child;
+		CHECK(DIGITAL_IO_Fanout_Open(&child, name) == 0);
+		_exit(DIGITAL_IO_Fanout_Attach(&child, DIGITAL_IO_FANOUT_RELIABLE) >= 0 ? 0 : 1);
+	}
+	Test_Wait(1);
+	for (value = 0; value < DIGITAL_IO_FANOUT_SLOTS; value++)
+	{
+		CHECK(DIGITAL_IO_Fanout_Publish(&fanout, report, sizeof(report), 0) == 0);
+	}
+	CHECK(DIGITAL_IO_Fanout_Publish(&fanout, report, sizeof(report), 0) != 0);
+	CHECK(DIGITAL_IO_Fanout_Reap(&fanout) == 1);
+	CHECK(DIGITAL_IO_Fanout_Publish(&fanout, report, sizeof(report), 0) == 0);
+
+	DIGITAL_IO_Fanout_Close(&fanout);
+	printf("fanout: OK\n");
+	return 0;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
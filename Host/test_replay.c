@@ -0,0 +1,422 @@
+/**
+  ******************************************************************************
+  * @file    test_replay.c
+  * @brief   Test of the capture-to-stimulus pipeline: run reports of a recorded
+  *          group, step program, chunked upload to a model of the module and
+  *          check of the playback report.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "digital_io_replay.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+/* Defines -------------------------------------*/
+#define TEST_PERIOD			(1000U)
+#define TEST_DECIMATION		(3U)
+#define TEST_UNIT			(TEST_PERIOD * TEST_DECIMATION)
+#define TEST_START			(0xFFF00000U)	// the timestamps wrap during the capture
+#define TEST_STEPS			(1200U)
+#define TEST_MAX_RUN		(0xFFFFU)		// DIGITAL_IO_CAPTURE_MAX_RUN
+#define TEST_BUFFER_SIZE	(DIGITAL_IO_REPLAY_MAX_WORDS * 4U)
+
+#define CHECK(condition)	do { if (!(condition)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); exit(1); } } while (0)
+
+
+/* Private typedef -------------------------------------*/
+typedef struct
+{
+	uint32_t				value;
+	uint32_t				records;
+} Test_Step;
+
+typedef struct
+{
+	uint8_t					report[DIGITAL_IO_DECODE_REPORT_SIZE];
+} Test_Report;
+
+// Model of the module: upload target, stimulus settings and the timing report
+typedef struct
+{
+	uint8_t					sequence;		// next expected sequence number
+	uint8_t					uploading;
+	uint32_t				offset;
+	uint32_t				size;			// bytes of the target (0 = the whole buffer)
+	uint32_t				buffer[DIGITAL_IO_REPLAY_MAX_WORDS];
+	uint32_t				chunks;
+	uint32_t				last_chunk;
+	uint32_t				mask;
+	uint32_t				unit;
+	uint8_t					flags;
+	uint8_t					corrupt;		// flip a word of the upload
+	uint32_t				late;			// extra lateness of every 8th step (CPU cycles)
+	uint16_t				mismatches;		// pins read back wrong
+	uint8_t					played;			// a REPORT_STIMULUS is ready
+	uint8_t					report[DIGITAL_IO_DECODE_REPORT_SIZE];
+} Test_Module;
+
+
+/* Private variables -------------------------------------*/
+static Test_Step steps[TEST_STEPS];
+static Test_Report reports[TEST_STEPS * 16U];
+static DIGITAL_IO_REPLAY_Program program;
+
+
+/* Private functions -------------------------------------*/
+/**
+  * @brief  xorshift32 generator.
+  * @retval Random word
+  */
+static uint32_t Test_Random(uint32_t* state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+/**
+  * @brief  Levels of the recorded group: every step changes a pin, the lengths
+  *         cover the word encodings (1, 255, 256 ticks), the runs split at the
+  *         maximum run length and the steps longer than one deadline.
+  * @retval None
+  */
+static void Test_Signal(uint32_t* state, uint32_t mask)
+{
+	static const uint32_t lengths[] = {1, 255, 256, 70000, 800000};
+	uint32_t value = 0, idx = 0, bit = 0;
+
+	for (idx = 0; idx < TEST_STEPS; idx++)
+	{
+		do
+		{
+			bit = Test_Random(state) % DIGITAL_IO_DECODE_BIT_NUM;
+		} while (!((mask >> bit) & 0x01U));
+		value ^= 1U << bit;
+		steps[idx].value = value;
+		steps[idx].records = (idx < 5) ? lengths[idx] : 1 + (Test_Random(state) % 400U);
+	}
+}
+
+/**
+  * @brief  Run reports of the steps like USBD_HID_Digital_IO_Capture_Run_Report,
+  *         the timestamps off the record grid by the rounding of the module timer.
+  *         The second run of the 70000 record step is lost.
+  * @retval Number of reports
+  */
+static uint32_t Test_Runs(void)
+{
+	uint32_t idx = 0, done = 0, length = 0, timestamp = 0, count = 0;
+	uint64_t record = 0;
+	uint8_t lost = 0, part = 0;
+	uint8_t* report = 0;
+
+	for (idx = 0; idx < TEST_STEPS; idx++)
+	{
+		for (done = 0, part = 0; done < steps[idx].records; done += length, part++)
+		{
+			length = steps[idx].records - done;
+			length = (length > TEST_MAX_RUN) ? TEST_MAX_RUN : length;
+			if (idx == 3 && part == 1)
+			{
+				lost = 1;
+				continue;
+			}
+			timestamp = TEST_START + (uint32_t)((record + done) * TEST_UNIT) + (uint32_t)((record + done) % 7U) * 100U;
+			report = reports[count++].report;
+			report[0] = DIGITAL_IO_DECODE_EXTENDED | DIGITAL_IO_DECODE_CAPTURE_RUN;
+			report[1] = lost;
+			memcpy(&report[2], &timestamp, sizeof(timestamp));
+			memcpy(&report[6], &steps[idx].value, 3);
+			report[9] = (uint8_t)length;
+			report[10] = (uint8_t)(length >> 8);
+			lost = 0;
+		}
+		record += steps[idx].records;
+	}
+	return count;
+}
+
+/**
+  * @brief  Step decoding like USBD_HID_Digital_IO_Stimulus_Next_Step.
+  * @retval 1 if a step was decoded, 0 at the end of the program
+  */
+static uint8_t Test_Next_Step(const uint32_t* words, uint16_t num, uint16_t* idx, uint32_t* value, uint32_t* ticks)
+{
+	uint32_t word = 0;
+
+	if (*idx >= num)
+	{
+		return 0;
+	}
+	word = words[(*idx)++];
+	*value = word & 0x00FFFFFFU;
+	*ticks = word >> DIGITAL_IO_REPLAY_TICKS_SHIFT;
+	if (*ticks == 0)
+	{
+		CHECK(*idx < num);
+		*ticks = words[(*idx)++];
+	}
+	return 1;
+}
+
+/**
+  * @brief  Output report of the module model.
+  * @retval 0 = accepted, -1 = stalled
+  */
+static int Test_Module_Output(Test_Module* module, const uint8_t* report)
+{
+	uint32_t sum = 0, late = 0, late_max = 0, ticks = 0, value = 0;
+	uint64_t late_sum = 0;
+	uint16_t idx = 0, step = 0, words = 0;
+
+	CHECK(report[DIGITAL_IO_REPLAY_SEQUENCE_BYTE] == module->sequence++);
+	switch (report[0])
+	{
+		case DIGITAL_IO_REPLAY_CONFIG:
+			module->mask = (uint32_t)report[1] | ((uint32_t)report[2] << 8) | ((uint32_t)report[3] << 16);
+			memcpy(&module->unit, &report[4], sizeof(module->unit));
+			module->flags = report[8];
+			return 0;
+
+		case DIGITAL_IO_REPLAY_UPLOAD:
+			CHECK(report[1] == DIGITAL_IO_REPLAY_TARGET);
+			memcpy(&module->offset, &report[2], sizeof(module->offset));
+			module->uploading = 1;
+			return 0;
+
+		case DIGITAL_IO_REPLAY_RUN:
+			words = (uint16_t)(report[1] | (report[2] << 8));
+			CHECK(module->uploading && module->offset == words * 4U);
+			module->uploading = 0;
+			for (idx = 0; idx < words; idx++)
+			{
+				sum += module->buffer[idx];
+			}
+			// The timing report: a deterministic lateness of every step, each one held within a deadline
+			memset(module->report, 0, sizeof(module->report));
+			module->report[0] = DIGITAL_IO_DECODE_EXTENDED | DIGITAL_IO_REPLAY_REPORT;
+			module->report[1] = module->flags;
+			if (sum != ((uint32_t)report[3] | ((uint32_t)report[4] << 8) | ((uint32_t)report[5] << 16) | ((uint32_t)report[6] << 24)))
+			{
+				module->report[1] |= DIGITAL_IO_REPLAY_CHECKSUM_ERROR;
+			}
+			else
+			{
+				for (idx = 0; Test_Next_Step(module->buffer, words, &idx, &value, &ticks); step++)
+				{
+					CHECK((value & ~module->mask) == 0 && ticks != 0 && (uint64_t)ticks * module->unit <= DIGITAL_IO_REPLAY_MAX_HOLD);
+					late = 12U + (step % 5U) + ((step % 8U == 7U) ? module->late : 0);
+					late_max = (late > late_max) ? late : late_max;
+					late_sum += late;
+				}
+				module->report[4] = (uint8_t)(late_max);
+				module->report[5] = (uint8_t)(late_max >> 8);
+				module->report[6] = (uint8_t)(late_max >> 16);
+				module->report[7] = (uint8_t)(late_sum / step);
+				module->report[8] = (uint8_t)((late_sum / step) >> 8);
+				module->report[9] = (uint8_t)(module->mismatches);
+				module->report[10] = (uint8_t)(module->mismatches >> 8);
+			}
+			module->report[2] = (uint8_t)(step);
+			module->report[3] = (uint8_t)(step >> 8);
+			module->played = 1;
+			return 0;
+
+		default:
+			return -1;
+	}
+}
+
+/**
+  * @brief  Transport into the module model: a feature report is stalled when
+  *         no upload is active or it goes past the end of the target.
+  * @retval 0 = sent, -1 = stalled (errno)
+  */
+static int Test_Write(void* context, const uint8_t* report, uint16_t length, uint8_t feature)
+{
+	Test_Module* module = (Test_Module*)context;
+
+	if (!feature)
+	{
+		CHECK(length == DIGITAL_IO_REPLAY_OUTPUT_SIZE);
+		return Test_Module_Output(module, report);
+	}
+	if (!module->uploading || length > DIGITAL_IO_REPLAY_CHUNK_SIZE || module->offset + length > (module->size ? module->size : TEST_BUFFER_SIZE))
+	{
+		errno = EPIPE;
+		return -1;
+	}
+	memcpy((uint8_t*)module->buffer + module->offset, report, length);
+	if (module->corrupt && module->offset == 0)
+	{
+		module->buffer[0] ^= 0x01U;
+	}
+	module->offset += length;
+	module->chunks++;
+	module->last_chunk = length;
+	return 0;
+}
+
+/**
+  * @brief  Program of the test runs: the encoded steps start exactly on the
+  *         records of the capture.
+  * @retval None
+  */
+static void Test_Program(const DIGITAL_IO_DECODE_Capture* capture, uint32_t count)
+{
+	uint32_t idx = 0, value = 0, ticks = 0, step_idx = 0, checksum = 0;
+	uint64_t record = 0, position = 0, held = 0;
+	uint16_t word_idx = 0;
+
+	CHECK(DIGITAL_IO_Replay_Init(&program, capture, 0) == 0 && program.unit == TEST_UNIT);
+	for (idx = 0; idx < count; idx++)
+	{
+		CHECK(DIGITAL_IO_Replay_Add(&program, reports[idx].report, DIGITAL_IO_DECODE_REPORT_SIZE) == 1);
+	}
+	CHECK(DIGITAL_IO_Replay_Finish(&program) == 0);
+	CHECK(program.lost == 1);
+
+	for (idx = 0; idx < program.num; idx++)
+	{
+		checksum += program.words[idx];
+	}
+	CHECK(checksum == program.checksum);
+	// 1 and 255 ticks in one word, 256 in two, 800000 ticks repeated over the hold limit
+	CHECK(program.words[0] == (steps[0].value | (1U << DIGITAL_IO_REPLAY_TICKS_SHIFT)));
+	CHECK(program.words[1] == (steps[1].value | (255U << DIGITAL_IO_REPLAY_TICKS_SHIFT)));
+	CHECK(program.words[2] == steps[2].value && program.words[3] == 256U);
+	CHECK(program.words[4] == steps[3].value && program.words[5] == 70000U);
+	CHECK(program.words[6] == steps[4].value && program.words[7] == DIGITAL_IO_REPLAY_MAX_HOLD / TEST_UNIT);
+
+	// Every step of the capture starts on its record
+	for (step_idx = 0; Test_Next_Step(program.words, program.num, &word_idx, &value, &ticks); )
+	{
+		CHECK(value == steps[step_idx].value && position == record + held);
+		position += ticks;
+		held += ticks;
+		if (held == steps[step_idx].records)
+		{
+			record += steps[step_idx++].records;
+			held = 0;
+		}
+	}
+	CHECK(step_idx == TEST_STEPS && position == record && program.ticks == record);
+}
+
+
+/* Main -------------------------------------*/
+int main(void)
+{
+	// Period 1000, group 0 = ports 0 and 1 (decimation 3), group 1 = port 3 (decimation 1)
+	const uint8_t config[10] = {0xE8, 0x03, 0x00, 0x00, TEST_DECIMATION, TEST_DECIMATION, 0, 1, 0, 0};
+	DIGITAL_IO_DECODE_Capture capture;
+	DIGITAL_IO_REPLAY_Result result;
+	Test_Module module;
+	uint8_t sequence = 0x40, bad[DIGITAL_IO_DECODE_REPORT_SIZE] = {0}, written[1 + DIGITAL_IO_REPLAY_OUTPUT_SIZE];
+	uint32_t state = 0x2545F491U, count = 0, idx = 0;
+	int pipe_fd[2] = {-1, -1};
+
+	DIGITAL_IO_Decode_Setup(&capture, config, 0x0BU);
+	CHECK(capture.group_num == 2 && capture.group[0].decimation == TEST_DECIMATION);
+	Test_Signal(&state, capture.group[0].mask);
+	count = Test_Runs();
+	Test_Program(&capture, count);
+
+	// Upload in chunks of 4096 bytes and the remainder, the playback follows the capture
+	memset(&module, 0, sizeof(module));
+	module.sequence = sequence;
+	CHECK(DIGITAL_IO_Replay_Send(&program, 0, DIGITAL_IO_REPLAY_VERIFY, &sequence, Test_Write, &module) == 0);
+	CHECK(sequence == module.sequence && module.played);
+	CHECK(module.mask == capture.group[0].mask && module.unit == TEST_UNIT && module.flags == DIGITAL_IO_REPLAY_VERIFY);
+	CHECK(module.chunks == (program.num * 4U + DIGITAL_IO_REPLAY_CHUNK_SIZE - 1) / DIGITAL_IO_REPLAY_CHUNK_SIZE);
+	CHECK(module.last_chunk == program.num * 4U - (module.chunks - 1) * DIGITAL_IO_REPLAY_CHUNK_SIZE);
+	CHECK(memcmp(module.buffer, program.words, program.num * 4U) == 0);
+	CHECK(DIGITAL_IO_Replay_Check(&program, module.report, DIGITAL_IO_DECODE_REPORT_SIZE, 0, &result) == 0);
+	CHECK(result.steps == program.steps && result.late_max == 16U && result.mismatches == 0);
+	printf("replay: %u runs, %u steps in %u words (%u chunks), %llu ticks of %u cycles, late max %u mean %u\n",
+		   count, program.steps, program.num, module.chunks, (unsigned long long)program.ticks, program.unit,
+		   result.late_max, result.late_mean);
+
+	// A late step, pins read back wrong, a corrupted upload
+	module.late = TEST_UNIT;
+	module.mismatches = 3;
+	CHECK(DIGITAL_IO_Replay_Send(&program, 0, DIGITAL_IO_REPLAY_VERIFY, &sequence, Test_Write, &module) == 0);
+	CHECK(DIGITAL_IO_Replay_Check(&program, module.report, DIGITAL_IO_DECODE_REPORT_SIZE, 0, &result)
+		  == (DIGITAL_IO_REPLAY_FAIL_LATE | DIGITAL_IO_REPLAY_FAIL_PINS));
+	CHECK(DIGITAL_IO_Replay_Check(&program, module.report, DIGITAL_IO_DECODE_REPORT_SIZE, 2 * TEST_UNIT, &result)
+		  == DIGITAL_IO_REPLAY_FAIL_PINS);
+	module.corrupt = 1;
+	CHECK(DIGITAL_IO_Replay_Send(&program, 0, 0, &sequence, Test_Write, &module) == 0);
+	CHECK(DIGITAL_IO_Replay_Check(&program, module.report, DIGITAL_IO_DECODE_REPORT_SIZE, 0, &result)
+		  == (DIGITAL_IO_REPLAY_FAIL_PROGRAM | DIGITAL_IO_REPLAY_FAIL_STEPS));
+	CHECK(DIGITAL_IO_Replay_Check(&program, reports[0].report, DIGITAL_IO_DECODE_REPORT_SIZE, 0, &result) == -1);
+
+	// A stalled chunk stops the upload before the run
+	memset(&module, 0, sizeof(module));
+	module.sequence = sequence;
+	module.size = DIGITAL_IO_REPLAY_CHUNK_SIZE + 4U;
+	CHECK(DIGITAL_IO_Replay_Send(&program, 0, 0, &sequence, Test_Write, &module) == -1 && errno == EPIPE);
+	CHECK(module.chunks == 1 && !module.played);
+
+	// Other groups and reports are skipped, a change every record overflows the program
+	CHECK(DIGITAL_IO_Replay_Init(&program, &capture, 0) == 0);
+	reports[0].report[1] = 0x10U;
+	CHECK(DIGITAL_IO_Replay_Add(&program, reports[0].report, DIGITAL_IO_DECODE_REPORT_SIZE) == 0);
+	CHECK(DIGITAL_IO_Replay_Add(&program, bad, DIGITAL_IO_DECODE_REPORT_SIZE) == 0);
+	for (idx = 0; idx < DIGITAL_IO_REPLAY_MAX_WORDS + 1; idx++)
+	{
+		bad[0] = DIGITAL_IO_DECODE_EXTENDED | DIGITAL_IO_DECODE_CAPTURE_RUN;
+		bad[2] = (uint8_t)(idx * TEST_UNIT);
+		bad[3] = (uint8_t)((idx * TEST_UNIT) >> 8);
+		bad[4] = (uint8_t)((idx * TEST_UNIT) >> 16);
+		bad[6] = (uint8_t)(idx & 0x01U);
+		bad[9] = 1;
+		if (DIGITAL_IO_Replay_Add(&program, bad, DIGITAL_IO_DECODE_REPORT_SIZE) != 1)
+		{
+			break;
+		}
+	}
+	CHECK(idx == DIGITAL_IO_REPLAY_MAX_WORDS + 1 && program.num == DIGITAL_IO_REPLAY_MAX_WORDS);
+	CHECK(DIGITAL_IO_Replay_Finish(&program) == -1 && errno == ENOSPC);
+
+	// Unknown group, state mode (the timestamps count DUT clocks)
+	CHECK(DIGITAL_IO_Replay_Init(&program, &capture, 2) == -1 && errno == EINVAL);
+	DIGITAL_IO_Decode_Setup(&capture, config, 0x1BU);
+	CHECK(DIGITAL_IO_Replay_Init(&program, &capture, 0) == -1 && errno == EINVAL);
+
+	// The hidraw transport prefixes report number 0
+	CHECK(pipe(pipe_fd) == 0);
+	memset(bad, 0xA5, sizeof(bad));
+	CHECK(DIGITAL_IO_Replay_Hidraw(&pipe_fd[1], bad, DIGITAL_IO_REPLAY_OUTPUT_SIZE - 1, 0) == 0);
+	CHECK(read(pipe_fd[0], written, sizeof(written)) == DIGITAL_IO_REPLAY_OUTPUT_SIZE && written[0] == 0 && written[1] == 0xA5);
+	CHECK(DIGITAL_IO_Replay_Hidraw(&pipe_fd[1], bad, DIGITAL_IO_REPLAY_OUTPUT_SIZE - 1, 1) == -1);
+	close(pipe_fd[0]);
+	close(pipe_fd[1]);
+
+	printf("replay: OK\n");
+	return 0;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
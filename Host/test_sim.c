@@ -0,0 +1,341 @@
+/**
+  ******************************************************************************
+  * @file    test_sim.c
+  * @brief   Runs the firmware core against the DUT models of the simulation.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "usbd_digital_io_sim.h"
+#include "test_sim_model.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/* Defines -------------------------------------*/
+#define TEST_SERIAL_BIT		(8U)		// loop passes of one serial bit
+#define TEST_SERIAL_LOG		(0x200U)	// logged passes of the serial test
+#define TEST_SERIAL_BYTE	(0x5AU)
+#define TEST_DELAY_PASSES	(6U)		// loop passes of the delay line
+#define TEST_DELAY_LONG		(0x1000U)	// cycles of the delay line in the ring test
+#define TEST_DELAY_CHANGES	(0x28U)		// changes pushed into the delay line (more than it holds)
+#define TEST_COUNTER_EDGES	(5U)
+#define TEST_SHIFT_BYTE		(0xA5U)
+
+// Port byte of LENGTH_DIGITAL_IO: changed, output, pin values
+#define TEST_PORT_OUTPUT(pins)	((uint8_t)(CHANGED | OUTPUT | ((pins) << 4)))
+#define TEST_PORT_INPUT			((uint8_t)(CHANGED | INPUT | PULLDOWN))
+
+#define CHECK(condition)	do { if (!(condition)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); exit(1); } } while (0)
+
+
+/* Private functions -------------------------------------*/
+/**
+  * @brief  Store new port settings and switch them with a host trigger.
+  * @retval None
+  */
+static void Test_Switch(DIGITAL_IO_SIM_TypeDef* sim, uint8_t port_0, uint8_t port_1)
+{
+	const uint8_t settings[] = {LENGTH_DIGITAL_IO, port_0, port_1, 0, 0, 0, 0};
+	const uint8_t trigger[] = {LENGTH_TRIGGER, 0xFE};
+
+	CHECK(USBD_HID_Digital_IO_Sim_Output(sim, settings) == ACK_ACCEPTED);
+	USBD_HID_Digital_IO_Sim_Run(sim, sim->loop_cycles);
+	CHECK(USBD_HID_Digital_IO_Sim_Output(sim, trigger) == ACK_ACCEPTED);
+}
+
+/**
+  * @brief  Echo model: port 0 outputs mirrored on port 1, trigger event on the echo.
+  * @retval None
+  */
+static void Test_Echo(DIGITAL_IO_SIM_TypeDef* sim)
+{
+	static DIGITAL_IO_SIM_Echo echo;	// main runs the module again after the test
+	DIGITAL_IO_SIM_Model model;
+	// Trigger 0: enabled, one element, port 1 pin 0 high
+	const uint8_t event[] = {LENGTH_TRIGGER_EVENT, 0x01, (uint8_t)(1 | (0 << 3) | (1 << 6)), 0, 0, 0};
+	const uint8_t oversampling[] = {COMMAND_OVERSAMPLING, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+	const uint8_t capture[] = {COMMAND_CAPTURE_CONFIG, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+	const uint8_t pipelined[2][7] = {{LENGTH_DIGITAL_IO, TEST_PORT_OUTPUT(0x0A), TEST_PORT_INPUT, 0, 0, 0, 0},
+									 {LENGTH_DIGITAL_IO, TEST_PORT_OUTPUT(0x0F), TEST_PORT_INPUT, 0, 0, 0, 0}};
+	const uint8_t trigger[] = {LENGTH_TRIGGER, 0xFE};
+	uint32_t fired = 0;
+
+	echo.out_mask = DIGITAL_IO_PORT_MASK(0);
+	echo.shift = DIGITAL_MAX_PIN_NUM;
+	USBD_HID_Digital_IO_Sim_Echo_Model(&echo, &model);
+	USBD_HID_Digital_IO_Sim_Init(sim, &model);
+
+	CHECK(USBD_HID_Digital_IO_Sim_Output(sim, event) == ACK_ACCEPTED);
+	Test_Switch(sim, TEST_PORT_OUTPUT(0x05), TEST_PORT_INPUT);
+	fired = USBD_HID_Digital_IO_Sim_Run(sim, 4 * sim->loop_cycles);
+	CHECK(sim->output_mask == DIGITAL_IO_PORT_MASK(0));
+	CHECK((sim->ctx.sample & 0xFFU) == 0x55U);
+	CHECK(fired == 0x01U);
+	CHECK(sim->trigger_pulses == 1 && sim->trigger_out == 0);
+
+	// The trigger disarmed itself
+	Test_Switch(sim, TEST_PORT_OUTPUT(0x0A), TEST_PORT_INPUT);
+	fired = USBD_HID_Digital_IO_Sim_Run(sim, 2 * sim->loop_cycles);
+	Test_Switch(sim, TEST_PORT_OUTPUT(0x05), TEST_PORT_INPUT);
+	fired |= USBD_HID_Digital_IO_Sim_Run(sim, 2 * sim->loop_cycles);
+	CHECK((sim->ctx.sample & 0xFFU) == 0x55U);
+	CHECK(fired == 0 && sim->trigger_pulses == 1);
+
+	// Core commands reach the core, those of the feature modules are not simulated
+	CHECK(USBD_HID_Digital_IO_Sim_Output(sim, oversampling) == ACK_ACCEPTED);
+	CHECK(sim->ctx.oversampling == 3);
+	CHECK(USBD_HID_Digital_IO_Sim_Output(sim, capture) == ACK_UNKNOWN);
+	USBD_HID_Digital_IO_Sim_Run(sim, 2 * sim->loop_cycles);
+	CHECK((sim->ctx.sample & 0xFFU) == 0x55U);
+
+	// A second LENGTH_DIGITAL_IO before the main loop stored the first one is dropped, the first one is switched
+	CHECK(USBD_HID_Digital_IO_Sim_Output(sim, pipelined[0]) == ACK_ACCEPTED);
+	CHECK(USBD_HID_Digital_IO_Sim_Output(sim, pipelined[1]) == ACK_DROPPED);
+	USBD_HID_Digital_IO_Sim_Run(sim, sim->loop_cycles);
+	CHECK(USBD_HID_Digital_IO_Sim_Output(sim, trigger) == ACK_ACCEPTED);
+	USBD_HID_Digital_IO_Sim_Run(sim, 2 * sim->loop_cycles);
+	CHECK((sim->ctx.sample & 0xFFU) == 0xAAU);
+	Test_Switch(sim, TEST_PORT_OUTPUT(0x05), TEST_PORT_INPUT);
+	USBD_HID_Digital_IO_Sim_Run(sim, 2 * sim->loop_cycles);
+	CHECK((sim->ctx.sample & 0xFFU) == 0x55U);
+	printf("echo: OK\n");
+}
+
+/**
+  * @brief  One main loop pass, the level of the answer pin is logged.
+  * @retval None
+  */
+static void Test_Pass(DIGITAL_IO_SIM_TypeDef* sim, uint8_t* log, uint32_t* passes)
+{
+	USBD_HID_Digital_IO_Sim_Run(sim, sim->loop_cycles);
+	CHECK(*passes < TEST_SERIAL_LOG);
+	log[(*passes)++] = (sim->ctx.sample >> DIGITAL_IO_BIT(1, 0)) & 0x01U;
+}
+
+/**
+  * @brief  Drive one serial bit on port 0 pin 0 for TEST_SERIAL_BIT passes.
+  * @retval None
+  */
+static void Test_Serial_Bit(DIGITAL_IO_SIM_TypeDef* sim, uint8_t level, uint8_t* log, uint32_t* passes)
+{
+	const uint8_t settings[] = {LENGTH_DIGITAL_IO, TEST_PORT_OUTPUT(level), TEST_PORT_INPUT, 0, 0, 0, 0};
+	const uint8_t trigger[] = {LENGTH_TRIGGER, 0xFE};
+	uint8_t idx = 0;
+
+	CHECK(USBD_HID_Digital_IO_Sim_Output(sim, settings) == ACK_ACCEPTED);
+	Test_Pass(sim, log, passes);
+	CHECK(USBD_HID_Digital_IO_Sim_Output(sim, trigger) == ACK_ACCEPTED);
+	for (idx = 1; idx < TEST_SERIAL_BIT; idx++)
+	{
+		Test_Pass(sim, log, passes);
+	}
+}
+
+/**
+  * @brief  Serial responder: the firmware sends a byte, the model answers byte + 1.
+  * @retval None
+  */
+static void Test_Serial(DIGITAL_IO_SIM_TypeDef* sim)
+{
+	static DIGITAL_IO_SIM_Serial serial;
+	DIGITAL_IO_SIM_Model model;
+	uint8_t log[TEST_SERIAL_LOG] = {0}, answer = 0, idx = 0;
+	uint32_t passes = 0, start = 0;
+
+	serial.rx_bit = DIGITAL_IO_BIT(0, 0);
+	serial.tx_bit = DIGITAL_IO_BIT(1, 0);
+	serial.bit_cycles = TEST_SERIAL_BIT * DIGITAL_IO_SIM_LOOP_CYCLES;
+	USBD_HID_Digital_IO_Sim_Serial_Model(&serial, &model);
+	USBD_HID_Digital_IO_Sim_Init(sim, &model);
+
+	// Idle high, start bit, 8 data bits (LSB first), stop bit and idle while the answer comes
+	Test_Serial_Bit(sim, 1, log, &passes);
+	Test_Serial_Bit(sim, 0, log, &passes);
+	for (idx = 0; idx < 8; idx++)
+	{
+		Test_Serial_Bit(sim, (TEST_SERIAL_BYTE >> idx) & 0x01U, log, &passes);
+	}
+	start = passes;
+	for (idx = 0; idx < 12; idx++)
+	{
+		Test_Serial_Bit(sim, 1, log, &passes);
+	}
+	CHECK(serial.received == 1);
+	CHECK(serial.framing_errors == 0);
+
+	// Decode the answer in the middle of its bits
+	while (start < passes && log[start] != 0)
+	{
+		start++;
+	}
+	CHECK(start + 10 * TEST_SERIAL_BIT <= passes);
+	for (idx = 0; idx < 8; idx++)
+	{
+		answer |= (uint8_t)(log[start + (idx + 1) * TEST_SERIAL_BIT + TEST_SERIAL_BIT / 2] << idx);
+	}
+	CHECK(log[start + 9 * TEST_SERIAL_BIT + TEST_SERIAL_BIT / 2] == 1);
+	CHECK(answer == (uint8_t)(TEST_SERIAL_BYTE + 1));
+	printf("serial: sent 0x%02X, answer 0x%02X\n", TEST_SERIAL_BYTE, answer);
+}
+
+
+/**
+  * @brief  Delay line: the echo arrives after the delay, a full line drops its oldest change.
+  * @retval None
+  */
+static void Test_Delay(DIGITAL_IO_SIM_TypeDef* sim)
+{
+	static DIGITAL_IO_SIM_Echo line;
+	DIGITAL_IO_SIM_Model model;
+	uint32_t pass = 0, sent = 0, arrived = 0, idx = 0, first = 0;
+
+	line.out_mask = DIGITAL_IO_PORT_MASK(0);
+	line.shift = DIGITAL_MAX_PIN_NUM;
+	line.delay = TEST_DELAY_PASSES * DIGITAL_IO_SIM_LOOP_CYCLES;
+	USBD_HID_Digital_IO_Sim_Delay_Model(&line, &model);
+	USBD_HID_Digital_IO_Sim_Init(sim, &model);
+
+	// Passes between the first sample with the new outputs and the first one with the echo
+	Test_Switch(sim, TEST_PORT_OUTPUT(0x05), TEST_PORT_INPUT);
+	for (pass = 1; pass <= 4 * TEST_DELAY_PASSES && arrived == 0; pass++)
+	{
+		USBD_HID_Digital_IO_Sim_Run(sim, sim->loop_cycles);
+		if (sent == 0 && (sim->ctx.sample & 0x0FU) == 0x05U)
+		{
+			sent = pass;
+		}
+		if (((sim->ctx.sample >> DIGITAL_IO_BIT(1, 0)) & 0x0FU) == 0x05U)
+		{
+			arrived = pass;
+		}
+	}
+	CHECK(sent != 0 && arrived != 0);
+	CHECK(arrived - sent == TEST_DELAY_PASSES);
+
+	// Ring: one change per cycle, DIGITAL_IO_SIM_DELAY_DEPTH - 1 of them stay in flight
+	model.Reset(model.state);
+	line.out_mask = DIGITAL_IO_PORT_MASK(0) | DIGITAL_IO_PORT_MASK(1);
+	line.shift = 2 * DIGITAL_MAX_PIN_NUM;
+	line.delay = TEST_DELAY_LONG;
+	for (idx = 1; idx <= TEST_DELAY_CHANGES; idx++)
+	{
+		CHECK(model.Step(model.state, idx, line.out_mask, idx) == 0);
+	}
+	first = TEST_DELAY_CHANGES - (DIGITAL_IO_SIM_DELAY_DEPTH - 1) + 1;
+	CHECK(model.Step(model.state, TEST_DELAY_CHANGES, line.out_mask, first - 1 + TEST_DELAY_LONG) == 0);
+	CHECK(model.Step(model.state, TEST_DELAY_CHANGES, line.out_mask, first + TEST_DELAY_LONG) == (first << line.shift));
+	CHECK(model.Step(model.state, TEST_DELAY_CHANGES, line.out_mask, TEST_DELAY_CHANGES + TEST_DELAY_LONG) == (TEST_DELAY_CHANGES << line.shift));
+	printf("delay: %u passes, oldest kept change %u of %u\n", (unsigned)(arrived - sent), (unsigned)first, (unsigned)TEST_DELAY_CHANGES);
+}
+
+/**
+  * @brief  Counter: rising clock edges counted on port 1, the reset pin clears the count.
+  * @retval None
+  */
+static void Test_Counter(DIGITAL_IO_SIM_TypeDef* sim)
+{
+	static DIGITAL_IO_SIM_Counter counter;
+	DIGITAL_IO_SIM_Model model;
+	uint8_t idx = 0;
+
+	counter.clock_bit = DIGITAL_IO_BIT(0, 0);
+	counter.reset_bit = DIGITAL_IO_BIT(0, 1);
+	counter.in_shift = DIGITAL_IO_BIT(1, 0);
+	counter.in_width = DIGITAL_MAX_PIN_NUM;
+	USBD_HID_Digital_IO_Sim_Counter_Model(&counter, &model);
+	USBD_HID_Digital_IO_Sim_Init(sim, &model);
+
+	for (idx = 0; idx < TEST_COUNTER_EDGES; idx++)
+	{
+		Test_Switch(sim, TEST_PORT_OUTPUT(0x01), TEST_PORT_INPUT);
+		USBD_HID_Digital_IO_Sim_Run(sim, 2 * sim->loop_cycles);
+		Test_Switch(sim, TEST_PORT_OUTPUT(0x00), TEST_PORT_INPUT);
+		USBD_HID_Digital_IO_Sim_Run(sim, 2 * sim->loop_cycles);
+	}
+	CHECK(counter.count == TEST_COUNTER_EDGES);
+	CHECK(((sim->ctx.sample >> DIGITAL_IO_BIT(1, 0)) & 0x0FU) == TEST_COUNTER_EDGES);
+
+	// Reset high: cleared, a clock edge meanwhile is not counted
+	Test_Switch(sim, TEST_PORT_OUTPUT(0x02), TEST_PORT_INPUT);
+	USBD_HID_Digital_IO_Sim_Run(sim, 2 * sim->loop_cycles);
+	Test_Switch(sim, TEST_PORT_OUTPUT(0x03), TEST_PORT_INPUT);
+	USBD_HID_Digital_IO_Sim_Run(sim, 2 * sim->loop_cycles);
+	CHECK(counter.count == 0);
+	CHECK(((sim->ctx.sample >> DIGITAL_IO_BIT(1, 0)) & 0x0FU) == 0);
+
+	// Counting again after the reset is released
+	Test_Switch(sim, TEST_PORT_OUTPUT(0x00), TEST_PORT_INPUT);
+	USBD_HID_Digital_IO_Sim_Run(sim, 2 * sim->loop_cycles);
+	Test_Switch(sim, TEST_PORT_OUTPUT(0x01), TEST_PORT_INPUT);
+	USBD_HID_Digital_IO_Sim_Run(sim, 2 * sim->loop_cycles);
+	CHECK(counter.count == 1);
+	CHECK(((sim->ctx.sample >> DIGITAL_IO_BIT(1, 0)) & 0x0FU) == 1);
+	printf("counter: OK\n");
+}
+
+/**
+  * @brief  C++ shift register model: a byte clocked in MSB first appears on ports 1 and 2.
+  * @retval None
+  */
+static void Test_Shift(DIGITAL_IO_SIM_TypeDef* sim)
+{
+	DIGITAL_IO_SIM_Model model;
+	uint8_t idx = 0, bit = 0;
+
+	Test_Sim_Shift_Model(DIGITAL_IO_BIT(0, 0), DIGITAL_IO_BIT(0, 1), DIGITAL_IO_BIT(1, 0), &model);
+	USBD_HID_Digital_IO_Sim_Init(sim, &model);
+
+	for (idx = 0; idx < 8; idx++)
+	{
+		bit = (TEST_SHIFT_BYTE >> (7 - idx)) & 0x01U;
+		Test_Switch(sim, TEST_PORT_OUTPUT(bit), TEST_PORT_INPUT);
+		USBD_HID_Digital_IO_Sim_Run(sim, 2 * sim->loop_cycles);
+		Test_Switch(sim, TEST_PORT_OUTPUT(bit | 0x02U), TEST_PORT_INPUT);
+		USBD_HID_Digital_IO_Sim_Run(sim, 2 * sim->loop_cycles);
+	}
+	CHECK(Test_Sim_Shift_Clocks() == 8);
+	CHECK(((sim->ctx.sample >> DIGITAL_IO_BIT(1, 0)) & 0xFFU) == TEST_SHIFT_BYTE);
+	printf("shift (C++ model): 0x%02X\n", (unsigned)((sim->ctx.sample >> DIGITAL_IO_BIT(1, 0)) & 0xFFU));
+}
+
+
+/* Main -------------------------------------*/
+int main(void)
+{
+	static DIGITAL_IO_SIM_TypeDef echo_sim, serial_sim, model_sim;
+	uint32_t echo_sample = 0;
+
+	Test_Echo(&echo_sim);
+	echo_sample = echo_sim.ctx.sample;
+	Test_Serial(&serial_sim);
+	Test_Delay(&model_sim);
+	Test_Counter(&model_sim);
+	Test_Shift(&model_sim);
+
+	// Every simulated module keeps its own core state
+	CHECK(echo_sim.ctx.sample == echo_sample);
+	CHECK(echo_sim.ctx.oversampling == 3 && serial_sim.ctx.oversampling == 1);
+	USBD_HID_Digital_IO_Sim_Run(&echo_sim, 2 * echo_sim.loop_cycles);
+	CHECK((echo_sim.ctx.sample & 0xFFU) == 0x55U);
+	printf("sim: OK\n");
+	return 0;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
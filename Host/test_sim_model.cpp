@@ -0,0 +1,121 @@
+/**
+  ******************************************************************************
+  * @file    test_sim_model.cpp
+  * @brief   C++ DUT model of the simulation test: a shift register object
+  *          behind the DIGITAL_IO_SIM_Model table of the C core.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "test_sim_model.h"
+
+
+/* Private classes -------------------------------------*/
+namespace
+{
+
+class Shift_Register
+{
+public:
+	Shift_Register(uint8_t data_bit, uint8_t clock_bit, uint8_t out_shift)
+		: data_bit_(data_bit), clock_bit_(clock_bit), out_shift_(out_shift), value_(0), clocks_(0), last_(0)
+	{
+	}
+
+	// Model table: static members with the object as the state of the C core
+	DIGITAL_IO_SIM_Model Model()
+	{
+		DIGITAL_IO_SIM_Model model;
+
+		model.Reset = &Shift_Register::Reset;
+		model.Step = &Shift_Register::Step;
+		model.state = this;
+		return model;
+	}
+
+	uint32_t Clocks() const
+	{
+		return clocks_;
+	}
+
+private:
+	static void Reset(void* state)
+	{
+		Shift_Register* self = static_cast<Shift_Register*>(state);
+
+		self->value_ = 0;
+		self->clocks_ = 0;
+		self->last_ = 0;
+	}
+
+	static uint32_t Step(void* state, uint32_t outputs, uint32_t output_mask, uint32_t now)
+	{
+		(void)output_mask;
+		(void)now;
+		return static_cast<Shift_Register*>(state)->Clock(outputs);
+	}
+
+	uint32_t Clock(uint32_t outputs)
+	{
+		uint8_t clock = (outputs >> clock_bit_) & 0x01U;
+
+		if (clock && !last_)
+		{
+			value_ = (uint8_t)((value_ << 1) | ((outputs >> data_bit_) & 0x01U));
+			clocks_++;
+		}
+		last_ = clock;
+		return ((uint32_t)value_ << out_shift_) & DIGITAL_IO_ALL_BITS;
+	}
+
+	uint8_t		data_bit_;
+	uint8_t		clock_bit_;
+	uint8_t		out_shift_;
+	uint8_t		value_;
+	uint32_t	clocks_;
+	uint8_t		last_;
+};
+
+Shift_Register* shift_register = nullptr;
+
+}
+
+
+/* Functions -------------------------------------*/
+/**
+  * @brief  Create the shift register and fill the model table.
+  * @retval None
+  */
+extern "C" void Test_Sim_Shift_Model(uint8_t data_bit, uint8_t clock_bit, uint8_t out_shift, DIGITAL_IO_SIM_Model* model)
+{
+	delete shift_register;
+	shift_register = new Shift_Register(data_bit, clock_bit, out_shift);
+	*model = shift_register->Model();
+}
+
+/**
+  * @brief  Rising clock edges since the reset of the shift register.
+  * @retval Clock edges
+  */
+extern "C" uint32_t Test_Sim_Shift_Clocks(void)
+{
+	return (shift_register != nullptr) ? shift_register->Clocks() : 0;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
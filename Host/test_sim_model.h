@@ -0,0 +1,62 @@
+/**
+  ******************************************************************************
+  * @file    test_sim_model.h
+  * @brief   C++ DUT model of the simulation test, plugged in through the
+  *          DIGITAL_IO_SIM_Model table.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "usbd_digital_io_sim.h"
+
+
+/* Defines -------------------------------------*/
+#ifndef __TEST_SIM_MODEL_H
+#define __TEST_SIM_MODEL_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ /**
+   * @brief  Test_Sim_Shift_Model
+   *         Serial-in parallel-out shift register: the data output is shifted in
+   *         on the rising edges of the clock output, the register drives 8 input pins.
+   * @param  data_bit: output pin of the serial data
+   * @param  clock_bit: output pin of the shift clock
+   * @param  out_shift: lowest input pin of the register (MSB first in, bit 0 = last bit)
+   * @param  model: filled with the model table (the state stays valid until the next call)
+   * @retval None
+   */
+ void Test_Sim_Shift_Model(uint8_t data_bit, uint8_t clock_bit, uint8_t out_shift, DIGITAL_IO_SIM_Model* model);
+
+ /**
+   * @brief  Test_Sim_Shift_Clocks
+   *         Rising clock edges seen by the shift register since its reset.
+   * @retval Clock edges
+   */
+ uint32_t Test_Sim_Shift_Clocks(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __TEST_SIM_MODEL_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
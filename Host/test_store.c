@@ -0,0 +1,310 @@
+/**
+  ******************************************************************************
+  * @file    test_store.c
+  * @brief   Test of the capture store: run and record reports of two rate
+  *          groups, direct and through the fan-out ring, pin queries against
+  *          a sample by sample reference.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "digital_io_store.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+/* Defines -------------------------------------*/
+#define TEST_PERIOD			(100U)
+#define TEST_START			(0xFFF00000U)	// the timestamps wrap during the capture
+#define TEST_RECORDS		(200000U)		// records of the fast group
+#define TEST_MAX_RUN		(0xFFFFU)		// DIGITAL_IO_CAPTURE_MAX_RUN
+#define TEST_TIME(idx)		(0x100000000ULL + TEST_START + (uint64_t)(idx) * TEST_PERIOD)
+
+#define CHECK(condition)	do { if (!(condition)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); exit(1); } } while (0)
+
+
+/* Private typedef -------------------------------------*/
+typedef struct
+{
+	uint8_t					report[DIGITAL_IO_DECODE_REPORT_SIZE];
+} Test_Report;
+
+
+/* Private variables -------------------------------------*/
+static uint32_t grid[TEST_RECORDS];				// levels of all groups every TEST_PERIOD
+static Test_Report reports[TEST_RECORDS];
+static DIGITAL_IO_STORE_Interval expected[TEST_RECORDS], found[TEST_RECORDS];
+
+
+/* Private functions -------------------------------------*/
+/**
+  * @brief  xorshift32 generator.
+  * @retval Random word
+  */
+static uint32_t Test_Random(uint32_t* state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+/**
+  * @brief  Levels of a group: long stable stretches, now and then a pin toggles.
+  * @retval None
+  */
+static void Test_Signal(uint32_t* state, uint32_t mask, uint8_t decimation)
+{
+	uint32_t value = 0, idx = 0, bit = 0;
+
+	for (idx = 0; idx < TEST_RECORDS; idx += decimation)
+	{
+		if ((Test_Random(state) & 0x3FU) == 0)
+		{
+			do
+			{
+				bit = Test_Random(state) % DIGITAL_IO_DECODE_BIT_NUM;
+			} while (!((mask >> bit) & 0x01U));
+			value ^= 1U << bit;
+		}
+		for (bit = 0; bit < decimation; bit++)
+		{
+			grid[idx + bit] = (grid[idx + bit] & ~mask) | value;
+		}
+	}
+}
+
+/**
+  * @brief  Run reports of the groups like USBD_HID_Digital_IO_Capture_Run_Report, the groups in round robin.
+  * @retval Number of reports
+  */
+static uint32_t Test_Runs(const DIGITAL_IO_DECODE_Capture* capture)
+{
+	uint32_t next[DIGITAL_IO_DECODE_PORT_NUM] = {0}, value = 0, length = 0, timestamp = 0, count = 0;
+	uint8_t group_idx = 0, decimation = 0, active = 1;
+	uint8_t* report = 0;
+
+	while (active)
+	{
+		active = 0;
+		for (group_idx = 0; group_idx < capture->group_num; group_idx++)
+		{
+			decimation = capture->group[group_idx].decimation;
+			if (next[group_idx] * decimation >= TEST_RECORDS)
+			{
+				continue;
+			}
+			active = 1;
+			value = grid[next[group_idx] * decimation] & capture->group[group_idx].mask;
+			for (length = 1; (next[group_idx] + length) * decimation < TEST_RECORDS && length < TEST_MAX_RUN
+				 && (grid[(next[group_idx] + length) * decimation] & capture->group[group_idx].mask) == value; length++)
+			{
+			}
+			timestamp = TEST_START + next[group_idx] * decimation * TEST_PERIOD;
+			report = reports[count++].report;
+			report[0] = DIGITAL_IO_DECODE_EXTENDED | DIGITAL_IO_DECODE_CAPTURE_RUN;
+			report[1] = (uint8_t)(group_idx << 4);
+			memcpy(&report[2], &timestamp, sizeof(timestamp));
+			memcpy(&report[6], &value, 3);
+			report[9] = (uint8_t)length;
+			report[10] = (uint8_t)(length >> 8);
+			next[group_idx] += length;
+		}
+	}
+	return count;
+}
+
+/**
+  * @brief  Record reports of one group with the port nibbles in port order.
+  * @retval Number of reports
+  */
+static uint32_t Test_Records(const DIGITAL_IO_DECODE_Capture* capture)
+{
+	const DIGITAL_IO_DECODE_Group* group = &capture->group[0];
+	uint32_t idx = 0, bits = 0, timestamp = 0, count = 0;
+	uint8_t num = (uint8_t)(DIGITAL_IO_DECODE_RECORD_BITS / (group->port_num * DIGITAL_IO_DECODE_PIN_NUM)), rec_idx = 0, port_idx = 0;
+	uint8_t* report = 0;
+
+	for (idx = 0; idx < TEST_RECORDS; idx += num)
+	{
+		bits = 0;
+		for (rec_idx = 0; rec_idx < num; rec_idx++)
+		{
+			for (port_idx = 0; port_idx < group->port_num; port_idx++)
+			{
+				bits |= ((grid[idx + rec_idx] >> (group->ports[port_idx] * DIGITAL_IO_DECODE_PIN_NUM)) & 0x0FU)
+						<< ((rec_idx * group->port_num + port_idx) * DIGITAL_IO_DECODE_PIN_NUM);
+			}
+		}
+		timestamp = TEST_START + idx * TEST_PERIOD;
+		report = reports[count++].report;
+		report[0] = DIGITAL_IO_DECODE_EXTENDED | DIGITAL_IO_DECODE_CAPTURE;
+		report[1] = (uint8_t)(num << 4);
+		memcpy(&report[2], &timestamp, sizeof(timestamp));
+		memcpy(&report[6], &bits, sizeof(bits));
+		report[10] = (idx == 0) ? 2 : 0;
+	}
+	return count;
+}
+
+/**
+  * @brief  Query the store and compare with the intervals of the reference.
+  * @retval Number of intervals
+  */
+static int64_t Test_Query(const DIGITAL_IO_STORE_TypeDef* store, const DIGITAL_IO_STORE_Condition* condition, size_t condition_num)
+{
+	uint32_t idx = 0, count = 0;
+	size_t term_idx = 0;
+	uint8_t match = 0, inside = 0;
+	int64_t result = 0;
+
+	for (idx = 0; idx <= TEST_RECORDS; idx++)
+	{
+		match = 0;
+		for (term_idx = 0; idx < TEST_RECORDS && term_idx < condition_num; term_idx++)
+		{
+			match |= ((grid[idx] & condition[term_idx].high) == condition[term_idx].high && (grid[idx] & condition[term_idx].low) == 0);
+		}
+		if (match && !inside)
+		{
+			expected[count].start = TEST_TIME(idx);
+		}
+		else if (!match && inside)
+		{
+			expected[count++].end = TEST_TIME(idx);
+		}
+		inside = match;
+	}
+
+	result = DIGITAL_IO_Store_Query(store, condition, condition_num, found, TEST_RECORDS);
+	CHECK(result == count);
+	CHECK(memcmp(found, expected, count * sizeof(DIGITAL_IO_STORE_Interval)) == 0);
+	// Only max intervals are written, the count is complete
+	if (count > 3)
+	{
+		memset(found, 0, sizeof(found));
+		CHECK(DIGITAL_IO_Store_Query(store, condition, condition_num, found, 3) == count);
+		CHECK(memcmp(found, expected, 3 * sizeof(DIGITAL_IO_STORE_Interval)) == 0 && found[3].start == 0);
+	}
+	return result;
+}
+
+/**
+  * @brief  All queries of the test on a store.
+  * @retval None
+  */
+static void Test_Queries(const DIGITAL_IO_STORE_TypeDef* store, const char* source)
+{
+	// Port 2 pin 1 high while port 4 pin 3 low
+	const DIGITAL_IO_STORE_Condition high_low = {DIGITAL_IO_STORE_BIT(2, 1), DIGITAL_IO_STORE_BIT(4, 3)};
+	const DIGITAL_IO_STORE_Condition any[2] = {{DIGITAL_IO_STORE_BIT(0, 0), 0}, {DIGITAL_IO_STORE_BIT(4, 3), DIGITAL_IO_STORE_BIT(1, 2)}};
+	const DIGITAL_IO_STORE_Condition low = {0, DIGITAL_IO_STORE_BIT(2, 1)};
+	const DIGITAL_IO_STORE_Condition always = {0, 0};
+	const DIGITAL_IO_STORE_Condition never = {DIGITAL_IO_STORE_BIT(2, 1), DIGITAL_IO_STORE_BIT(2, 1)};
+	int64_t intervals = 0;
+
+	intervals = Test_Query(store, &high_low, 1);
+	CHECK(intervals > 0);
+	Test_Query(store, any, 2);
+	Test_Query(store, &low, 1);
+	CHECK(Test_Query(store, &always, 1) == 1);
+	CHECK(Test_Query(store, &never, 1) == 0);
+	CHECK(found[0].start == TEST_TIME(0) && store->end == TEST_TIME(TEST_RECORDS));
+
+	printf("%s: %llu rows, %zu bytes of bitplanes (%llu uncompressed), port 2 pin 1 high while port 4 pin 3 low: %lld intervals\n",
+		   source, (unsigned long long)store->rows, DIGITAL_IO_Store_Size(store),
+		   (unsigned long long)(store->rows * DIGITAL_IO_DECODE_BIT_NUM / 8), (long long)intervals);
+}
+
+
+/* Main -------------------------------------*/
+int main(void)
+{
+	// Period 100, group 0 = ports 0-2 (decimation 1), group 1 = port 4 (decimation 2)
+	const uint8_t config[10] = {TEST_PERIOD, 0x00, 0x00, 0x00, 1, 1, 1, 0, 2, 0};
+	// One group of ports 2 and 4: 4 records per report
+	const uint8_t record_config[10] = {TEST_PERIOD, 0x00, 0x00, 0x00, 0, 0, 1, 0, 1, 0};
+	DIGITAL_IO_DECODE_Capture capture;
+	DIGITAL_IO_STORE_TypeDef store, ring_store;
+	DIGITAL_IO_FANOUT_TypeDef fanout;
+	uint32_t state = 0x2545F491U, count = 0, idx = 0;
+	int64_t added = 0;
+	char name[64];
+	int consumer = -1;
+
+	// Run reports of two groups merged in time order
+	DIGITAL_IO_Decode_Setup(&capture, config, 0x0BU);
+	Test_Signal(&state, capture.group[0].mask, 1);
+	Test_Signal(&state, capture.group[1].mask, 2);
+	count = Test_Runs(&capture);
+	DIGITAL_IO_Store_Init(&store, &capture);
+	for (idx = 0; idx < count; idx++)
+	{
+		CHECK(DIGITAL_IO_Store_Report(&store, reports[idx].report, DIGITAL_IO_DECODE_REPORT_SIZE) == 1);
+		// The changes of the first group wait for the other one
+		CHECK(idx > 0 || store.rows == 0);
+	}
+	CHECK(DIGITAL_IO_Store_Flush(&store) == 0);
+	Test_Queries(&store, "runs");
+
+	// The same reports from the fan-out ring
+	snprintf(name, sizeof(name), "/digital_io_store_test_%d", (int)getpid());
+	CHECK(DIGITAL_IO_Fanout_Create(&fanout, name) == 0);
+	consumer = DIGITAL_IO_Fanout_Attach(&fanout, DIGITAL_IO_FANOUT_RELIABLE);
+	CHECK(consumer >= 0);
+	DIGITAL_IO_Store_Init(&ring_store, &capture);
+	for (idx = 0; idx < count; idx++)
+	{
+		if (DIGITAL_IO_Fanout_Publish(&fanout, reports[idx].report, DIGITAL_IO_DECODE_REPORT_SIZE, idx) != 0)
+		{
+			added += DIGITAL_IO_Store_Fanout(&ring_store, &fanout, consumer);
+			CHECK(DIGITAL_IO_Fanout_Publish(&fanout, reports[idx].report, DIGITAL_IO_DECODE_REPORT_SIZE, idx) == 0);
+		}
+	}
+	added += DIGITAL_IO_Store_Fanout(&ring_store, &fanout, consumer);
+	CHECK(added == count);
+	CHECK(DIGITAL_IO_Store_Flush(&ring_store) == 0);
+	CHECK(ring_store.rows == store.rows && memcmp(ring_store.time, store.time, store.rows * sizeof(uint64_t)) == 0);
+	Test_Queries(&ring_store, "fan-out");
+	DIGITAL_IO_Store_Free(&ring_store);
+	DIGITAL_IO_Store_Free(&store);
+	DIGITAL_IO_Fanout_Close(&fanout);
+
+	// Record reports (no run length reports)
+	memset(grid, 0, sizeof(grid));
+	DIGITAL_IO_Decode_Setup(&capture, record_config, 0x03U);
+	Test_Signal(&state, capture.group[0].mask, 1);
+	count = Test_Records(&capture);
+	DIGITAL_IO_Store_Init(&store, &capture);
+	for (idx = 0; idx < count; idx++)
+	{
+		CHECK(DIGITAL_IO_Store_Report(&store, reports[idx].report, DIGITAL_IO_DECODE_REPORT_SIZE) == 1);
+	}
+	CHECK(DIGITAL_IO_Store_Flush(&store) == 0);
+	CHECK(store.lost == 2);
+	Test_Queries(&store, "records");
+	DIGITAL_IO_Store_Free(&store);
+
+	printf("store: OK\n");
+	return 0;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
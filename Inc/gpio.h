@@ -63,8 +63,58 @@
 /* USER CODE END Includes */
 
 /* USER CODE BEGIN Private defines */
+#define GPIO_DIGITAL_BANK_NUM		(0x03U)
+#define GPIO_DIGITAL_IDR_LANE_NUM	(0x02U)
+#define GPIO_DIGITAL_BIT_LANE_NUM	(0x03U)
+#define GPIO_DIGITAL_LANE_SIZE		(0x100U)
+#define GPIO_DIGITAL_LANE(word, lane)	(((word) >> ((lane) * 8U)) & 0xFFU)
+#define GPIO_DIGITAL_SAVED_SIZE		(GPIO_DIGITAL_BANK_NUM * 3U)	// MODER, PUPDR, ODR of each bank
+
+// EXTI lines used as sticky edge latches (one pin per line number, TRIGGER_IN line is kept)
+#define GPIO_DIGITAL_EDGE_LINE_NUM	(0x10U)
+#define GPIO_DIGITAL_EDGE_NO_BIT	(0xFFU)
+#define GPIO_DIGITAL_EDGE_RESERVED	((uint32_t)TRIGGER_IN_Pin)
+
  extern uint16_t gpio_digital_pin [DIGITAL_MAX_PORT_NUM]  [DIGITAL_MAX_PIN_NUM];
  extern GPIO_TypeDef* gpio_digital_port [DIGITAL_MAX_PORT_NUM]  [DIGITAL_MAX_PIN_NUM];
+ extern GPIO_TypeDef* gpio_digital_bank [GPIO_DIGITAL_BANK_NUM];
+ extern uint8_t gpio_digital_remap [DIGITAL_IO_MAX_BIT_NUM];
+ extern uint32_t gpio_digital_gather [GPIO_DIGITAL_BANK_NUM] [GPIO_DIGITAL_IDR_LANE_NUM] [GPIO_DIGITAL_LANE_SIZE];
+ extern uint16_t gpio_digital_scatter [GPIO_DIGITAL_BIT_LANE_NUM] [GPIO_DIGITAL_LANE_SIZE] [GPIO_DIGITAL_BANK_NUM];
+ extern uint16_t gpio_digital_bank_mask [DIGITAL_MAX_PORT_NUM] [GPIO_DIGITAL_BANK_NUM];
+ extern uint8_t gpio_digital_edge_line [GPIO_DIGITAL_EDGE_LINE_NUM];
+ extern uint32_t gpio_digital_edge_lines;
+ extern uint32_t gpio_digital_edge_watch;
+ extern uint32_t gpio_digital_edge_gather [GPIO_DIGITAL_IDR_LANE_NUM] [GPIO_DIGITAL_LANE_SIZE];
+
+/**
+  * @brief  GPIO_Gather_DIGITAL_IO
+  *         Convert one snapshot of the bank IDR registers to the logical
+  *         (port * 4 + pin) bit order with the precomputed remap tables.
+  * @param  idr_a, idr_b, idr_c: IDR values of GPIOA, GPIOB and GPIOC
+  * @retval Packed logical sample
+  */
+__attribute__((always_inline)) __STATIC_INLINE uint32_t GPIO_Gather_DIGITAL_IO(uint32_t idr_a, uint32_t idr_b, uint32_t idr_c)
+{
+	return gpio_digital_gather[0][0][GPIO_DIGITAL_LANE(idr_a, 0)] | gpio_digital_gather[0][1][GPIO_DIGITAL_LANE(idr_a, 1)]
+		 | gpio_digital_gather[1][0][GPIO_DIGITAL_LANE(idr_b, 0)] | gpio_digital_gather[1][1][GPIO_DIGITAL_LANE(idr_b, 1)]
+		 | gpio_digital_gather[2][0][GPIO_DIGITAL_LANE(idr_c, 0)] | gpio_digital_gather[2][1][GPIO_DIGITAL_LANE(idr_c, 1)];
+}
+
+/**
+  * @brief  GPIO_Read_Edges_DIGITAL_IO
+  *         Read and clear the latched EXTI edges of the digital IO pins.
+  *         The EXTI interrupts stay disabled in the NVIC, the pending flags
+  *         only record that an edge happened since the previous call.
+  * @retval Logical bits with at least one edge
+  */
+__attribute__((always_inline)) __STATIC_INLINE uint32_t GPIO_Read_Edges_DIGITAL_IO(void)
+{
+	uint32_t pending = EXTI->PR & gpio_digital_edge_lines;
+
+	EXTI->PR = pending;
+	return gpio_digital_edge_gather[0][GPIO_DIGITAL_LANE(pending, 0)] | gpio_digital_edge_gather[1][GPIO_DIGITAL_LANE(pending, 1)];
+}
 /* USER CODE END Private defines */
 
 void MX_GPIO_Init(void);
@@ -72,6 +122,16 @@ void MX_GPIO_Init(void);
 /* USER CODE BEGIN Prototypes */
 uint8_t GPIO_Read_DIGITAL_IO(uint8_t port, uint8_t pin);
 void GPIO_Write_DIGITAL_IO(uint8_t port, uint8_t pin, GPIO_PinState value);
+void GPIO_Remap_DIGITAL_IO(const uint8_t* remap);
+void GPIO_Setup_DIGITAL_IO(uint8_t port, uint32_t mode, uint32_t pull);
+void GPIO_Edge_Setup_DIGITAL_IO(void);
+uint32_t GPIO_Read_Packed_DIGITAL_IO(void);
+void GPIO_Snapshot_DIGITAL_IO(uint32_t* samples, uint8_t num);
+void GPIO_Compile_Packed_DIGITAL_IO(uint32_t mask, uint32_t value, uint32_t* bsrr);
+void GPIO_Write_Packed_DIGITAL_IO(uint32_t mask, uint32_t value);
+void GPIO_Config_Packed_DIGITAL_IO(uint32_t mask, uint32_t mode, uint32_t pull);
+void GPIO_Save_Packed_DIGITAL_IO(uint32_t* saved);
+void GPIO_Restore_Packed_DIGITAL_IO(uint32_t mask, const uint32_t* saved);
 void GPIO_Toggle_LED(void);
 void toggle_pps(void);
 /* USER CODE END Prototypes */
@@ -61,15 +61,21 @@
 
 /* USER CODE END Includes */
 
+extern TIM_HandleTypeDef htim1;
 extern TIM_HandleTypeDef htim3;
 extern TIM_HandleTypeDef htim9;
 
+extern DMA_HandleTypeDef hdma_tim1_ch1;
+extern DMA_HandleTypeDef hdma_tim1_ch2;
+extern DMA_HandleTypeDef hdma_tim1_ch3;
+
 /* USER CODE BEGIN Private defines */
 
 /* USER CODE END Private defines */
 
 extern void _Error_Handler(char *, int);
 
+void MX_TIM1_Init(void);
 void MX_TIM3_Init(void);
 void MX_TIM9_Init(void);
 
@@ -70,6 +70,8 @@
 
 #define CUSTOM_HID_REQ_SET_REPORT            0x09
 #define CUSTOM_HID_REQ_GET_REPORT            0x01
+
+#define CUSTOM_HID_REPORT_FEATURE            0x03
 /**
   * @}
   */ 
@@ -91,6 +93,10 @@ typedef struct _USBD_CUSTOM_HID_Itf
   int8_t (* Init)          (void);
   int8_t (* DeInit)        (void);
   int8_t (* OutEvent)      (uint8_t, uint8_t );   
+  uint8_t* (* FeatureBuffer) (uint16_t);
+  int8_t (* FeatureEvent)  (uint16_t);
+  uint8_t* (* FeatureSend) (uint16_t*);
+  uint8_t* (* InReady)     (uint16_t*);
 
 }USBD_CUSTOM_HID_ItfTypeDef;
 
@@ -101,6 +107,9 @@ typedef struct
   uint32_t             IdleState;  
   uint32_t             AltSetting;
   uint32_t             IsReportAvailable;  
+  uint32_t             IsFeatureAvailable;
+  uint16_t             FeatureLength;
+  uint32_t             IsOutPaused;
   CUSTOM_HID_StateTypeDef     state;  
 }
 USBD_CUSTOM_HID_HandleTypeDef; 
@@ -135,6 +144,8 @@ uint8_t USBD_CUSTOM_HID_SendReport (USBD_HandleTypeDef *pdev,
                                  uint8_t *report,
                                  uint16_t len);
 
+uint8_t USBD_CUSTOM_HID_ReceivePacket (USBD_HandleTypeDef *pdev);
+
 
 
 uint8_t  USBD_CUSTOM_HID_RegisterInterface  (USBD_HandleTypeDef   *pdev, 
@@ -264,6 +264,8 @@ static uint8_t  USBD_CUSTOM_HID_Init (USBD_HandleTypeDef *pdev,
     hhid = (USBD_CUSTOM_HID_HandleTypeDef*) pdev->pClassData;
       
     hhid->state = CUSTOM_HID_IDLE;
+    hhid->IsFeatureAvailable = 0;
+    hhid->IsOutPaused = 0;
     ((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData)->Init();
           /* Prepare Out endpoint to receive 1st packet */ 
     USBD_LL_PrepareReceive(pdev, CUSTOM_HID_EPOUT_ADDR, hhid->Report_buf, 
@@ -343,10 +345,41 @@ static uint8_t  USBD_CUSTOM_HID_Setup (USBD_HandleTypeDef *pdev,
       break;      
     
     case CUSTOM_HID_REQ_SET_REPORT:
+      /* Feature reports are received straight into the buffer of the interface */
+      if (((req->wValue >> 8) == CUSTOM_HID_REPORT_FEATURE) &&
+          (((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData)->FeatureBuffer != NULL))
+      {
+        pbuf = ((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData)->FeatureBuffer(req->wLength);
+        if (pbuf == NULL)
+        {
+          USBD_CtlError (pdev, req);
+          return USBD_FAIL;
+        }
+        hhid->IsFeatureAvailable = 1;
+        hhid->FeatureLength = req->wLength;
+        USBD_CtlPrepareRx (pdev, pbuf, req->wLength);
+        break;
+      }
       hhid->IsReportAvailable = 1;
-      USBD_CtlPrepareRx (pdev, hhid->Report_buf, (uint8_t)(req->wLength));
+      USBD_CtlPrepareRx (pdev, hhid->Report_buf, MIN(req->wLength, USBD_CUSTOMHID_OUTREPORT_BUF_SIZE));
       
       break;
+
+    case CUSTOM_HID_REQ_GET_REPORT:
+      /* Feature reports are sent straight from the buffer of the interface */
+      len = req->wLength;
+      if (((req->wValue >> 8) == CUSTOM_HID_REPORT_FEATURE) &&
+          (((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData)->FeatureSend != NULL))
+      {
+        pbuf = ((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData)->FeatureSend(&len);
+      }
+      if (pbuf == NULL)
+      {
+        USBD_CtlError (pdev, req);
+        return USBD_FAIL;
+      }
+      USBD_CtlSendData (pdev, pbuf, len);
+      break;
     default:
       USBD_CtlError (pdev, req);
       return USBD_FAIL; 
@@ -388,6 +421,27 @@ static uint8_t  USBD_CUSTOM_HID_Setup (USBD_HandleTypeDef *pdev,
   return USBD_OK;
 }
 
+/**
+  * @brief  USBD_CUSTOM_HID_ReceivePacket
+  *         Accept the next OUT report after a busy OutEvent
+  *         (USB interrupt or interrupts masked)
+  * @param  pdev: device instance
+  * @retval status: USBD_FAIL if the endpoint was not paused
+  */
+uint8_t USBD_CUSTOM_HID_ReceivePacket(USBD_HandleTypeDef *pdev)
+{
+  USBD_CUSTOM_HID_HandleTypeDef     *hhid = (USBD_CUSTOM_HID_HandleTypeDef*)pdev->pClassData;
+
+  if ((hhid == NULL) || (hhid->IsOutPaused == 0))
+  {
+    return USBD_FAIL;
+  }
+  hhid->IsOutPaused = 0;
+  USBD_LL_PrepareReceive(pdev, CUSTOM_HID_EPOUT_ADDR, hhid->Report_buf,
+                         USBD_CUSTOMHID_OUTREPORT_BUF_SIZE);
+  return USBD_OK;
+}
+
 /**
   * @brief  USBD_CUSTOM_HID_SendReport 
   *         Send CUSTOM_HID Report
@@ -441,7 +495,21 @@ static uint8_t  USBD_CUSTOM_HID_DataIn (USBD_HandleTypeDef *pdev,
   
   /* Ensure that the FIFO is empty before a new transfer, this condition could 
   be caused by  a new transfer before the end of the previous transfer */
-  ((USBD_CUSTOM_HID_HandleTypeDef *)pdev->pClassData)->state = CUSTOM_HID_IDLE;
+  USBD_CUSTOM_HID_HandleTypeDef     *hhid = (USBD_CUSTOM_HID_HandleTypeDef*)pdev->pClassData;
+  uint8_t *pbuf = NULL;
+  uint16_t len = 0;
+
+  hhid->state = CUSTOM_HID_IDLE;
+
+  /* Send the next queued report right from the transfer completion */
+  if (((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData)->InReady != NULL)
+  {
+    pbuf = ((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData)->InReady(&len);
+    if (pbuf != NULL)
+    {
+      USBD_CUSTOM_HID_SendReport(pdev, pbuf, len);
+    }
+  }
 
   return USBD_OK;
 }
@@ -459,8 +527,13 @@ static uint8_t  USBD_CUSTOM_HID_DataOut (USBD_HandleTypeDef *pdev,
   
   USBD_CUSTOM_HID_HandleTypeDef     *hhid = (USBD_CUSTOM_HID_HandleTypeDef*)pdev->pClassData;  
   
-  ((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData)->OutEvent(hhid->Report_buf[0], 
-                                                            hhid->Report_buf[1]);
+  /* A busy interface leaves the endpoint NAKing until it calls USBD_CUSTOM_HID_ReceivePacket */
+  if (((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData)->OutEvent(hhid->Report_buf[0], 
+                                                                hhid->Report_buf[1]) != USBD_OK)
+  {
+    hhid->IsOutPaused = 1;
+    return USBD_OK;
+  }
     
   USBD_LL_PrepareReceive(pdev, CUSTOM_HID_EPOUT_ADDR , hhid->Report_buf, 
                          USBD_CUSTOMHID_OUTREPORT_BUF_SIZE);
@@ -484,6 +557,11 @@ uint8_t USBD_CUSTOM_HID_EP0_RxReady(USBD_HandleTypeDef *pdev)
                                                               hhid->Report_buf[1]);
     hhid->IsReportAvailable = 0;      
   }
+  if (hhid->IsFeatureAvailable == 1)
+  {
+    ((USBD_CUSTOM_HID_ItfTypeDef *)pdev->pUserData)->FeatureEvent(hhid->FeatureLength);
+    hhid->IsFeatureAvailable = 0;
+  }
 
   return USBD_OK;
 }
@@ -25,7 +25,11 @@
   ******************************************************************************
   */
 /* Includes -------------------------------------*/
+#ifdef DIGITAL_IO_SIMULATION
+#include "usbd_digital_io_sim_port.h"
+#else
 #include "usbd_customhid.h"
+#endif
 
 
 /* Defines -------------------------------------*/
@@ -43,6 +47,93 @@
 
 #define DIGITAL_IO_MAX_TRIG_NUM (0x02U)
 
+// Packed logical sample: bit (port * 4 + pin), same order as the report bytes
+#define DIGITAL_IO_MAX_BIT_NUM	(DIGITAL_MAX_PORT_NUM * DIGITAL_MAX_PIN_NUM)
+#define DIGITAL_IO_ALL_BITS		(0x00FFFFFFU)
+#define DIGITAL_IO_BIT(port, pin)	((port) * DIGITAL_MAX_PIN_NUM + (pin))
+#define DIGITAL_IO_PORT_MASK(port)	(0x0FUL << ((port) * DIGITAL_MAX_PIN_NUM))
+
+// Commands: first byte of the output report >= COMMAND_FIRST, fixed size payload
+#define DIGITAL_IO_COMMAND_PAYLOAD_SIZE	(0x0AU)
+#define DIGITAL_IO_REMAP_MAX_ENTRY		(0x08U)
+#define DIGITAL_IO_MAX_OVERSAMPLING		(0x0FU)
+
+// Output report: byte[0] length or command, payload, last byte = sequence number of the host
+#define DIGITAL_IO_OUTPUT_REPORT_SIZE	(0x0CU)
+#define DIGITAL_IO_SEQUENCE_BYTE		(0x0BU)
+
+// IN report queues: reports of one report class waiting for the IN endpoint
+#define DIGITAL_IO_EVENT_QUEUE_SIZE		(0x08U)		// entries of one queue
+
+// IN report scheduler: highest class first, a waiting lower class goes first after AGE_LIMIT reports
+#define DIGITAL_IO_ACK_AGE_LIMIT		(0x04U)
+#define DIGITAL_IO_BULK_AGE_LIMIT		(0x08U)
+#define DIGITAL_IO_BULK_FILL			(0x02U)		// bulk reports prepared ahead of the IN transfers
+#define DIGITAL_IO_ACK_RESERVE			(0x02U)		// free ack slots before the next output report is accepted (its ack + ACK_APPLIED)
+
+// Feature report (SET_REPORT on the control pipe): bulk upload into the selected target
+#define DIGITAL_IO_UPLOAD_REPORT_SIZE	(0x1000U)	// size in the report descriptor: shorter reports are accepted, no padding past the target
+
+// Input reports: state report (byte[0] bit 7 = 0) or extended report (byte[0] = 0x80 | type)
+#define DIGITAL_IO_REPORT_SIZE			(0x0BU)
+#define DIGITAL_IO_REPORT_EXTENDED		(0x80U)
+
+/* Core context and HAL access:
+ * the target build has one static context and calls the GPIO layer directly,
+ * the host simulation (DIGITAL_IO_SIMULATION) runs any number of contexts, each
+ * thread works on the one selected by USBD_HID_Digital_IO_Context_Select and
+ * reaches the pins and the clock through the ops table of the context.
+ * All state of the core lives in the context (DIGITAL_IO_CTX_* accessors); the
+ * feature modules (capture, log, fabric, ...) drive peripherals of the target
+ * and are compiled out of the simulation.
+ */
+#ifdef DIGITAL_IO_SIMULATION
+// Selected context of the calling thread (the header is also included by C++ DUT models)
+#ifdef __cplusplus
+#define DIGITAL_IO_THREAD_LOCAL			thread_local
+#else
+#define DIGITAL_IO_THREAD_LOCAL			_Thread_local
+#endif
+#define DIGITAL_IO_CTX					(digital_io_current)
+#define DIGITAL_IO_TIMESTAMP()			(DIGITAL_IO_CTX->hal->Timestamp(DIGITAL_IO_CTX->hal_user))
+#define DIGITAL_IO_HAL_SETUP(port, mode, pull)	(DIGITAL_IO_CTX->hal->Setup(DIGITAL_IO_CTX->hal_user, (port), (mode), (pull)))
+#define DIGITAL_IO_HAL_READ()			(DIGITAL_IO_CTX->hal->Read(DIGITAL_IO_CTX->hal_user))
+#define DIGITAL_IO_HAL_READ_EDGES()		(0U)	// the simulated pins change only between two reads
+#define DIGITAL_IO_HAL_SNAPSHOT(samples, num)	do { uint8_t _i; for (_i = 0; _i < (num); _i++) (samples)[_i] = DIGITAL_IO_HAL_READ(); } while (0)
+#define DIGITAL_IO_HAL_WRITE(mask, value)	(DIGITAL_IO_CTX->hal->Write(DIGITAL_IO_CTX->hal_user, (mask), (value)))
+#define DIGITAL_IO_HAL_WRITE_BANK(bank, bsrr)	(DIGITAL_IO_CTX->hal->Write_Bank(DIGITAL_IO_CTX->hal_user, (bank), (bsrr)))
+#define DIGITAL_IO_HAL_COMPILE(mask, value, bsrr)	(DIGITAL_IO_CTX->hal->Compile(DIGITAL_IO_CTX->hal_user, (mask), (value), (bsrr)))
+#define DIGITAL_IO_HAL_REMAP(remap)		(DIGITAL_IO_CTX->hal->Remap(DIGITAL_IO_CTX->hal_user, (remap)))
+#define DIGITAL_IO_HAL_TRIGGER_OUT(bsrr)	(DIGITAL_IO_CTX->hal->Trigger_Out(DIGITAL_IO_CTX->hal_user, (bsrr)))
+// One thread per context and no interrupts: nothing to mask
+#define DIGITAL_IO_CRITICAL_ENTER(state)	((state) = 0U)
+#define DIGITAL_IO_CRITICAL_EXIT(state)	((void)(state))
+#define DIGITAL_IO_HAL_PIN(port, pin)	((uint16_t)(1U << (pin)))	// the simulated pins are the logical bits
+// BSRR words of the virtual TRIGGER_OUT pin (no trigger bus)
+#define DIGITAL_IO_TRIGGER_OUT_ASSERT	(0x00000001U)
+#define DIGITAL_IO_TRIGGER_OUT_RELEASE	(0x00010000U)
+#else
+#define DIGITAL_IO_CTX					(&digital_io_context)
+// Device timebase: CPU cycle counter (SystemCoreClock ticks, wraps after ~59 s at 72 MHz)
+#define DIGITAL_IO_TIMESTAMP()			(DWT->CYCCNT)
+#define DIGITAL_IO_HAL_SETUP(port, mode, pull)	GPIO_Setup_DIGITAL_IO((port), (mode), (pull))
+#define DIGITAL_IO_HAL_READ()			GPIO_Read_Packed_DIGITAL_IO()
+#define DIGITAL_IO_HAL_READ_EDGES()		GPIO_Read_Edges_DIGITAL_IO()
+#define DIGITAL_IO_HAL_SNAPSHOT(samples, num)	GPIO_Snapshot_DIGITAL_IO((samples), (num))
+#define DIGITAL_IO_HAL_WRITE(mask, value)	GPIO_Write_Packed_DIGITAL_IO((mask), (value))
+#define DIGITAL_IO_HAL_WRITE_BANK(bank, bsrr)	(gpio_digital_bank[(bank)]->BSRR = (bsrr))
+#define DIGITAL_IO_HAL_COMPILE(mask, value, bsrr)	GPIO_Compile_Packed_DIGITAL_IO((mask), (value), (bsrr))
+#define DIGITAL_IO_HAL_REMAP(remap)		GPIO_Remap_DIGITAL_IO((remap))
+#define DIGITAL_IO_HAL_TRIGGER_OUT(bsrr)	(TRIGGER_OUT_GPIO_Port->BSRR = (bsrr))
+// Producers in the main loop and in the USB interrupt
+#define DIGITAL_IO_CRITICAL_ENTER(state)	do { (state) = __get_PRIMASK(); __disable_irq(); } while (0)
+#define DIGITAL_IO_CRITICAL_EXIT(state)	__set_PRIMASK(state)
+#define DIGITAL_IO_HAL_PIN(port, pin)	(gpio_digital_pin[(port)][(pin)])
+// BSRR words of TRIGGER_OUT, set up for the trigger bus by COMMAND_FABRIC
+#define DIGITAL_IO_TRIGGER_OUT_ASSERT	(digital_io_fabric.assert_bsrr)
+#define DIGITAL_IO_TRIGGER_OUT_RELEASE	(digital_io_fabric.release_bsrr)
+#endif
+
 #define MASK_SHIFT(mask, nth) ((mask) << (nth))
 
 #ifdef __cplusplus
@@ -113,6 +204,82 @@
 	 LENGTH_DATETIME = 7
  } HID_Digital_IO_Output;
 
+ typedef enum {
+	 COMMAND_FIRST = 0x10,
+	 COMMAND_PIN_REMAP = 0x10,
+	 COMMAND_OVERSAMPLING = 0x11,
+	 COMMAND_CAPTURE_CONFIG = 0x12,
+	 COMMAND_CAPTURE_CONTROL = 0x13,
+	 COMMAND_UPLOAD = 0x14,
+	 COMMAND_TRIGGER_ACTION = 0x15,
+	 COMMAND_LOG = 0x16,
+	 COMMAND_DOWNLOAD = 0x17,
+	 COMMAND_INTERCONNECT_TEST = 0x18,
+	 COMMAND_LATENCY = 0x19,
+	 COMMAND_BUS_CONFIG = 0x1A,
+	 COMMAND_BUS_RUN = 0x1B,
+	 COMMAND_WATCH = 0x1C,
+	 COMMAND_DECODER = 0x1D,
+	 COMMAND_GROUP_CONFIG = 0x1E,
+	 COMMAND_GROUP_WRITE = 0x1F,
+	 COMMAND_TRIGGER_BENCH = 0x20,
+	 COMMAND_SEARCH = 0x21,
+	 COMMAND_STIMULUS_CONFIG = 0x22,
+	 COMMAND_STIMULUS_RUN = 0x23,
+	 COMMAND_FABRIC = 0x24
+ } HID_Digital_IO_Command;
+
+ typedef enum {
+	 ACTION_OUT_NONE = 0x00,
+	 ACTION_OUT_PULSE = 0x01,
+	 ACTION_OUT_SET = 0x02,
+	 ACTION_OUT_CLEAR = 0x03
+ } HID_Digital_IO_Trigger_Out;
+
+ typedef enum {
+	 UPLOAD_NONE = 0x00,
+	 UPLOAD_PIN_REMAP = 0x01,
+	 UPLOAD_CAPTURE_BUFFER = 0x02,
+	 UPLOAD_LOG = 0x03,				// download only
+	 UPLOAD_INTERCONNECT = 0x04,	// download only
+	 UPLOAD_BUS = 0x05,
+	 UPLOAD_STIMULUS = 0x06
+ } HID_Digital_IO_Upload_Target;
+
+ typedef enum {
+	 REPORT_CAPTURE = 0x01,
+	 REPORT_TRIGGER = 0x02,
+	 REPORT_LOG = 0x03,
+	 REPORT_INTERCONNECT = 0x04,
+	 REPORT_LATENCY = 0x05,
+	 REPORT_BUS = 0x06,
+	 REPORT_CAPTURE_RUN = 0x07,
+	 REPORT_WATCH = 0x08,
+	 REPORT_WATCH_ALLOC = 0x09,
+	 REPORT_DECODER = 0x0A,
+	 REPORT_GROUP = 0x0B,
+	 REPORT_TRIGGER_BENCH = 0x0C,
+	 REPORT_SEARCH = 0x0D,
+	 REPORT_STIMULUS = 0x0E,
+	 REPORT_FABRIC = 0x0F,
+	 REPORT_ACK = 0x10
+ } HID_Digital_IO_Report;
+
+ typedef enum {
+	 ACK_ACCEPTED = 0x00,		// processed, or stored for the main loop
+	 ACK_APPLIED = 0x01,			// the port registers were written
+	 ACK_DROPPED = 0x02,			// ignored (trigger without stored changes, or already triggered by a trigger action,
+								// LENGTH_DIGITAL_IO while the previous changes are not stored yet)
+	 ACK_UNKNOWN = 0x03			// unknown length or command code
+ } HID_Digital_IO_Ack_Status;
+
+ typedef enum {
+	 REPORT_CLASS_URGENT = 0x00,	// trigger and bus events
+	 REPORT_CLASS_ACK = 0x01,		// command results
+	 REPORT_CLASS_BULK = 0x02,		// state reports and streamed data
+	 REPORT_CLASS_NUM = 0x03
+ } HID_Digital_IO_Report_Class;
+
  typedef enum {
 	 PORT_UNUSED = 0xff,
 	 PORT_0 = 0x00,
@@ -152,22 +319,136 @@
 	 uint8_t  				var_val;
  } DIGITAL_LOGICAL_Element_TypeDef;
 
+ // Trigger actions: precompiled register writes and flags executed when the trigger fires
+ typedef struct _HID_DIGITAL_IO_TRIGGER_Action
+ {
+	uint32_t							out_mask;
+	uint32_t							out_value;
+	HID_Digital_IO_Trigger_Out			trigger_out;
+	uint8_t								switch_ports;
+	uint8_t								capture;
+	uint8_t								event_report;
+	uint8_t								arm;
+	// Compiled from the fields above (rebuilt after a remap)
+	uint32_t							bsrr[3];	// one word per GPIO_DIGITAL_BANK_NUM bank
+	uint32_t							trigger_out_bsrr;
+ } HID_DIGITAL_IO_TRIGGER_Action;
+
  typedef struct _HID_DIGITAL_IO_TRIGGER_Event
  {
 	uint8_t 							enable;
+	uint8_t								armed;
 	uint8_t								num_of_ANDs;
 	DIGITAL_LOGICAL_Element_TypeDef		element[LOGICAL_MAX_ELEMENT_NUM];
+	uint32_t							mask;
+	uint32_t							value;
+	uint32_t							edge_mask;
+	HID_DIGITAL_IO_TRIGGER_Action		action;
  } HID_DIGITAL_IO_TRIGGER_Event;
 
 
- extern HID_DIGITAL_IO_TypeDef digital_io;
- extern HID_DIGITAL_IO_TypeDef digital_io_new_state;
- extern HID_Digital_IO_Trigger digital_io_trigger;
- extern Digital_IO_Change_Flag digital_io_change_flag;
- extern Digital_IO_Report_Flag digital_io_report_flag;
- extern Digital_IO_Change_Flag digital_io_change_enable;
- extern HID_DIGITAL_IO_TRIGGER_Event digital_io_trig_events[DIGITAL_IO_MAX_TRIG_NUM];
- extern HID_Digital_IO_Trigger digital_io_do_trigger;
+ typedef struct _DIGITAL_IO_REPORT_Queue
+ {
+	 uint8_t						report[DIGITAL_IO_EVENT_QUEUE_SIZE][DIGITAL_IO_REPORT_SIZE];
+	 volatile uint8_t				head;
+	 volatile uint8_t				tail;
+	 uint8_t						age;		// reports of higher classes sent while this one waited
+	 volatile uint32_t				lost;
+ } DIGITAL_IO_REPORT_Queue;
+
+ typedef struct _DIGITAL_IO_ACK_Info
+ {
+	 volatile uint8_t				pending;	// the applied ack is sent after the port switch
+	 uint8_t						sequence;
+	 uint32_t						receive_tick;
+	 uint32_t						apply_tick;
+ } DIGITAL_IO_ACK_TypeDef;
+
+ typedef struct _DIGITAL_IO_UPLOAD_Info
+ {
+	 HID_Digital_IO_Upload_Target	target;
+	 uint32_t						offset;
+	 volatile uint32_t				received;
+	 volatile uint16_t				pending;	// bytes of the data stage in progress (upload only)
+ } DIGITAL_IO_UPLOAD_TypeDef;
+
+ typedef struct _DIGITAL_IO_HAL_Ops
+ {
+	 void		(* Setup)		(void* user, uint8_t port, uint32_t mode, uint32_t pull);
+	 uint32_t	(* Read)		(void* user);		// packed logical sample
+	 void		(* Write)		(void* user, uint32_t mask, uint32_t value);
+	 void		(* Write_Bank)	(void* user, uint8_t bank, uint32_t bsrr);
+	 void		(* Compile)		(void* user, uint32_t mask, uint32_t value, uint32_t* bsrr);	// BSRR words of the banks
+	 void		(* Remap)		(void* user, const uint8_t* remap);		// rebuild the pin tables (checked permutation)
+	 void		(* Trigger_Out)	(void* user, uint32_t bsrr);			// BSRR write of TRIGGER_OUT
+	 uint32_t	(* Timestamp)	(void* user);		// device timebase (CPU cycles)
+ } DIGITAL_IO_HAL_Ops;
+
+ typedef struct _DIGITAL_IO_CONTEXT_Info
+ {
+	 // Pin settings: active and pending (applied by the next trigger)
+	 HID_DIGITAL_IO_TypeDef			state;
+	 HID_DIGITAL_IO_TypeDef			new_state;
+	 ORDERED_ARRAY					switch_buffer;
+	 HID_DIGITAL_IO_TRIGGER_Event	trig_events[DIGITAL_IO_MAX_TRIG_NUM];
+	 // Flags between the USB interrupt, the SysTick and the main loop
+	 HID_Digital_IO_Trigger			trigger;
+	 HID_Digital_IO_Trigger			do_trigger;
+	 Digital_IO_Change_Flag			change_enable;
+	 Digital_IO_Change_Flag			change_flag;
+	 Digital_IO_Report_Flag			report_flag;
+	 Digital_IO_Change_Flag			remap_flag;
+	 DIGITAL_IO_ACK_TypeDef			switch_ack;
+	 uint8_t						change_report[LENGTH_DIGITAL_IO];	// LENGTH_DIGITAL_IO payload for the main loop
+	 // Last sample
+	 uint32_t						sample;
+	 uint32_t						edge;
+	 uint32_t						edge_report;
+	 uint8_t						oversampling;
+	 // Logical bit -> physical bit tables: active and staged by COMMAND_PIN_REMAP or the upload
+	 uint8_t						remap[DIGITAL_IO_MAX_BIT_NUM];
+	 uint8_t						remap_new[DIGITAL_IO_MAX_BIT_NUM];
+	 // IN reports: one queue per class, the report in transfer
+	 DIGITAL_IO_REPORT_Queue		report_queue[REPORT_CLASS_NUM];
+	 uint8_t						report_tx[DIGITAL_IO_REPORT_SIZE];
+	 // Feature report transfers
+	 DIGITAL_IO_UPLOAD_TypeDef		upload;
+	 DIGITAL_IO_UPLOAD_TypeDef		download;
+	 // Pins and clock of the simulation (unused by the target build)
+	 const DIGITAL_IO_HAL_Ops*		hal;
+	 void*							hal_user;
+ } DIGITAL_IO_CONTEXT_TypeDef;
+
+
+#ifdef DIGITAL_IO_SIMULATION
+ extern DIGITAL_IO_THREAD_LOCAL DIGITAL_IO_CONTEXT_TypeDef* digital_io_current;
+#else
+ extern DIGITAL_IO_CONTEXT_TypeDef digital_io_context;
+#endif
+
+ // Core state of the selected context
+#define DIGITAL_IO_CTX_STATE			(DIGITAL_IO_CTX->state)
+#define DIGITAL_IO_CTX_NEW_STATE		(DIGITAL_IO_CTX->new_state)
+#define DIGITAL_IO_CTX_SWITCH_BUFFER	(DIGITAL_IO_CTX->switch_buffer)
+#define DIGITAL_IO_CTX_TRIG_EVENTS		(DIGITAL_IO_CTX->trig_events)
+#define DIGITAL_IO_CTX_TRIGGER			(DIGITAL_IO_CTX->trigger)
+#define DIGITAL_IO_CTX_DO_TRIGGER		(DIGITAL_IO_CTX->do_trigger)
+#define DIGITAL_IO_CTX_CHANGE_ENABLE	(DIGITAL_IO_CTX->change_enable)
+#define DIGITAL_IO_CTX_CHANGE_FLAG		(DIGITAL_IO_CTX->change_flag)
+#define DIGITAL_IO_CTX_REPORT_FLAG		(DIGITAL_IO_CTX->report_flag)
+#define DIGITAL_IO_CTX_REMAP_FLAG		(DIGITAL_IO_CTX->remap_flag)
+#define DIGITAL_IO_CTX_SWITCH_ACK		(DIGITAL_IO_CTX->switch_ack)
+#define DIGITAL_IO_CTX_CHANGE_REPORT	(DIGITAL_IO_CTX->change_report)
+#define DIGITAL_IO_CTX_SAMPLE			(DIGITAL_IO_CTX->sample)
+#define DIGITAL_IO_CTX_EDGE				(DIGITAL_IO_CTX->edge)
+#define DIGITAL_IO_CTX_EDGE_REPORT		(DIGITAL_IO_CTX->edge_report)
+#define DIGITAL_IO_CTX_OVERSAMPLING		(DIGITAL_IO_CTX->oversampling)
+#define DIGITAL_IO_CTX_REMAP			(DIGITAL_IO_CTX->remap)
+#define DIGITAL_IO_CTX_REMAP_NEW		(DIGITAL_IO_CTX->remap_new)
+#define DIGITAL_IO_CTX_REPORT_QUEUE		(DIGITAL_IO_CTX->report_queue)
+#define DIGITAL_IO_CTX_REPORT_TX		(DIGITAL_IO_CTX->report_tx)
+#define DIGITAL_IO_CTX_UPLOAD			(DIGITAL_IO_CTX->upload)
+#define DIGITAL_IO_CTX_DOWNLOAD			(DIGITAL_IO_CTX->download)
 
  /**
    * @brief  USBH_HID_Digital_IO_Init
@@ -177,6 +458,26 @@
    */
  void USBD_HID_Digital_IO_Init(HID_DIGITAL_IO_TypeDef* digital_io_instance);
 
+ /**
+   * @brief  USBD_HID_Digital_IO_Context_Init
+   *         Reset a core context to the power-on state.
+   * @param  ctx: context
+   * @param  hal: pins and clock of the simulation (NULL on the target)
+   * @param  hal_user: argument of the ops
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Context_Init(DIGITAL_IO_CONTEXT_TypeDef* ctx, const DIGITAL_IO_HAL_Ops* hal, void* hal_user);
+
+#ifdef DIGITAL_IO_SIMULATION
+ /**
+   * @brief  USBD_HID_Digital_IO_Context_Select
+   *         Select the context the calling thread works on.
+   * @param  ctx: context
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Context_Select(DIGITAL_IO_CONTEXT_TypeDef* ctx);
+#endif
+
  /**
    * @brief  USBH_HID_Digital_IO_Init
    *         The function init the HID digital IO.
@@ -199,6 +500,14 @@
    */
  void USBD_HID_Digital_IO_Set_Changes(uint8_t* output_buff);
 
+ /**
+   * @brief  USBD_HID_Digital_IO_Store_Changes
+   *         Keep the payload of a LENGTH_DIGITAL_IO report for the main loop (USB interrupt).
+   * @param  output_buff: report payload
+   * @retval ACK_ACCEPTED, ACK_DROPPED while the previous changes are not stored yet
+   */
+ HID_Digital_IO_Ack_Status USBD_HID_Digital_IO_Store_Changes(const uint8_t* output_buff);
+
  /**
    * @brief  USBH_HID_Digital_IO_Init
    *         The function init the HID digital IO.
@@ -249,8 +558,184 @@
    */
  HID_Digital_IO_Trigger USBD_HID_Digital_IO_Check_Trigger_Event(HID_DIGITAL_IO_TRIGGER_Event* t, uint8_t id);
 
+ /**
+   * @brief  USBD_HID_Digital_IO_Reset_Trigger_Action
+   *         Set the default action of a trigger (TRIGGER_OUT pulse).
+   * @param  trig_event: trigger event
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Reset_Trigger_Action(HID_DIGITAL_IO_TRIGGER_Event* trig_event);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Process_Trigger_Action
+   *         Store and compile the action list of a trigger.
+   * @param  output_buff: command payload
+   * @param  t: trigger events
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Process_Trigger_Action(uint8_t* output_buff, HID_DIGITAL_IO_TRIGGER_Event* t);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Compile_Trigger_Action
+   *         Convert the action of a trigger to register writes with the active remap.
+   * @param  action: trigger action
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Compile_Trigger_Action(HID_DIGITAL_IO_TRIGGER_Action* action);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Run_Trigger_Action
+   *         Execute the action of a fired trigger and disarm it.
+   * @param  t: trigger events
+   * @param  id: fired trigger
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Run_Trigger_Action(HID_DIGITAL_IO_TRIGGER_Event* t, uint8_t id);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Queue_Report
+   *         Store an input report in the queue of its class.
+   * @param  report_class: HID_Digital_IO_Report_Class
+   * @param  report: DIGITAL_IO_REPORT_SIZE bytes
+   * @retval 1 if stored, 0 if the queue is full
+   */
+ uint8_t USBD_HID_Digital_IO_Queue_Report(HID_Digital_IO_Report_Class report_class, const uint8_t* report);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Report_Count
+   *         Number of queued reports of a class.
+   * @param  report_class: HID_Digital_IO_Report_Class
+   * @retval Queued reports
+   */
+ uint8_t USBD_HID_Digital_IO_Report_Count(HID_Digital_IO_Report_Class report_class);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Next_Report
+   *         Take the next report to send: highest class first, aged lower classes before it.
+   * @param  length: set to the report length
+   * @retval Report (valid until the IN transfer completes), NULL if all queues are empty
+   */
+ uint8_t* USBD_HID_Digital_IO_Next_Report(uint16_t* length);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Ack
+   *         Queue the acknowledgement of an output report.
+   * @param  command: length or command code of the output report
+   * @param  sequence: sequence number of the host
+   * @param  status: HID_Digital_IO_Ack_Status
+   * @param  receive_tick: timestamp of the reception
+   * @param  apply_tick: timestamp of the register writes (ACK_APPLIED)
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Ack(uint8_t command, uint8_t sequence, HID_Digital_IO_Ack_Status status, uint32_t receive_tick, uint32_t apply_tick);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Ack_Room
+   *         Room for the acks of the next output report (USB interrupt or interrupts masked).
+   * @retval 1 = the OUT endpoint may accept the next report, 0 = keep it NAKing
+   */
+ uint8_t USBD_HID_Digital_IO_Ack_Room(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Process_Command
+   *         Dispatch a command report (first byte >= COMMAND_FIRST).
+   * @param  command: command code
+   * @param  output_buff: command payload (DIGITAL_IO_COMMAND_PAYLOAD_SIZE bytes)
+   * @retval ACK_ACCEPTED, ACK_UNKNOWN for an unknown command code
+   */
+ HID_Digital_IO_Ack_Status USBD_HID_Digital_IO_Process_Command(uint8_t command, uint8_t* output_buff);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Process_Remap
+   *         Store a part of the logical -> physical pin remap table.
+   * @param  output_buff: command payload
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Process_Remap(uint8_t* output_buff);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Apply_Remap
+   *         Activate the uploaded remap table, all ports fall back to default inputs.
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Apply_Remap(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Check_Remap
+   *         Check that a remap table is a permutation of the physical pins.
+   * @param  remap: logical bit -> physical bit table (DIGITAL_IO_MAX_BIT_NUM entries)
+   * @retval 1 if every physical pin is used exactly once, 0 otherwise
+   */
+ uint8_t USBD_HID_Digital_IO_Check_Remap(const uint8_t* remap);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Process_Upload
+   *         Select the target and the start offset of the next feature report uploads.
+   * @param  output_buff: command payload
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Process_Upload(uint8_t* output_buff);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Upload_Buffer
+   *         Destination of a feature report upload in the target (USB interrupt, SET_REPORT setup stage).
+   * @param  length: wLength of the control transfer (up to DIGITAL_IO_UPLOAD_REPORT_SIZE)
+   * @retval Position in the target, NULL if the target is busy or the data does not fit (request is stalled)
+   */
+ uint8_t* USBD_HID_Digital_IO_Upload_Buffer(uint16_t length);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Upload_Complete
+   *         Advance the upload offset after a received feature report (data stage done).
+   * @param  length: received bytes
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Upload_Complete(uint16_t length);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Upload_Pending
+   *         A feature report is being received into the target.
+   * @param  target: upload target
+   * @retval 1 during the data stage of an upload into the target, 0 otherwise
+   */
+ uint8_t USBD_HID_Digital_IO_Upload_Pending(HID_Digital_IO_Upload_Target target);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Process_Download
+   *         Select the source and the start offset of the next feature report reads.
+   * @param  output_buff: command payload
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Process_Download(uint8_t* output_buff);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Download_Buffer
+   *         Source of a feature report read (USB interrupt, GET_REPORT setup stage).
+   * @param  length: wLength of the control transfer, reduced to the remaining bytes
+   * @retval Pointer into the selected source, NULL if nothing is left (request is stalled)
+   */
+ uint8_t* USBD_HID_Digital_IO_Download_Buffer(uint16_t* length);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Majority
+   *         Bitwise majority vote of packed samples.
+   * @param  samples: packed samples
+   * @param  num: number of samples (1 - DIGITAL_IO_MAX_OVERSAMPLING)
+   * @retval Packed sample, a bit is 1 when it is 1 in more than half of the samples
+   */
+ uint32_t USBD_HID_Digital_IO_Majority(const uint32_t* samples, uint8_t num);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Timebase_Init
+   *         Start the cycle counter used for the device timestamps.
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Timebase_Init(void);
+
  uint8_t create_mask(uint8_t num);
  uint8_t read_from_byte(uint8_t buffer, INTERVAL_Size size, SHIFT_Num shift);
+ uint32_t read_uint32(const uint8_t* buffer);
+ void write_uint32(uint8_t* buffer, uint32_t value);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_bus.h
+  * @brief   Header file for the usbd_digital_io_bus.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "usbd_digital_io.h"
+#include "gpio.h"
+
+
+/* Defines -------------------------------------*/
+#ifndef __USBD_DIGITAL_IO_BUS_H
+#define __USBD_DIGITAL_IO_BUS_H
+
+#define DIGITAL_IO_BUS_MAX_CYCLES		(0x800U)	// cycles of one batch
+#define DIGITAL_IO_BUS_CYCLE_SIZE		(0x04U)		// bytes: flags, address (little endian), data
+#define DIGITAL_IO_BUS_BUFFER_SIZE		(DIGITAL_IO_BUS_MAX_CYCLES * DIGITAL_IO_BUS_CYCLE_SIZE)
+#define DIGITAL_IO_BUS_DATA_BITS		(0x08U)
+#define DIGITAL_IO_BUS_ADDRESS_BITS		(0x10U)
+#define DIGITAL_IO_BUS_TIME_UNIT		(0x09U)		// CPU cycles per timing unit (125 ns)
+
+#define DIGITAL_IO_BUS_CYCLE_READ		(0x01U)		// flags: read cycle, data is replaced by the latched byte
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ typedef enum {
+	 BUS_IDLE,
+	 BUS_RUN
+ } Digital_IO_Bus_State;
+
+ typedef struct _DIGITAL_IO_BUS_Info
+ {
+	 volatile Digital_IO_Bus_State	state;
+	 uint32_t						address_mask;
+	 uint32_t						data_mask;
+	 uint8_t						write_strobe;
+	 uint8_t						read_strobe;
+	 uint8_t						strobe_level;
+	 uint32_t						setup;
+	 uint32_t						pulse;
+	 uint32_t						hold;
+	 uint16_t						cycles;
+	 uint32_t						address_scatter[2][GPIO_DIGITAL_LANE_SIZE];
+	 uint32_t						data_scatter[GPIO_DIGITAL_LANE_SIZE];
+	 uint8_t						data_gather[GPIO_DIGITAL_BIT_LANE_NUM][GPIO_DIGITAL_LANE_SIZE];
+ } DIGITAL_IO_BUS_TypeDef;
+
+ extern DIGITAL_IO_BUS_TypeDef digital_io_bus;
+ extern uint8_t digital_io_bus_buffer[DIGITAL_IO_BUS_BUFFER_SIZE];
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Bus_Process_Command
+   *         Store the pin roles and timing of the bus, or request a batch run.
+   * @param  command: COMMAND_BUS_CONFIG or COMMAND_BUS_RUN
+   * @param  output_buff: command payload
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Bus_Process_Command(uint8_t command, uint8_t* output_buff);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Bus_Run
+   *         Execute the uploaded batch of bus cycles and queue the result report (main loop).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Bus_Run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_DIGITAL_IO_BUS_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
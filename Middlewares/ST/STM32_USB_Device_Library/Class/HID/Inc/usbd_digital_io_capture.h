@@ -0,0 +1,191 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_capture.h
+  * @brief   Header file for the usbd_digital_io_capture.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "usbd_digital_io.h"
+
+
+/* Defines -------------------------------------*/
+#ifndef __USBD_DIGITAL_IO_CAPTURE_H
+#define __USBD_DIGITAL_IO_CAPTURE_H
+
+#define DIGITAL_IO_CAPTURE_BUFFER_SIZE		(0x2000U)	// records of all rate groups (32 KB)
+#define DIGITAL_IO_CAPTURE_BLOCK_SIZE		(0x20U)		// logical samples per DMA half transfer
+#define DIGITAL_IO_CAPTURE_RAW_SIZE			(2U * DIGITAL_IO_MAX_OVERSAMPLING * DIGITAL_IO_CAPTURE_BLOCK_SIZE)
+#define DIGITAL_IO_CAPTURE_MIN_PERIOD		(0x90U)		// CPU cycles per logical sample (500 kHz)
+#define DIGITAL_IO_CAPTURE_MIN_DMA_PERIOD	(0x24U)		// CPU cycles between two DMA snapshots
+#define DIGITAL_IO_CAPTURE_DEFAULT_PERIOD	(0x2D0U)	// 100 kHz
+#define DIGITAL_IO_CAPTURE_MIN_GROUP_SIZE	(0x10U)
+
+#if (DIGITAL_MAX_PORT_NUM * DIGITAL_IO_CAPTURE_MIN_GROUP_SIZE) > DIGITAL_IO_CAPTURE_BUFFER_SIZE
+#error "The record buffer cannot hold the minimum size of every rate group"
+#endif
+
+#define DIGITAL_IO_CAPTURE_RECORD_BITS		(0x20U)		// packed nibbles in one capture report
+#define DIGITAL_IO_CAPTURE_MAX_RUN			(0xFFFFU)	// records of one run length report
+#define DIGITAL_IO_CAPTURE_CLOCK_TRIGGER	(TIM_TS_ITR2)	// TIM1 internal trigger connected to the TIM3 TRGO
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ typedef enum {
+	 CAPTURE_IDLE,
+	 CAPTURE_RUNNING
+ } Digital_IO_Capture_State;
+
+ typedef enum {
+	 CAPTURE_NO_REQUEST,
+	 CAPTURE_START,
+	 CAPTURE_STOP
+ } Digital_IO_Capture_Request;
+
+ typedef struct _DIGITAL_IO_CAPTURE_Group
+ {
+	 uint8_t				decimation;
+	 uint8_t				countdown;
+	 uint8_t				port_num;
+	 uint8_t				ports[DIGITAL_MAX_PORT_NUM];
+	 uint32_t				mask;
+	 uint32_t*				buffer;
+	 uint16_t				size;
+	 uint16_t				write_idx;
+	 volatile uint32_t		write_count;
+	 uint32_t				read_count;
+ } DIGITAL_IO_CAPTURE_Group;
+
+ typedef struct _DIGITAL_IO_CAPTURE_Info
+ {
+	 Digital_IO_Capture_State		state;
+	 Digital_IO_Capture_Request		request;
+	 uint8_t						stream;
+	 uint8_t						planar;
+	 uint8_t						runs;
+	 uint8_t						external;
+	 uint8_t						falling;
+	 uint8_t						oversampling;
+	 uint32_t						period_new;
+	 uint8_t						decimation_new[DIGITAL_MAX_PORT_NUM];
+	 uint32_t						period;
+	 uint32_t						start_tick;
+	 volatile uint32_t				sample_count;
+	 volatile uint32_t				edges;
+	 uint32_t						last_snapshot;
+	 uint32_t						clock_smcr;
+	 uint32_t						clock_cr2;
+	 uint32_t						clock_dier;
+	 uint8_t						group_num;
+	 uint8_t						stream_group;
+	 DIGITAL_IO_CAPTURE_Group		group[DIGITAL_MAX_PORT_NUM];
+ } DIGITAL_IO_CAPTURE_TypeDef;
+
+ extern DIGITAL_IO_CAPTURE_TypeDef digital_io_capture;
+ extern uint32_t digital_io_capture_buffer[DIGITAL_IO_CAPTURE_BUFFER_SIZE];
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Capture_Init
+   *         Set the default capture settings (all ports, full rate).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Capture_Init(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Capture_Process_Command
+   *         Store capture settings and start/stop requests from the host.
+   * @param  command: COMMAND_CAPTURE_CONFIG or COMMAND_CAPTURE_CONTROL
+   * @param  output_buff: command payload
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Capture_Process_Command(uint8_t command, uint8_t* output_buff);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Capture_Handle
+   *         Execute the pending start/stop request (main loop).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Capture_Handle(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Capture_Start
+   *         Build the rate groups and start the timer triggered DMA snapshots.
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Capture_Start(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Capture_Stop
+   *         Stop the snapshots and process the samples of the unfinished block.
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Capture_Stop(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Capture_Process_Block
+   *         Convert raw DMA snapshots to logical samples and store them.
+   * @param  offset: first raw snapshot
+   * @param  num: number of logical samples
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Capture_Process_Block(uint16_t offset, uint16_t num);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Capture_Store
+   *         Decimate one logical sample into the records of the rate groups.
+   * @param  sample: packed logical sample
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Capture_Store(uint32_t sample);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Capture_Stream_Report
+   *         Create the next capture record report (rate groups in turn).
+   * @param  report: report buffer (DIGITAL_IO_REPORT_SIZE bytes)
+   * @retval 1 if a report was created, 0 if there are no new records
+   */
+ uint8_t USBD_HID_Digital_IO_Capture_Stream_Report(uint8_t* report);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Capture_Run_Report
+   *         Create a run length report of a rate group: value and duration of the next finished run.
+   * @param  group: rate group with new records
+   * @param  available: number of new records
+   * @param  lost: records overwritten before the first new record
+   * @param  report: report buffer (DIGITAL_IO_REPORT_SIZE bytes)
+   * @retval 1 if a report was created, 0 if the current run is not finished yet
+   */
+ uint8_t USBD_HID_Digital_IO_Capture_Run_Report(DIGITAL_IO_CAPTURE_Group* group, uint32_t available, uint32_t lost, uint8_t* report);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Capture_Take_Edges
+   *         Read and clear the edges seen between the DMA snapshots.
+   * @retval Logical bits which changed in any snapshot since the previous call
+   */
+ uint32_t USBD_HID_Digital_IO_Capture_Take_Edges(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_DIGITAL_IO_CAPTURE_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,130 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_decoder.h
+  * @brief   Header file for the usbd_digital_io_decoder.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "usbd_digital_io.h"
+
+
+/* Defines -------------------------------------*/
+#ifndef __USBD_DIGITAL_IO_DECODER_H
+#define __USBD_DIGITAL_IO_DECODER_H
+
+#define DIGITAL_IO_DECODER_NUM				(0x04U)
+#define DIGITAL_IO_DECODER_MAX_BIT_NUM		(0x08U)		// Gray code width
+#define DIGITAL_IO_DECODER_REPORT_PERIOD	(0x0AU)		// ms between two reports of a decoder
+#define DIGITAL_IO_DECODER_HARDWARE			(0x80U)		// report: position counted by the TIM4 encoder mode
+#define DIGITAL_IO_DECODER_NO_TIMER			(0xFFU)
+// TIM4 encoder inputs: TI1 = PB6, TI2 = PB7 (AF2)
+#define DIGITAL_IO_DECODER_TIMER_PORT		(GPIOB)
+#define DIGITAL_IO_DECODER_TIMER_TI1		(GPIO_PIN_6)
+#define DIGITAL_IO_DECODER_TIMER_TI2		(GPIO_PIN_7)
+#define DIGITAL_IO_DECODER_TIMER_AF			(GPIO_AF2_TIM4)
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ typedef enum {
+	 DECODER_OFF = 0x00,
+	 DECODER_QUADRATURE = 0x01,
+	 DECODER_GRAY = 0x02
+ } Digital_IO_Decoder_Type;
+
+ typedef struct _DIGITAL_IO_DECODER_Channel
+ {
+	 // Settings of the host (logical bits, least significant first; quadrature: A, B)
+	 Digital_IO_Decoder_Type		type;
+	 uint8_t						bit_num;
+	 uint8_t						bits[DIGITAL_IO_DECODER_MAX_BIT_NUM];
+	 // Decoding state
+	 uint32_t						mask;
+	 uint8_t						code;
+	 volatile int32_t				position;
+	 volatile uint32_t				errors;
+	 // Reporting state
+	 int32_t						report_position;
+	 uint32_t						report_errors;
+	 int32_t						velocity;
+	 uint32_t						report_tick;
+ } DIGITAL_IO_DECODER_Channel;
+
+ typedef struct _DIGITAL_IO_DECODER_Info
+ {
+	 volatile uint8_t				request;
+	 DIGITAL_IO_DECODER_Channel		channel_new[DIGITAL_IO_DECODER_NUM];
+	 DIGITAL_IO_DECODER_Channel		channel[DIGITAL_IO_DECODER_NUM];
+	 uint32_t						mask;
+	 uint32_t						last_sample;
+	 uint8_t						timer_channel;
+	 int8_t							timer_sign;
+	 uint16_t						timer_count;
+	 uint8_t						next;
+ } DIGITAL_IO_DECODER_TypeDef;
+
+ extern DIGITAL_IO_DECODER_TypeDef digital_io_decoder;
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Decoder_Init
+   *         Switch all decoders off.
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Decoder_Init(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Decoder_Process_Command
+   *         Store the settings of one decoder.
+   * @param  output_buff: command payload
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Decoder_Process_Command(uint8_t* output_buff);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Decoder_Handle
+   *         Apply the new decoder settings and select the timer decoder (main loop).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Decoder_Handle(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Decoder_Sample
+   *         Decode the changes of one packed sample (capture DMA interrupt or main loop).
+   * @param  sample: packed logical sample
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Decoder_Sample(uint32_t sample);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Decoder_Report
+   *         Create the report of the next decoder with new counts.
+   * @param  report: report buffer (DIGITAL_IO_REPORT_SIZE bytes)
+   * @retval 1 if a report was created, 0 if no decoder is due
+   */
+ uint8_t USBD_HID_Digital_IO_Decoder_Report(uint8_t* report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_DIGITAL_IO_DECODER_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,127 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_fabric.h
+  * @brief   Header file for the usbd_digital_io_fabric.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "usbd_digital_io.h"
+
+
+/* Defines -------------------------------------*/
+#ifndef __USBD_DIGITAL_IO_FABRIC_H
+#define __USBD_DIGITAL_IO_FABRIC_H
+
+#define DIGITAL_IO_FABRIC_ORIGIN		(0x80U)		// report: this module asserted the bus
+#define DIGITAL_IO_FABRIC_FORWARDED		(0x40U)		// report: the edge was forwarded to TRIGGER_OUT
+#define DIGITAL_IO_FABRIC_NO_ORIGIN		(0xFFU)
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ typedef enum {
+	 FABRIC_OFF = 0x00,
+	 FABRIC_WIRED_OR = 0x01,		// all TRIGGER_OUT (open drain) and TRIGGER_IN on one line, active low
+	 FABRIC_CHAIN = 0x02			// TRIGGER_OUT to the TRIGGER_IN of the next module, active high
+ } Digital_IO_Fabric_Mode;
+
+ typedef struct _DIGITAL_IO_FABRIC_Info
+ {
+	 // Settings of the host, applied in the main loop
+	 Digital_IO_Fabric_Mode			mode_new;
+	 uint8_t						capture_new;
+	 uint32_t						out_mask_new;
+	 uint32_t						out_value_new;
+	 uint8_t						arm_new;
+	 volatile uint8_t				request;
+	 // Active settings
+	 Digital_IO_Fabric_Mode			mode;
+	 uint8_t						capture;
+	 uint32_t						bsrr[3];	// one word per GPIO_DIGITAL_BANK_NUM bank
+	 uint8_t						arm;
+	 uint32_t						assert_bsrr;	// TRIGGER_OUT write which asserts the bus
+	 uint32_t						release_bsrr;	// TRIGGER_OUT write which releases the bus
+	 // Own assert before the bus edge
+	 volatile uint8_t				origin_id;
+	 volatile uint32_t				origin_tick;
+	 // Last bus edge, reported by the main loop
+	 volatile uint8_t				pending;
+	 uint8_t						code;
+	 uint32_t						edge_tick;
+	 uint32_t						local_tick;
+	 volatile uint32_t				lost;
+ } DIGITAL_IO_FABRIC_TypeDef;
+
+ extern DIGITAL_IO_FABRIC_TypeDef digital_io_fabric;
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Fabric_Init
+   *         Switch the trigger bus off (TRIGGER_OUT is a plain output).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Fabric_Init(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Fabric_Process_Command
+   *         Store the mode of the trigger bus and the reaction to its edges.
+   * @param  output_buff: command payload
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Fabric_Process_Command(uint8_t* output_buff);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Fabric_Handle
+   *         Configure TRIGGER_IN/TRIGGER_OUT for the new mode (main loop).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Fabric_Handle(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Fabric_Origin
+   *         Note the own assert of the bus right before a trigger action writes TRIGGER_OUT.
+   * @param  id: fired trigger
+   * @param  bsrr: TRIGGER_OUT write of the action
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Fabric_Origin(uint8_t id, uint32_t bsrr);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Fabric_IRQ
+   *         Timestamp and react to a bus edge on TRIGGER_IN (EXTI15_10 interrupt).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Fabric_IRQ(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Fabric_Report
+   *         Create the report of the last bus edge.
+   * @param  report: report buffer (DIGITAL_IO_REPORT_SIZE bytes)
+   * @retval 1 if a report was created, 0 if there was no edge
+   */
+ uint8_t USBD_HID_Digital_IO_Fabric_Report(uint8_t* report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_DIGITAL_IO_FABRIC_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
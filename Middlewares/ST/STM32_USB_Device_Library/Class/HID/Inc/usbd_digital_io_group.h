@@ -0,0 +1,125 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_group.h
+  * @brief   Header file for the usbd_digital_io_group.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "usbd_digital_io.h"
+#include "gpio.h"
+
+
+/* Defines -------------------------------------*/
+#ifndef __USBD_DIGITAL_IO_GROUP_H
+#define __USBD_DIGITAL_IO_GROUP_H
+
+#define DIGITAL_IO_GROUP_NUM			(0x04U)
+#define DIGITAL_IO_GROUP_MAX_WIDTH		(0x10U)		// bits of one group value
+#define DIGITAL_IO_GROUP_MAX_ENTRY		(0x08U)		// bits of one config command
+#define DIGITAL_IO_GROUP_NIBBLE_SIZE	(0x10U)
+#define DIGITAL_IO_GROUP_VALUE_LANES	(DIGITAL_IO_GROUP_MAX_WIDTH / 4U)	// nibbles of a group value
+#define DIGITAL_IO_GROUP_SAMPLE_LANES	(DIGITAL_IO_MAX_BIT_NUM / 4U)		// nibbles of a packed sample
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ typedef struct _DIGITAL_IO_GROUP_Info
+ {
+	 // Ordered logical bits of each group (value bit 0 first), staged by the commands
+	 uint8_t						bits_new[DIGITAL_IO_GROUP_NUM][DIGITAL_IO_GROUP_MAX_WIDTH];
+	 uint8_t						width_new[DIGITAL_IO_GROUP_NUM];
+	 volatile uint8_t				request;
+	 uint8_t						bits[DIGITAL_IO_GROUP_NUM][DIGITAL_IO_GROUP_MAX_WIDTH];
+	 volatile uint8_t				width[DIGITAL_IO_GROUP_NUM];
+	 // Value nibble -> BSRR word of each bank (set and reset bits of the four pins)
+	 uint32_t						scatter[DIGITAL_IO_GROUP_NUM][DIGITAL_IO_GROUP_VALUE_LANES][DIGITAL_IO_GROUP_NIBBLE_SIZE][GPIO_DIGITAL_BANK_NUM];
+	 // Sample nibble -> group value bits
+	 uint16_t						gather[DIGITAL_IO_GROUP_NUM][DIGITAL_IO_GROUP_SAMPLE_LANES][DIGITAL_IO_GROUP_NIBBLE_SIZE];
+	 uint8_t						report;
+	 uint16_t						value[DIGITAL_IO_GROUP_NUM];
+ } DIGITAL_IO_GROUP_TypeDef;
+
+ extern DIGITAL_IO_GROUP_TypeDef digital_io_group;
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Group_Process_Command
+   *         Stage the bits of a group or write a value to a group.
+   * @param  command: COMMAND_GROUP_CONFIG or COMMAND_GROUP_WRITE
+   * @param  output_buff: command payload
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Group_Process_Command(uint8_t command, uint8_t* output_buff);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Group_Handle
+   *         Activate the staged groups and build their tables (main loop).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Group_Handle(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Group_Remap
+   *         Rebuild the tables of the active groups after a new remap (main loop).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Group_Remap(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Group_Write
+   *         Write a value to the pins of a group with one BSRR access per bank.
+   * @param  group: group index
+   * @param  value: group value (bit 0 -> first pin of the group)
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Group_Write(uint8_t group, uint16_t value);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Group_Read
+   *         Extract the value of a group from a packed sample.
+   * @param  group: group index
+   * @param  sample: packed logical sample
+   * @retval Group value (bit 0 <- first pin of the group)
+   */
+ uint16_t USBD_HID_Digital_IO_Group_Read(uint8_t group, uint32_t sample);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Group_Latch
+   *         Take the group values of the sample of the state report.
+   * @param  sample: packed logical sample
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Group_Latch(uint32_t sample);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Group_Report
+   *         Create the report of the latched group values.
+   * @param  report: report buffer (DIGITAL_IO_REPORT_SIZE bytes)
+   * @retval 1 if a report was created, 0 if no values are latched
+   */
+ uint8_t USBD_HID_Digital_IO_Group_Report(uint8_t* report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_DIGITAL_IO_GROUP_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
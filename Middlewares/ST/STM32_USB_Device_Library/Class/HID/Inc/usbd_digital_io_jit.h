@@ -0,0 +1,111 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_jit.h
+  * @brief   Header file for the usbd_digital_io_jit.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "usbd_digital_io.h"
+
+
+/* Defines -------------------------------------*/
+#ifndef __USBD_DIGITAL_IO_JIT_H
+#define __USBD_DIGITAL_IO_JIT_H
+
+#define DIGITAL_IO_JIT_CODE_SIZE		(0x100U)	// halfwords of the RAM code buffer
+#define DIGITAL_IO_JIT_MAX_TRIGGER_SIZE	(0x16U)		// halfwords of one compiled trigger (worst case)
+#define DIGITAL_IO_JIT_BENCH_RUNS		(0x100U)	// evaluations of one benchmark pass
+// Benchmark modes
+#define DIGITAL_IO_JIT_BENCH_TRIGGER	(0x00U)		// compiled code against the interpreter
+#define DIGITAL_IO_JIT_BENCH_SAMPLE		(0x01U)		// oversampled read (snapshots + majority vote) against one read
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ // Compiled evaluator: bit n of the result = trigger n matches (armed state not included)
+ typedef uint32_t (*Digital_IO_Jit_Function)(uint32_t sample, uint32_t edge);
+
+ typedef struct _DIGITAL_IO_JIT_Info
+ {
+	 volatile uint8_t				request;
+	 volatile uint8_t				valid;
+	 volatile uint8_t				bench;
+	 uint8_t						bench_mode;
+	 uint16_t						size;
+	 Digital_IO_Jit_Function		function;
+ } DIGITAL_IO_JIT_TypeDef;
+
+ extern DIGITAL_IO_JIT_TypeDef digital_io_jit;
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Jit_Invalidate
+   *         Fall back to the interpreter until the triggers are compiled again.
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Jit_Invalidate(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Jit_Process_Command
+   *         Request a benchmark of the trigger evaluators or of the sample read.
+   * @param  output_buff: command payload
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Jit_Process_Command(uint8_t* output_buff);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Jit_Compile
+   *         Compile the enabled triggers to Thumb-2 code in the RAM buffer (main loop).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Jit_Compile(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Jit_Interpret
+   *         Evaluate the triggers from their mask/value pairs.
+   * @param  sample: packed logical sample
+   * @param  edge: logical bits changed since the previous sample
+   * @retval Bit n = trigger n matches
+   */
+ uint32_t USBD_HID_Digital_IO_Jit_Interpret(uint32_t sample, uint32_t edge);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Jit_Evaluate
+   *         Evaluate the triggers with the compiled code, or the interpreter if there is none.
+   * @param  sample: packed logical sample
+   * @param  edge: logical bits changed since the previous sample
+   * @retval Bit n = trigger n matches
+   */
+ uint32_t USBD_HID_Digital_IO_Jit_Evaluate(uint32_t sample, uint32_t edge);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Jit_Bench
+   *         Measure the requested benchmark and report the cycles (main loop).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Jit_Bench(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_DIGITAL_IO_JIT_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,86 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_latency.h
+  * @brief   Header file for the usbd_digital_io_latency.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "usbd_digital_io.h"
+
+
+/* Defines -------------------------------------*/
+#ifndef __USBD_DIGITAL_IO_LATENCY_H
+#define __USBD_DIGITAL_IO_LATENCY_H
+
+#define DIGITAL_IO_LATENCY_MAX_TIMEOUT	(0x2710U)	// us, interrupts are disabled while waiting (10 ms)
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ typedef enum {
+	 LATENCY_IDLE,
+	 LATENCY_START,
+	 LATENCY_RUNNING,
+	 LATENCY_STOP
+ } Digital_IO_Latency_State;
+
+ typedef struct _DIGITAL_IO_LATENCY_Info
+ {
+	 volatile Digital_IO_Latency_State	state;
+	 uint8_t						stimulus;
+	 uint8_t						stimulus_level;
+	 uint8_t						response;
+	 uint8_t						response_level;
+	 uint16_t						runs;
+	 uint16_t						timeout;
+	 uint16_t						rest;
+	 uint16_t						done;
+	 uint16_t						timeouts;
+	 uint32_t						last_end;
+	 uint32_t						min;
+	 uint32_t						max;
+	 uint64_t						sum;
+ } DIGITAL_IO_LATENCY_TypeDef;
+
+ extern DIGITAL_IO_LATENCY_TypeDef digital_io_latency;
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Latency_Process_Command
+   *         Store a latency test request.
+   * @param  output_buff: command payload
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Latency_Process_Command(uint8_t* output_buff);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Latency_Handle
+   *         Run the next measurement of the active test (main loop).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Latency_Handle(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_DIGITAL_IO_LATENCY_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,151 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_log.h
+  * @brief   Header file for the usbd_digital_io_log.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "usbd_digital_io.h"
+
+
+/* Defines -------------------------------------*/
+#ifndef __USBD_DIGITAL_IO_LOG_H
+#define __USBD_DIGITAL_IO_LOG_H
+
+// Log region: flash sectors 5-7 (the image is limited to sectors 0-4 by the linker script)
+#define DIGITAL_IO_LOG_BASE				(0x08020000U)
+#define DIGITAL_IO_LOG_SECTOR_SIZE		(0x20000U)
+#define DIGITAL_IO_LOG_SECTOR_NUM		(0x03U)
+#define DIGITAL_IO_LOG_FIRST_SECTOR		(FLASH_SECTOR_5)
+#define DIGITAL_IO_LOG_SIZE				(DIGITAL_IO_LOG_SECTOR_NUM * DIGITAL_IO_LOG_SECTOR_SIZE)
+#define DIGITAL_IO_LOG_SECTOR_ADDR(idx)	(DIGITAL_IO_LOG_BASE + (idx) * DIGITAL_IO_LOG_SECTOR_SIZE)
+
+#define DIGITAL_IO_LOG_STAGE_SIZE		(0x400U)	// RAM words waiting for programming
+#define DIGITAL_IO_LOG_PROGRAM_BURST	(0x08U)		// words programmed per main loop pass
+#define DIGITAL_IO_LOG_HEADER_SIZE		(0x03U)		// words: magic, sequence, time base
+
+/* Record words (never 0xFFFFFFFF, the erased state ends the records of a sector):
+ * [31:30] type, [29:24] time since the previous record (ms), [23:0] payload
+ * LOG_LEVEL	-> payload = packed sample (the level changed)
+ * LOG_EVENT	-> payload = trigger ID or marker (DIGITAL_IO_LOG_MARK_*)
+ * LOG_EDGE		-> payload = pins with edges but no level change (glitches)
+ * LOG_SPECIAL	-> DIGITAL_IO_LOG_TIME (next word = absolute time) or DIGITAL_IO_LOG_MAGIC (sector header)
+ */
+#define DIGITAL_IO_LOG_MAGIC			(0xDA7A1060U)
+#define DIGITAL_IO_LOG_TIME				(0xC0000000U)
+#define DIGITAL_IO_LOG_ERASED			(0xFFFFFFFFU)
+#define DIGITAL_IO_LOG_MAX_DELTA		(0x3FU)
+#define DIGITAL_IO_LOG_PAYLOAD			(0x00FFFFFFU)
+#define DIGITAL_IO_LOG_WORD(type, delta, payload)	(((uint32_t)(type) << 30) | ((uint32_t)(delta) << 24) | ((payload) & DIGITAL_IO_LOG_PAYLOAD))
+
+#define DIGITAL_IO_LOG_REQUEST_START	(0x01U)
+#define DIGITAL_IO_LOG_REQUEST_STOP		(0x02U)
+#define DIGITAL_IO_LOG_REQUEST_CLEAR	(0x04U)
+#define DIGITAL_IO_LOG_REQUEST_STATUS	(0x08U)
+
+#define DIGITAL_IO_LOG_MARK_START		(0xFFFFU)
+#define DIGITAL_IO_LOG_MARK_STOP		(0xFFFEU)
+#define DIGITAL_IO_LOG_MARK_LOST		(0xFFFDU)
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ typedef enum {
+	 LOG_LEVEL = 0x00,
+	 LOG_EVENT = 0x01,
+	 LOG_EDGE = 0x02,
+	 LOG_SPECIAL = 0x03
+ } Digital_IO_Log_Record;
+
+ typedef struct _DIGITAL_IO_LOG_Info
+ {
+	 uint8_t						recording;
+	 volatile uint8_t				request;
+	 uint8_t						sector;
+	 uint8_t						erase_pending;
+	 uint32_t						sequence;
+	 uint32_t						write_addr;
+	 uint32_t						last_tick;
+	 uint32_t						last_sample;
+	 uint32_t						flash_tick;
+	 uint8_t						flash_time;
+	 uint32_t						lost;
+	 uint8_t						lost_mark;
+	 uint16_t						stage_head;
+	 uint16_t						stage_tail;
+ } DIGITAL_IO_LOG_TypeDef;
+
+ extern DIGITAL_IO_LOG_TypeDef digital_io_log;
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Log_Init
+   *         Find the end of the log after reset and resume an interrupted recording.
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Log_Init(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Log_Process_Command
+   *         Start, stop or clear the recorder, request a status report.
+   * @param  output_buff: command payload
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Log_Process_Command(uint8_t* output_buff);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Log_Sample
+   *         Record the level changes and glitches of a new sample.
+   * @param  sample: packed sample
+   * @param  edge: pins with edges since the previous sample
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Log_Sample(uint32_t sample, uint32_t edge);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Log_Event
+   *         Record a trigger event or a marker.
+   * @param  id: trigger ID or DIGITAL_IO_LOG_MARK_*
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Log_Event(uint16_t id);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Log_Handle
+   *         Program staged records, switch and erase sectors (main loop).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Log_Handle(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Log_Status_Report
+   *         Create a log status report.
+   * @param  report: report buffer (DIGITAL_IO_REPORT_SIZE bytes)
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Log_Status_Report(uint8_t* report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_DIGITAL_IO_LOG_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
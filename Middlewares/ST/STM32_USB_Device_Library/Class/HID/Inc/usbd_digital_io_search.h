@@ -0,0 +1,130 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_search.h
+  * @brief   Header file for the usbd_digital_io_search.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "usbd_digital_io.h"
+#include "usbd_digital_io_capture.h"
+
+
+/* Defines -------------------------------------*/
+#ifndef __USBD_DIGITAL_IO_SEARCH_H
+#define __USBD_DIGITAL_IO_SEARCH_H
+
+#define DIGITAL_IO_SEARCH_MAX_STEP		(0x04U)		// records of one sequence pattern
+#define DIGITAL_IO_SEARCH_MAX_WINDOW	(0x0FU)		// records sent before and after a match
+#define DIGITAL_IO_SEARCH_CHUNK			(0x400U)	// records scanned in one main loop pass
+// Flags of the final report
+#define DIGITAL_IO_SEARCH_LIMIT			(0x01U)		// stopped at the maximum number of matches
+#define DIGITAL_IO_SEARCH_BUSY			(0x02U)		// the capture runs: not searched or stopped
+#define DIGITAL_IO_SEARCH_INVALID		(0x04U)		// no such rate group
+#define DIGITAL_IO_SEARCH_CANCELLED		(0x08U)
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ typedef enum {
+	 SEARCH_IDLE,
+	 SEARCH_RUN,
+	 SEARCH_MATCH,
+	 SEARCH_DONE
+ } Digital_IO_Search_State;
+
+ typedef enum {
+	 SEARCH_NO_REQUEST,
+	 SEARCH_START,
+	 SEARCH_CANCEL
+ } Digital_IO_Search_Request;
+
+ typedef enum {
+	 SEARCH_REPORT_MATCH = 0x00,
+	 SEARCH_REPORT_WINDOW = 0x01,
+	 SEARCH_REPORT_DONE = 0x02
+ } Digital_IO_Search_Report;
+
+ typedef struct _DIGITAL_IO_SEARCH_Step
+ {
+	 uint32_t					mask;
+	 uint32_t					value;
+ } DIGITAL_IO_SEARCH_Step;
+
+ typedef struct _DIGITAL_IO_SEARCH_Info
+ {
+	 // Pattern of the host, staged by the commands
+	 DIGITAL_IO_SEARCH_Step			step_new[DIGITAL_IO_SEARCH_MAX_STEP];
+	 uint8_t						step_num_new;
+	 uint8_t						group_new;
+	 uint8_t						window_new;
+	 uint16_t						limit_new;
+	 volatile Digital_IO_Search_Request	request;
+	 // Running search (record numbers count from the capture start)
+	 Digital_IO_Search_State		state;
+	 DIGITAL_IO_SEARCH_Step			step[DIGITAL_IO_SEARCH_MAX_STEP];
+	 uint8_t						step_num;
+	 uint8_t						window;
+	 uint8_t						flags;
+	 uint16_t						limit;
+	 DIGITAL_IO_CAPTURE_Group*		group;
+	 uint32_t						first;
+	 uint32_t						end;
+	 uint32_t						position;
+	 uint32_t						scanned;
+	 uint32_t						match_count;
+	 uint32_t						match;
+	 uint8_t						match_sent;
+	 uint32_t						window_pos;
+	 uint32_t						window_end;
+ } DIGITAL_IO_SEARCH_TypeDef;
+
+ extern DIGITAL_IO_SEARCH_TypeDef digital_io_search;
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Search_Process_Command
+   *         Stage one step of the pattern, start or cancel the search.
+   * @param  output_buff: command payload
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Search_Process_Command(uint8_t* output_buff);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Search_Handle
+   *         Start the requested search and scan the next records (main loop).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Search_Handle(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Search_Report
+   *         Create the report of the current match, its window or the end of the search.
+   * @param  report: report buffer (DIGITAL_IO_REPORT_SIZE bytes)
+   * @retval 1 if a report was created, 0 if there is nothing to send
+   */
+ uint8_t USBD_HID_Digital_IO_Search_Report(uint8_t* report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_DIGITAL_IO_SEARCH_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
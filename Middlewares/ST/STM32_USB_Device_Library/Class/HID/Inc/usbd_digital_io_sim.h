@@ -0,0 +1,157 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_sim.h
+  * @brief   Header file for the usbd_digital_io_sim.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "usbd_digital_io.h"
+
+
+/* Defines -------------------------------------*/
+#ifndef __USBD_DIGITAL_IO_SIM_H
+#define __USBD_DIGITAL_IO_SIM_H
+
+#ifdef DIGITAL_IO_SIMULATION
+
+#define DIGITAL_IO_SIM_LOOP_CYCLES		(0x100U)	// default virtual CPU cycles of one main loop pass
+#define DIGITAL_IO_SIM_BANK_BITS		(0x10U)		// simulated bank b holds the logical bits 16*b .. 16*b+15
+#define DIGITAL_IO_SIM_DELAY_DEPTH		(0x20U)		// output changes in flight in a delay line
+#define DIGITAL_IO_SIM_SERIAL_IDLE		(0xFFU)
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ /* DUT model plug-in: the model sees the simulated output pins at every read of
+  * the firmware and returns the levels it drives on the other pins. A C++ model
+  * fills the table with static member functions and its object as the state.
+  */
+ typedef struct _DIGITAL_IO_SIM_Model
+ {
+	 void		(* Reset)	(void* state);
+	 uint32_t	(* Step)	(void* state, uint32_t outputs, uint32_t output_mask, uint32_t now);	// driven levels (logical bits)
+	 void*		state;
+ } DIGITAL_IO_SIM_Model;
+
+ typedef struct _DIGITAL_IO_SIM_Info
+ {
+	 DIGITAL_IO_CONTEXT_TypeDef		ctx;
+	 DIGITAL_IO_SIM_Model			model;
+	 uint32_t						clock;			// virtual CPU cycles
+	 uint32_t						loop_cycles;	// clock advance of one main loop pass
+	 // Simulated pins (logical bits)
+	 uint32_t						output_mask;	// pins in output mode
+	 uint32_t						outputs;		// output data register
+	 uint32_t						pull_up;		// inputs pulled high when the model leaves them floating
+	 uint8_t						trigger_out;	// level of the virtual TRIGGER_OUT pin
+	 uint32_t						trigger_pulses;	// rising edges of TRIGGER_OUT
+	 uint8_t						output_report[DIGITAL_IO_COMMAND_PAYLOAD_SIZE];
+ } DIGITAL_IO_SIM_TypeDef;
+
+ // Sample models
+ typedef struct _DIGITAL_IO_SIM_Echo
+ {
+	 uint32_t						out_mask;		// echoed output pins
+	 int8_t							shift;			// logical bits between an output and its input (+ = higher bit)
+	 uint32_t						delay;			// cycles between an output change and the input (delay line)
+	 // Delay line: output changes in flight
+	 uint32_t						tick[DIGITAL_IO_SIM_DELAY_DEPTH];
+	 uint32_t						value[DIGITAL_IO_SIM_DELAY_DEPTH];
+	 uint8_t						head;
+	 uint8_t						tail;
+	 uint32_t						last;
+	 uint32_t						level;
+ } DIGITAL_IO_SIM_Echo;
+
+ typedef struct _DIGITAL_IO_SIM_Counter
+ {
+	 uint8_t						clock_bit;		// output pin counted on its rising edge
+	 uint8_t						reset_bit;		// output pin which clears the count while high (0xFF = none)
+	 uint8_t						in_shift;		// lowest input pin of the count
+	 uint8_t						in_width;		// input pins of the count
+	 uint32_t						count;
+	 uint8_t						last;
+ } DIGITAL_IO_SIM_Counter;
+
+ typedef struct _DIGITAL_IO_SIM_Serial
+ {
+	 uint8_t						rx_bit;			// output pin of the firmware (DUT receives, idle high, 8N1)
+	 uint8_t						tx_bit;			// input pin of the firmware (DUT answers)
+	 uint32_t						bit_cycles;		// cycles of one bit
+	 const uint8_t*					response;		// answer of every received byte (256 entries), NULL = byte + 1
+	 // Receiver
+	 uint8_t						rx_state;		// 0 = idle, 1-8 = data bits, 9 = stop bit
+	 uint32_t						rx_start;
+	 uint8_t						rx_byte;
+	 uint8_t						rx_last;
+	 // Transmitter
+	 uint8_t						tx_busy;
+	 uint32_t						tx_start;
+	 uint16_t						tx_frame;		// start, 8 data (LSB first), stop
+	 uint32_t						received;
+	 uint32_t						framing_errors;
+ } DIGITAL_IO_SIM_Serial;
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Sim_Init
+   *         Reset a simulated module with a DUT model and select its context.
+   * @param  sim: simulated module
+   * @param  model: DUT model (copied)
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Sim_Init(DIGITAL_IO_SIM_TypeDef* sim, const DIGITAL_IO_SIM_Model* model);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Sim_Output
+   *         Deliver an output report of the host (core lengths: digital IO, trigger, trigger event).
+   *         Commands go to USBD_HID_Digital_IO_Process_Command: pin remap, upload/download,
+   *         trigger action and oversampling; the commands of the feature modules
+   *         (capture, log, bus, fabric, ...) are answered with ACK_UNKNOWN.
+   * @param  sim: simulated module
+   * @param  report: output report (byte[0] = length)
+   * @retval HID_Digital_IO_Ack_Status
+   */
+ HID_Digital_IO_Ack_Status USBD_HID_Digital_IO_Sim_Output(DIGITAL_IO_SIM_TypeDef* sim, const uint8_t* report);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Sim_Run
+   *         Run main loop passes of the core until the virtual clock advanced by the given cycles.
+   * @param  sim: simulated module
+   * @param  cycles: virtual CPU cycles
+   * @retval Fired triggers (bit per trigger)
+   */
+ uint32_t USBD_HID_Digital_IO_Sim_Run(DIGITAL_IO_SIM_TypeDef* sim, uint32_t cycles);
+
+ // Sample models: the state is the model struct, set it up before USBD_HID_Digital_IO_Sim_Init
+ void USBD_HID_Digital_IO_Sim_Echo_Model(DIGITAL_IO_SIM_Echo* echo, DIGITAL_IO_SIM_Model* model);
+ void USBD_HID_Digital_IO_Sim_Delay_Model(DIGITAL_IO_SIM_Echo* echo, DIGITAL_IO_SIM_Model* model);
+ void USBD_HID_Digital_IO_Sim_Counter_Model(DIGITAL_IO_SIM_Counter* counter, DIGITAL_IO_SIM_Model* model);
+ void USBD_HID_Digital_IO_Sim_Serial_Model(DIGITAL_IO_SIM_Serial* serial, DIGITAL_IO_SIM_Model* model);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* DIGITAL_IO_SIMULATION */
+
+#endif  /* __USBD_DIGITAL_IO_SIM_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
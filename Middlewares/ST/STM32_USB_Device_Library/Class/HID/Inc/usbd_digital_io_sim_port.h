@@ -0,0 +1,72 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_sim_port.h
+  * @brief   Host definitions of the HAL and USB device names used by the core
+  *          (DIGITAL_IO_SIMULATION), instead of the STM32 headers.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+/* Defines -------------------------------------*/
+#ifndef __USBD_DIGITAL_IO_SIM_PORT_H
+#define __USBD_DIGITAL_IO_SIM_PORT_H
+
+// Same values as stm32f4xx_hal_gpio.h
+#define GPIO_MODE_INPUT			(0x00000000U)
+#define GPIO_MODE_OUTPUT_PP		(0x00000001U)
+#define GPIO_MODE_OUTPUT_OD		(0x00000011U)
+#define GPIO_NOPULL				(0x00000000U)
+#define GPIO_PULLUP				(0x00000001U)
+#define GPIO_PULLDOWN			(0x00000002U)
+
+// Same as gpio.h: BSRR words of a trigger action
+#define GPIO_DIGITAL_BANK_NUM	(0x03U)
+
+#ifndef MIN
+#define MIN(a, b)				(((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b)				(((a) > (b)) ? (a) : (b))
+#endif
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ typedef struct
+ {
+	 uint32_t	Pin;
+	 uint32_t	Mode;
+	 uint32_t	Pull;
+	 uint32_t	Speed;
+	 uint32_t	Alternate;
+ } GPIO_InitTypeDef;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_DIGITAL_IO_SIM_PORT_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
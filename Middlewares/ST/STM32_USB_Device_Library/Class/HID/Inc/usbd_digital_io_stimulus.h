@@ -0,0 +1,88 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_stimulus.h
+  * @brief   Header file for the usbd_digital_io_stimulus.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "usbd_digital_io.h"
+
+
+/* Defines -------------------------------------*/
+#ifndef __USBD_DIGITAL_IO_STIMULUS_H
+#define __USBD_DIGITAL_IO_STIMULUS_H
+
+#define DIGITAL_IO_STIMULUS_MAX_WORDS		(0x1000U)	// program words (16 KB)
+#define DIGITAL_IO_STIMULUS_VALUE_MASK		(DIGITAL_IO_ALL_BITS)
+#define DIGITAL_IO_STIMULUS_TICKS_SHIFT		(0x18U)		// step word: ticks in bits 24-31 (0 = next word holds the ticks)
+#define DIGITAL_IO_STIMULUS_LEAD			(0x400U)	// CPU cycles between the start and the first step
+// Config flags
+#define DIGITAL_IO_STIMULUS_VERIFY			(0x01U)		// read the pins back at the end of every step
+#define DIGITAL_IO_STIMULUS_ISOLATE			(0x02U)		// interrupts masked during the playback
+// Result flags
+#define DIGITAL_IO_STIMULUS_CHECKSUM_ERROR	(0x10U)		// the uploaded program does not match, not played
+#define DIGITAL_IO_STIMULUS_TRUNCATED		(0x20U)		// the last step misses its ticks word
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ typedef enum {
+	 STIMULUS_IDLE,
+	 STIMULUS_RUN
+ } Digital_IO_Stimulus_State;
+
+ typedef struct _DIGITAL_IO_STIMULUS_Info
+ {
+	 volatile Digital_IO_Stimulus_State	state;
+	 uint32_t						mask;
+	 uint32_t						unit;
+	 uint8_t						flags;
+	 uint8_t						result;
+	 uint16_t						words;
+	 uint32_t						checksum;
+ } DIGITAL_IO_STIMULUS_TypeDef;
+
+ extern DIGITAL_IO_STIMULUS_TypeDef digital_io_stimulus;
+ extern uint32_t digital_io_stimulus_buffer[DIGITAL_IO_STIMULUS_MAX_WORDS];
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Stimulus_Process_Command
+   *         Store the driven pins and time unit, or request the playback of the uploaded program.
+   * @param  command: COMMAND_STIMULUS_CONFIG or COMMAND_STIMULUS_RUN
+   * @param  output_buff: command payload
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Stimulus_Process_Command(uint8_t command, uint8_t* output_buff);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Stimulus_Run
+   *         Play the uploaded program and queue the timing report (main loop).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Stimulus_Run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_DIGITAL_IO_STIMULUS_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
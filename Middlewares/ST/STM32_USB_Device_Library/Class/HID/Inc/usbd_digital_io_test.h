@@ -0,0 +1,74 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_test.h
+  * @brief   Header file for the usbd_digital_io_test.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "usbd_digital_io.h"
+
+
+/* Defines -------------------------------------*/
+#ifndef __USBD_DIGITAL_IO_TEST_H
+#define __USBD_DIGITAL_IO_TEST_H
+
+#define DIGITAL_IO_TEST_DEFAULT_SETTLE	(0x0AU)		// us after every pin change
+#define DIGITAL_IO_TEST_MAX_SETTLE		(0x3E8U)	// 1 ms
+#define DIGITAL_IO_TEST_REFUSED			(0xFFU)		// tested pin count of a refused test
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ typedef struct _DIGITAL_IO_TEST_Info
+ {
+	 volatile uint8_t				request;
+	 uint32_t						mask;
+	 uint16_t						settle;
+	 uint32_t						connected;
+	 uint32_t						stuck_high;
+	 uint32_t						stuck_low;
+	 uint32_t						matrix[DIGITAL_IO_MAX_BIT_NUM];
+ } DIGITAL_IO_TEST_TypeDef;
+
+ extern DIGITAL_IO_TEST_TypeDef digital_io_test;
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Test_Process_Command
+   *         Store the pins and the settle time of an interconnect test request.
+   * @param  output_buff: command payload
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Test_Process_Command(uint8_t* output_buff);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Test_Run
+   *         Run the requested interconnect test and queue the result report (main loop).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Test_Run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_DIGITAL_IO_TEST_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,108 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_watch.h
+  * @brief   Header file for the usbd_digital_io_watch.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+/* Includes -------------------------------------*/
+#include "usbd_digital_io.h"
+
+
+/* Defines -------------------------------------*/
+#ifndef __USBD_DIGITAL_IO_WATCH_H
+#define __USBD_DIGITAL_IO_WATCH_H
+
+#define DIGITAL_IO_WATCH_RING_SIZE		(0x100U)	// edge records (timestamp, code)
+#define DIGITAL_IO_WATCH_LEVEL			(0x80U)		// code: level after the edge
+#define DIGITAL_IO_WATCH_POLLED			(0x40U)		// code: timestamp of the main loop poll, not of the edge
+#define DIGITAL_IO_WATCH_NO_RECORD		(0xFFU)
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+ typedef struct _DIGITAL_IO_WATCH_Info
+ {
+	 volatile uint8_t				request;
+	 uint32_t						mask_new;
+	 uint32_t						mask;
+	 uint32_t						lined;
+	 uint32_t						polled;
+	 uint32_t						last_sample;
+	 volatile uint32_t				edges;
+	 volatile uint16_t				head;
+	 volatile uint16_t				tail;
+	 volatile uint32_t				lost;
+ } DIGITAL_IO_WATCH_TypeDef;
+
+ extern DIGITAL_IO_WATCH_TypeDef digital_io_watch;
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Watch_Process_Command
+   *         Store the pins to watch.
+   * @param  output_buff: command payload
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Watch_Process_Command(uint8_t* output_buff);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Watch_Handle
+   *         Allocate the EXTI lines to the watched pins and report the allocation (main loop).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Watch_Handle(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Watch_IRQ
+   *         Timestamp the pending edges of the EXTI lines (EXTI interrupts).
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Watch_IRQ(void);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Watch_Poll
+   *         Record the edges of the watched pins without an EXTI line.
+   * @param  sample: packed sample of the main loop
+   * @retval None
+   */
+ void USBD_HID_Digital_IO_Watch_Poll(uint32_t sample);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Watch_Report
+   *         Create the next edge record report.
+   * @param  report: report buffer (DIGITAL_IO_REPORT_SIZE bytes)
+   * @retval 1 if a report was created, 0 if the ring is empty
+   */
+ uint8_t USBD_HID_Digital_IO_Watch_Report(uint8_t* report);
+
+ /**
+   * @brief  USBD_HID_Digital_IO_Watch_Take_Edges
+   *         Read and clear the edges of the lines served by the EXTI interrupt.
+   * @retval Logical bits with at least one edge since the previous call
+   */
+ uint32_t USBD_HID_Digital_IO_Watch_Take_Edges(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_DIGITAL_IO_WATCH_H */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -48,22 +48,78 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "usbd_digital_io.h"
+#include "usbd_digital_io_capture.h"
+#ifndef DIGITAL_IO_SIMULATION
 #include "gpio.h"
 #include "stm32f4xx_hal_gpio.h"
+#include "usbd_digital_io_log.h"
+#include "usbd_digital_io_test.h"
+#include "usbd_digital_io_latency.h"
+#include "usbd_digital_io_bus.h"
+#include "usbd_digital_io_watch.h"
+#include "usbd_digital_io_decoder.h"
+#include "usbd_digital_io_group.h"
+#include "usbd_digital_io_jit.h"
+#include "usbd_digital_io_search.h"
+#include "usbd_digital_io_stimulus.h"
+#include "usbd_digital_io_fabric.h"
+#endif
 
 /* Global variables */
-HID_DIGITAL_IO_TypeDef digital_io;
-HID_DIGITAL_IO_TypeDef digital_io_new_state;
-HID_Digital_IO_Trigger digital_io_trigger;
-HID_Digital_IO_Trigger digital_io_do_trigger = DONTCARE;
-Digital_IO_Change_Flag digital_io_change_enable;
-Digital_IO_Change_Flag digital_io_change_flag;
-Digital_IO_Report_Flag digital_io_report_flag;
-ORDERED_ARRAY digital_io_switch_buffer;
-HID_DIGITAL_IO_TRIGGER_Event digital_io_trig_events[DIGITAL_IO_MAX_TRIG_NUM];
+#ifdef DIGITAL_IO_SIMULATION
+DIGITAL_IO_THREAD_LOCAL DIGITAL_IO_CONTEXT_TypeDef* digital_io_current = NULL;
+#else
+DIGITAL_IO_CONTEXT_TypeDef digital_io_context;
+#endif
+
+/* Private functions */
+static uint8_t* USBD_HID_Digital_IO_Upload_Target(uint32_t* size);
 
 /* Functions */
 
+/**
+  * @brief  USBD_HID_Digital_IO_Context_Init
+  *         Reset a core context to the power-on state.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Context_Init(DIGITAL_IO_CONTEXT_TypeDef* ctx, const DIGITAL_IO_HAL_Ops* hal, void* hal_user)
+{
+	uint8_t* raw = (uint8_t*)ctx;
+	uint32_t idx = 0;
+
+	for (idx = 0; idx < sizeof(DIGITAL_IO_CONTEXT_TypeDef); idx++)
+	{
+		raw[idx] = 0;
+	}
+	ctx->trigger = DONTCARE;
+	ctx->do_trigger = DONTCARE;
+	ctx->change_enable = UNCHANGED;
+	ctx->change_flag = UNCHANGED;
+	ctx->report_flag = NO_REPORT;
+	ctx->remap_flag = UNCHANGED;
+	ctx->oversampling = 1;
+	// Power-on wiring: logical bit n on physical bit n
+	for (idx = 0; idx < DIGITAL_IO_MAX_BIT_NUM; idx++)
+	{
+		ctx->remap[idx] = (uint8_t)idx;
+		ctx->remap_new[idx] = (uint8_t)idx;
+	}
+	ctx->hal = hal;
+	ctx->hal_user = hal_user;
+}
+
+#ifdef DIGITAL_IO_SIMULATION
+/**
+  * @brief  USBD_HID_Digital_IO_Context_Select
+  *         Select the context the calling thread works on.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Context_Select(DIGITAL_IO_CONTEXT_TypeDef* ctx)
+{
+	digital_io_current = ctx;
+}
+#endif
+
 /**
   * @brief  USBH_HID_Digital_IO_Init
   *         The function init the HID digital IO.
@@ -93,7 +149,7 @@ void USBD_HID_Digital_IO_Init(HID_DIGITAL_IO_TypeDef* digital_io_instance)
 	  // Set pin specific default values
 	  for (pin_idx = 0; pin_idx < DIGITAL_MAX_PIN_NUM; pin_idx++){
 		  digital_io_instance->ports[port_idx].pins[pin_idx] = DIGITAL_PIN_LOW;
-		  digital_io_instance->ports[port_idx].gpio_settings.Pin |= gpio_digital_pin[port_idx][pin_idx];
+		  digital_io_instance->ports[port_idx].gpio_settings.Pin |= DIGITAL_IO_HAL_PIN(port_idx, pin_idx);
 	  }
   }
 }
@@ -109,18 +165,18 @@ void USBD_HID_Digital_IO_Reset_SwitchTrig(void)
   uint8_t port_idx = 0;
 
   // Reset switch buffer
-  digital_io_switch_buffer.head_idx = 0;
-  digital_io_switch_buffer.tail_idx = (DIGITAL_MAX_PORT_NUM - 1);
+  DIGITAL_IO_CTX_SWITCH_BUFFER.head_idx = 0;
+  DIGITAL_IO_CTX_SWITCH_BUFFER.tail_idx = (DIGITAL_MAX_PORT_NUM - 1);
 
   // Unset trigger, change and report flag
-  digital_io_trigger = DONTCARE;
-  digital_io_change_flag = UNCHANGED;
-  digital_io_change_flag = NO_REPORT;
+  DIGITAL_IO_CTX_TRIGGER = DONTCARE;
+  DIGITAL_IO_CTX_CHANGE_FLAG = UNCHANGED;
+  DIGITAL_IO_CTX_REPORT_FLAG = NO_REPORT;
 
   for(port_idx = 0; port_idx < DIGITAL_MAX_PORT_NUM; port_idx++)
   {
 	  // Fill switch buffer
-	  digital_io_switch_buffer.array[port_idx] = PORT_UNUSED;
+	  DIGITAL_IO_CTX_SWITCH_BUFFER.array[port_idx] = PORT_UNUSED;
   }
 }
 
@@ -131,36 +187,29 @@ void USBD_HID_Digital_IO_Reset_SwitchTrig(void)
   */
 void USBD_HID_Digital_IO_CreateReport(uint8_t* report)
 {
-  uint8_t port_idx = 0, pin_idx = 0, offset = 0, report_num = 0;
+  uint8_t port_idx = 0;
   // Clean old report
   report[0] = 0;
-  report[1] = 0;
-  report[2] = 0;
-  report[3] = 0;
   // Step over all ports
   for(port_idx = 0; port_idx < DIGITAL_MAX_PORT_NUM; port_idx++)
   {
 	  // Add IO directions to the report
 	  // FORMAT: 1 byte (2 last bit reserved)
 	  // XX543210, when 0...5 indicate the direction of the numbered ports
-	  report[0] += (digital_io.ports[port_idx].gpio_settings.Mode << port_idx);
-
-	  // Select actual report and add offset
-	  if ((port_idx % 2) == 0) {
-		  report_num += 1;
-		  offset = 0;
-	  }
-	  else {
-		  offset = 4;
-	  }
-	  // Add pin values to the report
-	  // FORMAT: 3 byte -> 0000|1111, 2222|3333, 4444|5555 (4 pin / port)
-	  // Numbers sign the actual port
-	  // Step over all pins
-	  for (pin_idx = 0; pin_idx < DIGITAL_MAX_PIN_NUM; pin_idx++){
-		  report[report_num] += (digital_io.ports[port_idx].pins[pin_idx] << (pin_idx + offset));
-	  }
+	  report[0] += (DIGITAL_IO_CTX_STATE.ports[port_idx].gpio_settings.Mode << port_idx);
   }
+  // Add pin values to the report
+  // FORMAT: 3 byte -> 0000|1111, 2222|3333, 4444|5555 (4 pin / port)
+  // Numbers sign the actual port, the packed sample has the same bit order
+  report[1] = (uint8_t)(DIGITAL_IO_CTX_SAMPLE);
+  report[2] = (uint8_t)(DIGITAL_IO_CTX_SAMPLE >> 8);
+  report[3] = (uint8_t)(DIGITAL_IO_CTX_SAMPLE >> 16);
+  // Add sticky edges to the report
+  // FORMAT: 3 byte, same order as the pin values, 1 = changed (even back) since the previous report
+  report[4] = (uint8_t)(DIGITAL_IO_CTX_EDGE_REPORT);
+  report[5] = (uint8_t)(DIGITAL_IO_CTX_EDGE_REPORT >> 8);
+  report[6] = (uint8_t)(DIGITAL_IO_CTX_EDGE_REPORT >> 16);
+  DIGITAL_IO_CTX_EDGE_REPORT = 0;
 }
 
 /**
@@ -170,15 +219,35 @@ void USBD_HID_Digital_IO_CreateReport(uint8_t* report)
   */
 void USBD_HID_Digital_IO_Read(void)
 {
-  uint8_t port_idx = 0, pin_idx = 0;
+  uint32_t samples[DIGITAL_IO_MAX_OVERSAMPLING];
+  uint32_t previous = DIGITAL_IO_CTX_SAMPLE, edge = 0;
+  uint8_t idx = 0;
 
-  // Step over all ports
-  for(port_idx = 0; port_idx < DIGITAL_MAX_PORT_NUM; port_idx++)
+  // Pulses between two reads: EXTI edge latches (or the watch interrupt) and the snapshots of the capture path
+  edge = DIGITAL_IO_HAL_READ_EDGES();
+#ifndef DIGITAL_IO_SIMULATION
+  edge |= USBD_HID_Digital_IO_Capture_Take_Edges() | USBD_HID_Digital_IO_Watch_Take_Edges();
+#endif
+
+  if (DIGITAL_IO_CTX_OVERSAMPLING <= 1)
   {
-	  for (pin_idx = 0; pin_idx < DIGITAL_MAX_PIN_NUM; pin_idx++){
-		  digital_io.ports[port_idx].pins[pin_idx] = GPIO_Read_DIGITAL_IO(port_idx, pin_idx);
+	  // One snapshot of all banks, converted to the logical order by table lookups
+	  DIGITAL_IO_CTX_SAMPLE = DIGITAL_IO_HAL_READ();
+  }
+  else
+  {
+	  // Back-to-back snapshots filtered by majority vote (ringing on long cables)
+	  DIGITAL_IO_HAL_SNAPSHOT(samples, DIGITAL_IO_CTX_OVERSAMPLING);
+	  DIGITAL_IO_CTX_SAMPLE = USBD_HID_Digital_IO_Majority(samples, DIGITAL_IO_CTX_OVERSAMPLING);
+	  // The filtered glitches are still reported as edges
+	  for (idx = 1; idx < DIGITAL_IO_CTX_OVERSAMPLING; idx++)
+	  {
+		  edge |= samples[idx] ^ samples[idx - 1];
 	  }
   }
+
+  DIGITAL_IO_CTX_EDGE = edge | (DIGITAL_IO_CTX_SAMPLE ^ previous);
+  DIGITAL_IO_CTX_EDGE_REPORT |= DIGITAL_IO_CTX_EDGE;
 }
 
 
@@ -204,47 +273,47 @@ void USBD_HID_Digital_IO_Set_Changes(uint8_t* output_buff)
 		{
 			// MODE: 2nd bit in the byte contain IO direction (mask it)
 			temp_mode = (output_buff[port_idx] & 0x02);
-			digital_io_new_state.ports[port_idx].gpio_settings.Mode = (temp_mode == OUTPUT) ? GPIO_MODE_OUTPUT_PP : GPIO_MODE_INPUT;
+			DIGITAL_IO_CTX_NEW_STATE.ports[port_idx].gpio_settings.Mode = (temp_mode == OUTPUT) ? GPIO_MODE_OUTPUT_PP : GPIO_MODE_INPUT;
 
 			// PULL: 3nd and 4nd bits in the byte together define pull type (mask these)
 			temp_pull = (output_buff[port_idx] & 0x0C);
 			switch(temp_pull)
 			{
 				case NOPULL:
-					digital_io_new_state.ports[port_idx].gpio_settings.Pull = GPIO_NOPULL;
+					DIGITAL_IO_CTX_NEW_STATE.ports[port_idx].gpio_settings.Pull = GPIO_NOPULL;
 					break;
 				case PULLDOWN:
-					digital_io_new_state.ports[port_idx].gpio_settings.Pull = GPIO_PULLDOWN;
+					DIGITAL_IO_CTX_NEW_STATE.ports[port_idx].gpio_settings.Pull = GPIO_PULLDOWN;
 					break;
 				case PULLUP:
-					digital_io_new_state.ports[port_idx].gpio_settings.Pull = GPIO_PULLUP;
+					DIGITAL_IO_CTX_NEW_STATE.ports[port_idx].gpio_settings.Pull = GPIO_PULLUP;
 					break;
 				default:
-					digital_io_new_state.ports[port_idx].gpio_settings.Pull = GPIO_NOPULL;
+					DIGITAL_IO_CTX_NEW_STATE.ports[port_idx].gpio_settings.Pull = GPIO_NOPULL;
 					break;
 			} // switch (pull)
 
 			// Update _changeIO flag based on PULL and MODE settings
-			if ( digital_io_new_state.ports[port_idx].gpio_settings.Mode != digital_io.ports[port_idx].gpio_settings.Mode ||
-				 digital_io_new_state.ports[port_idx].gpio_settings.Pull != digital_io.ports[port_idx].gpio_settings.Pull )
+			if ( DIGITAL_IO_CTX_NEW_STATE.ports[port_idx].gpio_settings.Mode != DIGITAL_IO_CTX_STATE.ports[port_idx].gpio_settings.Mode ||
+				 DIGITAL_IO_CTX_NEW_STATE.ports[port_idx].gpio_settings.Pull != DIGITAL_IO_CTX_STATE.ports[port_idx].gpio_settings.Pull )
 			{
-				digital_io_new_state.ports[port_idx]._changeIO = CHANGED;
+				DIGITAL_IO_CTX_NEW_STATE.ports[port_idx]._changeIO = CHANGED;
 
 				// Add OUT -> IN higher priority than IN -> OUT (avoid to connecting two outputs together)
-				if (digital_io_new_state.ports[port_idx].gpio_settings.Mode == GPIO_MODE_OUTPUT_PP)
+				if (DIGITAL_IO_CTX_NEW_STATE.ports[port_idx].gpio_settings.Mode == GPIO_MODE_OUTPUT_PP)
 				{
-					digital_io_switch_buffer.array[digital_io_switch_buffer.tail_idx] = port_idx;
-					digital_io_switch_buffer.tail_idx--;
+					DIGITAL_IO_CTX_SWITCH_BUFFER.array[DIGITAL_IO_CTX_SWITCH_BUFFER.tail_idx] = port_idx;
+					DIGITAL_IO_CTX_SWITCH_BUFFER.tail_idx--;
 				}
 				else
 				{
-					digital_io_switch_buffer.array[digital_io_switch_buffer.head_idx] = port_idx;
-					digital_io_switch_buffer.head_idx++;
+					DIGITAL_IO_CTX_SWITCH_BUFFER.array[DIGITAL_IO_CTX_SWITCH_BUFFER.head_idx] = port_idx;
+					DIGITAL_IO_CTX_SWITCH_BUFFER.head_idx++;
 				}
 			} // if (_changeIO)
 			else
 			{
-				digital_io_new_state.ports[port_idx]._changeIO = UNCHANGED;
+				DIGITAL_IO_CTX_NEW_STATE.ports[port_idx]._changeIO = UNCHANGED;
 			} // else (_changeIO)
 
 
@@ -258,40 +327,62 @@ void USBD_HID_Digital_IO_Set_Changes(uint8_t* output_buff)
 				for (pin_idx = 0; pin_idx < DIGITAL_MAX_PIN_NUM; pin_idx++)
 				{
 					// Mask actual pin values
-					digital_io_new_state.ports[port_idx].pins[pin_idx] = (temp_pins >> pin_idx) & 0x01;
+					DIGITAL_IO_CTX_NEW_STATE.ports[port_idx].pins[pin_idx] = (temp_pins >> pin_idx) & 0x01;
 
 					// Update _changePIN flag based on pin values and _changeIO state (true, when old is INPUT or (OUTPUT and pin values different))
-					digital_io_new_state.ports[port_idx]._changePIN = CHANGED;
+					DIGITAL_IO_CTX_NEW_STATE.ports[port_idx]._changePIN = CHANGED;
 				}
 			}
 			// The _changePIN flag may different if the previous setting was OUTPUT
 			else
 			{
-				digital_io_new_state.ports[port_idx]._changePIN = UNCHANGED;
+				DIGITAL_IO_CTX_NEW_STATE.ports[port_idx]._changePIN = UNCHANGED;
 			}// if (pin)
 		} // if (usage)
 		// Use default settings
 		else
 		{
 		  // Add default gpio settings
-		  digital_io_new_state.ports[port_idx].gpio_settings.Mode = GPIO_MODE_INPUT;
-		  digital_io_new_state.ports[port_idx].gpio_settings.Pull = GPIO_PULLDOWN;
-		  digital_io_new_state.ports[port_idx].gpio_settings.Pin = 0;
+		  DIGITAL_IO_CTX_NEW_STATE.ports[port_idx].gpio_settings.Mode = GPIO_MODE_INPUT;
+		  DIGITAL_IO_CTX_NEW_STATE.ports[port_idx].gpio_settings.Pull = GPIO_PULLDOWN;
+		  DIGITAL_IO_CTX_NEW_STATE.ports[port_idx].gpio_settings.Pin = 0;
 
 		  // Add default number and change state
-		  digital_io_new_state.ports[port_idx].pin_enabled_size = DIGITAL_MAX_PIN_NUM;
-		  digital_io_new_state.ports[port_idx]._changeIO = UNCHANGED;
-		  digital_io_new_state.ports[port_idx]._changePIN = UNCHANGED;
+		  DIGITAL_IO_CTX_NEW_STATE.ports[port_idx].pin_enabled_size = DIGITAL_MAX_PIN_NUM;
+		  DIGITAL_IO_CTX_NEW_STATE.ports[port_idx]._changeIO = UNCHANGED;
+		  DIGITAL_IO_CTX_NEW_STATE.ports[port_idx]._changePIN = UNCHANGED;
 
 		  // Set pin specific default values
 		  for (pin_idx = 0; pin_idx < DIGITAL_MAX_PIN_NUM; pin_idx++){
-			  digital_io_new_state.ports[port_idx].pins[pin_idx] = DIGITAL_PIN_LOW;
-			  digital_io_new_state.ports[port_idx].gpio_settings.Pin |= gpio_digital_pin[port_idx][pin_idx];
+			  DIGITAL_IO_CTX_NEW_STATE.ports[port_idx].pins[pin_idx] = DIGITAL_PIN_LOW;
+			  DIGITAL_IO_CTX_NEW_STATE.ports[port_idx].gpio_settings.Pin |= DIGITAL_IO_HAL_PIN(port_idx, pin_idx);
 		  }
 		} // else (usage)
 	} // for (ports)
 }
 
+/**
+  * @brief  USBD_HID_Digital_IO_Store_Changes
+  *         Keep the payload of a LENGTH_DIGITAL_IO report for the main loop.
+  * @retval ACK_ACCEPTED, ACK_DROPPED while the previous changes are not stored yet
+  */
+HID_Digital_IO_Ack_Status USBD_HID_Digital_IO_Store_Changes(const uint8_t* output_buff)
+{
+	uint8_t idx = 0;
+
+	// The main loop reads the payload until it clears the flag: a pipelined report must not overwrite it
+	if (DIGITAL_IO_CTX_CHANGE_FLAG == CHANGED)
+	{
+		return ACK_DROPPED;
+	}
+	for (idx = 0; idx < LENGTH_DIGITAL_IO; idx++)
+	{
+		DIGITAL_IO_CTX_CHANGE_REPORT[idx] = output_buff[idx];
+	}
+	DIGITAL_IO_CTX_CHANGE_FLAG = CHANGED;
+	return ACK_ACCEPTED;
+}
+
 /**
   * @brief  USBH_HID_Digital_IO_Init
   *         The function init the HID digital IO.
@@ -301,11 +392,11 @@ void USBD_HID_Digital_IO_Trigger (uint8_t* output_buff)
 {
 	if (output_buff[0] == 0xfe)
 	{
-		digital_io_trigger = TRIGGERED;
+		DIGITAL_IO_CTX_TRIGGER = TRIGGERED;
 	}
 	else
 	{
-		digital_io_trigger = DONTCARE;
+		DIGITAL_IO_CTX_TRIGGER = DONTCARE;
 	}
 }
 
@@ -317,45 +408,56 @@ void USBD_HID_Digital_IO_Trigger (uint8_t* output_buff)
 void USBD_HID_Digital_IO_SwitchPorts(void)
 {
 	uint8_t port_idx = 0, pin_idx = 0;
+	uint32_t mask = 0, value = 0;
 	// Copy changes to the digital IO instance
-	digital_io = digital_io_new_state;
+	DIGITAL_IO_CTX_STATE = DIGITAL_IO_CTX_NEW_STATE;
+
+	// Collect the new output values in packed logical order
+	for (port_idx = 0; port_idx < DIGITAL_MAX_PORT_NUM; port_idx ++)
+	{
+		if(DIGITAL_IO_CTX_STATE.ports[port_idx]._changePIN == CHANGED)
+		{
+			mask |= DIGITAL_IO_PORT_MASK(port_idx);
+			for (pin_idx = 0; pin_idx < DIGITAL_MAX_PIN_NUM; pin_idx ++)
+			{
+				value |= ((uint32_t)DIGITAL_IO_CTX_STATE.ports[port_idx].pins[pin_idx] << DIGITAL_IO_BIT(port_idx, pin_idx));
+			}
+		}
+	}
 
 	// Set changes physically
 
 	// Fist step: OUT -> IN changes
-	while(digital_io_switch_buffer.head_idx != 0)
+	while(DIGITAL_IO_CTX_SWITCH_BUFFER.head_idx != 0)
 	{
-		digital_io_switch_buffer.head_idx --;
-		USBD_HID_Digital_IO_GPIO_Setup (digital_io_switch_buffer.head_idx);
+		DIGITAL_IO_CTX_SWITCH_BUFFER.head_idx --;
+		USBD_HID_Digital_IO_GPIO_Setup (DIGITAL_IO_CTX_SWITCH_BUFFER.head_idx);
 
 	}
 
-	// Second step: IN -> OUT changes
-	while(digital_io_switch_buffer.tail_idx != (DIGITAL_MAX_PORT_NUM - 1))
+	// Second step: set/unset gpio values with one BSRR write per bank
+	// (ODR of the pins still in input mode is preloaded, so IN -> OUT starts with the new value)
+	DIGITAL_IO_HAL_WRITE(mask, value);
+	DIGITAL_IO_CTX_SWITCH_ACK.apply_tick = DIGITAL_IO_TIMESTAMP();
+
+	// Third step: IN -> OUT changes
+	while(DIGITAL_IO_CTX_SWITCH_BUFFER.tail_idx != (DIGITAL_MAX_PORT_NUM - 1))
 	{
-		digital_io_switch_buffer.tail_idx ++;
-		USBD_HID_Digital_IO_GPIO_Setup (digital_io_switch_buffer.tail_idx);
+		DIGITAL_IO_CTX_SWITCH_BUFFER.tail_idx ++;
+		USBD_HID_Digital_IO_GPIO_Setup (DIGITAL_IO_CTX_SWITCH_BUFFER.tail_idx);
 	}
 
-	// Third step: set/unset gpio values
 	for (port_idx = 0; port_idx < DIGITAL_MAX_PORT_NUM; port_idx ++)
 	{
-		if(digital_io.ports[port_idx]._changePIN == CHANGED)
-		{
-			for (pin_idx = 0; pin_idx < DIGITAL_MAX_PIN_NUM; pin_idx ++)
-			{
-				GPIO_Write_DIGITAL_IO(port_idx, pin_idx, digital_io.ports[port_idx].pins[pin_idx]);
-			}
-		}
 		// Reset default values
-		digital_io.ports[port_idx]._changePIN = UNCHANGED;
-		digital_io.ports[port_idx]._changeIO = UNCHANGED;
+		DIGITAL_IO_CTX_STATE.ports[port_idx]._changePIN = UNCHANGED;
+		DIGITAL_IO_CTX_STATE.ports[port_idx]._changeIO = UNCHANGED;
 	}
 
 
 
 	// Finish with reset the worn out buffers
-	//USBD_HID_Digital_IO_Init(digital_io_new_state);
+	//USBD_HID_Digital_IO_Init(DIGITAL_IO_CTX_NEW_STATE);
 	//USBD_HID_Digital_IO_Reset_SwitchTrig();
 }
 
@@ -366,12 +468,9 @@ void USBD_HID_Digital_IO_SwitchPorts(void)
   */
 void USBD_HID_Digital_IO_GPIO_Setup (uint8_t idx)
 {
-	GPIO_InitTypeDef GPIO_InitStruct;
-	GPIO_TypeDef* temp_portdef = gpio_digital_port[digital_io_switch_buffer.array[idx]][0];
-	GPIO_InitStruct.Pin = digital_io.ports[digital_io_switch_buffer.array[idx]].gpio_settings.Pin;
-	GPIO_InitStruct.Mode = digital_io.ports[digital_io_switch_buffer.array[idx]].gpio_settings.Mode;
-	GPIO_InitStruct.Pull = digital_io.ports[digital_io_switch_buffer.array[idx]].gpio_settings.Pull;
-	HAL_GPIO_Init(temp_portdef, &GPIO_InitStruct);
+	uint8_t port = DIGITAL_IO_CTX_SWITCH_BUFFER.array[idx];
+	// The pins of a (remapped) port may belong to more banks
+	DIGITAL_IO_HAL_SETUP(port, DIGITAL_IO_CTX_STATE.ports[port].gpio_settings.Mode, DIGITAL_IO_CTX_STATE.ports[port].gpio_settings.Pull);
 }
 
 /**
@@ -384,7 +483,11 @@ void USBD_HID_Digital_IO_Reset_Trigger_Event(HID_DIGITAL_IO_TRIGGER_Event* trig_
 	uint8_t trig_idx = 0;
 	// Initialize trigger event values
 	trig_event->enable = 0;
+	trig_event->armed = 0;
 	trig_event->num_of_ANDs = 0;
+	trig_event->mask = 0;
+	trig_event->value = 0;
+	trig_event->edge_mask = 0;
 	for(trig_idx = 0; trig_idx < LOGICAL_MAX_ELEMENT_NUM; trig_idx++)
 	{
 		trig_event->element[trig_idx].pin_num = 0;
@@ -402,32 +505,62 @@ void USBD_HID_Digital_IO_Process_Trigger_Event(uint8_t* output_buff, HID_DIGITAL
 {
 	/* PROTOCOL:
 	 * Input: 5 bytes
-	 * Byte[0] 		-> (E | IIDD | YY | -) -> E = ENABLE trig event, IIDD = ID of the trig event, YY (+1) = number of AND operator/operators
-	 * Byte[1-3]	-> ( XXX | YYY | V |-) ->XXX = port number (0-5), YYY = pin number (0-3), V = value (0 or 1)
+	 * Byte[0] 		-> (E | IIDD | YY | D) -> E = ENABLE trig event, IIDD = ID of the trig event, YY (+1) = number of AND operator/operators,
+	 *					D = disarmed, only the action of an other trigger arms it
+	 * Byte[1-3]	-> ( XXX | YYY | V | E) ->XXX = port number (0-5), YYY = pin number (0-3), V = value (0 or 1),
+	 *					E = edge element: the pin changed since the previous sample (V is not used)
 	 */
-	uint8_t trig_idx = 0, id = 0, enable = 0, num = 0, port = 0, pin = 0, var = 0;
+	uint8_t trig_idx = 0, id = 0, enable = 0, num = 0, port = 0, pin = 0, var = 0, edge = 0;
+	uint32_t bit = 0;
 
 
 	// Read ID and identificate trigger event descriptor
 	id = read_from_byte(output_buff[0], SIZE_4, SHIFT_1);
+	if (id >= DIGITAL_IO_MAX_TRIG_NUM)
+	{
+		return;
+	}
 
 	// Read EN bit
 	enable = read_from_byte(output_buff[0], SIZE_1, SHIFT_0);
 	t[id].enable = enable;
+	t[id].armed = !read_from_byte(output_buff[0], SIZE_1, SHIFT_7);
 
 	if(t[id].enable)
 	{
 		// Read number of ANDs
 		num = read_from_byte(output_buff[0], SIZE_2, SHIFT_5) + 1;
 		t[id].num_of_ANDs = num;
+		t[id].mask = 0;
+		t[id].value = 0;
+		t[id].edge_mask = 0;
 		for(trig_idx = 0; trig_idx < t[id].num_of_ANDs; trig_idx ++)
 		{
 			port = read_from_byte(output_buff[trig_idx+1], SIZE_3, SHIFT_0);
 			pin = read_from_byte(output_buff[trig_idx+1], SIZE_3, SHIFT_3);
 			var = read_from_byte(output_buff[trig_idx+1], SIZE_1, SHIFT_6);
+			edge = read_from_byte(output_buff[trig_idx+1], SIZE_1, SHIFT_7);
 			t[id].element[trig_idx].port_num = port;
 			t[id].element[trig_idx].pin_num = pin;
 			t[id].element[trig_idx].var_val = var;
+
+			// Precompile the AND of the elements to a mask/value pair of the packed sample
+			if (port < DIGITAL_MAX_PORT_NUM && pin < DIGITAL_MAX_PIN_NUM)
+			{
+				bit = (1UL << DIGITAL_IO_BIT(port, pin));
+				if (edge)
+				{
+					t[id].edge_mask |= bit;
+					continue;
+				}
+				if ((t[id].mask & bit) && ((t[id].value & bit) != (var ? bit : 0)))
+				{
+					// Contradicting elements never fire
+					t[id].enable = 0;
+				}
+				t[id].mask |= bit;
+				t[id].value |= (var ? bit : 0);
+			}
 		}
 	}
 	else
@@ -435,6 +568,11 @@ void USBD_HID_Digital_IO_Process_Trigger_Event(uint8_t* output_buff, HID_DIGITAL
 		// Reset trigger event and disable it
 		USBD_HID_Digital_IO_Reset_Trigger_Event(&t[id]);
 	}
+
+#ifndef DIGITAL_IO_SIMULATION
+	// The compiled triggers are out of date
+	USBD_HID_Digital_IO_Jit_Invalidate();
+#endif
 }
 
 /**
@@ -444,50 +582,777 @@ void USBD_HID_Digital_IO_Process_Trigger_Event(uint8_t* output_buff, HID_DIGITAL
   */
 HID_Digital_IO_Trigger USBD_HID_Digital_IO_Check_Trigger_Event(HID_DIGITAL_IO_TRIGGER_Event* t, uint8_t id)
 {
-	uint8_t trig_idx = 0, port = 0, pin = 0;
-	uint8_t param[4] = {0};
-	uint8_t value[4] = {0};
+	// Check actual trigger contidions (AND of all elements in one compare)
+	if(t[id].enable && t[id].armed && ((DIGITAL_IO_CTX_SAMPLE & t[id].mask) == t[id].value)
+	   && ((DIGITAL_IO_CTX_EDGE & t[id].edge_mask) == t[id].edge_mask))
+	{
+		return TRIGGERED;
+	}
+	return DONTCARE;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Reset_Trigger_Action
+  *         Set the default action of a trigger (TRIGGER_OUT pulse).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Reset_Trigger_Action(HID_DIGITAL_IO_TRIGGER_Event* trig_event)
+{
+	trig_event->action.out_mask = 0;
+	trig_event->action.out_value = 0;
+	trig_event->action.trigger_out = ACTION_OUT_PULSE;
+	trig_event->action.switch_ports = 0;
+	trig_event->action.capture = CAPTURE_NO_REQUEST;
+	trig_event->action.event_report = 0;
+	trig_event->action.arm = 0;
+	USBD_HID_Digital_IO_Compile_Trigger_Action(&trig_event->action);
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Process_Trigger_Action
+  *         Store and compile the action list of a trigger.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Process_Trigger_Action(uint8_t* output_buff, HID_DIGITAL_IO_TRIGGER_Event* t)
+{
+	/* PROTOCOL:
+	 * Input: 10 bytes
+	 * Byte[0]		-> ID of the trig event
+	 * Byte[1]		-> (O | TT | S | CC | R | -) -> O = drive the output pins below, TT = TRIGGER_OUT (0 keep, 1 pulse, 2 set, 3 clear;
+	 *					assert/release of the trigger bus with COMMAND_FABRIC),
+	 *					S = switch to the stored port settings, CC = capture (0 keep, 1 start, 2 stop), R = send an event report
+	 * Byte[2-4]	-> logical bits to drive (port * 4 + pin, little endian)
+	 * Byte[5-7]	-> values of the driven bits
+	 * Byte[8]		-> trig events armed by this one (bit = ID)
+	 * Byte[9]		-> reserved
+	 */
+	HID_DIGITAL_IO_TRIGGER_Action* action = NULL;
+	uint8_t id = output_buff[0], capture = 0;
 
-	// Read parameters to the logical expression
-	for(trig_idx = 0; trig_idx < t[id].num_of_ANDs; trig_idx++)
+	if (id >= DIGITAL_IO_MAX_TRIG_NUM)
 	{
-		value[trig_idx] = t[id].element[trig_idx].var_val;
-		port = t[id].element[trig_idx].port_num;
-		pin = t[id].element[trig_idx].pin_num;
-		param[trig_idx] = digital_io.ports[port].pins[pin];
+		return;
 	}
+	action = &t[id].action;
 
-	// Check actual trigger contidions
-	if(t[id].enable)
+	action->out_mask = 0;
+	action->out_value = 0;
+	if (read_from_byte(output_buff[1], SIZE_1, SHIFT_0))
+	{
+		action->out_mask = (read_uint32(&output_buff[2]) & DIGITAL_IO_ALL_BITS);
+		action->out_value = (read_uint32(&output_buff[5]) & action->out_mask);
+	}
+	action->trigger_out = (HID_Digital_IO_Trigger_Out)read_from_byte(output_buff[1], SIZE_2, SHIFT_1);
+	action->switch_ports = read_from_byte(output_buff[1], SIZE_1, SHIFT_3);
+	capture = read_from_byte(output_buff[1], SIZE_2, SHIFT_4);
+	action->capture = (capture == 1) ? CAPTURE_START : ((capture == 2) ? CAPTURE_STOP : CAPTURE_NO_REQUEST);
+	action->event_report = read_from_byte(output_buff[1], SIZE_1, SHIFT_6);
+	action->arm = output_buff[8] & ((1U << DIGITAL_IO_MAX_TRIG_NUM) - 1U);
+
+	USBD_HID_Digital_IO_Compile_Trigger_Action(action);
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Compile_Trigger_Action
+  *         Convert the action of a trigger to register writes with the active remap.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Compile_Trigger_Action(HID_DIGITAL_IO_TRIGGER_Action* action)
+{
+	DIGITAL_IO_HAL_COMPILE(action->out_mask, action->out_value, action->bsrr);
+
+	switch (action->trigger_out)
 	{
-		switch(t[id].num_of_ANDs)
+		case ACTION_OUT_PULSE:
+		case ACTION_OUT_SET:
+			action->trigger_out_bsrr = DIGITAL_IO_TRIGGER_OUT_ASSERT;
+			break;
+		case ACTION_OUT_CLEAR:
+			action->trigger_out_bsrr = DIGITAL_IO_TRIGGER_OUT_RELEASE;
+			break;
+		default:
+			action->trigger_out_bsrr = 0;
+			break;
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Run_Trigger_Action
+  *         Execute the action of a fired trigger and disarm it.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Run_Trigger_Action(HID_DIGITAL_IO_TRIGGER_Event* t, uint8_t id)
+{
+	HID_DIGITAL_IO_TRIGGER_Action* action = &t[id].action;
+	uint8_t report[DIGITAL_IO_REPORT_SIZE] = {0};
+	uint8_t bank_idx = 0, trig_idx = 0;
+	uint32_t timestamp = DIGITAL_IO_TIMESTAMP();
+
+	t[id].armed = 0;
+
+	// Pin reactions first: only register writes
+	for (bank_idx = 0; bank_idx < GPIO_DIGITAL_BANK_NUM; bank_idx++)
+	{
+		if (action->bsrr[bank_idx] != 0)
 		{
-			case 1:
-				if(param[0] == value[0]) {
-					return TRIGGERED;
-				}
-				break;
-			case 2:
-				if((param[0] == value[0]) && (param[1] == value[1])) {
-					return TRIGGERED;
-				}
-				break;
-			case 3:
-				if((param[0] == value[0]) && (param[1] == value[1]) && (param[2] == value[2])) {
-					return TRIGGERED;
-				}
-				break;
-			case 4:
-				if((param[0] == value[0]) && (param[1] == value[1]) && (param[2] == value[2]) && (param[3] == value[3])) {
-					return TRIGGERED;
-				}
-				break;
-			default:
-				return DONTCARE;
-				break;
+			DIGITAL_IO_HAL_WRITE_BANK(bank_idx, action->bsrr[bank_idx]);
+		}
+	}
+	if (action->trigger_out_bsrr != 0)
+	{
+#ifndef DIGITAL_IO_SIMULATION
+		USBD_HID_Digital_IO_Fabric_Origin(id, action->trigger_out_bsrr);
+#endif
+		DIGITAL_IO_HAL_TRIGGER_OUT(action->trigger_out_bsrr);
+		// The SysTick releases the pulse
+		DIGITAL_IO_CTX_DO_TRIGGER = (action->trigger_out == ACTION_OUT_PULSE) ? DO_TRIGGER : DONTCARE;
+	}
+
+	// Flags for the main loop
+	if (action->switch_ports && DIGITAL_IO_CTX_CHANGE_ENABLE)
+	{
+		DIGITAL_IO_CTX_TRIGGER = TRIGGERED;
+	}
+#ifndef DIGITAL_IO_SIMULATION
+	if (action->capture != CAPTURE_NO_REQUEST)
+	{
+		digital_io_capture.request = (Digital_IO_Capture_Request)action->capture;
+	}
+#endif
+	for (trig_idx = 0; trig_idx < DIGITAL_IO_MAX_TRIG_NUM; trig_idx++)
+	{
+		if (action->arm & (1U << trig_idx))
+		{
+			t[trig_idx].armed = t[trig_idx].enable;
+		}
+	}
+#ifndef DIGITAL_IO_SIMULATION
+	USBD_HID_Digital_IO_Log_Event(id);
+#endif
+
+	if (action->event_report)
+	{
+		/* PROTOCOL:
+		 * Output: 11 bytes
+		 * Byte[0]		-> 0x80 | REPORT_TRIGGER
+		 * Byte[1]		-> ID of the trig event
+		 * Byte[2-5]	-> timestamp (CPU cycles, little endian)
+		 * Byte[6-8]	-> sample which fired the trigger (same format as the state report)
+		 */
+		report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_TRIGGER;
+		report[1] = id;
+		write_uint32(&report[2], timestamp);
+		report[6] = (uint8_t)(DIGITAL_IO_CTX_SAMPLE);
+		report[7] = (uint8_t)(DIGITAL_IO_CTX_SAMPLE >> 8);
+		report[8] = (uint8_t)(DIGITAL_IO_CTX_SAMPLE >> 16);
+		USBD_HID_Digital_IO_Queue_Report(REPORT_CLASS_URGENT, report);
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Queue_Report
+  *         Store an input report in the queue of its class.
+  * @retval 1 if stored, 0 if the queue is full
+  */
+uint8_t USBD_HID_Digital_IO_Queue_Report(HID_Digital_IO_Report_Class report_class, const uint8_t* report)
+{
+	DIGITAL_IO_REPORT_Queue* queue = &DIGITAL_IO_CTX_REPORT_QUEUE[report_class];
+	uint32_t primask = 0;
+	uint8_t head = 0, next = 0, idx = 0;
+
+	// Producers in the main loop and in the USB interrupt
+	DIGITAL_IO_CRITICAL_ENTER(primask);
+	head = queue->head;
+	next = (head + 1) % DIGITAL_IO_EVENT_QUEUE_SIZE;
+	if (next == queue->tail)
+	{
+		queue->lost++;
+		DIGITAL_IO_CRITICAL_EXIT(primask);
+		return 0;
+	}
+	for (idx = 0; idx < DIGITAL_IO_REPORT_SIZE; idx++)
+	{
+		queue->report[head][idx] = report[idx];
+	}
+	queue->head = next;
+	DIGITAL_IO_CRITICAL_EXIT(primask);
+	return 1;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Report_Count
+  *         Number of queued reports of a class.
+  * @retval Queued reports
+  */
+uint8_t USBD_HID_Digital_IO_Report_Count(HID_Digital_IO_Report_Class report_class)
+{
+	DIGITAL_IO_REPORT_Queue* queue = &DIGITAL_IO_CTX_REPORT_QUEUE[report_class];
+
+	return (queue->head + DIGITAL_IO_EVENT_QUEUE_SIZE - queue->tail) % DIGITAL_IO_EVENT_QUEUE_SIZE;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Next_Report
+  *         Take the next report to send: highest class first, aged lower classes before it.
+  * @retval Report (valid until the IN transfer completes), NULL if all queues are empty
+  */
+uint8_t* USBD_HID_Digital_IO_Next_Report(uint16_t* length)
+{
+	/* Called by the DataIn completion (USB interrupt) and by the main loop while the
+	 * IN endpoint is idle (interrupts masked). An urgent report waits at most for the
+	 * transfer in progress and one aged report of each lower class.
+	 */
+	static const uint8_t age_limit[REPORT_CLASS_NUM] = {0, DIGITAL_IO_ACK_AGE_LIMIT, DIGITAL_IO_BULK_AGE_LIMIT};
+	DIGITAL_IO_REPORT_Queue* queue = NULL;
+	uint8_t report_class = 0, select = REPORT_CLASS_NUM, idx = 0;
+
+	for (report_class = 0; report_class < REPORT_CLASS_NUM; report_class++)
+	{
+		queue = &DIGITAL_IO_CTX_REPORT_QUEUE[report_class];
+		if (queue->tail == queue->head)
+		{
+			continue;
+		}
+		if (select == REPORT_CLASS_NUM)
+		{
+			select = report_class;
+		}
+		else if (queue->age >= age_limit[report_class])
+		{
+			select = report_class;
+			break;
+		}
+	}
+	if (select == REPORT_CLASS_NUM)
+	{
+		return NULL;
+	}
+
+	// The waiting lower classes age
+	for (report_class = select + 1; report_class < REPORT_CLASS_NUM; report_class++)
+	{
+		queue = &DIGITAL_IO_CTX_REPORT_QUEUE[report_class];
+		if (queue->tail != queue->head && queue->age < 0xFF)
+		{
+			queue->age++;
+		}
+	}
+
+	queue = &DIGITAL_IO_CTX_REPORT_QUEUE[select];
+	queue->age = 0;
+	for (idx = 0; idx < DIGITAL_IO_REPORT_SIZE; idx++)
+	{
+		DIGITAL_IO_CTX_REPORT_TX[idx] = queue->report[queue->tail][idx];
+	}
+	queue->tail = (queue->tail + 1) % DIGITAL_IO_EVENT_QUEUE_SIZE;
+	*length = DIGITAL_IO_REPORT_SIZE;
+	return DIGITAL_IO_CTX_REPORT_TX;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Ack
+  *         Queue the acknowledgement of an output report.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Ack(uint8_t command, uint8_t sequence, HID_Digital_IO_Ack_Status status, uint32_t receive_tick, uint32_t apply_tick)
+{
+	DIGITAL_IO_REPORT_Queue* queue = &DIGITAL_IO_CTX_REPORT_QUEUE[REPORT_CLASS_ACK];
+	uint8_t report[DIGITAL_IO_REPORT_SIZE] = {0};
+	uint32_t delay = 0, lost = 0, primask = 0;
+
+	/* PROTOCOL:
+	 * Output: 11 bytes, one per output report, a second one (ACK_APPLIED) after the port switch of LENGTH_TRIGGER
+	 * Byte[0]		-> 0x80 | REPORT_ACK
+	 * Byte[1]		-> sequence number (last byte of the output report)
+	 * Byte[2]		-> length or command code of the output report
+	 * Byte[3]		-> (LLLL | SSSS) -> S = status (HID_Digital_IO_Ack_Status),
+	 *				   L = ack class reports lost since the previous ack (saturated)
+	 * Byte[4-7]	-> receive timestamp (CPU cycles, little endian)
+	 * Byte[8-10]	-> ACK_APPLIED: CPU cycles from the reception to the register writes (little endian, saturated)
+	 */
+	if (status == ACK_APPLIED)
+	{
+		delay = MIN(apply_tick - receive_tick, 0x00FFFFFFU);
+	}
+	report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_ACK;
+	report[1] = sequence;
+	report[2] = command;
+	write_uint32(&report[4], receive_tick);
+	report[8] = (uint8_t)(delay);
+	report[9] = (uint8_t)(delay >> 8);
+	report[10] = (uint8_t)(delay >> 16);
+
+	// The loss count is taken back only if this ack is queued
+	DIGITAL_IO_CRITICAL_ENTER(primask);
+	lost = MIN(queue->lost, 0x0FU);
+	report[3] = (uint8_t)(status | (lost << 4));
+	if (USBD_HID_Digital_IO_Queue_Report(REPORT_CLASS_ACK, report))
+	{
+		queue->lost -= lost;
+	}
+	DIGITAL_IO_CRITICAL_EXIT(primask);
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Ack_Room
+  *         Room for the acks of the next output report.
+  * @retval 1 = the OUT endpoint may accept the next report, 0 = keep it NAKing
+  */
+uint8_t USBD_HID_Digital_IO_Ack_Room(void)
+{
+	return (DIGITAL_IO_EVENT_QUEUE_SIZE - 1U - USBD_HID_Digital_IO_Report_Count(REPORT_CLASS_ACK)) >= DIGITAL_IO_ACK_RESERVE;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Process_Command
+  *         Dispatch a command report (first byte >= COMMAND_FIRST).
+  * @retval ACK_ACCEPTED, ACK_UNKNOWN for an unknown command code
+  */
+HID_Digital_IO_Ack_Status USBD_HID_Digital_IO_Process_Command(uint8_t command, uint8_t* output_buff)
+{
+	switch (command)
+	{
+		case COMMAND_PIN_REMAP:
+			USBD_HID_Digital_IO_Process_Remap(output_buff);
+			break;
+		case COMMAND_UPLOAD:
+			USBD_HID_Digital_IO_Process_Upload(output_buff);
+			break;
+		case COMMAND_TRIGGER_ACTION:
+			USBD_HID_Digital_IO_Process_Trigger_Action(output_buff, DIGITAL_IO_CTX_TRIG_EVENTS);
+			break;
+		case COMMAND_DOWNLOAD:
+			USBD_HID_Digital_IO_Process_Download(output_buff);
+			break;
+		case COMMAND_OVERSAMPLING:
+			// Byte[0] -> number of snapshots per sample (1 = no filtering)
+			if (output_buff[0] >= 1 && output_buff[0] <= DIGITAL_IO_MAX_OVERSAMPLING)
+			{
+				DIGITAL_IO_CTX_OVERSAMPLING = output_buff[0];
+			}
+			break;
+#ifndef DIGITAL_IO_SIMULATION
+		// Feature modules: peripherals of the target, not simulated
+		case COMMAND_CAPTURE_CONFIG:
+		case COMMAND_CAPTURE_CONTROL:
+			USBD_HID_Digital_IO_Capture_Process_Command(command, output_buff);
+			break;
+		case COMMAND_LOG:
+			USBD_HID_Digital_IO_Log_Process_Command(output_buff);
+			break;
+		case COMMAND_INTERCONNECT_TEST:
+			USBD_HID_Digital_IO_Test_Process_Command(output_buff);
+			break;
+		case COMMAND_LATENCY:
+			USBD_HID_Digital_IO_Latency_Process_Command(output_buff);
+			break;
+		case COMMAND_BUS_CONFIG:
+		case COMMAND_BUS_RUN:
+			USBD_HID_Digital_IO_Bus_Process_Command(command, output_buff);
+			break;
+		case COMMAND_WATCH:
+			USBD_HID_Digital_IO_Watch_Process_Command(output_buff);
+			break;
+		case COMMAND_DECODER:
+			USBD_HID_Digital_IO_Decoder_Process_Command(output_buff);
+			break;
+		case COMMAND_GROUP_CONFIG:
+		case COMMAND_GROUP_WRITE:
+			USBD_HID_Digital_IO_Group_Process_Command(command, output_buff);
+			break;
+		case COMMAND_TRIGGER_BENCH:
+			USBD_HID_Digital_IO_Jit_Process_Command(output_buff);
+			break;
+		case COMMAND_SEARCH:
+			USBD_HID_Digital_IO_Search_Process_Command(output_buff);
+			break;
+		case COMMAND_STIMULUS_CONFIG:
+		case COMMAND_STIMULUS_RUN:
+			USBD_HID_Digital_IO_Stimulus_Process_Command(command, output_buff);
+			break;
+		case COMMAND_FABRIC:
+			USBD_HID_Digital_IO_Fabric_Process_Command(output_buff);
+			break;
+#endif
+		default:
+			return ACK_UNKNOWN;
+	}
+	return ACK_ACCEPTED;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Process_Remap
+  *         Store a part of the logical -> physical pin remap table.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Process_Remap(uint8_t* output_buff)
+{
+	/* PROTOCOL:
+	 * Input: 10 bytes
+	 * Byte[0]		-> (SSSSS | -- | A) -> SSSSS = first logical bit (port * 4 + pin), A = apply the table after this part
+	 * Byte[1]		-> number of entries in this part (0-8)
+	 * Byte[2-9]	-> physical bit (physical port * 4 + pin) of the logical bits from SSSSS
+	 */
+	uint8_t idx = 0, start = 0, num = 0;
+
+	start = read_from_byte(output_buff[0], SIZE_5, SHIFT_0);
+	num = output_buff[1];
+
+	for (idx = 0; idx < num && idx < DIGITAL_IO_REMAP_MAX_ENTRY && (start + idx) < DIGITAL_IO_MAX_BIT_NUM; idx++)
+	{
+		DIGITAL_IO_CTX_REMAP_NEW[start + idx] = output_buff[idx + 2];
+	}
+
+	// The tables are rebuilt in the main loop, not in the USB interrupt
+	if (read_from_byte(output_buff[0], SIZE_1, SHIFT_7))
+	{
+		DIGITAL_IO_CTX_REMAP_FLAG = CHANGED;
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Process_Upload
+  *         Select the target and the start offset of the next feature report uploads.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Process_Upload(uint8_t* output_buff)
+{
+	/* PROTOCOL:
+	 * Input: 5 bytes
+	 * Byte[0]		-> target (HID_Digital_IO_Upload_Target)
+	 * Byte[1-4]	-> byte offset in the target (little endian)
+	 *
+	 * The following SET_REPORT (feature) control transfers are received straight into the
+	 * target from the offset, each transfer continues where the previous one ended.
+	 * A transfer may be shorter than the declared DIGITAL_IO_UPLOAD_REPORT_SIZE, it is refused
+	 * (stall) when it does not fit in the rest of the target or the target is busy: the last
+	 * chunk carries exactly the remaining bytes, no padding.
+	 * A capture, bus batch or stimulus playback requested during the data stage of a transfer
+	 * into its buffer starts once the transfer is complete.
+	 * UPLOAD_PIN_REMAP stages the table like COMMAND_PIN_REMAP (apply with the A bit).
+	 */
+	DIGITAL_IO_CTX_UPLOAD.target = (HID_Digital_IO_Upload_Target)output_buff[0];
+	DIGITAL_IO_CTX_UPLOAD.offset = read_uint32(&output_buff[1]);
+	DIGITAL_IO_CTX_UPLOAD.received = 0;
+	DIGITAL_IO_CTX_UPLOAD.pending = 0;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Upload_Target
+  *         Selected upload target, only while nothing else writes or reads it.
+  * @retval Target, NULL if none is selected or it is busy
+  */
+static uint8_t* USBD_HID_Digital_IO_Upload_Target(uint32_t* size)
+{
+	uint8_t* buffer = NULL;
+
+	*size = 0;
+	switch (DIGITAL_IO_CTX_UPLOAD.target)
+	{
+		case UPLOAD_PIN_REMAP:
+			buffer = DIGITAL_IO_CTX_REMAP_NEW;
+			*size = sizeof(DIGITAL_IO_CTX_REMAP_NEW);
+			break;
+#ifndef DIGITAL_IO_SIMULATION
+		case UPLOAD_CAPTURE_BUFFER:
+			// The records are written by the DMA interrupt while the capture runs
+			if (digital_io_capture.state == CAPTURE_IDLE)
+			{
+				buffer = (uint8_t*)digital_io_capture_buffer;
+				*size = sizeof(digital_io_capture_buffer);
+			}
+			break;
+		case UPLOAD_BUS:
+			// The main loop reads and writes the cycles during a batch
+			if (digital_io_bus.state == BUS_IDLE)
+			{
+				buffer = digital_io_bus_buffer;
+				*size = sizeof(digital_io_bus_buffer);
+			}
+			break;
+		case UPLOAD_STIMULUS:
+			// The main loop reads the program during the playback
+			if (digital_io_stimulus.state == STIMULUS_IDLE)
+			{
+				buffer = (uint8_t*)digital_io_stimulus_buffer;
+				*size = sizeof(digital_io_stimulus_buffer);
+			}
+			break;
+#endif
+		default:
+			break;
+	}
+	return buffer;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Upload_Buffer
+  *         Destination of a feature report upload (USB interrupt, SET_REPORT setup stage).
+  * @retval Position in the target, NULL if the target is busy or the data does not fit
+  */
+uint8_t* USBD_HID_Digital_IO_Upload_Buffer(uint16_t length)
+{
+	uint32_t size = 0;
+	uint8_t* buffer = USBD_HID_Digital_IO_Upload_Target(&size);
+
+	// A new setup stage ends an aborted data stage
+	DIGITAL_IO_CTX_UPLOAD.pending = 0;
+	if (buffer == NULL || length == 0 || length > DIGITAL_IO_UPLOAD_REPORT_SIZE
+		|| DIGITAL_IO_CTX_UPLOAD.offset >= size || length > size - DIGITAL_IO_CTX_UPLOAD.offset)
+	{
+		return NULL;
+	}
+	// The data stage writes the target directly: its user waits until it is complete
+	DIGITAL_IO_CTX_UPLOAD.pending = length;
+	return &buffer[DIGITAL_IO_CTX_UPLOAD.offset];
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Upload_Complete
+  *         Advance the upload offset after a received feature report.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Upload_Complete(uint16_t length)
+{
+	if (DIGITAL_IO_CTX_UPLOAD.pending == 0)
+	{
+		return;
+	}
+	length = MIN(length, DIGITAL_IO_CTX_UPLOAD.pending);
+	DIGITAL_IO_CTX_UPLOAD.offset += length;
+	DIGITAL_IO_CTX_UPLOAD.received += length;
+	DIGITAL_IO_CTX_UPLOAD.pending = 0;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Upload_Pending
+  *         A feature report is being received into the target.
+  * @retval 1 during the data stage of an upload into the target, 0 otherwise
+  */
+uint8_t USBD_HID_Digital_IO_Upload_Pending(HID_Digital_IO_Upload_Target target)
+{
+	return DIGITAL_IO_CTX_UPLOAD.pending != 0 && DIGITAL_IO_CTX_UPLOAD.target == target;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Process_Download
+  *         Select the source and the start offset of the next feature report reads.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Process_Download(uint8_t* output_buff)
+{
+	/* PROTOCOL:
+	 * Input: 5 bytes
+	 * Byte[0]		-> source (HID_Digital_IO_Upload_Target)
+	 * Byte[1-4]	-> byte offset in the source (little endian)
+	 *
+	 * The following GET_REPORT (feature) control transfers are sent straight from
+	 * the source (no copy), each transfer continues where the previous one ended.
+	 * UPLOAD_LOG reads the flash log sectors (DIGITAL_IO_LOG_BASE).
+	 */
+	DIGITAL_IO_CTX_DOWNLOAD.target = (HID_Digital_IO_Upload_Target)output_buff[0];
+	DIGITAL_IO_CTX_DOWNLOAD.offset = read_uint32(&output_buff[1]);
+	DIGITAL_IO_CTX_DOWNLOAD.received = 0;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Download_Buffer
+  *         Source of a feature report read (USB interrupt, GET_REPORT setup stage).
+  * @retval Pointer into the selected source, NULL if nothing is left
+  */
+uint8_t* USBD_HID_Digital_IO_Download_Buffer(uint16_t* length)
+{
+	uint8_t* buffer = NULL;
+	uint32_t size = 0;
+
+	switch (DIGITAL_IO_CTX_DOWNLOAD.target)
+	{
+		case UPLOAD_PIN_REMAP:
+			buffer = DIGITAL_IO_CTX_REMAP;
+			size = sizeof(DIGITAL_IO_CTX_REMAP);
+			break;
+#ifndef DIGITAL_IO_SIMULATION
+		case UPLOAD_CAPTURE_BUFFER:
+			buffer = (uint8_t*)digital_io_capture_buffer;
+			size = sizeof(digital_io_capture_buffer);
+			break;
+		case UPLOAD_LOG:
+			buffer = (uint8_t*)DIGITAL_IO_LOG_BASE;
+			size = DIGITAL_IO_LOG_SIZE;
+			break;
+		case UPLOAD_INTERCONNECT:
+			// Row n: tested pins connected to logical bit n
+			buffer = (uint8_t*)digital_io_test.matrix;
+			size = sizeof(digital_io_test.matrix);
+			break;
+		case UPLOAD_BUS:
+			buffer = digital_io_bus_buffer;
+			size = sizeof(digital_io_bus_buffer);
+			break;
+		case UPLOAD_STIMULUS:
+			buffer = (uint8_t*)digital_io_stimulus_buffer;
+			size = sizeof(digital_io_stimulus_buffer);
+			break;
+#endif
+		default:
+			break;
+	}
+
+	if (buffer == NULL || *length == 0 || DIGITAL_IO_CTX_DOWNLOAD.offset >= size)
+	{
+		return NULL;
+	}
+	*length = MIN(*length, size - DIGITAL_IO_CTX_DOWNLOAD.offset);
+	buffer = &buffer[DIGITAL_IO_CTX_DOWNLOAD.offset];
+	DIGITAL_IO_CTX_DOWNLOAD.offset += *length;
+	DIGITAL_IO_CTX_DOWNLOAD.received += *length;
+	return buffer;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Apply_Remap
+  *         Activate the uploaded remap table, all ports fall back to default inputs.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Apply_Remap(void)
+{
+	uint8_t port_idx = 0;
+
+	if (USBD_HID_Digital_IO_Check_Remap(DIGITAL_IO_CTX_REMAP_NEW))
+	{
+		// Release every pin before the wiring changes (avoid to connecting two outputs together)
+		for (port_idx = 0; port_idx < DIGITAL_MAX_PORT_NUM; port_idx++)
+		{
+			DIGITAL_IO_HAL_SETUP(port_idx, GPIO_MODE_INPUT, GPIO_PULLDOWN);
+		}
+		for (port_idx = 0; port_idx < DIGITAL_IO_MAX_BIT_NUM; port_idx++)
+		{
+			DIGITAL_IO_CTX_REMAP[port_idx] = DIGITAL_IO_CTX_REMAP_NEW[port_idx];
+		}
+		DIGITAL_IO_HAL_REMAP(DIGITAL_IO_CTX_REMAP);
+
+		// Pending settings refer to the old wiring
+		USBD_HID_Digital_IO_Init(&DIGITAL_IO_CTX_STATE);
+		USBD_HID_Digital_IO_Init(&DIGITAL_IO_CTX_NEW_STATE);
+		USBD_HID_Digital_IO_Reset_SwitchTrig();
+		DIGITAL_IO_CTX_CHANGE_ENABLE = 0;
+
+		// Output actions address logical bits, the pins behind them changed
+		for (port_idx = 0; port_idx < DIGITAL_IO_MAX_TRIG_NUM; port_idx++)
+		{
+			USBD_HID_Digital_IO_Compile_Trigger_Action(&DIGITAL_IO_CTX_TRIG_EVENTS[port_idx].action);
+		}
+
+		// Bits of the old sample belong to other pins, restart the edge detection
+		DIGITAL_IO_CTX_SAMPLE = DIGITAL_IO_HAL_READ();
+		DIGITAL_IO_CTX_EDGE = 0;
+		DIGITAL_IO_CTX_EDGE_REPORT = 0;
+
+#ifndef DIGITAL_IO_SIMULATION
+		// The EXTI lines moved: allocate them to the watched pins again
+		if (!digital_io_watch.request)
+		{
+			digital_io_watch.mask_new = digital_io_watch.mask;
+			digital_io_watch.request = 1;
+		}
+
+		// The timer decoder depends on the wiring: set up the decoders again (counts restart)
+		digital_io_decoder.request = (1U << DIGITAL_IO_DECODER_NUM) - 1U;
+
+		// Group bits stay, their pins moved
+		USBD_HID_Digital_IO_Group_Remap();
+#endif
+	}
+	else
+	{
+		// Not a permutation: keep the active table
+		for (port_idx = 0; port_idx < DIGITAL_IO_MAX_BIT_NUM; port_idx++)
+		{
+			DIGITAL_IO_CTX_REMAP_NEW[port_idx] = DIGITAL_IO_CTX_REMAP[port_idx];
 		}
 	}
-	return DONTCARE;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Check_Remap
+  *         Check that a remap table is a permutation of the physical pins.
+  * @retval 1 if every physical pin is used exactly once, 0 otherwise
+  */
+uint8_t USBD_HID_Digital_IO_Check_Remap(const uint8_t* remap)
+{
+	uint32_t used = 0;
+	uint8_t bit_idx = 0;
+
+	for (bit_idx = 0; bit_idx < DIGITAL_IO_MAX_BIT_NUM; bit_idx++)
+	{
+		if (remap[bit_idx] >= DIGITAL_IO_MAX_BIT_NUM || (used & (1UL << remap[bit_idx])))
+		{
+			return 0;
+		}
+		used |= (1UL << remap[bit_idx]);
+	}
+	return 1;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Majority
+  *         Bitwise majority vote of packed samples.
+  * @retval Packed sample
+  */
+uint32_t USBD_HID_Digital_IO_Majority(const uint32_t* samples, uint8_t num)
+{
+	uint32_t count[4] = {0}, carry = 0, temp = 0, greater = 0, equal = 0xFFFFFFFFUL;
+	uint8_t idx = 0, bit_idx = 0, limit = num / 2;
+
+	if (num == 1)
+	{
+		return samples[0];
+	}
+	if (num == 3)
+	{
+		return (samples[0] & samples[1]) | (samples[0] & samples[2]) | (samples[1] & samples[2]);
+	}
+
+	// Bit-sliced counters: count[3..0] hold the number of ones of every pin
+	for (idx = 0; idx < num; idx++)
+	{
+		carry = samples[idx];
+		for (bit_idx = 0; bit_idx < 4; bit_idx++)
+		{
+			temp = count[bit_idx] & carry;
+			count[bit_idx] ^= carry;
+			carry = temp;
+		}
+	}
+
+	// count > limit, compared from the most significant counter bit
+	for (bit_idx = 4; bit_idx-- > 0;)
+	{
+		if (limit & (1U << bit_idx))
+		{
+			equal &= count[bit_idx];
+		}
+		else
+		{
+			greater |= equal & count[bit_idx];
+			equal &= ~count[bit_idx];
+		}
+	}
+	return greater;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Timebase_Init
+  *         Start the cycle counter used for the device timestamps.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Timebase_Init(void)
+{
+#ifndef DIGITAL_IO_SIMULATION
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
 }
 
 uint8_t create_mask(uint8_t num)
@@ -509,4 +1374,18 @@ uint8_t read_from_byte(uint8_t buffer, INTERVAL_Size size, SHIFT_Num shift)
 	uint8_t val2 = val1 >> shift;
 	return val2;
 }
+
+uint32_t read_uint32(const uint8_t* buffer)
+{
+	// Little endian, like every multi-byte field of the reports
+	return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
+void write_uint32(uint8_t* buffer, uint32_t value)
+{
+	buffer[0] = (uint8_t)(value);
+	buffer[1] = (uint8_t)(value >> 8);
+	buffer[2] = (uint8_t)(value >> 16);
+	buffer[3] = (uint8_t)(value >> 24);
+}
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,271 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_bus.c
+  * @brief   This file provides the parallel bus master cycles.
+  *
+  * @verbatim
+  *
+  *          ===================================================================
+  *                                Bus Description
+  *          ===================================================================
+  *           The host gives every logical bit a role (address, data, write
+  *           strobe, read strobe) and the timing, uploads a batch of cycles
+  *           (UPLOAD_BUS) and starts it. Every cycle is a few BSRR writes:
+  *             - write: address and data, setup, strobe pulse, hold
+  *             - read: address with the data pins as inputs, setup, strobe
+  *               pulse, the data is latched right before the trailing strobe
+  *               edge, hold
+  *           The latched bytes replace the data of the read cycles, the host
+  *           reads the whole batch back with COMMAND_DOWNLOAD (UPLOAD_BUS).
+  *           The address/data bits are the set bits of their masks, lowest
+  *           logical bit first; the tables are built by the config command.
+  *
+  *  @endverbatim
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_digital_io_bus.h"
+
+/* Global variables */
+DIGITAL_IO_BUS_TypeDef digital_io_bus;
+uint8_t digital_io_bus_buffer[DIGITAL_IO_BUS_BUFFER_SIZE];
+
+/* Private functions */
+static uint32_t USBD_HID_Digital_IO_Bus_Deposit(uint32_t mask, uint32_t value);
+static void USBD_HID_Digital_IO_Bus_Write_Banks(const uint32_t* bsrr);
+static void USBD_HID_Digital_IO_Bus_Wait(uint32_t start, uint32_t cycles);
+
+/* Functions */
+
+/**
+  * @brief  USBD_HID_Digital_IO_Bus_Process_Command
+  *         Store the pin roles and timing of the bus, or request a batch run.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Bus_Process_Command(uint8_t command, uint8_t* output_buff)
+{
+	/* PROTOCOL:
+	 * COMMAND_BUS_CONFIG: 10 bytes
+	 * Byte[0-2]	-> address bits (logical bits, little endian, first 16 set bits)
+	 * Byte[3-5]	-> data bits (first 8 set bits)
+	 * Byte[6]		-> (P | -- | WWWWW) -> WWWWW = write strobe bit, P = active strobe level
+	 * Byte[7]		-> (--- | RRRRR) -> RRRRR = read strobe bit
+	 * Byte[8]		-> (SSSS | HHHH) -> setup and hold time (DIGITAL_IO_BUS_TIME_UNIT)
+	 * Byte[9]		-> strobe pulse width (DIGITAL_IO_BUS_TIME_UNIT)
+	 *
+	 * COMMAND_BUS_RUN: 2 bytes (executed in the main loop)
+	 * Byte[0-1]	-> number of cycles in the uploaded batch (little endian)
+	 *
+	 * Result: REPORT_BUS, the batch with the read data is read with COMMAND_DOWNLOAD (UPLOAD_BUS).
+	 */
+	uint32_t mask = 0;
+	uint16_t value = 0, lane = 0, bit = 0;
+
+	if (digital_io_bus.state != BUS_IDLE)
+	{
+		return;
+	}
+
+	if (command == COMMAND_BUS_RUN)
+	{
+		digital_io_bus.cycles = MIN((uint32_t)(output_buff[0] | ((uint16_t)output_buff[1] << 8)), (uint32_t)DIGITAL_IO_BUS_MAX_CYCLES);
+		digital_io_bus.state = BUS_RUN;
+		return;
+	}
+
+	// Limit the masks to the first 16 address and 8 data bits
+	mask = (output_buff[0] | ((uint32_t)output_buff[1] << 8) | ((uint32_t)output_buff[2] << 16)) & DIGITAL_IO_ALL_BITS;
+	digital_io_bus.address_mask = USBD_HID_Digital_IO_Bus_Deposit(mask, (1UL << DIGITAL_IO_BUS_ADDRESS_BITS) - 1U);
+	mask = (output_buff[3] | ((uint32_t)output_buff[4] << 8) | ((uint32_t)output_buff[5] << 16)) & DIGITAL_IO_ALL_BITS;
+	digital_io_bus.data_mask = USBD_HID_Digital_IO_Bus_Deposit(mask, (1UL << DIGITAL_IO_BUS_DATA_BITS) - 1U);
+	digital_io_bus.write_strobe = read_from_byte(output_buff[6], SIZE_5, SHIFT_0) % DIGITAL_IO_MAX_BIT_NUM;
+	digital_io_bus.strobe_level = read_from_byte(output_buff[6], SIZE_1, SHIFT_7);
+	digital_io_bus.read_strobe = read_from_byte(output_buff[7], SIZE_5, SHIFT_0) % DIGITAL_IO_MAX_BIT_NUM;
+	digital_io_bus.setup = read_from_byte(output_buff[8], SIZE_4, SHIFT_4) * DIGITAL_IO_BUS_TIME_UNIT;
+	digital_io_bus.hold = read_from_byte(output_buff[8], SIZE_4, SHIFT_0) * DIGITAL_IO_BUS_TIME_UNIT;
+	digital_io_bus.pulse = output_buff[9] * DIGITAL_IO_BUS_TIME_UNIT;
+
+	// Byte -> packed logical bits, packed logical bits -> data byte
+	for (value = 0; value < GPIO_DIGITAL_LANE_SIZE; value++)
+	{
+		digital_io_bus.address_scatter[0][value] = USBD_HID_Digital_IO_Bus_Deposit(digital_io_bus.address_mask, value);
+		digital_io_bus.address_scatter[1][value] = USBD_HID_Digital_IO_Bus_Deposit(digital_io_bus.address_mask, (uint32_t)value << 8);
+		digital_io_bus.data_scatter[value] = USBD_HID_Digital_IO_Bus_Deposit(digital_io_bus.data_mask, value);
+	}
+	for (lane = 0; lane < GPIO_DIGITAL_BIT_LANE_NUM; lane++)
+	{
+		for (value = 0; value < GPIO_DIGITAL_LANE_SIZE; value++)
+		{
+			digital_io_bus.data_gather[lane][value] = 0;
+			for (bit = 0; bit < DIGITAL_IO_BUS_DATA_BITS; bit++)
+			{
+				if (GPIO_DIGITAL_LANE(digital_io_bus.data_scatter[1U << bit], lane) & value)
+				{
+					digital_io_bus.data_gather[lane][value] |= (1U << bit);
+				}
+			}
+		}
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Bus_Run
+  *         Execute the uploaded batch of bus cycles and queue the result report (main loop).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Bus_Run(void)
+{
+	uint32_t write_active[GPIO_DIGITAL_BANK_NUM], write_idle[GPIO_DIGITAL_BANK_NUM];
+	uint32_t read_active[GPIO_DIGITAL_BANK_NUM], read_idle[GPIO_DIGITAL_BANK_NUM], bsrr[GPIO_DIGITAL_BANK_NUM];
+	uint32_t write = 1U << digital_io_bus.write_strobe, read = 1U << digital_io_bus.read_strobe;
+	uint32_t strobes = write | read, idle = digital_io_bus.strobe_level ? 0 : strobes;
+	uint32_t bus = digital_io_bus.address_mask | digital_io_bus.data_mask, packed = 0, start = 0, begin = 0;
+	uint8_t report[DIGITAL_IO_REPORT_SIZE] = {0};
+	uint8_t* cycle = digital_io_bus_buffer;
+	uint8_t data_output = 0;
+	uint16_t idx = 0;
+
+	// Strobe writes, the strobes idle before the address pins become outputs
+	GPIO_Compile_Packed_DIGITAL_IO(write, ~idle, write_active);
+	GPIO_Compile_Packed_DIGITAL_IO(write, idle, write_idle);
+	GPIO_Compile_Packed_DIGITAL_IO(read, ~idle, read_active);
+	GPIO_Compile_Packed_DIGITAL_IO(read, idle, read_idle);
+	GPIO_Write_Packed_DIGITAL_IO(strobes, idle);
+	GPIO_Config_Packed_DIGITAL_IO(strobes | digital_io_bus.address_mask, GPIO_MODE_OUTPUT_PP, GPIO_NOPULL);
+	GPIO_Config_Packed_DIGITAL_IO(digital_io_bus.data_mask, GPIO_MODE_INPUT, GPIO_NOPULL);
+
+	begin = DIGITAL_IO_TIMESTAMP();
+	for (idx = 0; idx < digital_io_bus.cycles; idx++, cycle += DIGITAL_IO_BUS_CYCLE_SIZE)
+	{
+		packed = digital_io_bus.address_scatter[0][cycle[1]] | digital_io_bus.address_scatter[1][cycle[2]];
+		if (cycle[0] & DIGITAL_IO_BUS_CYCLE_READ)
+		{
+			if (data_output)
+			{
+				GPIO_Config_Packed_DIGITAL_IO(digital_io_bus.data_mask, GPIO_MODE_INPUT, GPIO_NOPULL);
+				data_output = 0;
+			}
+			GPIO_Compile_Packed_DIGITAL_IO(digital_io_bus.address_mask, packed, bsrr);
+			start = DIGITAL_IO_TIMESTAMP();
+			USBD_HID_Digital_IO_Bus_Write_Banks(bsrr);
+			USBD_HID_Digital_IO_Bus_Wait(start, digital_io_bus.setup);
+
+			start = DIGITAL_IO_TIMESTAMP();
+			USBD_HID_Digital_IO_Bus_Write_Banks(read_active);
+			USBD_HID_Digital_IO_Bus_Wait(start, digital_io_bus.pulse);
+			// Latch on the trailing strobe edge
+			packed = GPIO_Read_Packed_DIGITAL_IO();
+			start = DIGITAL_IO_TIMESTAMP();
+			USBD_HID_Digital_IO_Bus_Write_Banks(read_idle);
+			cycle[3] = digital_io_bus.data_gather[0][GPIO_DIGITAL_LANE(packed, 0)]
+					 | digital_io_bus.data_gather[1][GPIO_DIGITAL_LANE(packed, 1)]
+					 | digital_io_bus.data_gather[2][GPIO_DIGITAL_LANE(packed, 2)];
+		}
+		else
+		{
+			packed |= digital_io_bus.data_scatter[cycle[3]];
+			GPIO_Compile_Packed_DIGITAL_IO(bus, packed, bsrr);
+			start = DIGITAL_IO_TIMESTAMP();
+			USBD_HID_Digital_IO_Bus_Write_Banks(bsrr);
+			if (!data_output)
+			{
+				GPIO_Config_Packed_DIGITAL_IO(digital_io_bus.data_mask, GPIO_MODE_OUTPUT_PP, GPIO_NOPULL);
+				data_output = 1;
+			}
+			USBD_HID_Digital_IO_Bus_Wait(start, digital_io_bus.setup);
+
+			start = DIGITAL_IO_TIMESTAMP();
+			USBD_HID_Digital_IO_Bus_Write_Banks(write_active);
+			USBD_HID_Digital_IO_Bus_Wait(start, digital_io_bus.pulse);
+			start = DIGITAL_IO_TIMESTAMP();
+			USBD_HID_Digital_IO_Bus_Write_Banks(write_idle);
+		}
+		USBD_HID_Digital_IO_Bus_Wait(start, digital_io_bus.hold);
+	}
+
+	// Release the data pins
+	GPIO_Config_Packed_DIGITAL_IO(digital_io_bus.data_mask, GPIO_MODE_INPUT, GPIO_NOPULL);
+
+	/* PROTOCOL:
+	 * Output: 11 bytes
+	 * Byte[0]		-> 0x80 | REPORT_BUS
+	 * Byte[1-2]	-> executed cycles (little endian)
+	 * Byte[3-6]	-> duration of the batch (CPU cycles, little endian)
+	 */
+	report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_BUS;
+	report[1] = (uint8_t)(idx);
+	report[2] = (uint8_t)(idx >> 8);
+	write_uint32(&report[3], DIGITAL_IO_TIMESTAMP() - begin);
+	USBD_HID_Digital_IO_Queue_Report(REPORT_CLASS_ACK, report);
+	digital_io_bus.state = BUS_IDLE;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Bus_Deposit
+  *         Place the low bits of a value on the set bits of a mask, lowest bit first.
+  * @retval Packed logical bits
+  */
+static uint32_t USBD_HID_Digital_IO_Bus_Deposit(uint32_t mask, uint32_t value)
+{
+	uint32_t result = 0, bit = 0;
+
+	for (bit = 1; mask != 0 && value != 0; bit <<= 1)
+	{
+		if (value & bit)
+		{
+			result |= mask & (~mask + 1U);
+			value &= ~bit;
+		}
+		mask &= mask - 1U;
+	}
+	return result;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Bus_Write_Banks
+  *         Write the compiled BSRR word of every bank.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Bus_Write_Banks(const uint32_t* bsrr)
+{
+	uint8_t bank_idx = 0;
+
+	for (bank_idx = 0; bank_idx < GPIO_DIGITAL_BANK_NUM; bank_idx++)
+	{
+		if (bsrr[bank_idx] != 0)
+		{
+			gpio_digital_bank[bank_idx]->BSRR = bsrr[bank_idx];
+		}
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Bus_Wait
+  *         Wait until the given number of CPU cycles passed since start.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Bus_Wait(uint32_t start, uint32_t cycles)
+{
+	while ((DIGITAL_IO_TIMESTAMP() - start) < cycles);
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
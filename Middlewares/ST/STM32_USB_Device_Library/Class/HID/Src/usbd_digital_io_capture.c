@@ -0,0 +1,614 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_capture.c
+  * @brief   This file provides the timer/DMA capture of the digital IO pins.
+  *
+  * @verbatim
+  *
+  *          ===================================================================
+  *                                Capture Description
+  *          ===================================================================
+  *           TIM1 compare events (CH1, CH2, CH3) request DMA2 transfers from the
+  *           IDR register of GPIOA, GPIOB and GPIOC into circular raw buffers.
+  *           The half/full transfer interrupt of the GPIOC stream converts the
+  *           raw snapshots to packed logical samples (majority vote when
+  *           oversampling) and decimates them into rate groups:
+  *             - every port has its own decimation factor (0 = not captured)
+  *             - ports with the same factor form a group with its own records
+  *             - record n of a group was sampled at
+  *               start_tick + n * decimation * period (CPU cycles)
+  *
+  *           State mode (external clock): the DUT clock on PD2 (TIM3_ETR) resets
+  *           TIM3 at every active edge, the reset is sent on the TIM3 TRGO and
+  *           starts TIM1 in one pulse mode (trigger mode on ITR2). TIM1 counts
+  *           to the compare value once and requests exactly one snapshot of
+  *           the three ports per DUT clock, a few CPU cycles after the edge.
+  *           The timestamps of the records then count DUT clocks from the
+  *           start (start_tick = 0, period = 1). While the capture runs, the
+  *           TIM3 update interrupt (PPS output) is paused.
+  *
+  *  @endverbatim
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_digital_io_capture.h"
+#include "gpio.h"
+#include "tim.h"
+#include "usbd_digital_io_decoder.h"
+
+/* Global variables */
+DIGITAL_IO_CAPTURE_TypeDef digital_io_capture;
+uint32_t digital_io_capture_buffer[DIGITAL_IO_CAPTURE_BUFFER_SIZE];
+uint16_t digital_io_capture_raw[GPIO_DIGITAL_BANK_NUM][DIGITAL_IO_CAPTURE_RAW_SIZE];
+
+/* Private functions */
+static void USBD_HID_Digital_IO_Capture_Setup_Groups(void);
+static void USBD_HID_Digital_IO_Capture_Setup_Clock(void);
+static void USBD_HID_Digital_IO_Capture_Restore_Clock(void);
+static void USBD_HID_Digital_IO_Capture_HalfCplt(DMA_HandleTypeDef* hdma);
+static void USBD_HID_Digital_IO_Capture_Cplt(DMA_HandleTypeDef* hdma);
+
+/* Functions */
+
+/**
+  * @brief  USBD_HID_Digital_IO_Capture_Init
+  *         Set the default capture settings (all ports, full rate).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Capture_Init(void)
+{
+	uint8_t port_idx = 0;
+
+	digital_io_capture.state = CAPTURE_IDLE;
+	digital_io_capture.request = CAPTURE_NO_REQUEST;
+	digital_io_capture.stream = 0;
+	digital_io_capture.planar = 0;
+	digital_io_capture.runs = 0;
+	digital_io_capture.external = 0;
+	digital_io_capture.falling = 0;
+	digital_io_capture.oversampling = 1;
+	digital_io_capture.period_new = DIGITAL_IO_CAPTURE_DEFAULT_PERIOD;
+	digital_io_capture.period = DIGITAL_IO_CAPTURE_DEFAULT_PERIOD;
+	digital_io_capture.sample_count = 0;
+	digital_io_capture.edges = 0;
+	digital_io_capture.group_num = 0;
+	digital_io_capture.stream_group = 0;
+
+	for (port_idx = 0; port_idx < DIGITAL_MAX_PORT_NUM; port_idx++)
+	{
+		digital_io_capture.decimation_new[port_idx] = 1;
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Capture_Process_Command
+  *         Store capture settings and start/stop requests from the host.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Capture_Process_Command(uint8_t command, uint8_t* output_buff)
+{
+	/* PROTOCOL:
+	 * COMMAND_CAPTURE_CONFIG: 10 bytes (used at the next start)
+	 * Byte[0-3]	-> base sample period in CPU cycles (little endian)
+	 * Byte[4-9]	-> decimation factor of port 0-5 (0 = port is not captured)
+	 *
+	 * COMMAND_CAPTURE_CONTROL: 1 byte
+	 * Byte[0]		-> (R | S | P | L | X | F | --) -> R = run (1 start, 0 stop), S = stream records in IN reports,
+	 *				   P = planar records (pin-major bit order in the capture reports),
+	 *				   L = run length reports (REPORT_CAPTURE_RUN) instead of the records (with S),
+	 *				   X = state mode: one sample per DUT clock on PD2 (period and oversampling are ignored),
+	 *				   F = sample on the falling edge of the DUT clock (with X)
+	 */
+	uint8_t port_idx = 0;
+
+	switch (command)
+	{
+		case COMMAND_CAPTURE_CONFIG:
+			digital_io_capture.period_new = read_uint32(&output_buff[0]);
+			for (port_idx = 0; port_idx < DIGITAL_MAX_PORT_NUM; port_idx++)
+			{
+				digital_io_capture.decimation_new[port_idx] = output_buff[port_idx + 4];
+			}
+			break;
+		case COMMAND_CAPTURE_CONTROL:
+			digital_io_capture.stream = read_from_byte(output_buff[0], SIZE_1, SHIFT_1);
+			digital_io_capture.planar = read_from_byte(output_buff[0], SIZE_1, SHIFT_2);
+			digital_io_capture.runs = read_from_byte(output_buff[0], SIZE_1, SHIFT_3);
+			digital_io_capture.external = read_from_byte(output_buff[0], SIZE_1, SHIFT_4);
+			digital_io_capture.falling = read_from_byte(output_buff[0], SIZE_1, SHIFT_5);
+			digital_io_capture.request = read_from_byte(output_buff[0], SIZE_1, SHIFT_0) ? CAPTURE_START : CAPTURE_STOP;
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Capture_Handle
+  *         Execute the pending start/stop request (main loop).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Capture_Handle(void)
+{
+	Digital_IO_Capture_Request request = digital_io_capture.request;
+
+	// The DMA would write the buffer during the data stage of an upload into it
+	if (request == CAPTURE_START && USBD_HID_Digital_IO_Upload_Pending(UPLOAD_CAPTURE_BUFFER))
+	{
+		return;
+	}
+	digital_io_capture.request = CAPTURE_NO_REQUEST;
+	if (request == CAPTURE_START)
+	{
+		USBD_HID_Digital_IO_Capture_Start();
+	}
+	else if (request == CAPTURE_STOP)
+	{
+		USBD_HID_Digital_IO_Capture_Stop();
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Capture_Start
+  *         Build the rate groups and start the timer triggered DMA snapshots.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Capture_Start(void)
+{
+	uint32_t period = digital_io_capture.period_new, dma_period = 0, prescaler = 0, reload = 0, length = 0;
+
+	if (digital_io_capture.state == CAPTURE_RUNNING)
+	{
+		USBD_HID_Digital_IO_Capture_Stop();
+	}
+
+	if (digital_io_capture.external)
+	{
+		// One snapshot per DUT clock: TIM1 counts from 0 to the compare value and stops
+		digital_io_capture.oversampling = 1;
+		digital_io_capture.period = 1;
+		reload = 1;
+	}
+	else
+	{
+		// K snapshots per logical sample, evenly spaced over the sample period
+		digital_io_capture.oversampling = DIGITAL_IO_CTX_OVERSAMPLING;
+		if (period < DIGITAL_IO_CAPTURE_MIN_PERIOD)
+		{
+			period = DIGITAL_IO_CAPTURE_MIN_PERIOD;
+		}
+		dma_period = period / digital_io_capture.oversampling;
+		if (dma_period < DIGITAL_IO_CAPTURE_MIN_DMA_PERIOD)
+		{
+			dma_period = DIGITAL_IO_CAPTURE_MIN_DMA_PERIOD;
+		}
+		prescaler = (dma_period - 1) / 0x10000U;
+		reload = dma_period / (prescaler + 1) - 1;
+
+		// TIM1 runs from the CPU clock (APB2 prescaler 1): timer ticks are CPU cycles
+		digital_io_capture.period = (reload + 1) * (prescaler + 1) * digital_io_capture.oversampling;
+	}
+
+	USBD_HID_Digital_IO_Capture_Setup_Groups();
+
+	__HAL_TIM_DISABLE(&htim1);
+	__HAL_TIM_SET_PRESCALER(&htim1, prescaler);
+	__HAL_TIM_SET_AUTORELOAD(&htim1, reload);
+	htim1.Instance->EGR = TIM_EGR_UG;
+	__HAL_TIM_SET_COUNTER(&htim1, 0);
+	__HAL_TIM_CLEAR_FLAG(&htim1, TIM_FLAG_CC1 | TIM_FLAG_CC2 | TIM_FLAG_CC3 | TIM_FLAG_UPDATE);
+
+	// Raw buffers hold two blocks (double buffering with half/full transfer interrupts)
+	length = 2U * DIGITAL_IO_CAPTURE_BLOCK_SIZE * digital_io_capture.oversampling;
+	hdma_tim1_ch3.XferHalfCpltCallback = USBD_HID_Digital_IO_Capture_HalfCplt;
+	hdma_tim1_ch3.XferCpltCallback = USBD_HID_Digital_IO_Capture_Cplt;
+	HAL_DMA_Start(&hdma_tim1_ch1, (uint32_t)&GPIOA->IDR, (uint32_t)digital_io_capture_raw[0], length);
+	HAL_DMA_Start(&hdma_tim1_ch2, (uint32_t)&GPIOB->IDR, (uint32_t)digital_io_capture_raw[1], length);
+	HAL_DMA_Start_IT(&hdma_tim1_ch3, (uint32_t)&GPIOC->IDR, (uint32_t)digital_io_capture_raw[2], length);
+	__HAL_TIM_ENABLE_DMA(&htim1, TIM_DMA_CC1 | TIM_DMA_CC2 | TIM_DMA_CC3);
+
+	// The first compare event (CCR = 1) comes one timer tick after the counter start
+	digital_io_capture.sample_count = 0;
+	digital_io_capture.last_snapshot = GPIO_Read_Packed_DIGITAL_IO();
+	digital_io_capture.state = CAPTURE_RUNNING;
+	if (digital_io_capture.external)
+	{
+		// TIM1 is enabled by the DUT clock
+		digital_io_capture.start_tick = 0;
+		USBD_HID_Digital_IO_Capture_Setup_Clock();
+		return;
+	}
+	digital_io_capture.start_tick = DIGITAL_IO_TIMESTAMP() + (prescaler + 1);
+	__HAL_TIM_ENABLE(&htim1);
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Capture_Stop
+  *         Stop the snapshots and process the samples of the unfinished block.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Capture_Stop(void)
+{
+	uint16_t length = 0, position = 0, offset = 0;
+
+	if (digital_io_capture.state != CAPTURE_RUNNING)
+	{
+		return;
+	}
+
+	if (digital_io_capture.external)
+	{
+		USBD_HID_Digital_IO_Capture_Restore_Clock();
+	}
+	__HAL_TIM_DISABLE(&htim1);
+	__HAL_TIM_DISABLE_DMA(&htim1, TIM_DMA_CC1 | TIM_DMA_CC2 | TIM_DMA_CC3);
+
+	// Snapshots written after the last half/full transfer interrupt
+	length = 2U * DIGITAL_IO_CAPTURE_BLOCK_SIZE * digital_io_capture.oversampling;
+	position = length - __HAL_DMA_GET_COUNTER(&hdma_tim1_ch3);
+	offset = (position >= length / 2) ? (length / 2) : 0;
+
+	HAL_DMA_Abort(&hdma_tim1_ch1);
+	HAL_DMA_Abort(&hdma_tim1_ch2);
+	HAL_DMA_Abort(&hdma_tim1_ch3);
+
+	USBD_HID_Digital_IO_Capture_Process_Block(offset, (position - offset) / digital_io_capture.oversampling);
+	digital_io_capture.state = CAPTURE_IDLE;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Capture_Setup_Clock
+  *         Let the DUT clock on TIM3_ETR start TIM1 (state mode).
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Capture_Setup_Clock(void)
+{
+	// The TIM3 settings of the PPS counter are restored at the stop
+	digital_io_capture.clock_smcr = htim3.Instance->SMCR;
+	digital_io_capture.clock_cr2 = htim3.Instance->CR2;
+	digital_io_capture.clock_dier = htim3.Instance->DIER;
+
+	// TIM1: one pulse mode, started by the TIM3 TRGO
+	htim1.Instance->CR1 |= TIM_CR1_OPM;
+	htim1.Instance->SMCR = DIGITAL_IO_CAPTURE_CLOCK_TRIGGER | TIM_SLAVEMODE_TRIGGER;
+
+	// TIM3: reset by every active ETR edge (external clock mode 2 cannot use ETRF as trigger), TRGO on reset
+	__HAL_TIM_DISABLE_IT(&htim3, TIM_IT_UPDATE);
+	htim3.Instance->CR2 = (htim3.Instance->CR2 & ~TIM_CR2_MMS) | TIM_TRGO_RESET;
+	htim3.Instance->SMCR = (digital_io_capture.falling ? TIM_SMCR_ETP : 0) | TIM_TS_ETRF | TIM_SLAVEMODE_RESET;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Capture_Restore_Clock
+  *         Stop the DUT clock snapshots and restore the PPS counter.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Capture_Restore_Clock(void)
+{
+	htim3.Instance->SMCR = digital_io_capture.clock_smcr;
+	htim3.Instance->CR2 = digital_io_capture.clock_cr2;
+	__HAL_TIM_CLEAR_FLAG(&htim3, TIM_FLAG_UPDATE);
+	htim3.Instance->DIER = digital_io_capture.clock_dier;
+
+	htim1.Instance->SMCR = 0;
+	htim1.Instance->CR1 &= ~TIM_CR1_OPM;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Capture_Process_Block
+  *         Convert raw DMA snapshots to logical samples and store them.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Capture_Process_Block(uint16_t offset, uint16_t num)
+{
+	uint32_t samples[DIGITAL_IO_MAX_OVERSAMPLING];
+	uint32_t edges = 0, last = digital_io_capture.last_snapshot;
+	uint16_t sample_idx = 0, raw_idx = offset;
+	uint8_t snap_idx = 0, k = digital_io_capture.oversampling;
+
+	for (sample_idx = 0; sample_idx < num; sample_idx++)
+	{
+		if (k == 1)
+		{
+			samples[0] = GPIO_Gather_DIGITAL_IO(digital_io_capture_raw[0][raw_idx], digital_io_capture_raw[1][raw_idx], digital_io_capture_raw[2][raw_idx]);
+			edges |= samples[0] ^ last;
+			last = samples[0];
+			raw_idx++;
+		}
+		else
+		{
+			for (snap_idx = 0; snap_idx < k; snap_idx++, raw_idx++)
+			{
+				samples[snap_idx] = GPIO_Gather_DIGITAL_IO(digital_io_capture_raw[0][raw_idx], digital_io_capture_raw[1][raw_idx], digital_io_capture_raw[2][raw_idx]);
+				edges |= samples[snap_idx] ^ last;
+				last = samples[snap_idx];
+			}
+			samples[0] = USBD_HID_Digital_IO_Majority(samples, k);
+		}
+		USBD_HID_Digital_IO_Capture_Store(samples[0]);
+		USBD_HID_Digital_IO_Decoder_Sample(samples[0]);
+	}
+
+	// Edge latch between the snapshots, glitches removed by the majority vote included
+	digital_io_capture.last_snapshot = last;
+	digital_io_capture.edges |= edges;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Capture_Store
+  *         Decimate one logical sample into the records of the rate groups.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Capture_Store(uint32_t sample)
+{
+	DIGITAL_IO_CAPTURE_Group* group = digital_io_capture.group;
+	uint8_t group_idx = 0;
+
+	for (group_idx = 0; group_idx < digital_io_capture.group_num; group_idx++, group++)
+	{
+		if (--group->countdown == 0)
+		{
+			group->countdown = group->decimation;
+			group->buffer[group->write_idx] = sample & group->mask;
+			if (++group->write_idx == group->size)
+			{
+				group->write_idx = 0;
+			}
+			group->write_count++;
+		}
+	}
+	digital_io_capture.sample_count++;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Capture_Stream_Report
+  *         Create the next capture record report (rate groups in turn).
+  * @retval 1 if a report was created, 0 if there are no new records
+  */
+uint8_t USBD_HID_Digital_IO_Capture_Stream_Report(uint8_t* report)
+{
+	/* PROTOCOL:
+	 * Output: 11 bytes
+	 * Byte[0]		-> 0x80 | REPORT_CAPTURE
+	 * Byte[1]		-> (GGGG | NNNN) -> GGGG = rate group, NNNN = number of records
+	 * Byte[2-5]	-> timestamp of the first record (CPU cycles, little endian)
+	 * Byte[6-9]	-> records, the port nibbles of the group in port order, first record in the low bits
+	 *				   planar: NNNN bits per pin (pins of the group in port order), first record in the low bit
+	 * Byte[10]		-> records lost (overwritten) before this report, saturated
+	 */
+	DIGITAL_IO_CAPTURE_Group* group = 0;
+	uint32_t available = 0, lost = 0, bits = 0, record = 0, nibble = 0;
+	uint8_t try_idx = 0, rec_idx = 0, port_idx = 0, pin_idx = 0, num = 0, shift = 0;
+
+	for (try_idx = 0; try_idx < digital_io_capture.group_num; try_idx++)
+	{
+		group = &digital_io_capture.group[digital_io_capture.stream_group];
+		digital_io_capture.stream_group = (digital_io_capture.stream_group + 1) % digital_io_capture.group_num;
+
+		available = group->write_count - group->read_count;
+		if (available == 0)
+		{
+			continue;
+		}
+		if (available > group->size)
+		{
+			lost = available - group->size;
+			group->read_count = group->write_count - group->size;
+			available = group->size;
+		}
+
+		if (digital_io_capture.runs)
+		{
+			if (USBD_HID_Digital_IO_Capture_Run_Report(group, available, lost, report))
+			{
+				return 1;
+			}
+			continue;
+		}
+
+		num = DIGITAL_IO_CAPTURE_RECORD_BITS / (group->port_num * DIGITAL_MAX_PIN_NUM);
+		if (available < num)
+		{
+			num = available;
+		}
+
+		for (rec_idx = 0; rec_idx < num; rec_idx++)
+		{
+			record = group->buffer[(group->read_count + rec_idx) % group->size];
+			for (port_idx = 0; port_idx < group->port_num; port_idx++)
+			{
+				nibble = (record >> (group->ports[port_idx] * DIGITAL_MAX_PIN_NUM)) & 0x0FU;
+				if (digital_io_capture.planar)
+				{
+					// Transposed on the device: the host gets one bit plane per pin
+					for (pin_idx = 0; pin_idx < DIGITAL_MAX_PIN_NUM; pin_idx++)
+					{
+						bits |= ((nibble >> pin_idx) & 0x01U) << ((port_idx * DIGITAL_MAX_PIN_NUM + pin_idx) * num + rec_idx);
+					}
+				}
+				else
+				{
+					bits |= nibble << shift;
+				}
+				shift += DIGITAL_MAX_PIN_NUM;
+			}
+		}
+
+		report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_CAPTURE;
+		report[1] = (uint8_t)((group - digital_io_capture.group) | (num << 4));
+		write_uint32(&report[2], digital_io_capture.start_tick + group->read_count * group->decimation * digital_io_capture.period);
+		write_uint32(&report[6], bits);
+		report[10] = (lost > 0xFF) ? 0xFF : (uint8_t)lost;
+
+		group->read_count += num;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Capture_Run_Report
+  *         Create a run length report of a rate group: value and duration of the next finished run.
+  * @retval 1 if a report was created, 0 if the current run is not finished yet
+  */
+uint8_t USBD_HID_Digital_IO_Capture_Run_Report(DIGITAL_IO_CAPTURE_Group* group, uint32_t available, uint32_t lost, uint8_t* report)
+{
+	/* PROTOCOL:
+	 * Output: 11 bytes
+	 * Byte[0]		-> 0x80 | REPORT_CAPTURE_RUN
+	 * Byte[1]		-> (GGGG | LLLL) -> GGGG = rate group, LLLL = records lost before this run, saturated
+	 * Byte[2-5]	-> timestamp of the first record of the run (CPU cycles, little endian)
+	 * Byte[6-8]	-> value of the run (logical bits of the group, same format as the state report)
+	 * Byte[9-10]	-> number of records of the run (little endian)
+	 *
+	 * Long runs are split at DIGITAL_IO_CAPTURE_MAX_RUN records, the last run is sent when the capture stops.
+	 */
+	uint32_t value = group->buffer[group->read_count % group->size], length = 1;
+
+	while (length < available && length < DIGITAL_IO_CAPTURE_MAX_RUN
+		   && group->buffer[(group->read_count + length) % group->size] == value)
+	{
+		length++;
+	}
+	// The run may continue in records which are not stored yet (a loss is reported at once)
+	if (length == available && length < DIGITAL_IO_CAPTURE_MAX_RUN && lost == 0 && digital_io_capture.state == CAPTURE_RUNNING)
+	{
+		return 0;
+	}
+
+	report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_CAPTURE_RUN;
+	report[1] = (uint8_t)(((group - digital_io_capture.group) << 4) | ((lost > 0x0F) ? 0x0F : lost));
+	write_uint32(&report[2], digital_io_capture.start_tick + group->read_count * group->decimation * digital_io_capture.period);
+	report[6] = (uint8_t)(value);
+	report[7] = (uint8_t)(value >> 8);
+	report[8] = (uint8_t)(value >> 16);
+	report[9] = (uint8_t)(length);
+	report[10] = (uint8_t)(length >> 8);
+
+	group->read_count += length;
+	return 1;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Capture_Take_Edges
+  *         Read and clear the edges seen between the DMA snapshots.
+  * @retval Logical bits which changed in any snapshot since the previous call
+  */
+uint32_t USBD_HID_Digital_IO_Capture_Take_Edges(void)
+{
+	uint32_t edges = 0;
+
+	// The DMA interrupt may set new bits in between: exclusive access retries the exchange
+	do
+	{
+		edges = __LDREXW(&digital_io_capture.edges);
+	} while (__STREXW(0, &digital_io_capture.edges));
+
+	return edges;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Capture_Setup_Groups
+  *         Group the ports by decimation factor and share the record buffer
+  *         proportionally to the record rate of the groups.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Capture_Setup_Groups(void)
+{
+	DIGITAL_IO_CAPTURE_Group* group = 0;
+	uint32_t weight[DIGITAL_MAX_PORT_NUM], total = 0, offset = 0, size = 0;
+	uint8_t port_idx = 0, group_idx = 0, decimation = 0;
+
+	digital_io_capture.group_num = 0;
+	digital_io_capture.stream_group = 0;
+
+	for (port_idx = 0; port_idx < DIGITAL_MAX_PORT_NUM; port_idx++)
+	{
+		decimation = digital_io_capture.decimation_new[port_idx];
+		if (decimation == 0)
+		{
+			continue;
+		}
+		for (group_idx = 0; group_idx < digital_io_capture.group_num; group_idx++)
+		{
+			if (digital_io_capture.group[group_idx].decimation == decimation)
+			{
+				break;
+			}
+		}
+		group = &digital_io_capture.group[group_idx];
+		if (group_idx == digital_io_capture.group_num)
+		{
+			digital_io_capture.group_num++;
+			group->decimation = decimation;
+			group->port_num = 0;
+			group->mask = 0;
+		}
+		group->ports[group->port_num++] = port_idx;
+		group->mask |= DIGITAL_IO_PORT_MASK(port_idx);
+	}
+
+	// Every group covers about the same time span of the capture
+	for (group_idx = 0; group_idx < digital_io_capture.group_num; group_idx++)
+	{
+		weight[group_idx] = 0x10000U / digital_io_capture.group[group_idx].decimation;
+		total += weight[group_idx];
+	}
+	for (group_idx = 0; group_idx < digital_io_capture.group_num; group_idx++)
+	{
+		group = &digital_io_capture.group[group_idx];
+		// Every group keeps the minimum, the rest is shared: the sizes never exceed the buffer nor reach 0
+		size = DIGITAL_IO_CAPTURE_MIN_GROUP_SIZE
+			 + ((DIGITAL_IO_CAPTURE_BUFFER_SIZE - digital_io_capture.group_num * DIGITAL_IO_CAPTURE_MIN_GROUP_SIZE) * weight[group_idx]) / total;
+		group->buffer = &digital_io_capture_buffer[offset];
+		group->size = size;
+		group->write_idx = 0;
+		group->write_count = 0;
+		group->read_count = 0;
+		group->countdown = 1;
+		offset += size;
+	}
+}
+
+/**
+  * @brief  DMA half transfer: the first block of the raw buffers is complete.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Capture_HalfCplt(DMA_HandleTypeDef* hdma)
+{
+	UNUSED(hdma);
+
+	USBD_HID_Digital_IO_Capture_Process_Block(0, DIGITAL_IO_CAPTURE_BLOCK_SIZE);
+}
+
+/**
+  * @brief  DMA transfer complete: the second block of the raw buffers is complete.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Capture_Cplt(DMA_HandleTypeDef* hdma)
+{
+	UNUSED(hdma);
+
+	USBD_HID_Digital_IO_Capture_Process_Block(DIGITAL_IO_CAPTURE_BLOCK_SIZE * digital_io_capture.oversampling, DIGITAL_IO_CAPTURE_BLOCK_SIZE);
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
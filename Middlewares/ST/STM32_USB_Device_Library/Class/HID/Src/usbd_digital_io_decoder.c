@@ -0,0 +1,433 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_decoder.c
+  * @brief   This file provides the quadrature and Gray code position decoders.
+  *
+  * @verbatim
+  *
+  *          ===================================================================
+  *                                Decoder Description
+  *          ===================================================================
+  *           A decoder reads a Gray code from 2-8 logical bits. A quadrature
+  *           pair (A, B) is the 2 bit Gray code 00, 01, 11, 10.
+  *           The code is converted to binary and compared to the previous one:
+  *             - a difference of +1/-1 is one step
+  *             - a larger difference means missed steps: an error is counted
+  *               and the position moves by the shortest distance
+  *             - half a turn is ambiguous: an error without a move
+  *           The decoders see every logical sample of the capture (DMA
+  *           interrupt) while it runs, else the main loop samples.
+  *           A quadrature pair wired to PB6/PB7 is counted by the TIM4 encoder
+  *           mode instead (x4, no missed steps, no error detection).
+  *           Position, velocity (counts per second over the report interval)
+  *           and error count are reported when they change.
+  *
+  *  @endverbatim
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_digital_io_decoder.h"
+#include "gpio.h"
+
+/* Global variables */
+DIGITAL_IO_DECODER_TypeDef digital_io_decoder;
+
+/* Private functions */
+static uint8_t USBD_HID_Digital_IO_Decoder_Code(DIGITAL_IO_DECODER_Channel* channel, uint32_t sample);
+static uint8_t USBD_HID_Digital_IO_Decoder_Find_Timer(int8_t* sign);
+static void USBD_HID_Digital_IO_Decoder_Timer_Setup(uint8_t enable);
+static void USBD_HID_Digital_IO_Decoder_Timer_Update(void);
+
+/* Functions */
+
+/**
+  * @brief  USBD_HID_Digital_IO_Decoder_Init
+  *         Switch all decoders off.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Decoder_Init(void)
+{
+	uint8_t idx = 0;
+
+	digital_io_decoder.request = 0;
+	digital_io_decoder.mask = 0;
+	digital_io_decoder.last_sample = 0;
+	digital_io_decoder.timer_channel = DIGITAL_IO_DECODER_NO_TIMER;
+	digital_io_decoder.timer_sign = 1;
+	digital_io_decoder.timer_count = 0;
+	digital_io_decoder.next = 0;
+	for (idx = 0; idx < DIGITAL_IO_DECODER_NUM; idx++)
+	{
+		digital_io_decoder.channel_new[idx].type = DECODER_OFF;
+		digital_io_decoder.channel_new[idx].bit_num = 0;
+		digital_io_decoder.channel[idx].type = DECODER_OFF;
+		digital_io_decoder.channel[idx].bit_num = 0;
+		digital_io_decoder.channel[idx].mask = 0;
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Decoder_Process_Command
+  *         Store the settings of one decoder.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Decoder_Process_Command(uint8_t* output_buff)
+{
+	/* PROTOCOL:
+	 * COMMAND_DECODER: 10 bytes (executed in the main loop, the counts restart at 0)
+	 * Byte[0]		-> (TTTT | IIII) -> IIII = decoder, TTTT = DECODER_OFF, DECODER_QUADRATURE or DECODER_GRAY
+	 * Byte[1]		-> number of bits (quadrature: 2, Gray code: 2-8)
+	 * Byte[2-9]	-> logical bits, least significant first (quadrature: A, B)
+	 *
+	 * Result: REPORT_DECODER when the counts change.
+	 */
+	DIGITAL_IO_DECODER_Channel* channel = 0;
+	Digital_IO_Decoder_Type type = (Digital_IO_Decoder_Type)read_from_byte(output_buff[0], SIZE_4, SHIFT_4);
+	uint8_t idx = read_from_byte(output_buff[0], SIZE_4, SHIFT_0), bit_num = output_buff[1], bit_idx = 0;
+
+	if (idx >= DIGITAL_IO_DECODER_NUM)
+	{
+		return;
+	}
+	if (type == DECODER_QUADRATURE && bit_num != 2)
+	{
+		return;
+	}
+	if (type == DECODER_GRAY && (bit_num < 2 || bit_num > DIGITAL_IO_DECODER_MAX_BIT_NUM))
+	{
+		return;
+	}
+	if (type != DECODER_OFF && type != DECODER_QUADRATURE && type != DECODER_GRAY)
+	{
+		return;
+	}
+	for (bit_idx = 0; type != DECODER_OFF && bit_idx < bit_num; bit_idx++)
+	{
+		if (output_buff[2 + bit_idx] >= DIGITAL_IO_MAX_BIT_NUM)
+		{
+			return;
+		}
+	}
+
+	channel = &digital_io_decoder.channel_new[idx];
+	channel->type = type;
+	channel->bit_num = (type == DECODER_OFF) ? 0 : bit_num;
+	for (bit_idx = 0; bit_idx < channel->bit_num; bit_idx++)
+	{
+		channel->bits[bit_idx] = output_buff[2 + bit_idx];
+	}
+	digital_io_decoder.request |= (1U << idx);
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Decoder_Handle
+  *         Apply the new decoder settings and select the timer decoder (main loop).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Decoder_Handle(void)
+{
+	DIGITAL_IO_DECODER_Channel* channel = 0;
+	uint32_t primask = __get_PRIMASK(), sample = 0, now = HAL_GetTick();
+	uint8_t request = 0, idx = 0, bit_idx = 0, timer_channel = 0;
+	int8_t timer_sign = 1;
+
+	// The capture interrupt decodes samples as well: no interrupt while the channels change
+	__disable_irq();
+	request = digital_io_decoder.request;
+	digital_io_decoder.request = 0;
+	sample = GPIO_Read_Packed_DIGITAL_IO();
+	digital_io_decoder.last_sample = sample;
+	digital_io_decoder.mask = 0;
+	for (idx = 0; idx < DIGITAL_IO_DECODER_NUM; idx++)
+	{
+		channel = &digital_io_decoder.channel[idx];
+		if (request & (1U << idx))
+		{
+			channel->type = digital_io_decoder.channel_new[idx].type;
+			channel->bit_num = digital_io_decoder.channel_new[idx].bit_num;
+			channel->mask = 0;
+			for (bit_idx = 0; bit_idx < channel->bit_num; bit_idx++)
+			{
+				channel->bits[bit_idx] = digital_io_decoder.channel_new[idx].bits[bit_idx];
+				channel->mask |= (1UL << channel->bits[bit_idx]);
+			}
+			channel->position = 0;
+			channel->errors = 0;
+			channel->report_position = 0;
+			channel->report_errors = 0;
+			channel->velocity = 0;
+			channel->report_tick = now;
+		}
+		if (channel->type != DECODER_OFF)
+		{
+			channel->code = USBD_HID_Digital_IO_Decoder_Code(channel, sample);
+		}
+	}
+
+	timer_channel = USBD_HID_Digital_IO_Decoder_Find_Timer(&timer_sign);
+	for (idx = 0; idx < DIGITAL_IO_DECODER_NUM; idx++)
+	{
+		if (digital_io_decoder.channel[idx].type != DECODER_OFF && idx != timer_channel)
+		{
+			digital_io_decoder.mask |= digital_io_decoder.channel[idx].mask;
+		}
+	}
+	__set_PRIMASK(primask);
+
+	// The timer keeps counting while its decoder stays the same
+	if (timer_channel != digital_io_decoder.timer_channel || (timer_channel != DIGITAL_IO_DECODER_NO_TIMER && (request & (1U << timer_channel))))
+	{
+		digital_io_decoder.timer_channel = timer_channel;
+		digital_io_decoder.timer_sign = timer_sign;
+		USBD_HID_Digital_IO_Decoder_Timer_Setup(timer_channel != DIGITAL_IO_DECODER_NO_TIMER);
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Decoder_Sample
+  *         Decode the changes of one packed sample (capture DMA interrupt or main loop).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Decoder_Sample(uint32_t sample)
+{
+	DIGITAL_IO_DECODER_Channel* channel = 0;
+	uint32_t changed = (sample ^ digital_io_decoder.last_sample) & digital_io_decoder.mask;
+	int32_t delta = 0, size = 0;
+	uint8_t idx = 0, code = 0;
+
+	if (changed == 0)
+	{
+		return;
+	}
+	digital_io_decoder.last_sample = sample;
+
+	for (idx = 0; idx < DIGITAL_IO_DECODER_NUM; idx++)
+	{
+		channel = &digital_io_decoder.channel[idx];
+		if (!(changed & channel->mask) || idx == digital_io_decoder.timer_channel)
+		{
+			continue;
+		}
+
+		// Steps between the binary codes, modulo one turn (2 ^ bit_num codes)
+		code = USBD_HID_Digital_IO_Decoder_Code(channel, sample);
+		size = 1L << channel->bit_num;
+		delta = (int32_t)((code - channel->code) & (size - 1));
+		channel->code = code;
+		if (delta > size / 2)
+		{
+			delta -= size;
+		}
+		if (delta != 1 && delta != -1)
+		{
+			channel->errors++;
+			if (delta == size / 2)
+			{
+				continue;
+			}
+		}
+		channel->position += delta;
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Decoder_Report
+  *         Create the report of the next decoder with new counts.
+  * @retval 1 if a report was created, 0 if no decoder is due
+  */
+uint8_t USBD_HID_Digital_IO_Decoder_Report(uint8_t* report)
+{
+	/* PROTOCOL:
+	 * Output: 11 bytes
+	 * Byte[0]		-> 0x80 | REPORT_DECODER
+	 * Byte[1]		-> (H | --- | IIII) -> IIII = decoder, H = counted by the TIM4 encoder mode
+	 * Byte[2-5]	-> position in steps (signed, little endian)
+	 * Byte[6-8]	-> velocity in steps per second since the previous report (signed, saturated)
+	 * Byte[9-10]	-> error count (missed steps, saturated)
+	 *
+	 * A decoder is reported at most every DIGITAL_IO_DECODER_REPORT_PERIOD ms,
+	 * once more with velocity 0 after it stopped.
+	 */
+	DIGITAL_IO_DECODER_Channel* channel = 0;
+	uint32_t now = HAL_GetTick(), elapsed = 0, errors = 0;
+	int32_t position = 0, velocity = 0;
+	uint8_t num = 0, idx = 0;
+
+	if (digital_io_decoder.timer_channel != DIGITAL_IO_DECODER_NO_TIMER)
+	{
+		USBD_HID_Digital_IO_Decoder_Timer_Update();
+	}
+
+	for (num = 0; num < DIGITAL_IO_DECODER_NUM; num++)
+	{
+		idx = (digital_io_decoder.next + num) % DIGITAL_IO_DECODER_NUM;
+		channel = &digital_io_decoder.channel[idx];
+		elapsed = now - channel->report_tick;
+		if (channel->type == DECODER_OFF || elapsed < DIGITAL_IO_DECODER_REPORT_PERIOD)
+		{
+			continue;
+		}
+		position = channel->position;
+		errors = channel->errors;
+		if (position == channel->report_position && errors == channel->report_errors && channel->velocity == 0)
+		{
+			continue;
+		}
+
+		velocity = (int32_t)(((int64_t)(position - channel->report_position) * 1000) / (int32_t)elapsed);
+		velocity = MAX(MIN(velocity, 0x7FFFFFL), -0x800000L);
+
+		report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_DECODER;
+		report[1] = idx | ((idx == digital_io_decoder.timer_channel) ? DIGITAL_IO_DECODER_HARDWARE : 0);
+		write_uint32(&report[2], (uint32_t)position);
+		report[6] = (uint8_t)(velocity);
+		report[7] = (uint8_t)(velocity >> 8);
+		report[8] = (uint8_t)(velocity >> 16);
+		report[9] = (uint8_t)MIN(errors, 0xFFFFU);
+		report[10] = (uint8_t)(MIN(errors, 0xFFFFU) >> 8);
+
+		channel->report_position = position;
+		channel->report_errors = errors;
+		channel->velocity = velocity;
+		channel->report_tick = now;
+		digital_io_decoder.next = (idx + 1) % DIGITAL_IO_DECODER_NUM;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Decoder_Code
+  *         Read the Gray code of a decoder and convert it to binary.
+  * @retval Binary code
+  */
+static uint8_t USBD_HID_Digital_IO_Decoder_Code(DIGITAL_IO_DECODER_Channel* channel, uint32_t sample)
+{
+	uint8_t code = 0, bit_idx = 0, shift = 0;
+
+	for (bit_idx = 0; bit_idx < channel->bit_num; bit_idx++)
+	{
+		code |= ((sample >> channel->bits[bit_idx]) & 0x01U) << bit_idx;
+	}
+	for (shift = 1; shift < DIGITAL_IO_DECODER_MAX_BIT_NUM; shift <<= 1)
+	{
+		code ^= code >> shift;
+	}
+	return code;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Decoder_Find_Timer
+  *         Find the first quadrature decoder wired to the TIM4 encoder inputs.
+  * @param  sign: -1 if B is on TI1 (counting direction is reversed)
+  * @retval Decoder index or DIGITAL_IO_DECODER_NO_TIMER
+  */
+static uint8_t USBD_HID_Digital_IO_Decoder_Find_Timer(int8_t* sign)
+{
+	DIGITAL_IO_DECODER_Channel* channel = 0;
+	uint8_t idx = 0, phys_a = 0, phys_b = 0;
+	uint16_t pin_a = 0, pin_b = 0;
+
+	for (idx = 0; idx < DIGITAL_IO_DECODER_NUM; idx++)
+	{
+		channel = &digital_io_decoder.channel[idx];
+		if (channel->type != DECODER_QUADRATURE)
+		{
+			continue;
+		}
+		phys_a = gpio_digital_remap[channel->bits[0]];
+		phys_b = gpio_digital_remap[channel->bits[1]];
+		if (gpio_digital_port[phys_a / DIGITAL_MAX_PIN_NUM][phys_a % DIGITAL_MAX_PIN_NUM] != DIGITAL_IO_DECODER_TIMER_PORT
+			|| gpio_digital_port[phys_b / DIGITAL_MAX_PIN_NUM][phys_b % DIGITAL_MAX_PIN_NUM] != DIGITAL_IO_DECODER_TIMER_PORT)
+		{
+			continue;
+		}
+		pin_a = gpio_digital_pin[phys_a / DIGITAL_MAX_PIN_NUM][phys_a % DIGITAL_MAX_PIN_NUM];
+		pin_b = gpio_digital_pin[phys_b / DIGITAL_MAX_PIN_NUM][phys_b % DIGITAL_MAX_PIN_NUM];
+		if (pin_a == DIGITAL_IO_DECODER_TIMER_TI1 && pin_b == DIGITAL_IO_DECODER_TIMER_TI2)
+		{
+			*sign = 1;
+			return idx;
+		}
+		if (pin_a == DIGITAL_IO_DECODER_TIMER_TI2 && pin_b == DIGITAL_IO_DECODER_TIMER_TI1)
+		{
+			*sign = -1;
+			return idx;
+		}
+	}
+	return DIGITAL_IO_DECODER_NO_TIMER;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Decoder_Timer_Setup
+  *         Start TIM4 in encoder mode (both edges of TI1 and TI2) or release it.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Decoder_Timer_Setup(uint8_t enable)
+{
+	__HAL_RCC_TIM4_CLK_ENABLE();
+	TIM4->CR1 = 0;
+	if (!enable)
+	{
+		// Inputs in alternate function mode go back to plain inputs
+		if (((DIGITAL_IO_DECODER_TIMER_PORT->MODER >> (6 * 2)) & 0x0FU) == 0x0AU)
+		{
+			DIGITAL_IO_DECODER_TIMER_PORT->MODER &= ~((0x03U << (6 * 2)) | (0x03U << (7 * 2)));
+		}
+		return;
+	}
+
+	// Input filter: 8 samples of the timer clock (glitches below ~110 ns are ignored)
+	TIM4->SMCR = TIM_ENCODERMODE_TI12;
+	TIM4->CCMR1 = TIM_CCMR1_CC1S_0 | TIM_CCMR1_CC2S_0 | TIM_CCMR1_IC1F_0 | TIM_CCMR1_IC1F_1 | TIM_CCMR1_IC2F_0 | TIM_CCMR1_IC2F_1;
+	TIM4->CCER = 0;
+	TIM4->ARR = 0xFFFFU;
+	TIM4->CNT = 0;
+	digital_io_decoder.timer_count = 0;
+	TIM4->CR1 = TIM_CR1_CEN;
+
+	DIGITAL_IO_DECODER_TIMER_PORT->AFR[0] = (DIGITAL_IO_DECODER_TIMER_PORT->AFR[0] & ~((0x0FU << (6 * 4)) | (0x0FU << (7 * 4))))
+											| (DIGITAL_IO_DECODER_TIMER_AF << (6 * 4)) | (DIGITAL_IO_DECODER_TIMER_AF << (7 * 4));
+	USBD_HID_Digital_IO_Decoder_Timer_Update();
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Decoder_Timer_Update
+  *         Add the TIM4 counts to the position of the timer decoder (main loop).
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Decoder_Timer_Update(void)
+{
+	uint16_t count = (uint16_t)TIM4->CNT;
+	uint32_t moder = DIGITAL_IO_DECODER_TIMER_PORT->MODER;
+
+	// A port setup switches the inputs back to GPIO mode: the timer needs the alternate function
+	if (((moder >> (6 * 2)) & 0x0FU) == 0)
+	{
+		DIGITAL_IO_DECODER_TIMER_PORT->MODER = moder | (0x02U << (6 * 2)) | (0x02U << (7 * 2));
+	}
+
+	digital_io_decoder.channel[digital_io_decoder.timer_channel].position += digital_io_decoder.timer_sign * (int16_t)(count - digital_io_decoder.timer_count);
+	digital_io_decoder.timer_count = count;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,341 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_fabric.c
+  * @brief   This file provides the trigger bus between several modules.
+  *
+  * @verbatim
+  *
+  *          ===================================================================
+  *                                Fabric Description
+  *          ===================================================================
+  *           TRIGGER_OUT and TRIGGER_IN of several modules form a trigger bus:
+  *             - wired-OR: every TRIGGER_OUT (open drain) and TRIGGER_IN on
+  *               one line pulled up by the TRIGGER_IN pins, a module asserts
+  *               the bus by pulling it low. Every module (the asserting one
+  *               included) sees the same falling edge.
+  *             - daisy chain: TRIGGER_OUT drives the TRIGGER_IN of the next
+  *               module, every module forwards a rising edge to its
+  *               TRIGGER_OUT in the interrupt. The forward time is reported,
+  *               the host removes the delay of every hop.
+  *           A trigger asserts the bus with its TRIGGER_OUT action (pulse,
+  *           set; clear releases it). The SysTick releases the pulse.
+  *           Every module reacts to a bus edge in the EXTI15_10 interrupt:
+  *           output pins, capture start/stop (the timer stops at once) and
+  *           trigger arming, then timestamps the edge for the host. The
+  *           timestamps of one edge on all modules align the CPU cycle
+  *           counters, the EXTI latency is the same on every module.
+  *
+  *  @endverbatim
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_digital_io_fabric.h"
+#include "usbd_digital_io_capture.h"
+#include "usbd_digital_io_watch.h"
+#include "gpio.h"
+#include "tim.h"
+
+/* Global variables */
+DIGITAL_IO_FABRIC_TypeDef digital_io_fabric;
+
+/* Private functions */
+static void USBD_HID_Digital_IO_Fabric_React(uint32_t edge_tick, uint8_t code, uint32_t local_tick);
+
+/* Functions */
+
+/**
+  * @brief  USBD_HID_Digital_IO_Fabric_Init
+  *         Switch the trigger bus off (TRIGGER_OUT is a plain output).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Fabric_Init(void)
+{
+	digital_io_fabric.request = 0;
+	digital_io_fabric.mode = FABRIC_OFF;
+	digital_io_fabric.mode_new = FABRIC_OFF;
+	digital_io_fabric.capture = CAPTURE_NO_REQUEST;
+	digital_io_fabric.arm = 0;
+	digital_io_fabric.assert_bsrr = TRIGGER_OUT_Pin;
+	digital_io_fabric.release_bsrr = (uint32_t)TRIGGER_OUT_Pin << 16U;
+	digital_io_fabric.origin_id = DIGITAL_IO_FABRIC_NO_ORIGIN;
+	digital_io_fabric.pending = 0;
+	digital_io_fabric.lost = 0;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Fabric_Process_Command
+  *         Store the mode of the trigger bus and the reaction to its edges.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Fabric_Process_Command(uint8_t* output_buff)
+{
+	/* PROTOCOL:
+	 * COMMAND_FABRIC: 8 bytes (applied in the main loop)
+	 * Byte[0]		-> (MM | CC | ----) -> MM = FABRIC_OFF, FABRIC_WIRED_OR or FABRIC_CHAIN,
+	 *				   CC = capture on a bus edge (0 keep, 1 start, 2 stop)
+	 * Byte[1-3]	-> logical bits driven on a bus edge (little endian)
+	 * Byte[4-6]	-> values of the driven bits
+	 * Byte[7]		-> trig events armed by a bus edge (bit = ID)
+	 *
+	 * Result: REPORT_FABRIC for every bus edge.
+	 */
+	uint8_t mode = read_from_byte(output_buff[0], SIZE_2, SHIFT_0), capture = read_from_byte(output_buff[0], SIZE_2, SHIFT_2);
+
+	if (mode > FABRIC_CHAIN)
+	{
+		return;
+	}
+	digital_io_fabric.mode_new = (Digital_IO_Fabric_Mode)mode;
+	digital_io_fabric.capture_new = (capture == 1) ? CAPTURE_START : ((capture == 2) ? CAPTURE_STOP : CAPTURE_NO_REQUEST);
+	digital_io_fabric.out_mask_new = (output_buff[1] | ((uint32_t)output_buff[2] << 8) | ((uint32_t)output_buff[3] << 16)) & DIGITAL_IO_ALL_BITS;
+	digital_io_fabric.out_value_new = (output_buff[4] | ((uint32_t)output_buff[5] << 8) | ((uint32_t)output_buff[6] << 16)) & digital_io_fabric.out_mask_new;
+	digital_io_fabric.arm_new = output_buff[7] & ((1U << DIGITAL_IO_MAX_TRIG_NUM) - 1U);
+	digital_io_fabric.request = 1;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Fabric_Handle
+  *         Configure TRIGGER_IN/TRIGGER_OUT for the new mode (main loop).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Fabric_Handle(void)
+{
+	GPIO_InitTypeDef GPIO_InitStruct;
+	uint8_t idx = 0;
+
+	digital_io_fabric.request = 0;
+	HAL_NVIC_DisableIRQ(EXTI15_10_IRQn);
+
+	digital_io_fabric.mode = digital_io_fabric.mode_new;
+	digital_io_fabric.capture = digital_io_fabric.capture_new;
+	digital_io_fabric.arm = digital_io_fabric.arm_new;
+	GPIO_Compile_Packed_DIGITAL_IO(digital_io_fabric.out_mask_new, digital_io_fabric.out_value_new, digital_io_fabric.bsrr);
+
+	// Wired-OR: open drain, the line idles high and any module pulls it low
+	if (digital_io_fabric.mode == FABRIC_WIRED_OR)
+	{
+		digital_io_fabric.assert_bsrr = (uint32_t)TRIGGER_OUT_Pin << 16U;
+		digital_io_fabric.release_bsrr = TRIGGER_OUT_Pin;
+	}
+	else
+	{
+		digital_io_fabric.assert_bsrr = TRIGGER_OUT_Pin;
+		digital_io_fabric.release_bsrr = (uint32_t)TRIGGER_OUT_Pin << 16U;
+	}
+	DIGITAL_IO_HAL_TRIGGER_OUT(digital_io_fabric.release_bsrr);
+	DIGITAL_IO_CTX_DO_TRIGGER = DONTCARE;
+
+	GPIO_InitStruct.Pin = TRIGGER_OUT_Pin;
+	GPIO_InitStruct.Mode = (digital_io_fabric.mode == FABRIC_WIRED_OR) ? GPIO_MODE_OUTPUT_OD : GPIO_MODE_OUTPUT_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = (digital_io_fabric.mode == FABRIC_OFF) ? GPIO_SPEED_FREQ_LOW : GPIO_SPEED_FREQ_HIGH;
+	HAL_GPIO_Init(TRIGGER_OUT_GPIO_Port, &GPIO_InitStruct);
+
+	GPIO_InitStruct.Pin = TRIGGER_IN_Pin;
+	GPIO_InitStruct.Mode = (digital_io_fabric.mode == FABRIC_WIRED_OR) ? GPIO_MODE_IT_FALLING : GPIO_MODE_IT_RISING;
+	GPIO_InitStruct.Pull = (digital_io_fabric.mode == FABRIC_WIRED_OR) ? GPIO_PULLUP : GPIO_PULLDOWN;
+	HAL_GPIO_Init(TRIGGER_IN_GPIO_Port, &GPIO_InitStruct);
+	EXTI->PR = TRIGGER_IN_Pin;
+
+	digital_io_fabric.origin_id = DIGITAL_IO_FABRIC_NO_ORIGIN;
+	digital_io_fabric.pending = 0;
+	digital_io_fabric.lost = 0;
+
+	// The TRIGGER_OUT actions assert/release the bus
+	for (idx = 0; idx < DIGITAL_IO_MAX_TRIG_NUM; idx++)
+	{
+		USBD_HID_Digital_IO_Compile_Trigger_Action(&DIGITAL_IO_CTX_TRIG_EVENTS[idx].action);
+	}
+
+	// The vector is shared with the watched pins on the lines 10-15
+	if (digital_io_fabric.mode != FABRIC_OFF || (digital_io_watch.mask != 0 && (gpio_digital_edge_lines & 0xFC00U)))
+	{
+		HAL_NVIC_SetPriority(EXTI15_10_IRQn, 0, 0);
+		HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Fabric_Origin
+  *         Note the own assert of the bus right before a trigger action writes TRIGGER_OUT.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Fabric_Origin(uint8_t id, uint32_t bsrr)
+{
+	uint32_t timestamp = 0, primask = 0;
+
+	if (digital_io_fabric.mode == FABRIC_OFF || bsrr != digital_io_fabric.assert_bsrr)
+	{
+		return;
+	}
+
+	timestamp = DIGITAL_IO_TIMESTAMP();
+	if (digital_io_fabric.mode == FABRIC_WIRED_OR)
+	{
+		// No edge if another module holds the bus already
+		if (TRIGGER_IN_GPIO_Port->IDR & TRIGGER_IN_Pin)
+		{
+			digital_io_fabric.origin_tick = timestamp;
+			digital_io_fabric.origin_id = id;
+		}
+		return;
+	}
+
+	// Daisy chain: the own TRIGGER_IN does not see the edge, the module reacts at once
+	if (!(TRIGGER_OUT_GPIO_Port->ODR & TRIGGER_OUT_Pin))
+	{
+		primask = __get_PRIMASK();
+		__disable_irq();
+		USBD_HID_Digital_IO_Fabric_React(timestamp, DIGITAL_IO_FABRIC_ORIGIN | id, timestamp);
+		__set_PRIMASK(primask);
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Fabric_IRQ
+  *         Timestamp and react to a bus edge on TRIGGER_IN (EXTI15_10 interrupt).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Fabric_IRQ(void)
+{
+	uint32_t timestamp = DIGITAL_IO_TIMESTAMP(), local = 0;
+	uint8_t code = 0;
+
+	if (!(EXTI->PR & TRIGGER_IN_Pin))
+	{
+		return;
+	}
+	EXTI->PR = TRIGGER_IN_Pin;
+	if (digital_io_fabric.mode == FABRIC_OFF)
+	{
+		return;
+	}
+
+	if (digital_io_fabric.mode == FABRIC_CHAIN)
+	{
+		// Forward first (a closed ring stops at the module which drives already)
+		if (!(TRIGGER_OUT_GPIO_Port->ODR & TRIGGER_OUT_Pin))
+		{
+			DIGITAL_IO_HAL_TRIGGER_OUT(digital_io_fabric.assert_bsrr);
+			local = DIGITAL_IO_TIMESTAMP();
+			code = DIGITAL_IO_FABRIC_FORWARDED;
+			DIGITAL_IO_CTX_DO_TRIGGER = DO_TRIGGER;
+		}
+	}
+	else if (digital_io_fabric.origin_id != DIGITAL_IO_FABRIC_NO_ORIGIN)
+	{
+		code = DIGITAL_IO_FABRIC_ORIGIN | digital_io_fabric.origin_id;
+		local = digital_io_fabric.origin_tick;
+		digital_io_fabric.origin_id = DIGITAL_IO_FABRIC_NO_ORIGIN;
+	}
+	USBD_HID_Digital_IO_Fabric_React(timestamp, code, local);
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Fabric_Report
+  *         Create the report of the last bus edge.
+  * @retval 1 if a report was created, 0 if there was no edge
+  */
+uint8_t USBD_HID_Digital_IO_Fabric_Report(uint8_t* report)
+{
+	/* PROTOCOL:
+	 * Output: 11 bytes
+	 * Byte[0]		-> 0x80 | REPORT_FABRIC
+	 * Byte[1]		-> (IIII | -- | F | O) -> O = this module asserted the bus (IIII = trig event ID),
+	 *				   F = the edge was forwarded to TRIGGER_OUT (daisy chain)
+	 * Byte[2-5]	-> timestamp of the bus edge (CPU cycles at the EXTI interrupt entry, little endian)
+	 * Byte[6-9]	-> timestamp of the own assert (O) or of the forward (F), else 0
+	 * Byte[10]		-> bus edges not reported before this one, saturated
+	 */
+	uint32_t primask = 0, lost = 0;
+
+	if (!digital_io_fabric.pending)
+	{
+		return 0;
+	}
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	lost = digital_io_fabric.lost;
+	digital_io_fabric.lost = 0;
+	__set_PRIMASK(primask);
+
+	report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_FABRIC;
+	report[1] = digital_io_fabric.code;
+	write_uint32(&report[2], digital_io_fabric.edge_tick);
+	write_uint32(&report[6], digital_io_fabric.local_tick);
+	report[10] = (lost > 0xFF) ? 0xFF : (uint8_t)lost;
+
+	// The interrupt stores the next edge after this
+	digital_io_fabric.pending = 0;
+	return 1;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Fabric_React
+  *         Execute the reaction to a bus edge and store the edge for the report.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Fabric_React(uint32_t edge_tick, uint8_t code, uint32_t local_tick)
+{
+	uint8_t bank_idx = 0, trig_idx = 0;
+
+	// Pin reactions first: only register writes
+	for (bank_idx = 0; bank_idx < GPIO_DIGITAL_BANK_NUM; bank_idx++)
+	{
+		if (digital_io_fabric.bsrr[bank_idx] != 0)
+		{
+			gpio_digital_bank[bank_idx]->BSRR = digital_io_fabric.bsrr[bank_idx];
+		}
+	}
+
+	// A stop freezes the snapshots now, the main loop finishes the capture
+	if (digital_io_fabric.capture == CAPTURE_STOP && digital_io_capture.state == CAPTURE_RUNNING)
+	{
+		htim1.Instance->SMCR = 0;
+		htim1.Instance->CR1 &= ~TIM_CR1_CEN;
+	}
+	if (digital_io_fabric.capture != CAPTURE_NO_REQUEST)
+	{
+		digital_io_capture.request = (Digital_IO_Capture_Request)digital_io_fabric.capture;
+	}
+	for (trig_idx = 0; trig_idx < DIGITAL_IO_MAX_TRIG_NUM; trig_idx++)
+	{
+		if (digital_io_fabric.arm & (1U << trig_idx))
+		{
+			DIGITAL_IO_CTX_TRIG_EVENTS[trig_idx].armed = DIGITAL_IO_CTX_TRIG_EVENTS[trig_idx].enable;
+		}
+	}
+
+	// The first edge is kept until it is reported
+	if (digital_io_fabric.pending)
+	{
+		digital_io_fabric.lost++;
+		return;
+	}
+	digital_io_fabric.code = code;
+	digital_io_fabric.edge_tick = edge_tick;
+	digital_io_fabric.local_tick = local_tick;
+	digital_io_fabric.pending = 1;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
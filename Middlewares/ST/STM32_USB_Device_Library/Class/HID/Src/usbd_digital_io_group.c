@@ -0,0 +1,310 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_group.c
+  * @brief   This file provides the integer valued pin groups.
+  *
+  * @verbatim
+  *
+  *          ===================================================================
+  *                                Group Description
+  *          ===================================================================
+  *           A group is an ordered list of up to 16 logical bits, bit 0 of the
+  *           group value is the first pin of the list. The pins may be spread
+  *           over any ports and banks.
+  *           Both directions use nibble tables built from the current remap:
+  *             - write: every value nibble selects the BSRR words of the
+  *               banks (set and reset bits), the words of the nibbles are
+  *               combined and every bank is written once
+  *             - read: every nibble of the packed sample selects its group
+  *               value bits
+  *           The group values of the state report sample follow the state
+  *           report in a REPORT_GROUP.
+  *
+  *  @endverbatim
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_digital_io_group.h"
+
+/* Global variables */
+DIGITAL_IO_GROUP_TypeDef digital_io_group;
+
+/* Private functions */
+static void USBD_HID_Digital_IO_Group_Build(uint8_t group, uint8_t width);
+
+/* Functions */
+
+/**
+  * @brief  USBD_HID_Digital_IO_Group_Process_Command
+  *         Stage the bits of a group or write a value to a group.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Group_Process_Command(uint8_t command, uint8_t* output_buff)
+{
+	/* PROTOCOL:
+	 * COMMAND_GROUP_CONFIG: 10 bytes (applied in the main loop)
+	 * Byte[0]		-> (SSSS | GG | - | A) -> SSSS = first position in the group, GG = group,
+	 *				   A = apply the group after this part (width = SSSS + number of entries, 0 = removed)
+	 * Byte[1]		-> number of entries in this part (0-8)
+	 * Byte[2-9]	-> logical bits (port * 4 + pin) of the positions from SSSS
+	 *
+	 * COMMAND_GROUP_WRITE: 3 bytes (executed at once)
+	 * Byte[0]		-> group
+	 * Byte[1-2]	-> value (little endian, bit 0 -> first pin of the group)
+	 */
+	uint8_t group = 0, start = 0, num = 0, idx = 0;
+
+	switch (command)
+	{
+		case COMMAND_GROUP_CONFIG:
+			group = read_from_byte(output_buff[0], SIZE_2, SHIFT_4);
+			start = read_from_byte(output_buff[0], SIZE_4, SHIFT_0);
+			num = MIN(output_buff[1], DIGITAL_IO_GROUP_MAX_ENTRY);
+			for (idx = 0; idx < num && (start + idx) < DIGITAL_IO_GROUP_MAX_WIDTH; idx++)
+			{
+				digital_io_group.bits_new[group][start + idx] = output_buff[idx + 2];
+			}
+			if (read_from_byte(output_buff[0], SIZE_1, SHIFT_7))
+			{
+				digital_io_group.width_new[group] = start + idx;
+				digital_io_group.request |= (1U << group);
+			}
+			break;
+		case COMMAND_GROUP_WRITE:
+			if (output_buff[0] < DIGITAL_IO_GROUP_NUM)
+			{
+				USBD_HID_Digital_IO_Group_Write(output_buff[0], output_buff[1] | ((uint16_t)output_buff[2] << 8));
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Group_Handle
+  *         Activate the staged groups and build their tables (main loop).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Group_Handle(void)
+{
+	uint8_t request = digital_io_group.request, group = 0, idx = 0, width = 0;
+
+	digital_io_group.request = 0;
+	for (group = 0; group < DIGITAL_IO_GROUP_NUM; group++)
+	{
+		if (!(request & (1U << group)))
+		{
+			continue;
+		}
+
+		// Writes of the USB interrupt skip the group while its tables change
+		digital_io_group.width[group] = 0;
+		__DMB();
+		width = digital_io_group.width_new[group];
+		for (idx = 0; idx < width; idx++)
+		{
+			if (digital_io_group.bits_new[group][idx] >= DIGITAL_IO_MAX_BIT_NUM)
+			{
+				break;
+			}
+			digital_io_group.bits[group][idx] = digital_io_group.bits_new[group][idx];
+		}
+		if (idx < width)
+		{
+			// Invalid bit: the group stays removed
+			continue;
+		}
+		USBD_HID_Digital_IO_Group_Build(group, width);
+		__DMB();
+		digital_io_group.width[group] = width;
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Group_Remap
+  *         Rebuild the tables of the active groups after a new remap (main loop).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Group_Remap(void)
+{
+	uint8_t group = 0, width = 0;
+
+	for (group = 0; group < DIGITAL_IO_GROUP_NUM; group++)
+	{
+		width = digital_io_group.width[group];
+		if (width == 0)
+		{
+			continue;
+		}
+		digital_io_group.width[group] = 0;
+		__DMB();
+		USBD_HID_Digital_IO_Group_Build(group, width);
+		__DMB();
+		digital_io_group.width[group] = width;
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Group_Write
+  *         Write a value to the pins of a group with one BSRR access per bank.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Group_Write(uint8_t group, uint16_t value)
+{
+	uint32_t (*scatter)[DIGITAL_IO_GROUP_NIBBLE_SIZE][GPIO_DIGITAL_BANK_NUM] = digital_io_group.scatter[group];
+	uint32_t bsrr = 0;
+	uint8_t bank_idx = 0;
+
+	if (digital_io_group.width[group] == 0)
+	{
+		return;
+	}
+	for (bank_idx = 0; bank_idx < GPIO_DIGITAL_BANK_NUM; bank_idx++)
+	{
+		bsrr = scatter[0][value & 0x0FU][bank_idx] | scatter[1][(value >> 4) & 0x0FU][bank_idx]
+			 | scatter[2][(value >> 8) & 0x0FU][bank_idx] | scatter[3][(value >> 12) & 0x0FU][bank_idx];
+		if (bsrr != 0)
+		{
+			gpio_digital_bank[bank_idx]->BSRR = bsrr;
+		}
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Group_Read
+  *         Extract the value of a group from a packed sample.
+  * @retval Group value (bit 0 <- first pin of the group)
+  */
+uint16_t USBD_HID_Digital_IO_Group_Read(uint8_t group, uint32_t sample)
+{
+	uint16_t (*gather)[DIGITAL_IO_GROUP_NIBBLE_SIZE] = digital_io_group.gather[group];
+
+	return gather[0][sample & 0x0FU] | gather[1][(sample >> 4) & 0x0FU] | gather[2][(sample >> 8) & 0x0FU]
+		 | gather[3][(sample >> 12) & 0x0FU] | gather[4][(sample >> 16) & 0x0FU] | gather[5][(sample >> 20) & 0x0FU];
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Group_Latch
+  *         Take the group values of the sample of the state report.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Group_Latch(uint32_t sample)
+{
+	uint8_t group = 0;
+
+	digital_io_group.report = 0;
+	for (group = 0; group < DIGITAL_IO_GROUP_NUM; group++)
+	{
+		digital_io_group.value[group] = 0;
+		if (digital_io_group.width[group] != 0)
+		{
+			digital_io_group.value[group] = USBD_HID_Digital_IO_Group_Read(group, sample);
+			digital_io_group.report |= (1U << group);
+		}
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Group_Report
+  *         Create the report of the latched group values.
+  * @retval 1 if a report was created, 0 if no values are latched
+  */
+uint8_t USBD_HID_Digital_IO_Group_Report(uint8_t* report)
+{
+	/* PROTOCOL:
+	 * Output: 11 bytes
+	 * Byte[0]		-> 0x80 | REPORT_GROUP
+	 * Byte[1]		-> defined groups (bit n = group n)
+	 * Byte[2-9]	-> value of group 0-3 (little endian, 0 if not defined)
+	 * Byte[10]		-> 0
+	 *
+	 * Sent after every state report while groups are defined, same sample.
+	 */
+	uint8_t group = 0;
+
+	if (digital_io_group.report == 0)
+	{
+		return 0;
+	}
+
+	report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_GROUP;
+	report[1] = digital_io_group.report;
+	for (group = 0; group < DIGITAL_IO_GROUP_NUM; group++)
+	{
+		report[2 + group * 2] = (uint8_t)(digital_io_group.value[group]);
+		report[3 + group * 2] = (uint8_t)(digital_io_group.value[group] >> 8);
+	}
+	report[10] = 0;
+
+	digital_io_group.report = 0;
+	return 1;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Group_Build
+  *         Build the nibble tables of a group from the current remap.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Group_Build(uint8_t group, uint8_t width)
+{
+	uint32_t mask = 0, value = 0;
+	uint8_t lane = 0, nibble = 0, pos = 0, bit = 0;
+
+	// Value nibble -> BSRR words: the pins of the other nibbles are not touched
+	for (lane = 0; lane < DIGITAL_IO_GROUP_VALUE_LANES; lane++)
+	{
+		for (nibble = 0; nibble < DIGITAL_IO_GROUP_NIBBLE_SIZE; nibble++)
+		{
+			mask = 0;
+			value = 0;
+			for (pos = lane * 4U; pos < lane * 4U + 4U && pos < width; pos++)
+			{
+				mask |= (1UL << digital_io_group.bits[group][pos]);
+				if (nibble & (1U << (pos - lane * 4U)))
+				{
+					value |= (1UL << digital_io_group.bits[group][pos]);
+				}
+			}
+			GPIO_Compile_Packed_DIGITAL_IO(mask, value, digital_io_group.scatter[group][lane][nibble]);
+		}
+	}
+
+	// Sample nibble -> value bits of the positions on these logical bits
+	for (lane = 0; lane < DIGITAL_IO_GROUP_SAMPLE_LANES; lane++)
+	{
+		for (nibble = 0; nibble < DIGITAL_IO_GROUP_NIBBLE_SIZE; nibble++)
+		{
+			digital_io_group.gather[group][lane][nibble] = 0;
+			for (pos = 0; pos < width; pos++)
+			{
+				bit = digital_io_group.bits[group][pos];
+				if (bit / 4U == lane && (nibble & (1U << (bit % 4U))))
+				{
+					digital_io_group.gather[group][lane][nibble] |= (1U << pos);
+				}
+			}
+		}
+	}
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
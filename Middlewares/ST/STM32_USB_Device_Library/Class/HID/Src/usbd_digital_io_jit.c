@@ -0,0 +1,375 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_jit.c
+  * @brief   This file provides the trigger compiler to Thumb-2 code in RAM.
+  *
+  * @verbatim
+  *
+  *          ===================================================================
+  *                                Compiler Description
+  *          ===================================================================
+  *           The enabled triggers are compiled to one straight-line function
+  *           uint32_t f(sample, edge) in a RAM buffer, per trigger:
+  *               MOVW/MOVT r2, #mask      AND.W r2, r0, r2
+  *               MOVW/MOVT r3, #value     CMP r2, r3     BNE next
+  *               MOVW/MOVT r2, #edge_mask AND.W r3, r1, r2
+  *               CMP r3, r2               BNE next
+  *               ORR.W r12, r12, #(1 << id)
+  *           (parts with a zero mask are left out). The main loop runs the
+  *           result against the armed state in trigger order, like the
+  *           interpreter. A change of a trigger falls back to the interpreter
+  *           at once, the main loop compiles again. Triggers which do not fit
+  *           the buffer keep the interpreter.
+  *           The benchmark runs both evaluators on the current sample with
+  *           masked interrupts and reports the mean cycles of one evaluation.
+  *           The sample mode measures the polled read the same way: K
+  *           snapshots with the majority vote (K = oversampling) against one
+  *           packed read, the difference is the cost of the oversampling.
+  *
+  *  @endverbatim
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_digital_io_jit.h"
+#include "gpio.h"
+
+// One result bit per trigger
+#if DIGITAL_IO_MAX_TRIG_NUM > 32
+#error "The compiled code returns the fired triggers in one 32 bit register"
+#endif
+
+/* Global variables */
+DIGITAL_IO_JIT_TypeDef digital_io_jit = {1, 0, 0, DIGITAL_IO_JIT_BENCH_TRIGGER, 0, 0};
+uint16_t digital_io_jit_code[DIGITAL_IO_JIT_CODE_SIZE] __attribute__((aligned(4)));
+
+/* Private functions */
+static void USBD_HID_Digital_IO_Jit_Bench_Sample(uint8_t* report);
+static uint16_t USBD_HID_Digital_IO_Jit_Load(uint16_t pos, uint8_t reg, uint32_t value);
+static uint16_t USBD_HID_Digital_IO_Jit_Match(uint16_t pos, uint8_t reg_input, uint8_t reg_result, uint8_t reg_compare);
+
+/* Functions */
+
+/**
+  * @brief  USBD_HID_Digital_IO_Jit_Invalidate
+  *         Fall back to the interpreter until the triggers are compiled again.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Jit_Invalidate(void)
+{
+	digital_io_jit.valid = 0;
+	digital_io_jit.request = 1;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Jit_Process_Command
+  *         Request a benchmark of the trigger evaluators or of the sample read.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Jit_Process_Command(uint8_t* output_buff)
+{
+	/* PROTOCOL:
+	 * COMMAND_TRIGGER_BENCH: 1 byte (executed in the main loop)
+	 * Byte[0]		-> mode: DIGITAL_IO_JIT_BENCH_TRIGGER or DIGITAL_IO_JIT_BENCH_SAMPLE
+	 *
+	 * Result: REPORT_TRIGGER_BENCH
+	 */
+	digital_io_jit.bench_mode = (output_buff[0] == DIGITAL_IO_JIT_BENCH_SAMPLE) ? DIGITAL_IO_JIT_BENCH_SAMPLE : DIGITAL_IO_JIT_BENCH_TRIGGER;
+	digital_io_jit.bench = 1;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Jit_Compile
+  *         Compile the enabled triggers to Thumb-2 code in the RAM buffer (main loop).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Jit_Compile(void)
+{
+	HID_DIGITAL_IO_TRIGGER_Event* t = DIGITAL_IO_CTX_TRIG_EVENTS;
+	uint32_t primask = 0, imm12 = 0;
+	uint16_t pos = 0, branch[2], branch_num = 0, idx = 0;
+	uint8_t id = 0;
+
+	digital_io_jit.request = 0;
+	digital_io_jit.valid = 0;
+
+	// MOV.W r12, #0
+	digital_io_jit_code[pos++] = 0xF04FU;
+	digital_io_jit_code[pos++] = 0x0C00U;
+
+	for (id = 0; id < DIGITAL_IO_MAX_TRIG_NUM; id++)
+	{
+		if (!t[id].enable)
+		{
+			continue;
+		}
+		if (pos + DIGITAL_IO_JIT_MAX_TRIGGER_SIZE + 2U > DIGITAL_IO_JIT_CODE_SIZE)
+		{
+			// Does not fit: the interpreter stays
+			return;
+		}
+
+		branch_num = 0;
+		if (t[id].mask != 0)
+		{
+			pos = USBD_HID_Digital_IO_Jit_Load(pos, 2, t[id].mask);
+			pos = USBD_HID_Digital_IO_Jit_Load(pos, 3, t[id].value);
+			pos = USBD_HID_Digital_IO_Jit_Match(pos, 0, 2, 3);
+			branch[branch_num++] = pos - 1U;
+		}
+		if (t[id].edge_mask != 0)
+		{
+			pos = USBD_HID_Digital_IO_Jit_Load(pos, 2, t[id].edge_mask);
+			pos = USBD_HID_Digital_IO_Jit_Match(pos, 1, 3, 2);
+			branch[branch_num++] = pos - 1U;
+		}
+
+		// ORR.W r12, r12, #(1 << id): modified immediate i:imm3:imm8, bits above 7 are 0x80 rotated right by 39 - id
+		imm12 = (id < 8U) ? (1U << id) : ((39U - id) << 7);
+		digital_io_jit_code[pos++] = 0xF04CU | (uint16_t)((imm12 >> 11) << 10);
+		digital_io_jit_code[pos++] = 0x0C00U | (uint16_t)(((imm12 >> 8) & 0x07U) << 12) | (uint16_t)(imm12 & 0xFFU);
+
+		// BNE to the next trigger: offset from the branch + 4 bytes, in halfwords
+		for (idx = 0; idx < branch_num; idx++)
+		{
+			digital_io_jit_code[branch[idx]] = 0xD100U | (uint16_t)(pos - branch[idx] - 2U);
+		}
+	}
+
+	// MOV r0, r12; BX LR
+	digital_io_jit_code[pos++] = 0x4660U;
+	digital_io_jit_code[pos++] = 0x4770U;
+	digital_io_jit.size = pos;
+	digital_io_jit.function = (Digital_IO_Jit_Function)((uint32_t)digital_io_jit_code | 0x01U);
+
+	// The new instructions must reach the bus before they are fetched
+	__DSB();
+	__ISB();
+
+	// A trigger changed by the USB interrupt meanwhile: compile again in the next pass
+	primask = __get_PRIMASK();
+	__disable_irq();
+	digital_io_jit.valid = !digital_io_jit.request;
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Jit_Interpret
+  *         Evaluate the triggers from their mask/value pairs.
+  * @retval Bit n = trigger n matches
+  */
+uint32_t USBD_HID_Digital_IO_Jit_Interpret(uint32_t sample, uint32_t edge)
+{
+	HID_DIGITAL_IO_TRIGGER_Event* t = DIGITAL_IO_CTX_TRIG_EVENTS;
+	uint32_t match = 0;
+	uint8_t id = 0;
+
+	for (id = 0; id < DIGITAL_IO_MAX_TRIG_NUM; id++)
+	{
+		if (t[id].enable && ((sample & t[id].mask) == t[id].value) && ((edge & t[id].edge_mask) == t[id].edge_mask))
+		{
+			match |= (1UL << id);
+		}
+	}
+	return match;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Jit_Evaluate
+  *         Evaluate the triggers with the compiled code, or the interpreter if there is none.
+  * @retval Bit n = trigger n matches
+  */
+uint32_t USBD_HID_Digital_IO_Jit_Evaluate(uint32_t sample, uint32_t edge)
+{
+	if (digital_io_jit.valid)
+	{
+		return digital_io_jit.function(sample, edge);
+	}
+	return USBD_HID_Digital_IO_Jit_Interpret(sample, edge);
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Jit_Bench
+  *         Measure the requested benchmark and report the cycles (main loop).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Jit_Bench(void)
+{
+	uint8_t report[DIGITAL_IO_REPORT_SIZE] = {0};
+	uint32_t primask = __get_PRIMASK(), start = 0, compiled = 0, interpreted = 0, match = 0, check = 0;
+	uint16_t run = 0;
+
+	digital_io_jit.bench = 0;
+	if (digital_io_jit.bench_mode == DIGITAL_IO_JIT_BENCH_SAMPLE)
+	{
+		USBD_HID_Digital_IO_Jit_Bench_Sample(report);
+		USBD_HID_Digital_IO_Queue_Report(REPORT_CLASS_ACK, report);
+		return;
+	}
+
+	__disable_irq();
+	if (digital_io_jit.valid)
+	{
+		start = DIGITAL_IO_TIMESTAMP();
+		for (run = 0; run < DIGITAL_IO_JIT_BENCH_RUNS; run++)
+		{
+			match |= digital_io_jit.function(DIGITAL_IO_CTX_SAMPLE, DIGITAL_IO_CTX_EDGE);
+		}
+		compiled = DIGITAL_IO_TIMESTAMP() - start;
+	}
+	start = DIGITAL_IO_TIMESTAMP();
+	for (run = 0; run < DIGITAL_IO_JIT_BENCH_RUNS; run++)
+	{
+		check |= USBD_HID_Digital_IO_Jit_Interpret(DIGITAL_IO_CTX_SAMPLE, DIGITAL_IO_CTX_EDGE);
+	}
+	interpreted = DIGITAL_IO_TIMESTAMP() - start;
+	__set_PRIMASK(primask);
+
+	/* PROTOCOL:
+	 * Output: 11 bytes
+	 * Byte[0]		-> 0x80 | REPORT_TRIGGER_BENCH
+	 * Byte[1]		-> (V | M | S | -----) -> V = compiled code is active, M = both evaluators gave the same result,
+	 *				   S = 0 (trigger mode)
+	 * Byte[2-3]	-> size of the compiled code (bytes, little endian)
+	 * Byte[4-5]	-> CPU cycles of one compiled evaluation (mean with the loop, 0 if not active)
+	 * Byte[6-7]	-> CPU cycles of one interpreted evaluation
+	 * Byte[8-9]	-> matching triggers (bit = ID)
+	 */
+	report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_TRIGGER_BENCH;
+	report[1] = (digital_io_jit.valid ? 0x01U : 0) | ((!digital_io_jit.valid || match == check) ? 0x02U : 0);
+	report[2] = (uint8_t)(digital_io_jit.size * 2U);
+	report[3] = (uint8_t)((digital_io_jit.size * 2U) >> 8);
+	compiled /= DIGITAL_IO_JIT_BENCH_RUNS;
+	interpreted /= DIGITAL_IO_JIT_BENCH_RUNS;
+	report[4] = (uint8_t)(compiled);
+	report[5] = (uint8_t)(compiled >> 8);
+	report[6] = (uint8_t)(interpreted);
+	report[7] = (uint8_t)(interpreted >> 8);
+	report[8] = (uint8_t)(check);
+	report[9] = (uint8_t)(check >> 8);
+	USBD_HID_Digital_IO_Queue_Report(REPORT_CLASS_ACK, report);
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Jit_Bench_Sample
+  *         Measure the oversampled read against one packed read.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Jit_Bench_Sample(uint8_t* report)
+{
+	uint32_t samples[DIGITAL_IO_MAX_OVERSAMPLING];
+	uint32_t primask = __get_PRIMASK(), start = 0, oversampled = 0, single = 0, sample = 0, check = 0;
+	uint8_t num = DIGITAL_IO_CTX_OVERSAMPLING;
+	uint16_t run = 0;
+
+	// Same steps as USBD_HID_Digital_IO_Read
+	__disable_irq();
+	start = DIGITAL_IO_TIMESTAMP();
+	for (run = 0; run < DIGITAL_IO_JIT_BENCH_RUNS; run++)
+	{
+		if (num <= 1)
+		{
+			sample = GPIO_Read_Packed_DIGITAL_IO();
+		}
+		else
+		{
+			GPIO_Snapshot_DIGITAL_IO(samples, num);
+			sample = USBD_HID_Digital_IO_Majority(samples, num);
+		}
+		check |= sample;
+	}
+	oversampled = DIGITAL_IO_TIMESTAMP() - start;
+	start = DIGITAL_IO_TIMESTAMP();
+	for (run = 0; run < DIGITAL_IO_JIT_BENCH_RUNS; run++)
+	{
+		check |= GPIO_Read_Packed_DIGITAL_IO();
+	}
+	single = DIGITAL_IO_TIMESTAMP() - start;
+	__set_PRIMASK(primask);
+
+	/* PROTOCOL:
+	 * Output: 11 bytes
+	 * Byte[0]		-> 0x80 | REPORT_TRIGGER_BENCH
+	 * Byte[1]		-> (- | - | S | -----) -> S = 1 (sample mode)
+	 * Byte[2]		-> K: snapshots per sample (oversampling)
+	 * Byte[3]		-> reserved
+	 * Byte[4-5]	-> CPU cycles of one read with K snapshots and the majority vote (mean with the loop)
+	 * Byte[6-7]	-> CPU cycles of one packed read
+	 * Byte[8-10]	-> OR of all measured samples (keeps the reads, little endian)
+	 */
+	oversampled /= DIGITAL_IO_JIT_BENCH_RUNS;
+	single /= DIGITAL_IO_JIT_BENCH_RUNS;
+	report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_TRIGGER_BENCH;
+	report[1] = 0x04U;
+	report[2] = num;
+	report[4] = (uint8_t)(oversampled);
+	report[5] = (uint8_t)(oversampled >> 8);
+	report[6] = (uint8_t)(single);
+	report[7] = (uint8_t)(single >> 8);
+	report[8] = (uint8_t)(check);
+	report[9] = (uint8_t)(check >> 8);
+	report[10] = (uint8_t)(check >> 16);
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Jit_Load
+  *         Emit MOVW (and MOVT for the upper half) of a constant.
+  * @retval Next position in the code buffer
+  */
+static uint16_t USBD_HID_Digital_IO_Jit_Load(uint16_t pos, uint8_t reg, uint32_t value)
+{
+	uint16_t half = (uint16_t)value;
+	uint8_t word = 0;
+
+	for (word = 0; word < 2; word++)
+	{
+		// MOVW (0xF240) / MOVT (0xF2C0): imm16 = imm4:i:imm3:imm8
+		digital_io_jit_code[pos++] = (word ? 0xF2C0U : 0xF240U) | ((half >> 12) & 0x000FU) | (((half >> 11) & 0x01U) << 10);
+		digital_io_jit_code[pos++] = (((half >> 8) & 0x07U) << 12) | ((uint16_t)reg << 8) | (half & 0x00FFU);
+
+		half = (uint16_t)(value >> 16);
+		if (half == 0)
+		{
+			// MOVW cleared the upper half
+			break;
+		}
+	}
+	return pos;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Jit_Match
+  *         Emit AND.W of the input with the mask in r2, CMP and a BNE placeholder.
+  * @retval Next position in the code buffer (the BNE is the last halfword)
+  */
+static uint16_t USBD_HID_Digital_IO_Jit_Match(uint16_t pos, uint8_t reg_input, uint8_t reg_result, uint8_t reg_compare)
+{
+	// AND.W Rd, Rn, r2
+	digital_io_jit_code[pos++] = 0xEA00U | reg_input;
+	digital_io_jit_code[pos++] = ((uint16_t)reg_result << 8) | 0x02U;
+	// CMP Rn, Rm (16 bit)
+	digital_io_jit_code[pos++] = 0x4280U | ((uint16_t)reg_compare << 3) | reg_result;
+	// BNE, patched when the end of the trigger is known
+	digital_io_jit_code[pos++] = 0xD100U;
+	return pos;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,259 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_latency.c
+  * @brief   This file provides the stimulus to response latency measurement.
+  *
+  * @verbatim
+  *
+  *          ===================================================================
+  *                                Latency Description
+  *          ===================================================================
+  *           One measurement per main loop pass, after the rest time:
+  *             - the response pin must be at its idle level
+  *             - interrupts are disabled, the cycle counter is read right
+  *               before the BSRR write of the stimulus
+  *             - the response pin is polled (IDR and its EXTI edge latch, so
+  *               pulses shorter than the poll loop are not missed) until it
+  *               reaches the expected level or the timeout expires
+  *             - the stimulus returns to its idle level, the HAL tick is
+  *               corrected for the missed SysTick interrupts
+  *           Times are CPU cycles of the device timebase (DIGITAL_IO_TIMESTAMP),
+  *           min, max and mean are reported after the last run.
+  *
+  *  @endverbatim
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_digital_io_latency.h"
+#include "gpio.h"
+
+/* HAL tick counter, corrected after a measurement with disabled interrupts */
+extern __IO uint32_t uwTick;
+
+/* Global variables */
+DIGITAL_IO_LATENCY_TypeDef digital_io_latency;
+
+/* Private functions */
+static void USBD_HID_Digital_IO_Latency_Measure(void);
+static void USBD_HID_Digital_IO_Latency_Report(void);
+
+/* Functions */
+
+/**
+  * @brief  USBD_HID_Digital_IO_Latency_Process_Command
+  *         Store a latency test request.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Latency_Process_Command(uint8_t* output_buff)
+{
+	/* PROTOCOL:
+	 * COMMAND_LATENCY: 8 bytes (executed in the main loop)
+	 * Byte[0]		-> (P | -- | SSSSS) -> SSSSS = stimulus logical bit (output pin), P = active stimulus level
+	 * Byte[1]		-> (E | -- | RRRRR) -> RRRRR = response logical bit, E = expected response level
+	 * Byte[2-3]	-> number of runs (0 = stop the test and report)
+	 * Byte[4-5]	-> timeout of one run in us (0 or above 10000 = 10000)
+	 * Byte[6-7]	-> rest time between the runs in us
+	 *
+	 * Result: REPORT_LATENCY after the last run.
+	 */
+	uint16_t runs = output_buff[2] | ((uint16_t)output_buff[3] << 8);
+
+	if (runs == 0)
+	{
+		if (digital_io_latency.state != LATENCY_IDLE)
+		{
+			digital_io_latency.state = LATENCY_STOP;
+		}
+		return;
+	}
+	// No change of the settings while a run could read them
+	if (digital_io_latency.state != LATENCY_IDLE)
+	{
+		return;
+	}
+
+	digital_io_latency.stimulus = read_from_byte(output_buff[0], SIZE_5, SHIFT_0) % DIGITAL_IO_MAX_BIT_NUM;
+	digital_io_latency.stimulus_level = read_from_byte(output_buff[0], SIZE_1, SHIFT_7);
+	digital_io_latency.response = read_from_byte(output_buff[1], SIZE_5, SHIFT_0) % DIGITAL_IO_MAX_BIT_NUM;
+	digital_io_latency.response_level = read_from_byte(output_buff[1], SIZE_1, SHIFT_7);
+	digital_io_latency.runs = runs;
+	digital_io_latency.timeout = output_buff[4] | ((uint16_t)output_buff[5] << 8);
+	if (digital_io_latency.timeout == 0 || digital_io_latency.timeout > DIGITAL_IO_LATENCY_MAX_TIMEOUT)
+	{
+		digital_io_latency.timeout = DIGITAL_IO_LATENCY_MAX_TIMEOUT;
+	}
+	digital_io_latency.rest = output_buff[6] | ((uint16_t)output_buff[7] << 8);
+	digital_io_latency.state = LATENCY_START;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Latency_Handle
+  *         Run the next measurement of the active test (main loop).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Latency_Handle(void)
+{
+	uint32_t rest = (SystemCoreClock / 1000000U) * digital_io_latency.rest;
+
+	switch (digital_io_latency.state)
+	{
+		case LATENCY_START:
+			digital_io_latency.done = 0;
+			digital_io_latency.timeouts = 0;
+			digital_io_latency.min = 0xFFFFFFFFU;
+			digital_io_latency.max = 0;
+			digital_io_latency.sum = 0;
+			digital_io_latency.last_end = DIGITAL_IO_TIMESTAMP() - rest;
+			digital_io_latency.state = LATENCY_RUNNING;
+			break;
+		case LATENCY_RUNNING:
+			if ((DIGITAL_IO_TIMESTAMP() - digital_io_latency.last_end) < rest)
+			{
+				break;
+			}
+			USBD_HID_Digital_IO_Latency_Measure();
+			if (digital_io_latency.done >= digital_io_latency.runs)
+			{
+				USBD_HID_Digital_IO_Latency_Report();
+				digital_io_latency.state = LATENCY_IDLE;
+			}
+			break;
+		case LATENCY_STOP:
+			USBD_HID_Digital_IO_Latency_Report();
+			digital_io_latency.state = LATENCY_IDLE;
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Latency_Measure
+  *         Apply the stimulus and wait for the response with disabled interrupts.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Latency_Measure(void)
+{
+	uint32_t active[GPIO_DIGITAL_BANK_NUM], idle[GPIO_DIGITAL_BANK_NUM];
+	uint32_t stimulus = 1U << digital_io_latency.stimulus, response = 1U << digital_io_latency.response;
+	uint32_t line = 0, expected = 0, start = 0, now = 0, base = uwTick, cycles_per_ms = SystemCoreClock / 1000U;
+	uint32_t timeout = (SystemCoreClock / 1000000U) * digital_io_latency.timeout, primask = __get_PRIMASK();
+	uint8_t phys = gpio_digital_remap[digital_io_latency.response], bank_idx = 0, line_idx = 0, found = 0;
+	GPIO_TypeDef* port = gpio_digital_port[phys / DIGITAL_MAX_PIN_NUM][phys % DIGITAL_MAX_PIN_NUM];
+	uint16_t pin = gpio_digital_pin[phys / DIGITAL_MAX_PIN_NUM][phys % DIGITAL_MAX_PIN_NUM];
+
+	GPIO_Compile_Packed_DIGITAL_IO(stimulus, digital_io_latency.stimulus_level ? stimulus : 0, active);
+	GPIO_Compile_Packed_DIGITAL_IO(stimulus, digital_io_latency.stimulus_level ? 0 : stimulus, idle);
+	expected = digital_io_latency.response_level ? pin : 0;
+
+	// EXTI edge latch of the response pin (if it got a line)
+	for (line_idx = 0; line_idx < GPIO_DIGITAL_EDGE_LINE_NUM; line_idx++)
+	{
+		if (gpio_digital_edge_line[line_idx] == digital_io_latency.response)
+		{
+			line = 1U << line_idx;
+		}
+	}
+
+	digital_io_latency.done++;
+	// The response has to start from its idle level
+	if ((port->IDR & pin) == expected || response == stimulus)
+	{
+		digital_io_latency.timeouts++;
+		digital_io_latency.last_end = DIGITAL_IO_TIMESTAMP();
+		return;
+	}
+
+	__disable_irq();
+	EXTI->PR = line;
+	start = DIGITAL_IO_TIMESTAMP();
+	for (bank_idx = 0; bank_idx < GPIO_DIGITAL_BANK_NUM; bank_idx++)
+	{
+		if (active[bank_idx] != 0)
+		{
+			gpio_digital_bank[bank_idx]->BSRR = active[bank_idx];
+		}
+	}
+	do
+	{
+		now = DIGITAL_IO_TIMESTAMP();
+		found = ((port->IDR & pin) == expected) || (EXTI->PR & line);
+	} while (!found && (now - start) < timeout);
+
+	for (bank_idx = 0; bank_idx < GPIO_DIGITAL_BANK_NUM; bank_idx++)
+	{
+		if (idle[bank_idx] != 0)
+		{
+			gpio_digital_bank[bank_idx]->BSRR = idle[bank_idx];
+		}
+	}
+	// Ticks of the missed SysTick interrupts
+	digital_io_latency.last_end = DIGITAL_IO_TIMESTAMP();
+	uwTick = base + (digital_io_latency.last_end - start) / cycles_per_ms;
+	__set_PRIMASK(primask);
+
+	if (!found)
+	{
+		digital_io_latency.timeouts++;
+		return;
+	}
+	now -= start;
+	digital_io_latency.sum += now;
+	digital_io_latency.min = MIN(digital_io_latency.min, now);
+	digital_io_latency.max = MAX(digital_io_latency.max, now);
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Latency_Report
+  *         Queue the summary of the test.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Latency_Report(void)
+{
+	uint8_t report[DIGITAL_IO_REPORT_SIZE] = {0};
+	uint32_t valid = digital_io_latency.done - digital_io_latency.timeouts;
+	uint32_t min = valid ? digital_io_latency.min : 0, max = digital_io_latency.max;
+	uint32_t mean = valid ? (uint32_t)(digital_io_latency.sum / valid) : 0;
+
+	/* PROTOCOL:
+	 * Output: 11 bytes
+	 * Byte[0]		-> 0x80 | REPORT_LATENCY
+	 * Byte[1]		-> runs without response (timeout or response not idle), saturated
+	 * Byte[2-4]	-> min response time (CPU cycles, little endian)
+	 * Byte[5-7]	-> max response time
+	 * Byte[8-10]	-> mean response time
+	 */
+	report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_LATENCY;
+	report[1] = (digital_io_latency.timeouts > 0xFF) ? 0xFF : (uint8_t)digital_io_latency.timeouts;
+	report[2] = (uint8_t)(min);
+	report[3] = (uint8_t)(min >> 8);
+	report[4] = (uint8_t)(min >> 16);
+	report[5] = (uint8_t)(max);
+	report[6] = (uint8_t)(max >> 8);
+	report[7] = (uint8_t)(max >> 16);
+	report[8] = (uint8_t)(mean);
+	report[9] = (uint8_t)(mean >> 8);
+	report[10] = (uint8_t)(mean >> 16);
+	USBD_HID_Digital_IO_Queue_Report(REPORT_CLASS_ACK, report);
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,531 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_log.c
+  * @brief   This file provides the non-volatile transition recorder.
+  *
+  * @verbatim
+  *
+  *          ===================================================================
+  *                                Log Description
+  *          ===================================================================
+  *           The log is a ring of flash sectors (5-7), every sector starts with
+  *           a header (magic, sequence number, time base in ms) followed by
+  *           record words until the first erased word:
+  *             - records are staged in RAM and programmed a few words per main
+  *               loop pass, a power loss loses only the staged words
+  *             - the sector after the active one is erased in the background
+  *               as soon as it is marked and the capture is idle; the erase
+  *               never delays a running capture: a log which reaches the
+  *               sector meanwhile waits with its records in RAM, records
+  *               which do not fit there are counted as lost
+  *             - during an erase the CPU cannot read the flash: the erase runs
+  *               from RAM with the interrupts disabled and keeps sampling the
+  *               pins into the log
+  *           After reset the newest sector is replayed to find the end of the log,
+  *           an interrupted recording continues with a new start marker.
+  *
+  *  @endverbatim
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_digital_io_log.h"
+#include "usbd_digital_io_capture.h"
+#include "gpio.h"
+
+/* HAL tick counter, corrected after an erase with disabled interrupts */
+extern __IO uint32_t uwTick;
+
+/* Global variables */
+DIGITAL_IO_LOG_TypeDef digital_io_log;
+uint32_t digital_io_log_stage[DIGITAL_IO_LOG_STAGE_SIZE];
+
+/* Private functions */
+static uint8_t USBD_HID_Digital_IO_Log_Blank(uint8_t idx);
+static void USBD_HID_Digital_IO_Log_Open(uint8_t idx);
+static void USBD_HID_Digital_IO_Log_Program(void);
+static void USBD_HID_Digital_IO_Log_Erase(uint8_t idx);
+static void USBD_HID_Digital_IO_Log_Put(uint32_t word);
+static void USBD_HID_Digital_IO_Log_Record(Digital_IO_Log_Record type, uint32_t payload, uint32_t tick);
+static void USBD_HID_Digital_IO_Log_Record_Sample(uint32_t sample, uint32_t edge, uint32_t tick);
+
+/* Functions */
+
+/**
+  * @brief  USBD_HID_Digital_IO_Log_Init
+  *         Find the end of the log after reset and resume an interrupted recording.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Log_Init(void)
+{
+	const uint32_t* word = NULL;
+	uint32_t pos = 0, tick = 0;
+	uint8_t idx = 0, active = DIGITAL_IO_LOG_SECTOR_NUM, time = 0, recording = 0;
+
+	digital_io_log.recording = 0;
+	digital_io_log.request = 0;
+	digital_io_log.sector = DIGITAL_IO_LOG_SECTOR_NUM - 1;
+	digital_io_log.erase_pending = 0;
+	digital_io_log.sequence = 0;
+	digital_io_log.write_addr = 0;
+	digital_io_log.last_sample = 0;
+	digital_io_log.flash_tick = 0;
+	digital_io_log.flash_time = 0;
+	digital_io_log.lost = 0;
+	digital_io_log.lost_mark = 0;
+	digital_io_log.stage_head = 0;
+	digital_io_log.stage_tail = 0;
+	// The first record after reset carries the absolute time
+	digital_io_log.last_tick = HAL_GetTick() - (DIGITAL_IO_LOG_MAX_DELTA + 1);
+
+	// Newest sector: highest sequence number
+	for (idx = 0; idx < DIGITAL_IO_LOG_SECTOR_NUM; idx++)
+	{
+		word = (const uint32_t*)DIGITAL_IO_LOG_SECTOR_ADDR(idx);
+		if (word[0] == DIGITAL_IO_LOG_MAGIC && word[1] != DIGITAL_IO_LOG_ERASED
+			&& (active == DIGITAL_IO_LOG_SECTOR_NUM || word[1] > digital_io_log.sequence))
+		{
+			active = idx;
+			digital_io_log.sequence = word[1];
+		}
+	}
+
+	if (active == DIGITAL_IO_LOG_SECTOR_NUM)
+	{
+		// No log yet: erase what is not blank, the first sector opens in the main loop
+		digital_io_log.sequence = 0;
+		for (idx = 0; idx < DIGITAL_IO_LOG_SECTOR_NUM; idx++)
+		{
+			if (!USBD_HID_Digital_IO_Log_Blank(idx))
+			{
+				digital_io_log.erase_pending |= (1U << idx);
+			}
+		}
+		return;
+	}
+
+	// Replay the records: end of the log, time base and recorder state
+	word = (const uint32_t*)DIGITAL_IO_LOG_SECTOR_ADDR(active);
+	tick = word[2];
+	for (pos = DIGITAL_IO_LOG_HEADER_SIZE; pos < DIGITAL_IO_LOG_SECTOR_SIZE / 4U && word[pos] != DIGITAL_IO_LOG_ERASED; pos++)
+	{
+		if (time)
+		{
+			tick = word[pos];
+			time = 0;
+		}
+		else if (word[pos] == DIGITAL_IO_LOG_TIME)
+		{
+			time = 1;
+		}
+		else
+		{
+			tick += (word[pos] >> 24) & DIGITAL_IO_LOG_MAX_DELTA;
+			if ((word[pos] >> 30) == LOG_EVENT && (word[pos] & DIGITAL_IO_LOG_PAYLOAD) == DIGITAL_IO_LOG_MARK_START)
+			{
+				recording = 1;
+			}
+			else if ((word[pos] >> 30) == LOG_EVENT && (word[pos] & DIGITAL_IO_LOG_PAYLOAD) == DIGITAL_IO_LOG_MARK_STOP)
+			{
+				recording = 0;
+			}
+		}
+	}
+	digital_io_log.sector = active;
+	digital_io_log.write_addr = DIGITAL_IO_LOG_SECTOR_ADDR(active) + pos * 4U;
+	digital_io_log.flash_tick = tick;
+
+	// A time record cut by the reset gets a dummy time, the next record brings the new one
+	if (time)
+	{
+		USBD_HID_Digital_IO_Log_Put(0);
+	}
+	if (!USBD_HID_Digital_IO_Log_Blank((active + 1) % DIGITAL_IO_LOG_SECTOR_NUM))
+	{
+		digital_io_log.erase_pending |= (1U << ((active + 1) % DIGITAL_IO_LOG_SECTOR_NUM));
+	}
+
+	if (recording)
+	{
+		digital_io_log.request |= DIGITAL_IO_LOG_REQUEST_START;
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Log_Process_Command
+  *         Start, stop or clear the recorder, request a status report.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Log_Process_Command(uint8_t* output_buff)
+{
+	/* PROTOCOL:
+	 * COMMAND_LOG: 1 byte (executed in the main loop)
+	 * Byte[0]		-> (R | C | S | -----) -> R = record (1 start, 0 stop), C = clear the log, S = send a status report
+	 *
+	 * The log is read back with COMMAND_DOWNLOAD (UPLOAD_LOG) and GET_REPORT (feature).
+	 */
+	uint8_t request = 0;
+
+	request = read_from_byte(output_buff[0], SIZE_1, SHIFT_0) ? DIGITAL_IO_LOG_REQUEST_START : DIGITAL_IO_LOG_REQUEST_STOP;
+	if (read_from_byte(output_buff[0], SIZE_1, SHIFT_1))
+	{
+		request |= DIGITAL_IO_LOG_REQUEST_CLEAR;
+	}
+	if (read_from_byte(output_buff[0], SIZE_1, SHIFT_2))
+	{
+		request |= DIGITAL_IO_LOG_REQUEST_STATUS;
+	}
+	digital_io_log.request = request;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Log_Sample
+  *         Record the level changes and glitches of a new sample.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Log_Sample(uint32_t sample, uint32_t edge)
+{
+	if (digital_io_log.recording && (sample != digital_io_log.last_sample || edge != 0))
+	{
+		USBD_HID_Digital_IO_Log_Record_Sample(sample, edge, HAL_GetTick());
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Log_Event
+  *         Record a trigger event or a marker.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Log_Event(uint16_t id)
+{
+	if (digital_io_log.recording)
+	{
+		USBD_HID_Digital_IO_Log_Record(LOG_EVENT, id, HAL_GetTick());
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Log_Handle
+  *         Program staged records, switch and erase sectors (main loop).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Log_Handle(void)
+{
+	uint8_t request = digital_io_log.request, report[DIGITAL_IO_REPORT_SIZE], idx = 0, next = 0;
+
+	if (request != 0)
+	{
+		digital_io_log.request = 0;
+		if ((request & DIGITAL_IO_LOG_REQUEST_STOP) && digital_io_log.recording)
+		{
+			USBD_HID_Digital_IO_Log_Event(DIGITAL_IO_LOG_MARK_STOP);
+			digital_io_log.recording = 0;
+		}
+		if (request & DIGITAL_IO_LOG_REQUEST_CLEAR)
+		{
+			// Drop the staged words and start a new log in the first sector
+			digital_io_log.stage_tail = digital_io_log.stage_head;
+			digital_io_log.erase_pending = (1U << DIGITAL_IO_LOG_SECTOR_NUM) - 1U;
+			digital_io_log.write_addr = 0;
+			digital_io_log.sector = DIGITAL_IO_LOG_SECTOR_NUM - 1;
+			digital_io_log.sequence = 0;
+			digital_io_log.flash_time = 0;
+			digital_io_log.lost = 0;
+			digital_io_log.lost_mark = 0;
+			digital_io_log.last_tick = HAL_GetTick() - (DIGITAL_IO_LOG_MAX_DELTA + 1);
+			if (digital_io_log.recording)
+			{
+				request |= DIGITAL_IO_LOG_REQUEST_START;
+				digital_io_log.recording = 0;
+			}
+		}
+		if ((request & DIGITAL_IO_LOG_REQUEST_START) && !digital_io_log.recording)
+		{
+			// Start marker and the initial levels
+			digital_io_log.recording = 1;
+			USBD_HID_Digital_IO_Log_Event(DIGITAL_IO_LOG_MARK_START);
+			USBD_HID_Digital_IO_Log_Record(LOG_LEVEL, DIGITAL_IO_CTX_SAMPLE, HAL_GetTick());
+			digital_io_log.last_sample = DIGITAL_IO_CTX_SAMPLE;
+		}
+		if (request & DIGITAL_IO_LOG_REQUEST_STATUS)
+		{
+			USBD_HID_Digital_IO_Log_Status_Report(report);
+			USBD_HID_Digital_IO_Queue_Report(REPORT_CLASS_ACK, report);
+		}
+	}
+
+	if (digital_io_log.stage_tail == digital_io_log.stage_head && digital_io_log.erase_pending == 0 && digital_io_log.write_addr != 0)
+	{
+		return;
+	}
+
+	HAL_FLASH_Unlock();
+	next = (digital_io_log.sector + 1) % DIGITAL_IO_LOG_SECTOR_NUM;
+	if (digital_io_log.write_addr == 0 || digital_io_log.write_addr + 8U > DIGITAL_IO_LOG_SECTOR_ADDR(digital_io_log.sector) + DIGITAL_IO_LOG_SECTOR_SIZE)
+	{
+		// The log reached the next sector: erase it now if the background erase did not run yet.
+		// The erase disables the interrupts for seconds, a running capture would lose its DMA blocks:
+		// the records wait in the staging buffer until the capture stops
+		if ((digital_io_log.erase_pending & (1U << next)) && digital_io_capture.state == CAPTURE_IDLE)
+		{
+			USBD_HID_Digital_IO_Log_Erase(next);
+			digital_io_log.erase_pending &= ~(1U << next);
+		}
+		if (!(digital_io_log.erase_pending & (1U << next)))
+		{
+			USBD_HID_Digital_IO_Log_Open(next);
+		}
+	}
+	else if (digital_io_log.erase_pending != 0 && digital_io_capture.state == CAPTURE_IDLE)
+	{
+		// Background erase, the sector after the active one first (marked when the active one opened)
+		for (idx = 0; !(digital_io_log.erase_pending & (1U << idx)); idx++);
+		if (digital_io_log.erase_pending & (1U << next))
+		{
+			idx = next;
+		}
+		USBD_HID_Digital_IO_Log_Erase(idx);
+		digital_io_log.erase_pending &= ~(1U << idx);
+	}
+	// No open sector while the next one waits for its erase
+	if (digital_io_log.write_addr != 0)
+	{
+		USBD_HID_Digital_IO_Log_Program();
+	}
+	HAL_FLASH_Lock();
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Log_Status_Report
+  *         Create a log status report.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Log_Status_Report(uint8_t* report)
+{
+	/* PROTOCOL:
+	 * Output: 11 bytes
+	 * Byte[0]		-> 0x80 | REPORT_LOG
+	 * Byte[1]		-> (R | EEE | ----) -> R = recording, EEE = sectors waiting for erase
+	 * Byte[2-5]	-> end of the log (byte offset from the log base, little endian)
+	 * Byte[6-9]	-> sequence number of the active sector
+	 * Byte[10]		-> records lost (staging buffer full, also while a capture holds back the erase of the next sector), saturated
+	 */
+	report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_LOG;
+	report[1] = digital_io_log.recording | (digital_io_log.erase_pending << 1);
+	write_uint32(&report[2], (digital_io_log.write_addr != 0) ? (digital_io_log.write_addr - DIGITAL_IO_LOG_BASE) : 0);
+	write_uint32(&report[6], digital_io_log.sequence);
+	report[10] = (digital_io_log.lost > 0xFF) ? 0xFF : (uint8_t)digital_io_log.lost;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Log_Blank
+  *         Check that a log sector is erased.
+  * @retval 1 if every word is erased
+  */
+static uint8_t USBD_HID_Digital_IO_Log_Blank(uint8_t idx)
+{
+	const uint32_t* word = (const uint32_t*)DIGITAL_IO_LOG_SECTOR_ADDR(idx);
+	uint32_t pos = 0;
+
+	for (pos = 0; pos < DIGITAL_IO_LOG_SECTOR_SIZE / 4U; pos++)
+	{
+		if (word[pos] != DIGITAL_IO_LOG_ERASED)
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Log_Open
+  *         Write the header of an erased sector and continue the log there.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Log_Open(uint8_t idx)
+{
+	uint32_t addr = DIGITAL_IO_LOG_SECTOR_ADDR(idx);
+	uint8_t next = (idx + 1) % DIGITAL_IO_LOG_SECTOR_NUM;
+
+	// Time base: time of the last record in the previous sector
+	digital_io_log.sequence++;
+	HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, addr, DIGITAL_IO_LOG_MAGIC);
+	HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, addr + 4U, digital_io_log.sequence);
+	HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, addr + 8U, digital_io_log.flash_tick);
+	digital_io_log.sector = idx;
+	digital_io_log.write_addr = addr + DIGITAL_IO_LOG_HEADER_SIZE * 4U;
+
+	// The oldest sector is erased before the log reaches it
+	if (!(digital_io_log.erase_pending & (1U << next)) && !USBD_HID_Digital_IO_Log_Blank(next))
+	{
+		digital_io_log.erase_pending |= (1U << next);
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Log_Program
+  *         Program a burst of staged words into the active sector.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Log_Program(void)
+{
+	uint32_t word = 0, end = DIGITAL_IO_LOG_SECTOR_ADDR(digital_io_log.sector) + DIGITAL_IO_LOG_SECTOR_SIZE;
+	uint8_t num = 0;
+
+	for (num = 0; num < DIGITAL_IO_LOG_PROGRAM_BURST && digital_io_log.stage_tail != digital_io_log.stage_head; num++)
+	{
+		word = digital_io_log_stage[digital_io_log.stage_tail];
+
+		// A time record is not split between two sectors
+		if (digital_io_log.write_addr + ((word == DIGITAL_IO_LOG_TIME && !digital_io_log.flash_time) ? 8U : 4U) > end)
+		{
+			break;
+		}
+		if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, digital_io_log.write_addr, word) != HAL_OK)
+		{
+			break;
+		}
+		digital_io_log.write_addr += 4U;
+		digital_io_log.stage_tail = (digital_io_log.stage_tail + 1) % DIGITAL_IO_LOG_STAGE_SIZE;
+
+		// Follow the time of the programmed records (time base of the next header)
+		if (digital_io_log.flash_time)
+		{
+			digital_io_log.flash_tick = word;
+			digital_io_log.flash_time = 0;
+		}
+		else if (word == DIGITAL_IO_LOG_TIME)
+		{
+			digital_io_log.flash_time = 1;
+		}
+		else
+		{
+			digital_io_log.flash_tick += (word >> 24) & DIGITAL_IO_LOG_MAX_DELTA;
+		}
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Log_Erase
+  *         Erase a log sector and sample the pins from RAM until it is finished.
+  *         Every flash read (code, vector table) would stall during the erase.
+  * @retval None
+  */
+__RAM_FUNC static void USBD_HID_Digital_IO_Log_Erase(uint8_t idx)
+{
+	uint32_t start = DIGITAL_IO_TIMESTAMP(), cycles_per_ms = SystemCoreClock / 1000U, base = uwTick;
+	uint32_t sample = 0, edge = 0, primask = __get_PRIMASK();
+
+	__disable_irq();
+	FLASH->SR = FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR;
+	FLASH->CR = (FLASH->CR & CR_PSIZE_MASK & ~FLASH_CR_SNB) | FLASH_PSIZE_WORD | FLASH_CR_SER
+			  | ((uint32_t)(DIGITAL_IO_LOG_FIRST_SECTOR + idx) << FLASH_CR_SNB_Pos);
+	FLASH->CR |= FLASH_CR_STRT;
+
+	while (FLASH->SR & FLASH_SR_BSY)
+	{
+		sample = GPIO_Gather_DIGITAL_IO(GPIOA->IDR, GPIOB->IDR, GPIOC->IDR);
+		edge |= GPIO_Read_Edges_DIGITAL_IO();
+		if (digital_io_log.recording && (sample != digital_io_log.last_sample || edge != 0))
+		{
+			USBD_HID_Digital_IO_Log_Record_Sample(sample, edge, base + (DIGITAL_IO_TIMESTAMP() - start) / cycles_per_ms);
+			edge = 0;
+		}
+	}
+	FLASH->CR &= ~(FLASH_CR_SER | FLASH_CR_SNB);
+
+	// Drop the cached lines of the erased sector
+	FLASH->ACR &= ~FLASH_ACR_DCEN;
+	FLASH->ACR |= FLASH_ACR_DCRST;
+	FLASH->ACR &= ~FLASH_ACR_DCRST;
+	FLASH->ACR |= FLASH_ACR_DCEN;
+
+	// Ticks of the missed SysTick interrupts
+	uwTick = base + (DIGITAL_IO_TIMESTAMP() - start) / cycles_per_ms;
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Log_Put
+  *         Append a word to the staging buffer.
+  * @retval None
+  */
+__RAM_FUNC static void USBD_HID_Digital_IO_Log_Put(uint32_t word)
+{
+	digital_io_log_stage[digital_io_log.stage_head] = word;
+	digital_io_log.stage_head = (digital_io_log.stage_head + 1) % DIGITAL_IO_LOG_STAGE_SIZE;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Log_Record
+  *         Stage a record, with a time record before it if the delta does not fit.
+  * @retval None
+  */
+__RAM_FUNC static void USBD_HID_Digital_IO_Log_Record(Digital_IO_Log_Record type, uint32_t payload, uint32_t tick)
+{
+	uint32_t delta = tick - digital_io_log.last_tick;
+	uint16_t used = (digital_io_log.stage_head + DIGITAL_IO_LOG_STAGE_SIZE - digital_io_log.stage_tail) % DIGITAL_IO_LOG_STAGE_SIZE;
+
+	// Worst case: lost marker, time record and the record
+	if (used + 4U >= DIGITAL_IO_LOG_STAGE_SIZE)
+	{
+		digital_io_log.lost++;
+		digital_io_log.lost_mark = 1;
+		return;
+	}
+	if (delta > DIGITAL_IO_LOG_MAX_DELTA)
+	{
+		USBD_HID_Digital_IO_Log_Put(DIGITAL_IO_LOG_TIME);
+		USBD_HID_Digital_IO_Log_Put(tick);
+		delta = 0;
+	}
+	if (digital_io_log.lost_mark)
+	{
+		// Records were dropped before this one
+		USBD_HID_Digital_IO_Log_Put(DIGITAL_IO_LOG_WORD(LOG_EVENT, delta, DIGITAL_IO_LOG_MARK_LOST));
+		digital_io_log.lost_mark = 0;
+		delta = 0;
+	}
+	USBD_HID_Digital_IO_Log_Put(DIGITAL_IO_LOG_WORD(type, delta, payload));
+	digital_io_log.last_tick = tick;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Log_Record_Sample
+  *         Stage the level change and the glitches (edges without level change) of a sample.
+  * @retval None
+  */
+__RAM_FUNC static void USBD_HID_Digital_IO_Log_Record_Sample(uint32_t sample, uint32_t edge, uint32_t tick)
+{
+	uint32_t glitch = edge & ~(sample ^ digital_io_log.last_sample);
+
+	if (sample != digital_io_log.last_sample)
+	{
+		USBD_HID_Digital_IO_Log_Record(LOG_LEVEL, sample, tick);
+		digital_io_log.last_sample = sample;
+	}
+	if (glitch != 0)
+	{
+		USBD_HID_Digital_IO_Log_Record(LOG_EDGE, glitch, tick);
+	}
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
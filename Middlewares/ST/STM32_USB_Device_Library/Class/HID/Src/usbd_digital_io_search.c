@@ -0,0 +1,356 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_search.c
+  * @brief   This file provides the pattern search over the capture records.
+  *
+  * @verbatim
+  *
+  *          ===================================================================
+  *                                Search Description
+  *          ===================================================================
+  *           The records of a rate group stay in the capture buffer after the
+  *           capture stopped. The search scans them on the device and sends
+  *           only the matches instead of the whole buffer:
+  *             - a pattern is a sequence of 1-4 consecutive records, every
+  *               step is a mask/value pair over all 24 logical bits
+  *             - every record is compared as one word: a step matches if
+  *               ((record ^ value) & mask) == 0
+  *             - the first step is scanned in a tight loop over the ring
+  *               segments, the other steps are tested at its candidates only
+  *           The main loop scans DIGITAL_IO_SEARCH_CHUNK records per pass and
+  *           pauses at a match until its reports are sent: the record number
+  *           and timestamp, then the records of a small window around it.
+  *
+  *  @endverbatim
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_digital_io_search.h"
+
+/* Global variables */
+DIGITAL_IO_SEARCH_TypeDef digital_io_search;
+
+/* Private functions */
+static void USBD_HID_Digital_IO_Search_Start(void);
+static uint8_t USBD_HID_Digital_IO_Search_Scan(void);
+
+/* Functions */
+
+/**
+  * @brief  USBD_HID_Digital_IO_Search_Process_Command
+  *         Stage one step of the pattern, start or cancel the search.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Search_Process_Command(uint8_t* output_buff)
+{
+	/* PROTOCOL:
+	 * COMMAND_SEARCH: 10 bytes (executed in the main loop, the capture must be stopped)
+	 * Byte[0]		-> (SS | GGGG | C | R) -> SS = step of the pattern, GGGG = rate group,
+	 *				   C = cancel the running search,
+	 *				   R = start the search with the steps 0-SS after this step
+	 * Byte[1]		-> records sent before and after every match (0-15)
+	 * Byte[2-4]	-> mask of the step (logical bits, same format as the state report)
+	 * Byte[5-7]	-> value of the step
+	 * Byte[8-9]	-> maximum number of matches (little endian, 0 = all)
+	 *
+	 * Result: REPORT_SEARCH for every match and its window, then the final REPORT_SEARCH.
+	 */
+	DIGITAL_IO_SEARCH_Step* step = 0;
+	uint8_t step_idx = read_from_byte(output_buff[0], SIZE_2, SHIFT_0);
+
+	if (read_from_byte(output_buff[0], SIZE_1, SHIFT_6))
+	{
+		digital_io_search.request = SEARCH_CANCEL;
+		return;
+	}
+
+	step = &digital_io_search.step_new[step_idx];
+	step->mask = (output_buff[2] | ((uint32_t)output_buff[3] << 8) | ((uint32_t)output_buff[4] << 16)) & DIGITAL_IO_ALL_BITS;
+	step->value = (output_buff[5] | ((uint32_t)output_buff[6] << 8) | ((uint32_t)output_buff[7] << 16)) & step->mask;
+
+	if (read_from_byte(output_buff[0], SIZE_1, SHIFT_7))
+	{
+		digital_io_search.step_num_new = step_idx + 1;
+		digital_io_search.group_new = read_from_byte(output_buff[0], SIZE_4, SHIFT_2);
+		digital_io_search.window_new = MIN(output_buff[1], DIGITAL_IO_SEARCH_MAX_WINDOW);
+		digital_io_search.limit_new = output_buff[8] | ((uint16_t)output_buff[9] << 8);
+		digital_io_search.request = SEARCH_START;
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Search_Handle
+  *         Start the requested search and scan the next records (main loop).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Search_Handle(void)
+{
+	Digital_IO_Search_Request request = digital_io_search.request;
+
+	digital_io_search.request = SEARCH_NO_REQUEST;
+	if (request == SEARCH_START)
+	{
+		USBD_HID_Digital_IO_Search_Start();
+	}
+	else if (request == SEARCH_CANCEL && digital_io_search.state != SEARCH_IDLE)
+	{
+		digital_io_search.flags |= DIGITAL_IO_SEARCH_CANCELLED;
+		digital_io_search.state = SEARCH_DONE;
+	}
+
+	if (digital_io_search.state == SEARCH_IDLE || digital_io_search.state == SEARCH_DONE)
+	{
+		return;
+	}
+
+	// A new capture overwrites the records (and may move the rate groups)
+	if (digital_io_capture.state == CAPTURE_RUNNING)
+	{
+		digital_io_search.flags |= DIGITAL_IO_SEARCH_BUSY;
+		digital_io_search.state = SEARCH_DONE;
+		return;
+	}
+
+	if (digital_io_search.state == SEARCH_RUN)
+	{
+		if (USBD_HID_Digital_IO_Search_Scan())
+		{
+			// Window: clipped to the stored records, the records of the sequence included
+			digital_io_search.match_count++;
+			digital_io_search.match_sent = 0;
+			digital_io_search.window_pos = digital_io_search.match - digital_io_search.window;
+			if (digital_io_search.match - digital_io_search.first < digital_io_search.window)
+			{
+				digital_io_search.window_pos = digital_io_search.first;
+			}
+			digital_io_search.window_end = MIN(digital_io_search.end, digital_io_search.match + digital_io_search.step_num + digital_io_search.window);
+			digital_io_search.state = SEARCH_MATCH;
+		}
+		else if (digital_io_search.position + digital_io_search.step_num > digital_io_search.end)
+		{
+			digital_io_search.state = SEARCH_DONE;
+		}
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Search_Report
+  *         Create the report of the current match, its window or the end of the search.
+  * @retval 1 if a report was created, 0 if there is nothing to send
+  */
+uint8_t USBD_HID_Digital_IO_Search_Report(uint8_t* report)
+{
+	/* PROTOCOL:
+	 * Output: 11 bytes
+	 * Byte[0]		-> 0x80 | REPORT_SEARCH
+	 * Byte[1]		-> (KK | NN | GGGG) -> KK = SEARCH_REPORT_MATCH, SEARCH_REPORT_WINDOW or SEARCH_REPORT_DONE,
+	 *				   NN = number of records (window), GGGG = rate group
+	 *
+	 * SEARCH_REPORT_MATCH:
+	 * Byte[2-5]	-> record number of the first step (records since the capture start, little endian)
+	 * Byte[6-9]	-> timestamp of the record (CPU cycles or DUT clocks, same as the capture reports)
+	 * Byte[10]		-> match number (low byte, first match = 0)
+	 *
+	 * SEARCH_REPORT_WINDOW: sent after its match
+	 * Byte[2]		-> position of the first record relative to the match (signed)
+	 * Byte[3-5]	-> first record (logical bits of the group)
+	 * Byte[6-8]	-> second record (NN = 2)
+	 * Byte[9-10]	-> match number (little endian)
+	 *
+	 * SEARCH_REPORT_DONE:
+	 * Byte[2-5]	-> number of matches (little endian)
+	 * Byte[6-9]	-> number of records scanned
+	 * Byte[10]		-> flags: DIGITAL_IO_SEARCH_LIMIT, _BUSY, _INVALID, _CANCELLED
+	 */
+	DIGITAL_IO_CAPTURE_Group* group = digital_io_search.group;
+	uint32_t record = 0, number = digital_io_search.match_count - 1;
+	uint8_t group_idx = 0, num = 0, idx = 0;
+
+	if (digital_io_search.state != SEARCH_MATCH && digital_io_search.state != SEARCH_DONE)
+	{
+		return 0;
+	}
+	if (group != 0)
+	{
+		group_idx = (uint8_t)(group - digital_io_capture.group);
+	}
+	report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_SEARCH;
+
+	if (digital_io_search.state == SEARCH_DONE)
+	{
+		report[1] = (uint8_t)(SEARCH_REPORT_DONE | (group_idx << 4));
+		write_uint32(&report[2], digital_io_search.match_count);
+		write_uint32(&report[6], digital_io_search.scanned);
+		report[10] = digital_io_search.flags;
+		digital_io_search.state = SEARCH_IDLE;
+		return 1;
+	}
+
+	if (!digital_io_search.match_sent)
+	{
+		report[1] = (uint8_t)(SEARCH_REPORT_MATCH | (group_idx << 4));
+		write_uint32(&report[2], digital_io_search.match);
+		write_uint32(&report[6], digital_io_capture.start_tick + digital_io_search.match * group->decimation * digital_io_capture.period);
+		report[10] = (uint8_t)number;
+		digital_io_search.match_sent = 1;
+	}
+	else
+	{
+		num = (uint8_t)MIN(2U, digital_io_search.window_end - digital_io_search.window_pos);
+		report[1] = (uint8_t)(SEARCH_REPORT_WINDOW | (num << 2) | (group_idx << 4));
+		report[2] = (uint8_t)(int8_t)(digital_io_search.window_pos - digital_io_search.match);
+		for (idx = 0; idx < 2; idx++)
+		{
+			record = (idx < num) ? group->buffer[(digital_io_search.window_pos + idx) % group->size] : 0;
+			report[3 + idx * 3] = (uint8_t)(record);
+			report[4 + idx * 3] = (uint8_t)(record >> 8);
+			report[5 + idx * 3] = (uint8_t)(record >> 16);
+		}
+		report[9] = (uint8_t)(number);
+		report[10] = (uint8_t)(number >> 8);
+		digital_io_search.window_pos += num;
+	}
+
+	// Next match after the window
+	if (digital_io_search.window_pos >= digital_io_search.window_end)
+	{
+		if (digital_io_search.limit != 0 && digital_io_search.match_count >= digital_io_search.limit)
+		{
+			digital_io_search.flags |= DIGITAL_IO_SEARCH_LIMIT;
+			digital_io_search.state = SEARCH_DONE;
+		}
+		else
+		{
+			digital_io_search.state = SEARCH_RUN;
+		}
+	}
+	return 1;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Search_Start
+  *         Take the staged pattern and search the stored records of the group.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Search_Start(void)
+{
+	DIGITAL_IO_CAPTURE_Group* group = 0;
+	uint8_t step_idx = 0;
+
+	for (step_idx = 0; step_idx < digital_io_search.step_num_new; step_idx++)
+	{
+		digital_io_search.step[step_idx] = digital_io_search.step_new[step_idx];
+	}
+	digital_io_search.step_num = digital_io_search.step_num_new;
+	digital_io_search.window = digital_io_search.window_new;
+	digital_io_search.limit = digital_io_search.limit_new;
+	digital_io_search.flags = 0;
+	digital_io_search.group = 0;
+	digital_io_search.scanned = 0;
+	digital_io_search.match_count = 0;
+	digital_io_search.first = 0;
+	digital_io_search.end = 0;
+	digital_io_search.position = 0;
+	digital_io_search.state = SEARCH_DONE;
+
+	if (digital_io_search.group_new >= digital_io_capture.group_num)
+	{
+		digital_io_search.flags |= DIGITAL_IO_SEARCH_INVALID;
+		return;
+	}
+	group = &digital_io_capture.group[digital_io_search.group_new];
+	digital_io_search.group = group;
+
+	// Only the last group->size records are still stored
+	digital_io_search.end = group->write_count;
+	if (group->write_count > group->size)
+	{
+		digital_io_search.first = group->write_count - group->size;
+	}
+	digital_io_search.position = digital_io_search.first;
+	digital_io_search.state = SEARCH_RUN;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Search_Scan
+  *         Scan the next records for the pattern.
+  * @retval 1 if a match was found (digital_io_search.match), 0 if the chunk has no match
+  */
+static uint8_t USBD_HID_Digital_IO_Search_Scan(void)
+{
+	DIGITAL_IO_CAPTURE_Group* group = digital_io_search.group;
+	DIGITAL_IO_SEARCH_Step* step = digital_io_search.step;
+	uint32_t* record = 0;
+	uint32_t mask = step[0].mask, value = step[0].value;
+	uint32_t position = digital_io_search.position, last = 0, limit = 0, run = 0, idx = 0;
+	uint8_t step_idx = 0;
+
+	// Last record which can start the whole sequence
+	if (digital_io_search.end - position < digital_io_search.step_num)
+	{
+		return 0;
+	}
+	last = digital_io_search.end - digital_io_search.step_num + 1;
+	limit = (last - position > DIGITAL_IO_SEARCH_CHUNK) ? (position + DIGITAL_IO_SEARCH_CHUNK) : last;
+
+	while (position < limit)
+	{
+		// Contiguous segment of the ring buffer
+		idx = position % group->size;
+		run = MIN(limit - position, group->size - idx);
+		record = &group->buffer[idx];
+		for (idx = 0; idx < run; idx++)
+		{
+			if (((record[idx] ^ value) & mask) == 0)
+			{
+				break;
+			}
+		}
+		position += idx;
+		digital_io_search.scanned += idx;
+		if (idx == run)
+		{
+			continue;
+		}
+
+		// Candidate: the other steps on the following records
+		for (step_idx = 1; step_idx < digital_io_search.step_num; step_idx++)
+		{
+			if ((group->buffer[(position + step_idx) % group->size] ^ step[step_idx].value) & step[step_idx].mask)
+			{
+				break;
+			}
+		}
+		digital_io_search.scanned++;
+		if (step_idx == digital_io_search.step_num)
+		{
+			digital_io_search.match = position;
+			digital_io_search.position = position + 1;
+			return 1;
+		}
+		position++;
+	}
+	digital_io_search.position = position;
+	return 0;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
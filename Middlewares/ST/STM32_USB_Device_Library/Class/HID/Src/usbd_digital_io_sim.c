@@ -0,0 +1,628 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_sim.c
+  * @brief   This file provides the host simulation of the digital IO core
+  *          with closed-loop DUT models.
+  *
+  * @verbatim
+  *
+  *          ===================================================================
+  *                                Simulation Description
+  *          ===================================================================
+  *           Built only with DIGITAL_IO_SIMULATION. Every simulated module owns
+  *           a core context whose HAL ops work on simulated pins and a virtual
+  *           clock (CPU cycles). One main loop pass of the core reads the pins,
+  *           fires the triggers, stores the host changes and switches the ports,
+  *           then the clock advances by loop_cycles.
+  *           The DUT model is called at every read of the pins: it sees the
+  *           output pins and returns the levels of the input pins. The model
+  *           table is plain C, a C++ model fills it with static member
+  *           functions and passes its object as the state.
+  *           Simulated banks: bank b holds the logical bits 16*b .. 16*b+15,
+  *           BSRR words as on the target (set bits low, reset bits high).
+  *           Sample models:
+  *             - echo: outputs mirrored to inputs (shifted by logical bits)
+  *             - delay line: echo after a fixed number of cycles
+  *             - counter: rising edges of a clock output on the input pins
+  *             - serial responder: 8N1 receiver on an output, answers every
+  *               byte on an input (response table or byte + 1)
+  *           The models sample at the read times of the core, so a bit of the
+  *           serial responder should span several loop passes.
+  *
+  *  @endverbatim
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_digital_io_sim.h"
+
+#ifdef DIGITAL_IO_SIMULATION
+
+/* Private functions */
+static void USBD_HID_Digital_IO_Sim_Setup(void* user, uint8_t port, uint32_t mode, uint32_t pull);
+static uint32_t USBD_HID_Digital_IO_Sim_Read(void* user);
+static void USBD_HID_Digital_IO_Sim_Write(void* user, uint32_t mask, uint32_t value);
+static void USBD_HID_Digital_IO_Sim_Write_Bank(void* user, uint8_t bank, uint32_t bsrr);
+static void USBD_HID_Digital_IO_Sim_Compile(void* user, uint32_t mask, uint32_t value, uint32_t* bsrr);
+static void USBD_HID_Digital_IO_Sim_Remap(void* user, const uint8_t* remap);
+static void USBD_HID_Digital_IO_Sim_Trigger_Out(void* user, uint32_t bsrr);
+static uint32_t USBD_HID_Digital_IO_Sim_Timestamp(void* user);
+static uint32_t USBD_HID_Digital_IO_Sim_Shift(uint32_t value, int8_t shift);
+static void USBD_HID_Digital_IO_Sim_Echo_Reset(void* state);
+static uint32_t USBD_HID_Digital_IO_Sim_Echo_Step(void* state, uint32_t outputs, uint32_t output_mask, uint32_t now);
+static uint32_t USBD_HID_Digital_IO_Sim_Delay_Step(void* state, uint32_t outputs, uint32_t output_mask, uint32_t now);
+static void USBD_HID_Digital_IO_Sim_Counter_Reset(void* state);
+static uint32_t USBD_HID_Digital_IO_Sim_Counter_Step(void* state, uint32_t outputs, uint32_t output_mask, uint32_t now);
+static void USBD_HID_Digital_IO_Sim_Serial_Reset(void* state);
+static uint32_t USBD_HID_Digital_IO_Sim_Serial_Step(void* state, uint32_t outputs, uint32_t output_mask, uint32_t now);
+
+/* Global variables */
+const DIGITAL_IO_HAL_Ops digital_io_sim_hal =
+{
+	USBD_HID_Digital_IO_Sim_Setup,
+	USBD_HID_Digital_IO_Sim_Read,
+	USBD_HID_Digital_IO_Sim_Write,
+	USBD_HID_Digital_IO_Sim_Write_Bank,
+	USBD_HID_Digital_IO_Sim_Compile,
+	USBD_HID_Digital_IO_Sim_Remap,
+	USBD_HID_Digital_IO_Sim_Trigger_Out,
+	USBD_HID_Digital_IO_Sim_Timestamp
+};
+
+/* Functions */
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Init
+  *         Reset a simulated module with a DUT model and select its context.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Sim_Init(DIGITAL_IO_SIM_TypeDef* sim, const DIGITAL_IO_SIM_Model* model)
+{
+	uint8_t idx = 0;
+
+	sim->model = *model;
+	sim->clock = 0;
+	sim->loop_cycles = DIGITAL_IO_SIM_LOOP_CYCLES;
+	sim->output_mask = 0;
+	sim->outputs = 0;
+	sim->pull_up = 0;
+	sim->trigger_out = 0;
+	sim->trigger_pulses = 0;
+	for (idx = 0; idx < DIGITAL_IO_COMMAND_PAYLOAD_SIZE; idx++)
+	{
+		sim->output_report[idx] = 0;
+	}
+	if (sim->model.Reset != NULL)
+	{
+		sim->model.Reset(sim->model.state);
+	}
+
+	// Power-on state of the core, as the main() of the target
+	USBD_HID_Digital_IO_Context_Init(&sim->ctx, &digital_io_sim_hal, sim);
+	USBD_HID_Digital_IO_Context_Select(&sim->ctx);
+	USBD_HID_Digital_IO_Init(&DIGITAL_IO_CTX_STATE);
+	USBD_HID_Digital_IO_Init(&DIGITAL_IO_CTX_NEW_STATE);
+	USBD_HID_Digital_IO_Reset_SwitchTrig();
+	for (idx = 0; idx < DIGITAL_IO_MAX_TRIG_NUM; idx++)
+	{
+		USBD_HID_Digital_IO_Reset_Trigger_Event(&DIGITAL_IO_CTX_TRIG_EVENTS[idx]);
+		USBD_HID_Digital_IO_Reset_Trigger_Action(&DIGITAL_IO_CTX_TRIG_EVENTS[idx]);
+	}
+	DIGITAL_IO_CTX_SAMPLE = DIGITAL_IO_HAL_READ();
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Output
+  *         Deliver an output report of the host (core lengths and commands).
+  * @retval HID_Digital_IO_Ack_Status
+  */
+HID_Digital_IO_Ack_Status USBD_HID_Digital_IO_Sim_Output(DIGITAL_IO_SIM_TypeDef* sim, const uint8_t* report)
+{
+	uint8_t idx = 0;
+
+	USBD_HID_Digital_IO_Context_Select(&sim->ctx);
+	for (idx = 0; idx < DIGITAL_IO_COMMAND_PAYLOAD_SIZE; idx++)
+	{
+		sim->output_report[idx] = (idx < report[0]) ? report[idx + 1] : 0;
+	}
+
+	// Same handling as USB_RX_Interrupt of the target
+	switch (report[0])
+	{
+		case LENGTH_NOTHING:
+			return ACK_ACCEPTED;
+		case LENGTH_TRIGGER_EVENT:
+			USBD_HID_Digital_IO_Process_Trigger_Event(sim->output_report, DIGITAL_IO_CTX_TRIG_EVENTS);
+			return ACK_ACCEPTED;
+		case LENGTH_TRIGGER:
+			if (DIGITAL_IO_CTX_CHANGE_ENABLE && DIGITAL_IO_CTX_TRIGGER != TRIGGERED)
+			{
+				USBD_HID_Digital_IO_Trigger(sim->output_report);
+				return (DIGITAL_IO_CTX_TRIGGER == TRIGGERED) ? ACK_ACCEPTED : ACK_DROPPED;
+			}
+			return ACK_DROPPED;
+		case LENGTH_DIGITAL_IO:
+			return USBD_HID_Digital_IO_Store_Changes(sim->output_report);
+		default:
+			// Commands of the feature modules are not simulated (ACK_UNKNOWN)
+			if (report[0] >= COMMAND_FIRST)
+			{
+				return USBD_HID_Digital_IO_Process_Command(report[0], sim->output_report);
+			}
+			return ACK_UNKNOWN;
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Run
+  *         Run main loop passes of the core until the virtual clock advanced by the given cycles.
+  * @retval Fired triggers (bit per trigger)
+  */
+uint32_t USBD_HID_Digital_IO_Sim_Run(DIGITAL_IO_SIM_TypeDef* sim, uint32_t cycles)
+{
+	uint32_t end = sim->clock + cycles, fired = 0;
+	uint8_t idx = 0;
+
+	USBD_HID_Digital_IO_Context_Select(&sim->ctx);
+	while ((int32_t)(end - sim->clock) > 0)
+	{
+		// The SysTick of the target releases a TRIGGER_OUT pulse, here the next pass does
+		if (DIGITAL_IO_CTX_DO_TRIGGER == DO_TRIGGER)
+		{
+			DIGITAL_IO_HAL_TRIGGER_OUT(DIGITAL_IO_TRIGGER_OUT_RELEASE);
+			DIGITAL_IO_CTX_DO_TRIGGER = DONTCARE;
+		}
+
+		// Read the pins (the DUT model reacts) and fire the triggers
+		USBD_HID_Digital_IO_Read();
+		for (idx = 0; idx < DIGITAL_IO_MAX_TRIG_NUM; idx++)
+		{
+			if (USBD_HID_Digital_IO_Check_Trigger_Event(DIGITAL_IO_CTX_TRIG_EVENTS, idx) == TRIGGERED)
+			{
+				USBD_HID_Digital_IO_Run_Trigger_Action(DIGITAL_IO_CTX_TRIG_EVENTS, idx);
+				fired |= (1UL << idx);
+			}
+		}
+
+		// Store digital IO changes
+		if (DIGITAL_IO_CTX_CHANGE_FLAG == CHANGED)
+		{
+			USBD_HID_Digital_IO_Init(&DIGITAL_IO_CTX_NEW_STATE);
+			USBD_HID_Digital_IO_Set_Changes(DIGITAL_IO_CTX_CHANGE_REPORT);
+			DIGITAL_IO_CTX_CHANGE_FLAG = UNCHANGED;
+			DIGITAL_IO_CTX_CHANGE_ENABLE = 1;
+		}
+
+		// Activate a new pin remap table
+		if (DIGITAL_IO_CTX_REMAP_FLAG == CHANGED)
+		{
+			DIGITAL_IO_CTX_REMAP_FLAG = UNCHANGED;
+			USBD_HID_Digital_IO_Apply_Remap();
+		}
+
+		// Enforce settings of the pins
+		if (DIGITAL_IO_CTX_TRIGGER == TRIGGERED)
+		{
+			USBD_HID_Digital_IO_SwitchPorts();
+			USBD_HID_Digital_IO_Init(&DIGITAL_IO_CTX_NEW_STATE);
+			USBD_HID_Digital_IO_Reset_SwitchTrig();
+			DIGITAL_IO_CTX_TRIGGER = DONTCARE;
+			DIGITAL_IO_CTX_CHANGE_ENABLE = 0;
+		}
+
+		sim->clock += sim->loop_cycles;
+	}
+	return fired;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Setup
+  *         Set the mode and pull of the pins of a port.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Sim_Setup(void* user, uint8_t port, uint32_t mode, uint32_t pull)
+{
+	DIGITAL_IO_SIM_TypeDef* sim = (DIGITAL_IO_SIM_TypeDef*)user;
+	uint32_t mask = DIGITAL_IO_PORT_MASK(port);
+
+	if (mode == GPIO_MODE_OUTPUT_PP || mode == GPIO_MODE_OUTPUT_OD)
+	{
+		sim->output_mask |= mask;
+	}
+	else
+	{
+		sim->output_mask &= ~mask;
+	}
+	if (pull == GPIO_PULLUP)
+	{
+		sim->pull_up |= mask;
+	}
+	else
+	{
+		sim->pull_up &= ~mask;
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Read
+  *         Packed sample: the outputs and the levels driven by the DUT model.
+  * @retval Packed sample
+  */
+static uint32_t USBD_HID_Digital_IO_Sim_Read(void* user)
+{
+	DIGITAL_IO_SIM_TypeDef* sim = (DIGITAL_IO_SIM_TypeDef*)user;
+	uint32_t driven = sim->pull_up;
+
+	if (sim->model.Step != NULL)
+	{
+		driven = sim->model.Step(sim->model.state, sim->outputs & sim->output_mask, sim->output_mask, sim->clock);
+	}
+	return ((sim->outputs & sim->output_mask) | (driven & ~sim->output_mask)) & DIGITAL_IO_ALL_BITS;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Write
+  *         Write the output register of the masked pins.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Sim_Write(void* user, uint32_t mask, uint32_t value)
+{
+	DIGITAL_IO_SIM_TypeDef* sim = (DIGITAL_IO_SIM_TypeDef*)user;
+
+	sim->outputs = ((sim->outputs & ~mask) | (value & mask)) & DIGITAL_IO_ALL_BITS;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Write_Bank
+  *         BSRR write of a simulated bank.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Sim_Write_Bank(void* user, uint8_t bank, uint32_t bsrr)
+{
+	DIGITAL_IO_SIM_TypeDef* sim = (DIGITAL_IO_SIM_TypeDef*)user;
+	uint32_t shift = bank * DIGITAL_IO_SIM_BANK_BITS, set = 0, reset = 0;
+
+	if (shift >= 32)
+	{
+		return;
+	}
+	set = (bsrr & 0xFFFFU) << shift;
+	reset = (bsrr >> 16) << shift;
+	sim->outputs = ((sim->outputs & ~reset) | set) & DIGITAL_IO_ALL_BITS;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Compile
+  *         BSRR words of the simulated banks which write the masked logical bits.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Sim_Compile(void* user, uint32_t mask, uint32_t value, uint32_t* bsrr)
+{
+	uint32_t shift = 0, bank_mask = 0, bank_value = 0;
+	uint8_t bank = 0;
+
+	(void)user;
+	for (bank = 0; bank < GPIO_DIGITAL_BANK_NUM; bank++)
+	{
+		shift = bank * DIGITAL_IO_SIM_BANK_BITS;
+		bank_mask = (shift < 32) ? ((mask >> shift) & 0xFFFFU) : 0;
+		bank_value = (shift < 32) ? ((value >> shift) & bank_mask) : 0;
+		bsrr[bank] = bank_value | ((bank_mask & ~bank_value) << 16);
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Remap
+  *         New wiring: the simulated pins are the logical bits, only the table of the context changes.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Sim_Remap(void* user, const uint8_t* remap)
+{
+	(void)user;
+	(void)remap;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Trigger_Out
+  *         BSRR write of the virtual TRIGGER_OUT pin, rising edges are counted.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Sim_Trigger_Out(void* user, uint32_t bsrr)
+{
+	DIGITAL_IO_SIM_TypeDef* sim = (DIGITAL_IO_SIM_TypeDef*)user;
+
+	if (bsrr & DIGITAL_IO_TRIGGER_OUT_ASSERT)
+	{
+		sim->trigger_pulses += !sim->trigger_out;
+		sim->trigger_out = 1;
+	}
+	else if (bsrr & DIGITAL_IO_TRIGGER_OUT_RELEASE)
+	{
+		sim->trigger_out = 0;
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Timestamp
+  *         Virtual clock of the simulated module.
+  * @retval CPU cycles
+  */
+static uint32_t USBD_HID_Digital_IO_Sim_Timestamp(void* user)
+{
+	return ((DIGITAL_IO_SIM_TypeDef*)user)->clock;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Shift
+  *         Move logical bits up (+) or down (-).
+  * @retval Shifted bits
+  */
+static uint32_t USBD_HID_Digital_IO_Sim_Shift(uint32_t value, int8_t shift)
+{
+	return ((shift >= 0) ? (value << shift) : (value >> -shift)) & DIGITAL_IO_ALL_BITS;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Echo_Model
+  *         Outputs mirrored to the inputs at once.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Sim_Echo_Model(DIGITAL_IO_SIM_Echo* echo, DIGITAL_IO_SIM_Model* model)
+{
+	model->Reset = USBD_HID_Digital_IO_Sim_Echo_Reset;
+	model->Step = USBD_HID_Digital_IO_Sim_Echo_Step;
+	model->state = echo;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Delay_Model
+  *         Outputs mirrored to the inputs after echo->delay cycles.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Sim_Delay_Model(DIGITAL_IO_SIM_Echo* echo, DIGITAL_IO_SIM_Model* model)
+{
+	model->Reset = USBD_HID_Digital_IO_Sim_Echo_Reset;
+	model->Step = USBD_HID_Digital_IO_Sim_Delay_Step;
+	model->state = echo;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Echo_Reset
+  *         Empty the delay line.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Sim_Echo_Reset(void* state)
+{
+	DIGITAL_IO_SIM_Echo* echo = (DIGITAL_IO_SIM_Echo*)state;
+
+	echo->head = 0;
+	echo->tail = 0;
+	echo->last = 0;
+	echo->level = 0;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Echo_Step
+  *         Inputs of the echo model.
+  * @retval Driven levels
+  */
+static uint32_t USBD_HID_Digital_IO_Sim_Echo_Step(void* state, uint32_t outputs, uint32_t output_mask, uint32_t now)
+{
+	DIGITAL_IO_SIM_Echo* echo = (DIGITAL_IO_SIM_Echo*)state;
+
+	(void)output_mask;
+	(void)now;
+	return USBD_HID_Digital_IO_Sim_Shift(outputs & echo->out_mask, echo->shift);
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Delay_Step
+  *         Inputs of the delay line model.
+  * @retval Driven levels
+  */
+static uint32_t USBD_HID_Digital_IO_Sim_Delay_Step(void* state, uint32_t outputs, uint32_t output_mask, uint32_t now)
+{
+	DIGITAL_IO_SIM_Echo* echo = (DIGITAL_IO_SIM_Echo*)state;
+	uint32_t value = outputs & echo->out_mask;
+	uint8_t next = 0;
+
+	(void)output_mask;
+	// Output changes enter the line, a full line drops its oldest change
+	if (value != echo->last)
+	{
+		next = (echo->head + 1) % DIGITAL_IO_SIM_DELAY_DEPTH;
+		if (next == echo->tail)
+		{
+			echo->tail = (echo->tail + 1) % DIGITAL_IO_SIM_DELAY_DEPTH;
+		}
+		echo->tick[echo->head] = now;
+		echo->value[echo->head] = value;
+		echo->head = next;
+		echo->last = value;
+	}
+
+	// Changes older than the delay reach the inputs
+	while (echo->tail != echo->head && (int32_t)(now - echo->tick[echo->tail] - echo->delay) >= 0)
+	{
+		echo->level = echo->value[echo->tail];
+		echo->tail = (echo->tail + 1) % DIGITAL_IO_SIM_DELAY_DEPTH;
+	}
+	return USBD_HID_Digital_IO_Sim_Shift(echo->level, echo->shift);
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Counter_Model
+  *         Rising edges of a clock output counted on the input pins.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Sim_Counter_Model(DIGITAL_IO_SIM_Counter* counter, DIGITAL_IO_SIM_Model* model)
+{
+	model->Reset = USBD_HID_Digital_IO_Sim_Counter_Reset;
+	model->Step = USBD_HID_Digital_IO_Sim_Counter_Step;
+	model->state = counter;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Counter_Reset
+  *         Clear the count.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Sim_Counter_Reset(void* state)
+{
+	DIGITAL_IO_SIM_Counter* counter = (DIGITAL_IO_SIM_Counter*)state;
+
+	counter->count = 0;
+	counter->last = 0;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Counter_Step
+  *         Inputs of the counter model.
+  * @retval Driven levels
+  */
+static uint32_t USBD_HID_Digital_IO_Sim_Counter_Step(void* state, uint32_t outputs, uint32_t output_mask, uint32_t now)
+{
+	DIGITAL_IO_SIM_Counter* counter = (DIGITAL_IO_SIM_Counter*)state;
+	uint8_t clock = (outputs >> counter->clock_bit) & 0x01U;
+
+	(void)output_mask;
+	(void)now;
+	if (counter->reset_bit < DIGITAL_IO_MAX_BIT_NUM && ((outputs >> counter->reset_bit) & 0x01U))
+	{
+		counter->count = 0;
+	}
+	else if (clock && !counter->last)
+	{
+		counter->count++;
+	}
+	counter->last = clock;
+	return ((counter->count & ((1UL << counter->in_width) - 1)) << counter->in_shift) & DIGITAL_IO_ALL_BITS;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Serial_Model
+  *         8N1 receiver on an output pin, answers every byte on an input pin.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Sim_Serial_Model(DIGITAL_IO_SIM_Serial* serial, DIGITAL_IO_SIM_Model* model)
+{
+	model->Reset = USBD_HID_Digital_IO_Sim_Serial_Reset;
+	model->Step = USBD_HID_Digital_IO_Sim_Serial_Step;
+	model->state = serial;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Serial_Reset
+  *         Idle receiver and transmitter.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Sim_Serial_Reset(void* state)
+{
+	DIGITAL_IO_SIM_Serial* serial = (DIGITAL_IO_SIM_Serial*)state;
+
+	serial->rx_state = 0;
+	serial->rx_byte = 0;
+	serial->rx_last = 1;
+	serial->tx_busy = 0;
+	serial->received = 0;
+	serial->framing_errors = 0;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Sim_Serial_Step
+  *         Inputs of the serial responder model.
+  * @retval Driven levels
+  */
+static uint32_t USBD_HID_Digital_IO_Sim_Serial_Step(void* state, uint32_t outputs, uint32_t output_mask, uint32_t now)
+{
+	DIGITAL_IO_SIM_Serial* serial = (DIGITAL_IO_SIM_Serial*)state;
+	uint32_t bit = MAX(serial->bit_cycles, 1U), sample = 0, elapsed = 0;
+	uint8_t rx = 1, tx = 1, answer = 0;
+
+	// A released line (input mode) idles high
+	if (output_mask & (1UL << serial->rx_bit))
+	{
+		rx = (outputs >> serial->rx_bit) & 0x01U;
+	}
+
+	// Receiver: start bit on the falling edge, the bits sampled in their middle
+	if (serial->rx_state == 0)
+	{
+		if (serial->rx_last && !rx)
+		{
+			serial->rx_state = 1;
+			serial->rx_start = now;
+			serial->rx_byte = 0;
+		}
+	}
+	while (serial->rx_state != 0)
+	{
+		sample = serial->rx_start + serial->rx_state * bit + bit / 2;
+		if ((int32_t)(now - sample) < 0)
+		{
+			break;
+		}
+		if (serial->rx_state <= 8)
+		{
+			serial->rx_byte |= (uint8_t)(rx << (serial->rx_state - 1));
+			serial->rx_state++;
+			continue;
+		}
+
+		// Stop bit: answer a valid byte (a byte during an answer is not answered)
+		serial->rx_state = 0;
+		if (!rx)
+		{
+			serial->framing_errors++;
+		}
+		else
+		{
+			serial->received++;
+			if (!serial->tx_busy)
+			{
+				answer = (serial->response != NULL) ? serial->response[serial->rx_byte] : (uint8_t)(serial->rx_byte + 1);
+				serial->tx_frame = (uint16_t)((1U << 9) | ((uint16_t)answer << 1));
+				serial->tx_start = now;
+				serial->tx_busy = 1;
+			}
+		}
+	}
+	serial->rx_last = rx;
+
+	// Transmitter
+	if (serial->tx_busy)
+	{
+		elapsed = (now - serial->tx_start) / bit;
+		if (elapsed >= 10)
+		{
+			serial->tx_busy = 0;
+		}
+		else
+		{
+			tx = (serial->tx_frame >> elapsed) & 0x01U;
+		}
+	}
+	return ((uint32_t)tx << serial->tx_bit) & DIGITAL_IO_ALL_BITS;
+}
+
+#endif /* DIGITAL_IO_SIMULATION */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,231 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_stimulus.c
+  * @brief   This file provides the timed playback of recorded pin programs.
+  *
+  * @verbatim
+  *
+  *          ===================================================================
+  *                                Stimulus Description
+  *          ===================================================================
+  *           A program is a list of steps: a value of the driven logical bits
+  *           and how long it is held. The host converts a capture into a
+  *           program, uploads it in feature report chunks (UPLOAD_STIMULUS)
+  *           and starts it with the checksum of the whole upload.
+  *           Step word (little endian):
+  *             - bits 0-23: value of the logical bits (state report format)
+  *             - bits 24-31: ticks the value is held (1-255), 0 = the
+  *               ticks are in the next word (32 bit)
+  *           One REPORT_CAPTURE_RUN becomes one step: the run value, and the
+  *           run length as ticks with the time unit = decimation * period of
+  *           the capture.
+  *           The playback follows an absolute schedule on the CPU cycle
+  *           counter (the errors do not add up), the next step is compiled
+  *           to BSRR words while the current one is held. The lateness of
+  *           every write against the schedule is measured, the verify pass
+  *           reads the pins back before every next step. After the
+  *           last step the driven pins get their previous mode, pull and
+  *           output level back.
+  *
+  *  @endverbatim
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_digital_io_stimulus.h"
+#include "gpio.h"
+
+/* Global variables */
+DIGITAL_IO_STIMULUS_TypeDef digital_io_stimulus;
+uint32_t digital_io_stimulus_buffer[DIGITAL_IO_STIMULUS_MAX_WORDS];
+
+/* Private functions */
+static uint8_t USBD_HID_Digital_IO_Stimulus_Next_Step(uint16_t* idx, uint32_t* value, uint32_t* ticks);
+
+/* Functions */
+
+/**
+  * @brief  USBD_HID_Digital_IO_Stimulus_Process_Command
+  *         Store the driven pins and time unit, or request the playback of the uploaded program.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Stimulus_Process_Command(uint8_t command, uint8_t* output_buff)
+{
+	/* PROTOCOL:
+	 * COMMAND_STIMULUS_CONFIG: 8 bytes
+	 * Byte[0-2]	-> driven logical bits (little endian, outputs during the playback, restored after it)
+	 * Byte[3-6]	-> time unit: CPU cycles per tick (little endian, 0 = 1)
+	 * Byte[7]		-> (V | I | ------) -> V = verify the pins after every step,
+	 *				   I = mask the interrupts during the playback (no USB until the end)
+	 *
+	 * COMMAND_STIMULUS_RUN: 6 bytes (executed in the main loop)
+	 * Byte[0-1]	-> number of uploaded program words (little endian)
+	 * Byte[2-5]	-> checksum: 32 bit sum of the program words (little endian)
+	 *
+	 * Result: REPORT_STIMULUS.
+	 */
+	if (digital_io_stimulus.state != STIMULUS_IDLE)
+	{
+		return;
+	}
+
+	if (command == COMMAND_STIMULUS_RUN)
+	{
+		digital_io_stimulus.words = MIN((uint32_t)(output_buff[0] | ((uint16_t)output_buff[1] << 8)), (uint32_t)DIGITAL_IO_STIMULUS_MAX_WORDS);
+		digital_io_stimulus.checksum = read_uint32(&output_buff[2]);
+		digital_io_stimulus.state = STIMULUS_RUN;
+		return;
+	}
+
+	digital_io_stimulus.mask = (output_buff[0] | ((uint32_t)output_buff[1] << 8) | ((uint32_t)output_buff[2] << 16)) & DIGITAL_IO_ALL_BITS;
+	digital_io_stimulus.unit = MAX(read_uint32(&output_buff[3]), 1U);
+	digital_io_stimulus.flags = output_buff[7] & (DIGITAL_IO_STIMULUS_VERIFY | DIGITAL_IO_STIMULUS_ISOLATE);
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Stimulus_Run
+  *         Play the uploaded program and queue the timing report (main loop).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Stimulus_Run(void)
+{
+	uint32_t bsrr[GPIO_DIGITAL_BANK_NUM], saved[GPIO_DIGITAL_SAVED_SIZE];
+	uint32_t mask = digital_io_stimulus.mask, value = 0, expected = 0, ticks = 0, sum = 0;
+	uint32_t deadline = 0, late = 0, late_max = 0, late_sum = 0, mismatches = 0, primask = 0;
+	uint8_t report[DIGITAL_IO_REPORT_SIZE] = {0};
+	uint8_t verify = digital_io_stimulus.flags & DIGITAL_IO_STIMULUS_VERIFY, next = 0;
+	uint16_t idx = 0, steps = 0;
+
+	digital_io_stimulus.result = 0;
+	for (idx = 0; idx < digital_io_stimulus.words; idx++)
+	{
+		sum += digital_io_stimulus_buffer[idx];
+	}
+	idx = 0;
+
+	if (sum != digital_io_stimulus.checksum)
+	{
+		digital_io_stimulus.result |= DIGITAL_IO_STIMULUS_CHECKSUM_ERROR;
+	}
+	else
+	{
+		next = USBD_HID_Digital_IO_Stimulus_Next_Step(&idx, &value, &ticks);
+		GPIO_Compile_Packed_DIGITAL_IO(mask, value, bsrr);
+		GPIO_Save_Packed_DIGITAL_IO(saved);
+		GPIO_Config_Packed_DIGITAL_IO(mask, GPIO_MODE_OUTPUT_PP, GPIO_NOPULL);
+
+		if (digital_io_stimulus.flags & DIGITAL_IO_STIMULUS_ISOLATE)
+		{
+			primask = __get_PRIMASK();
+			__disable_irq();
+		}
+		deadline = DIGITAL_IO_TIMESTAMP() + DIGITAL_IO_STIMULUS_LEAD;
+		while (next)
+		{
+			while ((int32_t)(DIGITAL_IO_TIMESTAMP() - deadline) < 0);
+			gpio_digital_bank[0]->BSRR = bsrr[0];
+			gpio_digital_bank[1]->BSRR = bsrr[1];
+			gpio_digital_bank[2]->BSRR = bsrr[2];
+			late = DIGITAL_IO_TIMESTAMP() - deadline;
+
+			late_max = MAX(late_max, late);
+			late_sum += late;
+			steps++;
+			expected = value;
+			deadline += ticks * digital_io_stimulus.unit;
+
+			// Prepare the next step while the value is held
+			next = USBD_HID_Digital_IO_Stimulus_Next_Step(&idx, &value, &ticks);
+			GPIO_Compile_Packed_DIGITAL_IO(mask, value, bsrr);
+			if (verify && ((GPIO_Read_Packed_DIGITAL_IO() ^ expected) & mask))
+			{
+				mismatches++;
+			}
+		}
+		// Hold the last value for its full time
+		while ((int32_t)(DIGITAL_IO_TIMESTAMP() - deadline) < 0);
+		if (digital_io_stimulus.flags & DIGITAL_IO_STIMULUS_ISOLATE)
+		{
+			__set_PRIMASK(primask);
+		}
+
+		// Give the played pins back with their previous mode, pull and level, drop the edges of the program
+		GPIO_Restore_Packed_DIGITAL_IO(mask, saved);
+		GPIO_Read_Edges_DIGITAL_IO();
+		DIGITAL_IO_CTX_SAMPLE = GPIO_Read_Packed_DIGITAL_IO();
+	}
+
+	/* PROTOCOL:
+	 * Output: 11 bytes
+	 * Byte[0]		-> 0x80 | REPORT_STIMULUS
+	 * Byte[1]		-> config flags (V, I) | result flags (DIGITAL_IO_STIMULUS_CHECKSUM_ERROR, _TRUNCATED)
+	 * Byte[2-3]	-> steps played (little endian)
+	 * Byte[4-6]	-> maximum lateness of a step (CPU cycles, little endian, saturated)
+	 * Byte[7-8]	-> mean lateness of the steps (CPU cycles, little endian, saturated)
+	 * Byte[9-10]	-> steps with a wrong pin read back (V, little endian, saturated)
+	 */
+	late_max = MIN(late_max, 0x00FFFFFFU);
+	late_sum = (steps != 0) ? MIN(late_sum / steps, 0xFFFFU) : 0;
+	mismatches = MIN(mismatches, 0xFFFFU);
+	report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_STIMULUS;
+	report[1] = digital_io_stimulus.flags | digital_io_stimulus.result;
+	report[2] = (uint8_t)(steps);
+	report[3] = (uint8_t)(steps >> 8);
+	report[4] = (uint8_t)(late_max);
+	report[5] = (uint8_t)(late_max >> 8);
+	report[6] = (uint8_t)(late_max >> 16);
+	report[7] = (uint8_t)(late_sum);
+	report[8] = (uint8_t)(late_sum >> 8);
+	report[9] = (uint8_t)(mismatches);
+	report[10] = (uint8_t)(mismatches >> 8);
+	USBD_HID_Digital_IO_Queue_Report(REPORT_CLASS_ACK, report);
+	digital_io_stimulus.state = STIMULUS_IDLE;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Stimulus_Next_Step
+  *         Decode the next step of the program.
+  * @retval 1 if a step was decoded, 0 at the end of the program
+  */
+static uint8_t USBD_HID_Digital_IO_Stimulus_Next_Step(uint16_t* idx, uint32_t* value, uint32_t* ticks)
+{
+	uint32_t word = 0;
+
+	if (*idx >= digital_io_stimulus.words)
+	{
+		return 0;
+	}
+	word = digital_io_stimulus_buffer[(*idx)++];
+	*value = word & DIGITAL_IO_STIMULUS_VALUE_MASK;
+	*ticks = word >> DIGITAL_IO_STIMULUS_TICKS_SHIFT;
+	if (*ticks == 0)
+	{
+		if (*idx >= digital_io_stimulus.words)
+		{
+			digital_io_stimulus.result |= DIGITAL_IO_STIMULUS_TRUNCATED;
+			return 0;
+		}
+		*ticks = digital_io_stimulus_buffer[(*idx)++];
+	}
+	return 1;
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
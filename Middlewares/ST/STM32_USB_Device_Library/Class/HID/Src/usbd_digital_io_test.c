@@ -0,0 +1,196 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_test.c
+  * @brief   This file provides the on-device interconnect test.
+  *
+  * @verbatim
+  *
+  *          ===================================================================
+  *                                Test Description
+  *          ===================================================================
+  *           Opens and shorts of a fixture harness are found with register
+  *           writes only, every step waits the settle time:
+  *             - pull-up and pull-down on all tested pins: pins which ignore
+  *               both pulls are stuck (driven from outside or shorted to a rail)
+  *             - walking one: one pin drives high, the others are pulled down
+  *             - walking zero: one pin drives low, the others are pulled up
+  *           A pin is connected to the driving pin when it follows both
+  *           patterns, this gives one row of the connectivity matrix.
+  *           Only the tested pins are restored after the test, the other
+  *           pins of the banks (TRIGGER_OUT) keep what the interrupts wrote.
+  *           The test is refused while a capture, a stimulus or a bus batch
+  *           uses the pins.
+  *
+  *  @endverbatim
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_digital_io_test.h"
+#include "gpio.h"
+#include "usbd_digital_io_capture.h"
+#include "usbd_digital_io_bus.h"
+#include "usbd_digital_io_stimulus.h"
+
+/* Global variables */
+DIGITAL_IO_TEST_TypeDef digital_io_test;
+
+/* Private functions */
+static uint32_t USBD_HID_Digital_IO_Test_Sample(void);
+
+/* Functions */
+
+/**
+  * @brief  USBD_HID_Digital_IO_Test_Process_Command
+  *         Store the pins and the settle time of an interconnect test request.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Test_Process_Command(uint8_t* output_buff)
+{
+	/* PROTOCOL:
+	 * COMMAND_INTERCONNECT_TEST: 5 bytes (executed in the main loop)
+	 * Byte[0-2]	-> logical bits of the tested pins (little endian), only these pins are driven
+	 * Byte[3-4]	-> settle time after every pin change in us (0 = default)
+	 *
+	 * Result: REPORT_INTERCONNECT, the matrix is read with COMMAND_DOWNLOAD (UPLOAD_INTERCONNECT).
+	 */
+	digital_io_test.mask = (output_buff[0] | ((uint32_t)output_buff[1] << 8) | ((uint32_t)output_buff[2] << 16)) & DIGITAL_IO_ALL_BITS;
+	digital_io_test.settle = output_buff[3] | ((uint16_t)output_buff[4] << 8);
+	if (digital_io_test.settle == 0 || digital_io_test.settle > DIGITAL_IO_TEST_MAX_SETTLE)
+	{
+		digital_io_test.settle = DIGITAL_IO_TEST_DEFAULT_SETTLE;
+	}
+	digital_io_test.request = 1;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Test_Run
+  *         Run the requested interconnect test and queue the result report (main loop).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Test_Run(void)
+{
+	uint32_t saved[GPIO_DIGITAL_SAVED_SIZE];
+	uint32_t mask = digital_io_test.mask, bit = 0, up = 0, down = 0, high = 0, low = 0;
+	uint8_t report[DIGITAL_IO_REPORT_SIZE] = {0};
+	uint8_t bit_idx = 0, num = 0;
+
+	digital_io_test.request = 0;
+
+	// The pins are in use
+	if (digital_io_capture.state != CAPTURE_IDLE || digital_io_stimulus.state != STIMULUS_IDLE || digital_io_bus.state != BUS_IDLE)
+	{
+		report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_INTERCONNECT;
+		report[10] = DIGITAL_IO_TEST_REFUSED;
+		USBD_HID_Digital_IO_Queue_Report(REPORT_CLASS_ACK, report);
+		return;
+	}
+
+	// Pin configuration before the test
+	GPIO_Save_Packed_DIGITAL_IO(saved);
+
+	// Pins which ignore the pulls
+	GPIO_Config_Packed_DIGITAL_IO(mask, GPIO_MODE_INPUT, GPIO_PULLUP);
+	up = USBD_HID_Digital_IO_Test_Sample();
+	GPIO_Config_Packed_DIGITAL_IO(mask, GPIO_MODE_INPUT, GPIO_PULLDOWN);
+	down = USBD_HID_Digital_IO_Test_Sample();
+	digital_io_test.stuck_high = up & down & mask;
+	digital_io_test.stuck_low = ~up & ~down & mask;
+	digital_io_test.connected = 0;
+
+	for (bit_idx = 0; bit_idx < DIGITAL_IO_MAX_BIT_NUM; bit_idx++)
+	{
+		bit = 1U << bit_idx;
+		digital_io_test.matrix[bit_idx] = 0;
+		if (!(mask & bit))
+		{
+			continue;
+		}
+		num++;
+
+		// Walking one against pull-downs
+		GPIO_Config_Packed_DIGITAL_IO(mask, GPIO_MODE_INPUT, GPIO_PULLDOWN);
+		GPIO_Write_Packed_DIGITAL_IO(bit, bit);
+		GPIO_Config_Packed_DIGITAL_IO(bit, GPIO_MODE_OUTPUT_PP, GPIO_NOPULL);
+		high = USBD_HID_Digital_IO_Test_Sample();
+
+		// Walking zero against pull-ups
+		GPIO_Config_Packed_DIGITAL_IO(mask, GPIO_MODE_INPUT, GPIO_PULLUP);
+		GPIO_Write_Packed_DIGITAL_IO(bit, 0);
+		GPIO_Config_Packed_DIGITAL_IO(bit, GPIO_MODE_OUTPUT_PP, GPIO_NOPULL);
+		low = USBD_HID_Digital_IO_Test_Sample();
+
+		// A driven pin which does not follow its own output is held by a stronger driver
+		if (!(high & bit))
+		{
+			digital_io_test.stuck_low |= bit;
+		}
+		if (low & bit)
+		{
+			digital_io_test.stuck_high |= bit;
+		}
+		digital_io_test.matrix[bit_idx] = high & ~low & mask & ~bit;
+		digital_io_test.connected |= digital_io_test.matrix[bit_idx];
+	}
+
+	// Restore the tested pins only, drop the edges of the test patterns
+	GPIO_Restore_Packed_DIGITAL_IO(mask, saved);
+	USBD_HID_Digital_IO_Test_Sample();
+	GPIO_Read_Edges_DIGITAL_IO();
+	DIGITAL_IO_CTX_SAMPLE = GPIO_Read_Packed_DIGITAL_IO();
+
+	/* PROTOCOL:
+	 * Output: 11 bytes
+	 * Byte[0]		-> 0x80 | REPORT_INTERCONNECT
+	 * Byte[1-3]	-> pins connected to at least one other tested pin
+	 * Byte[4-6]	-> pins stuck high (ignore the pull-down or the own low output)
+	 * Byte[7-9]	-> pins stuck low (ignore the pull-up or the own high output)
+	 * Byte[10]		-> number of tested pins, DIGITAL_IO_TEST_REFUSED = not run (capture, stimulus or bus active)
+	 * Tested pins in none of the masks are open.
+	 */
+	report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_INTERCONNECT;
+	report[1] = (uint8_t)(digital_io_test.connected);
+	report[2] = (uint8_t)(digital_io_test.connected >> 8);
+	report[3] = (uint8_t)(digital_io_test.connected >> 16);
+	report[4] = (uint8_t)(digital_io_test.stuck_high);
+	report[5] = (uint8_t)(digital_io_test.stuck_high >> 8);
+	report[6] = (uint8_t)(digital_io_test.stuck_high >> 16);
+	report[7] = (uint8_t)(digital_io_test.stuck_low);
+	report[8] = (uint8_t)(digital_io_test.stuck_low >> 8);
+	report[9] = (uint8_t)(digital_io_test.stuck_low >> 16);
+	report[10] = num;
+	USBD_HID_Digital_IO_Queue_Report(REPORT_CLASS_ACK, report);
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Test_Sample
+  *         Wait the settle time and read all pins.
+  * @retval Packed logical sample
+  */
+static uint32_t USBD_HID_Digital_IO_Test_Sample(void)
+{
+	uint32_t start = DIGITAL_IO_TIMESTAMP(), cycles = (SystemCoreClock / 1000000U) * digital_io_test.settle;
+
+	while ((DIGITAL_IO_TIMESTAMP() - start) < cycles);
+	return GPIO_Read_Packed_DIGITAL_IO();
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,298 @@
+/**
+  ******************************************************************************
+  * @file    usbd_digital_io_watch.c
+  * @brief   This file provides the edge timestamp log of watched pins.
+  *
+  * @verbatim
+  *
+  *          ===================================================================
+  *                                Watch Description
+  *          ===================================================================
+  *           Every EXTI line selects one bank (PB0/PC0, PB1/PC1, ... share a line).
+  *           The watched pins get their lines first (GPIO_Edge_Setup_DIGITAL_IO):
+  *             - watched pins with a line: the EXTI interrupt timestamps every
+  *               edge with the cycle counter and the level read in the interrupt
+  *             - watched pins without a line: the main loop compares the samples
+  *               and records the changes with the poll time (POLLED flag)
+  *           The allocation is reported after every watch command and remap.
+  *           The records go through a ring (the interrupt is the only producer
+  *           of the lined pins, the polled records are written with masked
+  *           interrupts) into the IN reports.
+  *           While watching, the EXTI interrupt also clears the edge latches of
+  *           its vectors and hands them to USBD_HID_Digital_IO_Read.
+  *
+  *  @endverbatim
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT 2015 STMicroelectronics</center></h2>
+  *
+  * Licensed under MCD-ST Liberty SW License Agreement V2, (the "License");
+  * You may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at:
+  *
+  *        http://www.st.com/software_license_agreement_liberty_v2
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_digital_io_watch.h"
+#include "usbd_digital_io_fabric.h"
+#include "gpio.h"
+
+/* Global variables */
+DIGITAL_IO_WATCH_TypeDef digital_io_watch;
+uint32_t digital_io_watch_ring[DIGITAL_IO_WATCH_RING_SIZE][2];
+
+/* Private functions */
+static void USBD_HID_Digital_IO_Watch_Push(uint32_t timestamp, uint8_t code);
+static void USBD_HID_Digital_IO_Watch_NVIC(uint32_t lines);
+
+/* Functions */
+
+/**
+  * @brief  USBD_HID_Digital_IO_Watch_Process_Command
+  *         Store the pins to watch.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Watch_Process_Command(uint8_t* output_buff)
+{
+	/* PROTOCOL:
+	 * COMMAND_WATCH: 3 bytes (executed in the main loop)
+	 * Byte[0-2]	-> watched logical bits (little endian, 0 = stop watching)
+	 *
+	 * Result: REPORT_WATCH_ALLOC, then REPORT_WATCH records while watching.
+	 */
+	digital_io_watch.mask_new = (output_buff[0] | ((uint32_t)output_buff[1] << 8) | ((uint32_t)output_buff[2] << 16)) & DIGITAL_IO_ALL_BITS;
+	digital_io_watch.request = 1;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Watch_Handle
+  *         Allocate the EXTI lines to the watched pins and report the allocation (main loop).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Watch_Handle(void)
+{
+	uint8_t report[DIGITAL_IO_REPORT_SIZE] = {0};
+	uint32_t primask = __get_PRIMASK();
+	uint8_t line = 0;
+
+	digital_io_watch.request = 0;
+
+	// New allocation: no interrupt while the lines move
+	USBD_HID_Digital_IO_Watch_NVIC(0);
+	digital_io_watch.mask = digital_io_watch.mask_new;
+	gpio_digital_edge_watch = digital_io_watch.mask;
+	GPIO_Edge_Setup_DIGITAL_IO();
+
+	digital_io_watch.lined = 0;
+	for (line = 0; line < GPIO_DIGITAL_EDGE_LINE_NUM; line++)
+	{
+		if (gpio_digital_edge_line[line] != GPIO_DIGITAL_EDGE_NO_BIT)
+		{
+			digital_io_watch.lined |= (1UL << gpio_digital_edge_line[line]) & digital_io_watch.mask;
+		}
+	}
+	digital_io_watch.polled = digital_io_watch.mask & ~digital_io_watch.lined;
+	digital_io_watch.last_sample = GPIO_Read_Packed_DIGITAL_IO();
+
+	__disable_irq();
+	digital_io_watch.head = 0;
+	digital_io_watch.tail = 0;
+	digital_io_watch.lost = 0;
+	__set_PRIMASK(primask);
+
+	if (digital_io_watch.mask != 0)
+	{
+		USBD_HID_Digital_IO_Watch_NVIC(gpio_digital_edge_lines);
+	}
+
+	/* PROTOCOL:
+	 * Output: 11 bytes
+	 * Byte[0]		-> 0x80 | REPORT_WATCH_ALLOC
+	 * Byte[1-3]	-> watched pins with an EXTI line (edge timestamps)
+	 * Byte[4-6]	-> watched pins without a line (main loop polling)
+	 */
+	report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_WATCH_ALLOC;
+	report[1] = (uint8_t)(digital_io_watch.lined);
+	report[2] = (uint8_t)(digital_io_watch.lined >> 8);
+	report[3] = (uint8_t)(digital_io_watch.lined >> 16);
+	report[4] = (uint8_t)(digital_io_watch.polled);
+	report[5] = (uint8_t)(digital_io_watch.polled >> 8);
+	report[6] = (uint8_t)(digital_io_watch.polled >> 16);
+	USBD_HID_Digital_IO_Queue_Report(REPORT_CLASS_ACK, report);
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Watch_IRQ
+  *         Timestamp the pending edges of the EXTI lines (EXTI interrupts).
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Watch_IRQ(void)
+{
+	uint32_t timestamp = DIGITAL_IO_TIMESTAMP();
+	// TRIGGER_IN shares EXTI15_10: cleared as well unless the trigger bus reads it
+	uint32_t pending = EXTI->PR & (gpio_digital_edge_lines | ((digital_io_fabric.mode == FABRIC_OFF) ? GPIO_DIGITAL_EDGE_RESERVED : 0));
+	uint32_t sample = GPIO_Read_Packed_DIGITAL_IO(), bits = 0;
+	uint8_t bit_idx = 0;
+
+	EXTI->PR = pending;
+	bits = gpio_digital_edge_gather[0][GPIO_DIGITAL_LANE(pending, 0)] | gpio_digital_edge_gather[1][GPIO_DIGITAL_LANE(pending, 1)];
+
+	// The exception clears the exclusive monitor of USBD_HID_Digital_IO_Watch_Take_Edges
+	digital_io_watch.edges |= bits;
+
+	bits &= digital_io_watch.lined;
+	while (bits != 0)
+	{
+		bit_idx = __CLZ(__RBIT(bits));
+		USBD_HID_Digital_IO_Watch_Push(timestamp, bit_idx | (((sample >> bit_idx) & 0x01U) ? DIGITAL_IO_WATCH_LEVEL : 0));
+		bits &= bits - 1U;
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Watch_Poll
+  *         Record the edges of the watched pins without an EXTI line.
+  * @retval None
+  */
+void USBD_HID_Digital_IO_Watch_Poll(uint32_t sample)
+{
+	uint32_t timestamp = DIGITAL_IO_TIMESTAMP(), bits = (sample ^ digital_io_watch.last_sample) & digital_io_watch.polled;
+	uint32_t primask = 0;
+	uint8_t bit_idx = 0;
+
+	digital_io_watch.last_sample = sample;
+	while (bits != 0)
+	{
+		bit_idx = __CLZ(__RBIT(bits));
+		// Second producer of the ring: keep the EXTI interrupt out of the push
+		primask = __get_PRIMASK();
+		__disable_irq();
+		USBD_HID_Digital_IO_Watch_Push(timestamp, bit_idx | DIGITAL_IO_WATCH_POLLED | (((sample >> bit_idx) & 0x01U) ? DIGITAL_IO_WATCH_LEVEL : 0));
+		__set_PRIMASK(primask);
+		bits &= bits - 1U;
+	}
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Watch_Report
+  *         Create the next edge record report.
+  * @retval 1 if a report was created, 0 if the ring is empty
+  */
+uint8_t USBD_HID_Digital_IO_Watch_Report(uint8_t* report)
+{
+	/* PROTOCOL:
+	 * Output: 11 bytes
+	 * Byte[0]		-> 0x80 | REPORT_WATCH
+	 * Byte[1]		-> (L | P | BBBBBB) -> BBBBBB = logical bit, L = level after the edge, P = polled
+	 * Byte[2-5]	-> timestamp of the edge (CPU cycles, little endian)
+	 * Byte[6]		-> second record (0xFF = none)
+	 * Byte[7-10]	-> timestamp of the second record
+	 */
+	uint16_t tail = digital_io_watch.tail;
+	uint8_t rec_idx = 0;
+
+	if (tail == digital_io_watch.head)
+	{
+		return 0;
+	}
+
+	report[0] = DIGITAL_IO_REPORT_EXTENDED | REPORT_WATCH;
+	for (rec_idx = 0; rec_idx < 2; rec_idx++)
+	{
+		if (tail == digital_io_watch.head)
+		{
+			report[1 + rec_idx * 5] = DIGITAL_IO_WATCH_NO_RECORD;
+			write_uint32(&report[2 + rec_idx * 5], 0);
+			continue;
+		}
+		report[1 + rec_idx * 5] = (uint8_t)digital_io_watch_ring[tail][1];
+		write_uint32(&report[2 + rec_idx * 5], digital_io_watch_ring[tail][0]);
+		tail = (tail + 1) % DIGITAL_IO_WATCH_RING_SIZE;
+	}
+	digital_io_watch.tail = tail;
+	return 1;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Watch_Take_Edges
+  *         Read and clear the edges of the lines served by the EXTI interrupt.
+  * @retval Logical bits with at least one edge since the previous call
+  */
+uint32_t USBD_HID_Digital_IO_Watch_Take_Edges(void)
+{
+	uint32_t edges = 0;
+
+	// The EXTI interrupt may set new bits in between: exclusive access retries the exchange
+	do
+	{
+		edges = __LDREXW(&digital_io_watch.edges);
+	} while (__STREXW(0, &digital_io_watch.edges));
+
+	return edges;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Watch_Push
+  *         Store an edge record, the head moves after the record is complete.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Watch_Push(uint32_t timestamp, uint8_t code)
+{
+	uint16_t head = digital_io_watch.head, next = (head + 1) % DIGITAL_IO_WATCH_RING_SIZE;
+
+	if (next == digital_io_watch.tail)
+	{
+		digital_io_watch.lost++;
+		return;
+	}
+	digital_io_watch_ring[head][0] = timestamp;
+	digital_io_watch_ring[head][1] = code;
+	__DMB();
+	digital_io_watch.head = next;
+}
+
+/**
+  * @brief  USBD_HID_Digital_IO_Watch_NVIC
+  *         Enable the EXTI interrupt vectors of the given lines, disable the others.
+  * @retval None
+  */
+static void USBD_HID_Digital_IO_Watch_NVIC(uint32_t lines)
+{
+	static const IRQn_Type vector[GPIO_DIGITAL_EDGE_LINE_NUM] = {
+		EXTI0_IRQn, EXTI1_IRQn, EXTI2_IRQn, EXTI3_IRQn, EXTI4_IRQn,
+		EXTI9_5_IRQn, EXTI9_5_IRQn, EXTI9_5_IRQn, EXTI9_5_IRQn, EXTI9_5_IRQn,
+		EXTI15_10_IRQn, EXTI15_10_IRQn, EXTI15_10_IRQn, EXTI15_10_IRQn, EXTI15_10_IRQn, EXTI15_10_IRQn
+	};
+	uint8_t line = 0;
+
+	// The trigger bus keeps the vector of TRIGGER_IN
+	if (digital_io_fabric.mode != FABRIC_OFF)
+	{
+		lines |= GPIO_DIGITAL_EDGE_RESERVED;
+	}
+	for (line = 0; line < GPIO_DIGITAL_EDGE_LINE_NUM; line++)
+	{
+		HAL_NVIC_DisableIRQ(vector[line]);
+	}
+	for (line = 0; line < GPIO_DIGITAL_EDGE_LINE_NUM; line++)
+	{
+		if (lines & (1UL << line))
+		{
+			HAL_NVIC_SetPriority(vector[line], 0, 0);
+			HAL_NVIC_EnableIRQ(vector[line]);
+		}
+	}
+}
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -78,6 +78,35 @@
  	{PORT_4_PIN_0_GPIO_Port, PORT_4_PIN_1_GPIO_Port, PORT_4_PIN_2_GPIO_Port, PORT_4_PIN_3_GPIO_Port},
  	{PORT_5_PIN_0_GPIO_Port, PORT_5_PIN_1_GPIO_Port, PORT_5_PIN_2_GPIO_Port, PORT_5_PIN_3_GPIO_Port}
  };
+
+ // Banks which hold the digital IO pins (index order of the gather/scatter tables)
+ GPIO_TypeDef* gpio_digital_bank [GPIO_DIGITAL_BANK_NUM] = {GPIOA, GPIOB, GPIOC};
+
+ // Logical bit (port * 4 + pin) -> physical bit (index of gpio_digital_pin/gpio_digital_port)
+ uint8_t gpio_digital_remap [DIGITAL_IO_MAX_BIT_NUM] =
+ {
+ 	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+ 	12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23
+ };
+
+ // IDR byte lane -> logical bits (read side)
+ uint32_t gpio_digital_gather [GPIO_DIGITAL_BANK_NUM] [GPIO_DIGITAL_IDR_LANE_NUM] [GPIO_DIGITAL_LANE_SIZE];
+
+ // Logical byte lane -> BSRR bits of each bank (write side)
+ uint16_t gpio_digital_scatter [GPIO_DIGITAL_BIT_LANE_NUM] [GPIO_DIGITAL_LANE_SIZE] [GPIO_DIGITAL_BANK_NUM];
+
+ // Pins of a logical port in each bank (mode and pull setup)
+ uint16_t gpio_digital_bank_mask [DIGITAL_MAX_PORT_NUM] [GPIO_DIGITAL_BANK_NUM];
+
+// EXTI line -> logical bit latched by the line (GPIO_DIGITAL_EDGE_NO_BIT if unused)
+uint8_t gpio_digital_edge_line [GPIO_DIGITAL_EDGE_LINE_NUM];
+uint32_t gpio_digital_edge_lines = 0;
+
+// Logical bits served first by the line allocation (watched pins)
+uint32_t gpio_digital_edge_watch = 0;
+
+// EXTI pending byte lane -> logical bits
+uint32_t gpio_digital_edge_gather [GPIO_DIGITAL_IDR_LANE_NUM] [GPIO_DIGITAL_LANE_SIZE];
 /* USER CODE END 1 */
 
 /** Configure pins as 
@@ -164,15 +193,367 @@ void MX_GPIO_Init(void)
 /* USER CODE BEGIN 2 */
 uint8_t GPIO_Read_DIGITAL_IO(uint8_t port, uint8_t pin)
 {
-	//volatile uint8_t szam = HAL_GPIO_ReadPin(GPIOB,GPIO_PIN_13);
-	//volatile uint8_t szam2 = HAL_GPIO_ReadPin(GPIOC,GPIO_PIN_8);
-	return HAL_GPIO_ReadPin(gpio_digital_port[port][pin],gpio_digital_pin[port][pin]);
-	//return szam2 + szam;
+	uint8_t phys = gpio_digital_remap[DIGITAL_IO_BIT(port, pin)];
+	return HAL_GPIO_ReadPin(gpio_digital_port[phys / DIGITAL_MAX_PIN_NUM][phys % DIGITAL_MAX_PIN_NUM],
+							gpio_digital_pin[phys / DIGITAL_MAX_PIN_NUM][phys % DIGITAL_MAX_PIN_NUM]);
 }
 
 void GPIO_Write_DIGITAL_IO(uint8_t port, uint8_t pin, GPIO_PinState value)
 {
-	HAL_GPIO_WritePin(gpio_digital_port[port][pin],gpio_digital_pin[port][pin], value);
+	uint8_t phys = gpio_digital_remap[DIGITAL_IO_BIT(port, pin)];
+	HAL_GPIO_WritePin(gpio_digital_port[phys / DIGITAL_MAX_PIN_NUM][phys % DIGITAL_MAX_PIN_NUM],
+					  gpio_digital_pin[phys / DIGITAL_MAX_PIN_NUM][phys % DIGITAL_MAX_PIN_NUM], value);
+}
+
+/**
+  * @brief  Store a new remap table and precompute the gather/scatter tables.
+  *         Reads and writes use only these tables afterwards, so the runtime
+  *         cost does not depend on the wiring of the adapter board.
+  * @param  remap: logical bit -> physical bit table, must pass USBD_HID_Digital_IO_Check_Remap
+  * @retval None
+  */
+void GPIO_Remap_DIGITAL_IO(const uint8_t* remap)
+{
+	uint8_t bank_idx = 0, lane_idx = 0, bit_idx = 0, pos = 0, phys = 0;
+	uint16_t value = 0, pin_mask = 0;
+	int8_t logical[GPIO_DIGITAL_BANK_NUM][16];
+
+	// Resolve the bank and IDR position of every logical bit
+	for (bank_idx = 0; bank_idx < GPIO_DIGITAL_BANK_NUM; bank_idx++)
+	{
+		for (pos = 0; pos < 16; pos++)
+		{
+			logical[bank_idx][pos] = -1;
+		}
+		for (bit_idx = 0; bit_idx < DIGITAL_MAX_PORT_NUM; bit_idx++)
+		{
+			gpio_digital_bank_mask[bit_idx][bank_idx] = 0;
+		}
+	}
+
+	for (bit_idx = 0; bit_idx < DIGITAL_IO_MAX_BIT_NUM; bit_idx++)
+	{
+		gpio_digital_remap[bit_idx] = remap[bit_idx];
+		phys = remap[bit_idx];
+		pin_mask = gpio_digital_pin[phys / DIGITAL_MAX_PIN_NUM][phys % DIGITAL_MAX_PIN_NUM];
+		for (bank_idx = 0; bank_idx < GPIO_DIGITAL_BANK_NUM; bank_idx++)
+		{
+			if (gpio_digital_bank[bank_idx] == gpio_digital_port[phys / DIGITAL_MAX_PIN_NUM][phys % DIGITAL_MAX_PIN_NUM])
+			{
+				break;
+			}
+		}
+		for (pos = 0; (pin_mask >> pos) != 1U; pos++);
+		logical[bank_idx][pos] = bit_idx;
+		gpio_digital_bank_mask[bit_idx / DIGITAL_MAX_PIN_NUM][bank_idx] |= pin_mask;
+	}
+
+	// Gather: every IDR byte value -> logical bits
+	for (bank_idx = 0; bank_idx < GPIO_DIGITAL_BANK_NUM; bank_idx++)
+	{
+		for (lane_idx = 0; lane_idx < GPIO_DIGITAL_IDR_LANE_NUM; lane_idx++)
+		{
+			for (value = 0; value < GPIO_DIGITAL_LANE_SIZE; value++)
+			{
+				gpio_digital_gather[bank_idx][lane_idx][value] = 0;
+				for (pos = 0; pos < 8; pos++)
+				{
+					if ((value & (1U << pos)) && logical[bank_idx][lane_idx * 8 + pos] >= 0)
+					{
+						gpio_digital_gather[bank_idx][lane_idx][value] |= (1UL << logical[bank_idx][lane_idx * 8 + pos]);
+					}
+				}
+			}
+		}
+	}
+
+	// Scatter: every logical byte value -> pin bits of each bank
+	for (lane_idx = 0; lane_idx < GPIO_DIGITAL_BIT_LANE_NUM; lane_idx++)
+	{
+		for (value = 0; value < GPIO_DIGITAL_LANE_SIZE; value++)
+		{
+			for (bank_idx = 0; bank_idx < GPIO_DIGITAL_BANK_NUM; bank_idx++)
+			{
+				gpio_digital_scatter[lane_idx][value][bank_idx] = 0;
+			}
+			for (pos = 0; pos < 8; pos++)
+			{
+				if (value & (1U << pos))
+				{
+					phys = remap[lane_idx * 8 + pos];
+					for (bank_idx = 0; bank_idx < GPIO_DIGITAL_BANK_NUM; bank_idx++)
+					{
+						if (gpio_digital_bank[bank_idx] == gpio_digital_port[phys / DIGITAL_MAX_PIN_NUM][phys % DIGITAL_MAX_PIN_NUM])
+						{
+							gpio_digital_scatter[lane_idx][value][bank_idx] |= gpio_digital_pin[phys / DIGITAL_MAX_PIN_NUM][phys % DIGITAL_MAX_PIN_NUM];
+						}
+					}
+				}
+			}
+		}
+	}
+
+	GPIO_Edge_Setup_DIGITAL_IO();
+}
+
+/**
+  * @brief  Assign the free EXTI lines to the digital IO pins as edge latches.
+  *         A line can select only one bank, the watched pins (gpio_digital_edge_watch)
+  *         get their lines first, then the first logical bit wins when more pins
+  *         share a pin number; the others are seen by sampling only.
+  * @retval None
+  */
+void GPIO_Edge_Setup_DIGITAL_IO(void)
+{
+	uint8_t line = 0, bit_idx = 0, lane_idx = 0, pos = 0, phys = 0, pass = 0;
+	uint16_t value = 0;
+	uint32_t lines = 0;
+	GPIO_TypeDef* bank = NULL;
+
+	// Release the lines of the previous wiring
+	EXTI->IMR &= ~gpio_digital_edge_lines;
+	EXTI->RTSR &= ~gpio_digital_edge_lines;
+	EXTI->FTSR &= ~gpio_digital_edge_lines;
+	EXTI->PR = gpio_digital_edge_lines;
+
+	for (line = 0; line < GPIO_DIGITAL_EDGE_LINE_NUM; line++)
+	{
+		gpio_digital_edge_line[line] = GPIO_DIGITAL_EDGE_NO_BIT;
+	}
+
+	// Pass 0: watched pins, pass 1: all other pins
+	for (pass = 0; pass < 2; pass++)
+	{
+		for (bit_idx = 0; bit_idx < DIGITAL_IO_MAX_BIT_NUM; bit_idx++)
+		{
+			if (((gpio_digital_edge_watch >> bit_idx) & 0x01U) == pass)
+			{
+				continue;
+			}
+			phys = gpio_digital_remap[bit_idx];
+			for (line = 0; (gpio_digital_pin[phys / DIGITAL_MAX_PIN_NUM][phys % DIGITAL_MAX_PIN_NUM] >> line) != 1U; line++);
+			if ((lines & (1UL << line)) || (GPIO_DIGITAL_EDGE_RESERVED & (1UL << line)))
+			{
+				continue;
+			}
+			bank = gpio_digital_port[phys / DIGITAL_MAX_PIN_NUM][phys % DIGITAL_MAX_PIN_NUM];
+			gpio_digital_edge_line[line] = bit_idx;
+			lines |= (1UL << line);
+
+			// Both edges, the NVIC vectors are enabled only while pins are watched
+			SYSCFG->EXTICR[line >> 2U] = (SYSCFG->EXTICR[line >> 2U] & ~(0x0FUL << (4U * (line & 0x03U))))
+									   | ((uint32_t)GPIO_GET_INDEX(bank) << (4U * (line & 0x03U)));
+		}
+	}
+
+	for (lane_idx = 0; lane_idx < GPIO_DIGITAL_IDR_LANE_NUM; lane_idx++)
+	{
+		for (value = 0; value < GPIO_DIGITAL_LANE_SIZE; value++)
+		{
+			gpio_digital_edge_gather[lane_idx][value] = 0;
+			for (pos = 0; pos < 8; pos++)
+			{
+				if ((value & (1U << pos)) && gpio_digital_edge_line[lane_idx * 8 + pos] != GPIO_DIGITAL_EDGE_NO_BIT)
+				{
+					gpio_digital_edge_gather[lane_idx][value] |= (1UL << gpio_digital_edge_line[lane_idx * 8 + pos]);
+				}
+			}
+		}
+	}
+
+	EXTI->RTSR |= lines;
+	EXTI->FTSR |= lines;
+	EXTI->PR = lines;
+	EXTI->IMR |= lines;
+	gpio_digital_edge_lines = lines;
+}
+
+/**
+  * @brief  Configure mode and pull of every pin of a logical port.
+  *         A remapped port can spread over more banks, one init call per bank.
+  * @retval None
+  */
+void GPIO_Setup_DIGITAL_IO(uint8_t port, uint32_t mode, uint32_t pull)
+{
+	GPIO_InitTypeDef GPIO_InitStruct;
+	uint8_t bank_idx = 0;
+
+	for (bank_idx = 0; bank_idx < GPIO_DIGITAL_BANK_NUM; bank_idx++)
+	{
+		if (gpio_digital_bank_mask[port][bank_idx] != 0)
+		{
+			GPIO_InitStruct.Pin = gpio_digital_bank_mask[port][bank_idx];
+			GPIO_InitStruct.Mode = mode;
+			GPIO_InitStruct.Pull = pull;
+			GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+			HAL_GPIO_Init(gpio_digital_bank[bank_idx], &GPIO_InitStruct);
+		}
+	}
+}
+
+/**
+  * @brief  Read every digital IO pin at once.
+  * @retval Packed logical sample, bit (port * 4 + pin)
+  */
+uint32_t GPIO_Read_Packed_DIGITAL_IO(void)
+{
+	return GPIO_Gather_DIGITAL_IO(GPIOA->IDR, GPIOB->IDR, GPIOC->IDR);
+}
+
+/**
+  * @brief  Take back-to-back snapshots of every digital IO pin.
+  *         The IDR registers are read first and converted afterwards, so the
+  *         snapshots are only a few bus cycles apart.
+  * @param  samples: destination of the packed samples
+  * @param  num: number of snapshots (max. DIGITAL_IO_MAX_OVERSAMPLING)
+  * @retval None
+  */
+void GPIO_Snapshot_DIGITAL_IO(uint32_t* samples, uint8_t num)
+{
+	uint16_t idr[DIGITAL_IO_MAX_OVERSAMPLING][GPIO_DIGITAL_BANK_NUM];
+	uint8_t idx = 0;
+
+	for (idx = 0; idx < num; idx++)
+	{
+		idr[idx][0] = GPIOA->IDR;
+		idr[idx][1] = GPIOB->IDR;
+		idr[idx][2] = GPIOC->IDR;
+	}
+	for (idx = 0; idx < num; idx++)
+	{
+		samples[idx] = GPIO_Gather_DIGITAL_IO(idr[idx][0], idr[idx][1], idr[idx][2]);
+	}
+}
+
+/**
+  * @brief  Convert a write of logical bits to the BSRR word of each bank.
+  * @param  mask: logical bits to write
+  * @param  value: logical bit values
+  * @param  bsrr: destination, GPIO_DIGITAL_BANK_NUM words (0 = bank is not written)
+  * @retval None
+  */
+void GPIO_Compile_Packed_DIGITAL_IO(uint32_t mask, uint32_t value, uint32_t* bsrr)
+{
+	uint32_t set = value & mask, reset = ~value & mask;
+	uint8_t bank_idx = 0;
+
+	for (bank_idx = 0; bank_idx < GPIO_DIGITAL_BANK_NUM; bank_idx++)
+	{
+		bsrr[bank_idx] = gpio_digital_scatter[0][GPIO_DIGITAL_LANE(set, 0)][bank_idx]
+					   | gpio_digital_scatter[1][GPIO_DIGITAL_LANE(set, 1)][bank_idx]
+					   | gpio_digital_scatter[2][GPIO_DIGITAL_LANE(set, 2)][bank_idx];
+		bsrr[bank_idx] |= (uint32_t)(gpio_digital_scatter[0][GPIO_DIGITAL_LANE(reset, 0)][bank_idx]
+					   | gpio_digital_scatter[1][GPIO_DIGITAL_LANE(reset, 1)][bank_idx]
+					   | gpio_digital_scatter[2][GPIO_DIGITAL_LANE(reset, 2)][bank_idx]) << 16U;
+	}
+}
+
+/**
+  * @brief  Write the selected logical bits with one BSRR access per bank.
+  * @param  mask: logical bits to write
+  * @param  value: logical bit values
+  * @retval None
+  */
+void GPIO_Write_Packed_DIGITAL_IO(uint32_t mask, uint32_t value)
+{
+	uint32_t bsrr[GPIO_DIGITAL_BANK_NUM];
+	uint8_t bank_idx = 0;
+
+	GPIO_Compile_Packed_DIGITAL_IO(mask, value, bsrr);
+	for (bank_idx = 0; bank_idx < GPIO_DIGITAL_BANK_NUM; bank_idx++)
+	{
+		if (bsrr[bank_idx] != 0)
+		{
+			gpio_digital_bank[bank_idx]->BSRR = bsrr[bank_idx];
+		}
+	}
+}
+
+/**
+  * @brief  Change mode and pull of the selected logical bits with direct register writes.
+  * @param  mask: logical bits to change
+  * @param  mode: GPIO_MODE_INPUT or GPIO_MODE_OUTPUT_PP
+  * @param  pull: GPIO_NOPULL, GPIO_PULLUP or GPIO_PULLDOWN
+  * @retval None
+  */
+void GPIO_Config_Packed_DIGITAL_IO(uint32_t mask, uint32_t mode, uint32_t pull)
+{
+	uint32_t pins[GPIO_DIGITAL_BANK_NUM], field = 0;
+	uint8_t bank_idx = 0, pos = 0;
+
+	// Bank pin masks of the logical bits: set half of the compiled BSRR words
+	GPIO_Compile_Packed_DIGITAL_IO(mask, mask, pins);
+	for (bank_idx = 0; bank_idx < GPIO_DIGITAL_BANK_NUM; bank_idx++)
+	{
+		// Two bit fields of MODER and PUPDR
+		field = 0;
+		for (pos = 0; pos < 16; pos++)
+		{
+			if (pins[bank_idx] & (1U << pos))
+			{
+				field |= 0x03U << (pos * 2U);
+			}
+		}
+		if (field != 0)
+		{
+			gpio_digital_bank[bank_idx]->PUPDR = (gpio_digital_bank[bank_idx]->PUPDR & ~field) | ((pull * 0x55555555U) & field);
+			gpio_digital_bank[bank_idx]->MODER = (gpio_digital_bank[bank_idx]->MODER & ~field) | (((mode & 0x03U) * 0x55555555U) & field);
+		}
+	}
+}
+
+/**
+  * @brief  Save the MODER, PUPDR and ODR registers of the digital IO banks.
+  * @param  saved: GPIO_DIGITAL_SAVED_SIZE words
+  * @retval None
+  */
+void GPIO_Save_Packed_DIGITAL_IO(uint32_t* saved)
+{
+	uint8_t bank_idx = 0;
+
+	for (bank_idx = 0; bank_idx < GPIO_DIGITAL_BANK_NUM; bank_idx++)
+	{
+		saved[bank_idx * 3U] = gpio_digital_bank[bank_idx]->MODER;
+		saved[bank_idx * 3U + 1U] = gpio_digital_bank[bank_idx]->PUPDR;
+		saved[bank_idx * 3U + 2U] = gpio_digital_bank[bank_idx]->ODR;
+	}
+}
+
+/**
+  * @brief  Restore output level, pull and mode of the selected logical bits only.
+  * @param  mask: logical bits to restore
+  * @param  saved: registers of GPIO_Save_Packed_DIGITAL_IO
+  * @retval None
+  */
+void GPIO_Restore_Packed_DIGITAL_IO(uint32_t mask, const uint32_t* saved)
+{
+	uint32_t pins[GPIO_DIGITAL_BANK_NUM], field = 0, odr = 0, primask = 0;
+	uint8_t bank_idx = 0, pos = 0;
+
+	GPIO_Compile_Packed_DIGITAL_IO(mask, mask, pins);
+	for (bank_idx = 0; bank_idx < GPIO_DIGITAL_BANK_NUM; bank_idx++)
+	{
+		field = 0;
+		for (pos = 0; pos < 16; pos++)
+		{
+			if (pins[bank_idx] & (1U << pos))
+			{
+				field |= 0x03U << (pos * 2U);
+			}
+		}
+		if (field == 0)
+		{
+			continue;
+		}
+		// Level first, so a pin which was an output comes back with its old value
+		odr = saved[bank_idx * 3U + 2U];
+		gpio_digital_bank[bank_idx]->BSRR = (odr & pins[bank_idx]) | ((~odr & pins[bank_idx]) << 16);
+		primask = __get_PRIMASK();
+		__disable_irq();
+		gpio_digital_bank[bank_idx]->PUPDR = (gpio_digital_bank[bank_idx]->PUPDR & ~field) | (saved[bank_idx * 3U + 1U] & field);
+		gpio_digital_bank[bank_idx]->MODER = (gpio_digital_bank[bank_idx]->MODER & ~field) | (saved[bank_idx * 3U] & field);
+		__set_PRIMASK(primask);
+	}
 }
 
 void GPIO_Toggle_LED(void)
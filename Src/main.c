@@ -49,6 +49,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
 #include "stm32f4xx_hal.h"
+#include "dma.h"
 #include "tim.h"
 #include "usb_device.h"
 #include "gpio.h"
@@ -57,6 +58,18 @@
 #include "usbd_customhid.h"
 #include "usbd_custom_hid_if.h"
 #include "usbd_digital_io.h"
+#include "usbd_digital_io_capture.h"
+#include "usbd_digital_io_log.h"
+#include "usbd_digital_io_test.h"
+#include "usbd_digital_io_latency.h"
+#include "usbd_digital_io_bus.h"
+#include "usbd_digital_io_watch.h"
+#include "usbd_digital_io_decoder.h"
+#include "usbd_digital_io_group.h"
+#include "usbd_digital_io_jit.h"
+#include "usbd_digital_io_search.h"
+#include "usbd_digital_io_stimulus.h"
+#include "usbd_digital_io_fabric.h"
 /* USER CODE END Includes */
 
 /* Private variables ---------------------------------------------------------*/
@@ -79,7 +92,6 @@ void USB_RX_Interrupt(void);
 uint8_t input_report[11] = {1};
 uint8_t output_report[64] = {0};
 MAIN_STATE main_state = MAIN_STATE_NORMAL;
-uint8_t trig_event_to_delete = 0;
 /* USER CODE END 0 */
 
 /**
@@ -91,6 +103,9 @@ int main(void)
 {
   /* USER CODE BEGIN 1 */
 	uint8_t i = 0;
+	uint32_t trig_match = 0;
+	uint8_t* report = NULL;
+	uint16_t report_length = 0;
   /* USER CODE END 1 */
 
   /* MCU Configuration----------------------------------------------------------*/
@@ -111,20 +126,30 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_USB_DEVICE_Init();
   MX_TIM3_Init();
   MX_TIM9_Init();
+  MX_TIM1_Init();
 
   /* Initialize interrupts */
   MX_NVIC_Init();
   /* USER CODE BEGIN 2 */
-  USBD_HID_Digital_IO_Init(&digital_io);
-  USBD_HID_Digital_IO_Init(&digital_io_new_state);
+  USBD_HID_Digital_IO_Context_Init(DIGITAL_IO_CTX, NULL, NULL);
+  USBD_HID_Digital_IO_Timebase_Init();
+  DIGITAL_IO_HAL_REMAP(DIGITAL_IO_CTX_REMAP);
+  USBD_HID_Digital_IO_Capture_Init();
+  USBD_HID_Digital_IO_Decoder_Init();
+  USBD_HID_Digital_IO_Fabric_Init();
+  USBD_HID_Digital_IO_Init(&DIGITAL_IO_CTX_STATE);
+  USBD_HID_Digital_IO_Init(&DIGITAL_IO_CTX_NEW_STATE);
   USBD_HID_Digital_IO_Reset_SwitchTrig();
   for (i = 0; i < DIGITAL_IO_MAX_TRIG_NUM; i++)
   {
-	  USBD_HID_Digital_IO_Reset_Trigger_Event(&digital_io_trig_events[i]);
+	  USBD_HID_Digital_IO_Reset_Trigger_Event(&DIGITAL_IO_CTX_TRIG_EVENTS[i]);
+	  USBD_HID_Digital_IO_Reset_Trigger_Action(&DIGITAL_IO_CTX_TRIG_EVENTS[i]);
   }
+  USBD_HID_Digital_IO_Log_Init();
   HAL_TIM_Base_Start_IT(&htim3);
   /* USER CODE END 2 */
 
@@ -136,51 +161,172 @@ int main(void)
 	{
 		// Read GPIO pins and test trigger events
 		USBD_HID_Digital_IO_Read();
+		USBD_HID_Digital_IO_Log_Sample(DIGITAL_IO_CTX_SAMPLE, DIGITAL_IO_CTX_EDGE);
+		if (digital_io_watch.polled)
+		{
+			USBD_HID_Digital_IO_Watch_Poll(DIGITAL_IO_CTX_SAMPLE);
+		}
+		// The running capture feeds the decoders with every sample
+		if (digital_io_capture.state != CAPTURE_RUNNING)
+		{
+			USBD_HID_Digital_IO_Decoder_Sample(DIGITAL_IO_CTX_SAMPLE);
+		}
 
+		// Fired triggers react at once with their precompiled action (and disarm), actions may arm the next ones
+		trig_match = USBD_HID_Digital_IO_Jit_Evaluate(DIGITAL_IO_CTX_SAMPLE, DIGITAL_IO_CTX_EDGE);
 		for(i = 0; i < DIGITAL_IO_MAX_TRIG_NUM; i++)
 		{
-			if(digital_io_do_trigger != TRIGGERED)
+			if ((trig_match & (1UL << i)) && DIGITAL_IO_CTX_TRIG_EVENTS[i].armed)
+			{
+				USBD_HID_Digital_IO_Run_Trigger_Action(DIGITAL_IO_CTX_TRIG_EVENTS, i);
+			}
+		}
+
+		// Queue the bus edges as urgent reports, the state report and streamed data as bulk reports
+		if (USBD_HID_Digital_IO_Report_Count(REPORT_CLASS_URGENT) < DIGITAL_IO_EVENT_QUEUE_SIZE - 1 &&
+			USBD_HID_Digital_IO_Fabric_Report((uint8_t*)&input_report))
+		{
+			USBD_HID_Digital_IO_Queue_Report(REPORT_CLASS_URGENT, (uint8_t*)&input_report);
+		}
+		while (USBD_HID_Digital_IO_Report_Count(REPORT_CLASS_BULK) < DIGITAL_IO_BULK_FILL)
+		{
+			if (DIGITAL_IO_CTX_REPORT_FLAG == SEND_REPORT)
+			{
+			  USBD_HID_Digital_IO_CreateReport((uint8_t*)&input_report);
+			  USBD_HID_Digital_IO_Group_Latch(DIGITAL_IO_CTX_SAMPLE);
+			  DIGITAL_IO_CTX_REPORT_FLAG = NO_REPORT;
+			}
+			else if (!USBD_HID_Digital_IO_Group_Report((uint8_t*)&input_report) &&
+					 !USBD_HID_Digital_IO_Watch_Report((uint8_t*)&input_report) &&
+					 !USBD_HID_Digital_IO_Decoder_Report((uint8_t*)&input_report) &&
+					 !USBD_HID_Digital_IO_Search_Report((uint8_t*)&input_report) &&
+					 !(digital_io_capture.stream && USBD_HID_Digital_IO_Capture_Stream_Report((uint8_t*)&input_report)))
+			{
+				break;
+			}
+			USBD_HID_Digital_IO_Queue_Report(REPORT_CLASS_BULK, (uint8_t*)&input_report);
+		}
+
+		// Start the IN transfers while the endpoint is idle, the DataIn completion sends the following reports
+		__disable_irq();
+		if (((USBD_CUSTOM_HID_HandleTypeDef*)hUsbDeviceFS.pClassData)->state == CUSTOM_HID_IDLE)
+		{
+			report = USBD_HID_Digital_IO_Next_Report(&report_length);
+			if (report != NULL)
 			{
-				digital_io_do_trigger = USBD_HID_Digital_IO_Check_Trigger_Event(digital_io_trig_events, i);
-				if (digital_io_do_trigger == TRIGGERED)
-				{
-					trig_event_to_delete = i;
-				}
+			  USBD_CUSTOM_HID_SendReport(&hUsbDeviceFS, report, report_length);
 			}
 		}
+		if (USBD_HID_Digital_IO_Ack_Room())
+		{
+			USBD_CUSTOM_HID_ReceivePacket(&hUsbDeviceFS);
+		}
+		__enable_irq();
+
+		// Start or stop the timer/DMA capture
+		if (digital_io_capture.request != CAPTURE_NO_REQUEST)
+		{
+			USBD_HID_Digital_IO_Capture_Handle();
+		}
+
+		// Interconnect test of the fixture harness
+		if (digital_io_test.request)
+		{
+			USBD_HID_Digital_IO_Test_Run();
+		}
+
+		// Trigger bus mode
+		if (digital_io_fabric.request)
+		{
+			USBD_HID_Digital_IO_Fabric_Handle();
+		}
 
-		if(digital_io_do_trigger == TRIGGERED)
+		// EXTI line allocation of the watched pins
+		if (digital_io_watch.request)
 		{
-			HAL_GPIO_WritePin(TRIGGER_OUT_GPIO_Port, TRIGGER_OUT_Pin, GPIO_PIN_SET);
-			digital_io_do_trigger = DO_TRIGGER;
-			USBD_HID_Digital_IO_Reset_Trigger_Event(&digital_io_trig_events[trig_event_to_delete]);
+			USBD_HID_Digital_IO_Watch_Handle();
 		}
 
-		// Create and send digital IO report
-		if (digital_io_report_flag == SEND_REPORT)
+		// Pin group settings
+		if (digital_io_group.request)
 		{
-		  USBD_HID_Digital_IO_CreateReport((uint8_t*)&input_report);
-		  USBD_CUSTOM_HID_SendReport(&hUsbDeviceFS,(uint8_t*)&input_report, 11);
-		  digital_io_report_flag = NO_REPORT;
+			USBD_HID_Digital_IO_Group_Handle();
 		}
 
+		// Compile the changed triggers, benchmark on request
+		if (digital_io_jit.request)
+		{
+			USBD_HID_Digital_IO_Jit_Compile();
+		}
+		if (digital_io_jit.bench)
+		{
+			USBD_HID_Digital_IO_Jit_Bench();
+		}
+
+		// Pattern search over the stored capture records
+		if (digital_io_search.request != SEARCH_NO_REQUEST || digital_io_search.state != SEARCH_IDLE)
+		{
+			USBD_HID_Digital_IO_Search_Handle();
+		}
+
+		// Position decoder settings
+		if (digital_io_decoder.request)
+		{
+			USBD_HID_Digital_IO_Decoder_Handle();
+		}
+
+		// Stimulus to response latency runs
+		if (digital_io_latency.state != LATENCY_IDLE)
+		{
+			USBD_HID_Digital_IO_Latency_Handle();
+		}
+
+		// Batch of parallel bus cycles
+		if (digital_io_bus.state == BUS_RUN && !USBD_HID_Digital_IO_Upload_Pending(UPLOAD_BUS))
+		{
+			USBD_HID_Digital_IO_Bus_Run();
+		}
+
+		// Timed playback of an uploaded stimulus program
+		if (digital_io_stimulus.state == STIMULUS_RUN && !USBD_HID_Digital_IO_Upload_Pending(UPLOAD_STIMULUS))
+		{
+			USBD_HID_Digital_IO_Stimulus_Run();
+		}
+
+		// Program the black-box log into flash
+		USBD_HID_Digital_IO_Log_Handle();
+
 		// Store digital IO changes
-		if (digital_io_change_flag == CHANGED)
+		if (DIGITAL_IO_CTX_CHANGE_FLAG == CHANGED)
+		{
+			USBD_HID_Digital_IO_Init(&DIGITAL_IO_CTX_NEW_STATE);
+			USBD_HID_Digital_IO_Set_Changes(DIGITAL_IO_CTX_CHANGE_REPORT);
+			DIGITAL_IO_CTX_CHANGE_FLAG = UNCHANGED;
+			DIGITAL_IO_CTX_CHANGE_ENABLE = 1;
+		}
+
+		// Rebuild the pin tables after a new remap table
+		if (DIGITAL_IO_CTX_REMAP_FLAG == CHANGED)
 		{
-			USBD_HID_Digital_IO_Init(&digital_io_new_state);
-			USBD_HID_Digital_IO_Set_Changes(output_report);
-			digital_io_change_flag = UNCHANGED;
-			digital_io_change_enable = 1;
+			DIGITAL_IO_CTX_REMAP_FLAG = UNCHANGED;
+			USBD_HID_Digital_IO_Apply_Remap();
 		}
 
 		// Enforce settings of the pins
-		if (digital_io_trigger == TRIGGERED)
+		if (DIGITAL_IO_CTX_TRIGGER == TRIGGERED)
 		{
 			USBD_HID_Digital_IO_SwitchPorts();
-			USBD_HID_Digital_IO_Init(&digital_io_new_state);
+			USBD_HID_Digital_IO_Init(&DIGITAL_IO_CTX_NEW_STATE);
 			USBD_HID_Digital_IO_Reset_SwitchTrig();
-			digital_io_trigger = DONTCARE;
-			digital_io_change_enable = 0;
+			DIGITAL_IO_CTX_TRIGGER = DONTCARE;
+			DIGITAL_IO_CTX_CHANGE_ENABLE = 0;
+			// A trigger from the host gets its second ack with the time of the register writes
+			if (DIGITAL_IO_CTX_SWITCH_ACK.pending)
+			{
+				USBD_HID_Digital_IO_Ack(LENGTH_TRIGGER, DIGITAL_IO_CTX_SWITCH_ACK.sequence, ACK_APPLIED,
+						DIGITAL_IO_CTX_SWITCH_ACK.receive_tick, DIGITAL_IO_CTX_SWITCH_ACK.apply_tick);
+				DIGITAL_IO_CTX_SWITCH_ACK.pending = 0;
+			}
 		}
 	}
 	if (main_state == MAIN_STATE_SYNC)
@@ -268,8 +414,10 @@ static void MX_NVIC_Init(void)
 
 void USB_RX_Interrupt(void)
 {
-	uint8_t i;
+	uint8_t i, size = 0, sequence = 0, triggered = 0;
+	uint32_t receive_tick = DIGITAL_IO_TIMESTAMP();
 	HID_Digital_IO_Output length = LENGTH_NOTHING;
+	HID_Digital_IO_Ack_Status status = ACK_ACCEPTED;
 	USBD_CUSTOM_HID_HandleTypeDef *myusb=(USBD_CUSTOM_HID_HandleTypeDef *)hUsbDeviceFS.pClassData;
 
 	//Clear arr
@@ -278,11 +426,13 @@ void USB_RX_Interrupt(void)
 		output_report[i]=0;
 	}
 
-	// First byte contains numbers of datas in byte length
+	// First byte contains numbers of datas in byte length (or the command code)
 	length = myusb->Report_buf[0];
+	sequence = myusb->Report_buf[DIGITAL_IO_SEQUENCE_BYTE];
+	size = ((uint8_t)length >= COMMAND_FIRST) ? DIGITAL_IO_COMMAND_PAYLOAD_SIZE : length;
 
 	// Copy the output report
-	for( i = 0; i < length; i++ )
+	for( i = 0; i < size && i < (DIGITAL_IO_SEQUENCE_BYTE - 1); i++ )
 	{
 		output_report[i]=myusb->Report_buf[i+1];
 	}
@@ -293,27 +443,47 @@ void USB_RX_Interrupt(void)
 		case LENGTH_NOTHING:
 			break;
 		case LENGTH_TRIGGER_EVENT:
-			USBD_HID_Digital_IO_Process_Trigger_Event(output_report, digital_io_trig_events);
+			USBD_HID_Digital_IO_Process_Trigger_Event(output_report, DIGITAL_IO_CTX_TRIG_EVENTS);
 			break;
 		case LENGTH_TRIGGER:
-			// Defend to the multiple triggering
-			if (digital_io_change_enable)
+			// Defend to the multiple triggering, a switch already triggered by a trigger action is not applied for the host
+			if (DIGITAL_IO_CTX_CHANGE_ENABLE && DIGITAL_IO_CTX_TRIGGER != TRIGGERED)
 			{
 				USBD_HID_Digital_IO_Trigger(output_report);
+				triggered = (DIGITAL_IO_CTX_TRIGGER == TRIGGERED);
+			}
+			if (triggered)
+			{
+				DIGITAL_IO_CTX_SWITCH_ACK.sequence = sequence;
+				DIGITAL_IO_CTX_SWITCH_ACK.receive_tick = receive_tick;
+				DIGITAL_IO_CTX_SWITCH_ACK.pending = 1;
+			}
+			else
+			{
+				status = ACK_DROPPED;
 			}
 			break;
 		case LENGTH_SYNC:
 			// Handle sync method, disable other tasks
 			break;
 		case LENGTH_DIGITAL_IO:
-			digital_io_change_flag = CHANGED;
+			status = USBD_HID_Digital_IO_Store_Changes(output_report);
 			break;
 		case LENGTH_DATETIME:
 			// Handle date- and timestamp
 			break;
 		default:
+			if ((uint8_t)length >= COMMAND_FIRST)
+			{
+				status = USBD_HID_Digital_IO_Process_Command(length, output_report);
+			}
+			else
+			{
+				status = ACK_UNKNOWN;
+			}
 			break;
 	}
+	USBD_HID_Digital_IO_Ack(length, sequence, status, receive_tick, 0);
 
 	// Test answer
 	/*HAL_GPIO_WritePin(LD2_GPIO_Port, LD2_Pin, GPIO_PIN_RESET);
@@ -37,6 +37,8 @@
 
 /* USER CODE BEGIN 0 */
 #include "usbd_digital_io.h"
+#include "usbd_digital_io_watch.h"
+#include "usbd_digital_io_fabric.h"
 
 // Scheduler timer
 uint16_t scheduler_timer = 0;
@@ -45,6 +47,7 @@ uint8_t external_counter = 0;
 
 /* External variables --------------------------------------------------------*/
 extern PCD_HandleTypeDef hpcd_USB_OTG_FS;
+extern DMA_HandleTypeDef hdma_tim1_ch3;
 extern TIM_HandleTypeDef htim3;
 
 /******************************************************************************/
@@ -189,17 +192,17 @@ void SysTick_Handler(void)
 	scheduler_timer ++;
 	if (scheduler_timer > 10)
 	{
-	  digital_io_report_flag = SEND_REPORT;
+	  DIGITAL_IO_CTX_REPORT_FLAG = SEND_REPORT;
 	  scheduler_timer = 0;
 	}
-	if (digital_io_do_trigger == DO_TRIGGER)
+	if (DIGITAL_IO_CTX_DO_TRIGGER == DO_TRIGGER)
 	{
 		 trigger_timeout ++;
 		 if(trigger_timeout > 500)
 		 {
-			HAL_GPIO_WritePin(TRIGGER_OUT_GPIO_Port, TRIGGER_OUT_Pin, GPIO_PIN_RESET);
+			DIGITAL_IO_HAL_TRIGGER_OUT(DIGITAL_IO_TRIGGER_OUT_RELEASE);
 			trigger_timeout = 0;
-			digital_io_do_trigger = DONTCARE;
+			DIGITAL_IO_CTX_DO_TRIGGER = DONTCARE;
 		 }
 	}
 
@@ -213,6 +216,77 @@ void SysTick_Handler(void)
 /* please refer to the startup file (startup_stm32f4xx.s).                    */
 /******************************************************************************/
 
+/**
+* @brief This function handles EXTI line0 interrupt.
+*/
+void EXTI0_IRQHandler(void)
+{
+  /* USER CODE BEGIN EXTI0_IRQn 0 */
+  USBD_HID_Digital_IO_Watch_IRQ();
+  /* USER CODE END EXTI0_IRQn 0 */
+}
+
+/**
+* @brief This function handles EXTI line1 interrupt.
+*/
+void EXTI1_IRQHandler(void)
+{
+  /* USER CODE BEGIN EXTI1_IRQn 0 */
+  USBD_HID_Digital_IO_Watch_IRQ();
+  /* USER CODE END EXTI1_IRQn 0 */
+}
+
+/**
+* @brief This function handles EXTI line2 interrupt.
+*/
+void EXTI2_IRQHandler(void)
+{
+  /* USER CODE BEGIN EXTI2_IRQn 0 */
+  USBD_HID_Digital_IO_Watch_IRQ();
+  /* USER CODE END EXTI2_IRQn 0 */
+}
+
+/**
+* @brief This function handles EXTI line3 interrupt.
+*/
+void EXTI3_IRQHandler(void)
+{
+  /* USER CODE BEGIN EXTI3_IRQn 0 */
+  USBD_HID_Digital_IO_Watch_IRQ();
+  /* USER CODE END EXTI3_IRQn 0 */
+}
+
+/**
+* @brief This function handles EXTI line4 interrupt.
+*/
+void EXTI4_IRQHandler(void)
+{
+  /* USER CODE BEGIN EXTI4_IRQn 0 */
+  USBD_HID_Digital_IO_Watch_IRQ();
+  /* USER CODE END EXTI4_IRQn 0 */
+}
+
+/**
+* @brief This function handles EXTI line[9:5] interrupts.
+*/
+void EXTI9_5_IRQHandler(void)
+{
+  /* USER CODE BEGIN EXTI9_5_IRQn 0 */
+  USBD_HID_Digital_IO_Watch_IRQ();
+  /* USER CODE END EXTI9_5_IRQn 0 */
+}
+
+/**
+* @brief This function handles EXTI line[15:10] interrupts.
+*/
+void EXTI15_10_IRQHandler(void)
+{
+  /* USER CODE BEGIN EXTI15_10_IRQn 0 */
+  USBD_HID_Digital_IO_Fabric_IRQ();
+  USBD_HID_Digital_IO_Watch_IRQ();
+  /* USER CODE END EXTI15_10_IRQn 0 */
+}
+
 /**
 * @brief This function handles TIM3 global interrupt.
 */
@@ -231,6 +305,20 @@ void TIM3_IRQHandler(void)
   /* USER CODE END TIM3_IRQn 1 */
 }
 
+/**
+* @brief This function handles DMA2 stream6 global interrupt.
+*/
+void DMA2_Stream6_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA2_Stream6_IRQn 0 */
+
+  /* USER CODE END DMA2_Stream6_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_tim1_ch3);
+  /* USER CODE BEGIN DMA2_Stream6_IRQn 1 */
+
+  /* USER CODE END DMA2_Stream6_IRQn 1 */
+}
+
 /**
 * @brief This function handles USB On The Go FS global interrupt.
 */
@@ -51,6 +51,7 @@
 #include "usbd_custom_hid_if.h"
 
 /* USER CODE BEGIN INCLUDE */
+#include "usbd_digital_io.h"
 extern void USB_RX_Interrupt(void);
 /* USER CODE END INCLUDE */
 
@@ -133,7 +134,7 @@ __ALIGN_BEGIN static uint8_t CUSTOM_HID_ReportDesc_FS[USBD_CUSTOM_HID_REPORT_DES
 	0x81, 0x02,                    //   INPUT (Data,Var,Abs)
 	// 2. 10 byte data:
 	// - 3 byte IO values (xxxx|yyyy format)
-	// - 3 byte for date (year/month/day)
+	// - 3 byte edges since the previous report (xxxx|yyyy format)
 	// - 4 byte for time (hour/minute/second/sub second)
 	0x75, 0x08,                    //   REPORT_SIZE (8)
 	0x95, 0x0a,                    //   REPORT_COUNT (10)
@@ -142,12 +143,20 @@ __ALIGN_BEGIN static uint8_t CUSTOM_HID_ReportDesc_FS[USBD_CUSTOM_HID_REPORT_DES
 	0x81, 0x00,                    //   INPUT (Data,Ary,Abs)
 
 	// Output report
-	// Same as the input
+	// Same as the input, last byte: sequence number of the host
 	0x75, 0x08,                    //   REPORT_SIZE (8)
-	0x95, 0x0b,                    //   REPORT_COUNT (11)
+	0x95, 0x0c,                    //   REPORT_COUNT (12)
 	0x15, 0x00,                    //   LOGICAL_MINIMUM (0)
 	0x26, 0xff, 0x00,              //   LOGICAL_MAXIMUM (255)
 	0x91, 0x00,                    //   OUTPUT (Data,Ary,Abs)
+
+	// Feature report
+	// Bulk upload into the target selected by COMMAND_UPLOAD (up to 4096 bytes, the last one without padding)
+	0x75, 0x08,                    //   REPORT_SIZE (8)
+	0x96, 0x00, 0x10,              //   REPORT_COUNT (4096)
+	0x15, 0x00,                    //   LOGICAL_MINIMUM (0)
+	0x26, 0xff, 0x00,              //   LOGICAL_MAXIMUM (255)
+	0xb1, 0x02,                    //   FEATURE (Data,Var,Abs)
   /* USER CODE END 0 */
   0xC0    /*     END_COLLECTION	             */
 };
@@ -181,6 +190,10 @@ extern USBD_HandleTypeDef hUsbDeviceFS;
 static int8_t CUSTOM_HID_Init_FS(void);
 static int8_t CUSTOM_HID_DeInit_FS(void);
 static int8_t CUSTOM_HID_OutEvent_FS(uint8_t event_idx, uint8_t state);
+static uint8_t* CUSTOM_HID_FeatureBuffer_FS(uint16_t length);
+static int8_t CUSTOM_HID_FeatureEvent_FS(uint16_t length);
+static uint8_t* CUSTOM_HID_FeatureSend_FS(uint16_t* length);
+static uint8_t* CUSTOM_HID_InReady_FS(uint16_t* length);
 
 /**
   * @}
@@ -191,7 +204,11 @@ USBD_CUSTOM_HID_ItfTypeDef USBD_CustomHID_fops_FS =
   CUSTOM_HID_ReportDesc_FS,
   CUSTOM_HID_Init_FS,
   CUSTOM_HID_DeInit_FS,
-  CUSTOM_HID_OutEvent_FS
+  CUSTOM_HID_OutEvent_FS,
+  CUSTOM_HID_FeatureBuffer_FS,
+  CUSTOM_HID_FeatureEvent_FS,
+  CUSTOM_HID_FeatureSend_FS,
+  CUSTOM_HID_InReady_FS
 };
 
 /** @defgroup USBD_CUSTOM_HID_Private_Functions USBD_CUSTOM_HID_Private_Functions
@@ -233,6 +250,11 @@ static int8_t CUSTOM_HID_OutEvent_FS(uint8_t event_idx, uint8_t state)
 {
   /* USER CODE BEGIN 6 */
   USB_RX_Interrupt();
+  // Backpressure: the host retries the next output report until its ack fits the queue
+  if (!USBD_HID_Digital_IO_Ack_Room())
+  {
+    return (USBD_BUSY);
+  }
   return (USBD_OK);
   /* USER CODE END 6 */
 }
@@ -253,6 +275,53 @@ static int8_t USBD_CUSTOM_HID_SendReport_FS(uint8_t *report, uint16_t len)
 /* USER CODE END 7 */
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_IMPLEMENTATION */
+/**
+  * @brief  Destination of a feature report (SET_REPORT setup stage)
+  * @param  length: wLength of the control transfer
+  * @retval Position in the upload target, NULL to stall the request
+  */
+static uint8_t* CUSTOM_HID_FeatureBuffer_FS(uint16_t length)
+{
+  return USBD_HID_Digital_IO_Upload_Buffer(length);
+}
+
+/**
+  * @brief  Feature report received (end of the data stage)
+  * @param  length: received bytes
+  * @retval USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t CUSTOM_HID_FeatureEvent_FS(uint16_t length)
+{
+  USBD_HID_Digital_IO_Upload_Complete(length);
+  return (USBD_OK);
+}
+
+/**
+  * @brief  Source of a feature report (GET_REPORT setup stage)
+  * @param  length: wLength of the control transfer, set to the bytes to send
+  * @retval Send buffer, NULL to stall the request
+  */
+static uint8_t* CUSTOM_HID_FeatureSend_FS(uint16_t* length)
+{
+  return USBD_HID_Digital_IO_Download_Buffer(length);
+}
+
+/**
+  * @brief  Next input report after a completed IN transfer
+  * @param  length: set to the report length
+  * @retval Report buffer, NULL if no report is queued
+  */
+static uint8_t* CUSTOM_HID_InReady_FS(uint16_t* length)
+{
+  uint8_t* report = USBD_HID_Digital_IO_Next_Report(length);
+
+  // An ack left the queue: accept output reports again
+  if (USBD_HID_Digital_IO_Ack_Room())
+  {
+    USBD_CUSTOM_HID_ReceivePacket(&hUsbDeviceFS);
+  }
+  return report;
+}
 
 /* USER CODE END PRIVATE_FUNCTIONS_IMPLEMENTATION */
 /**
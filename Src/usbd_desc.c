@@ -103,6 +103,8 @@
 #define USB_SIZ_BOS_DESC            0x0C
 
 /* USER CODE BEGIN PRIVATE_DEFINES */
+// Serial number string: 12 hex digits of the 96 bit unique device ID (UTF-16)
+#define USB_SIZ_STRING_SERIAL       0x1A
 
 /* USER CODE END PRIVATE_DEFINES */
 
@@ -111,6 +113,42 @@
   */
 
 /* USER CODE BEGIN 0 */
+/* Serial number descriptor, every module enumerates with its own serial */
+static uint8_t USBD_StringSerial[USB_SIZ_STRING_SERIAL];
+
+/**
+  * @brief  Convert the low digits of a value to hex UTF-16 characters.
+  * @param  value: value to convert
+  * @param  pbuf: destination
+  * @param  len: number of digits
+  * @retval None
+  */
+static void IntToUnicode(uint32_t value, uint8_t *pbuf, uint8_t len)
+{
+  uint8_t idx = 0;
+
+  for (idx = 0; idx < len; idx++)
+  {
+    pbuf[2 * idx] = ((value >> 28) < 0x0A) ? ((value >> 28) + '0') : ((value >> 28) + 'A' - 10);
+    pbuf[2 * idx + 1] = 0;
+    value <<= 4;
+  }
+}
+
+/**
+  * @brief  Build the serial number descriptor from the unique device ID.
+  * @retval None
+  */
+static void Get_SerialNum(void)
+{
+  uint32_t serial0 = *(uint32_t *)(UID_BASE), serial1 = *(uint32_t *)(UID_BASE + 4U), serial2 = *(uint32_t *)(UID_BASE + 8U);
+
+  serial0 += serial2;
+  USBD_StringSerial[0] = USB_SIZ_STRING_SERIAL;
+  USBD_StringSerial[1] = USB_DESC_TYPE_STRING;
+  IntToUnicode(serial0, &USBD_StringSerial[2], 8);
+  IntToUnicode(serial1, &USBD_StringSerial[18], 4);
+}
 
 /* USER CODE END 0 */
 
@@ -327,15 +365,13 @@ uint8_t * USBD_FS_ManufacturerStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *l
   */
 uint8_t * USBD_FS_SerialStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
 {
-  if(speed == USBD_SPEED_HIGH)
-  {
-    USBD_GetString((uint8_t *)USBD_SERIALNUMBER_STRING_FS, USBD_StrDesc, length);
-  }
-  else
-  {
-    USBD_GetString((uint8_t *)USBD_SERIALNUMBER_STRING_FS, USBD_StrDesc, length);
-  }
-  return USBD_StrDesc;
+  /* USER CODE BEGIN SERIAL */
+  // Derived from the unique device ID: host tools can own and address each module
+  UNUSED(speed);
+  *length = USB_SIZ_STRING_SERIAL;
+  Get_SerialNum();
+  return USBD_StringSerial;
+  /* USER CODE END SERIAL */
 }
 
 /**